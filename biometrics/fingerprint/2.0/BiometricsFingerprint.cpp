@@ -15,6 +15,7 @@
  */
 #define LOG_TAG "android.hardware.biometrics.fingerprint@2.0-service"
 #define LOG_VERBOSE "android.hardware.biometrics.fingerprint@2.0-service"
+#define ATRACE_TAG ATRACE_TAG_HAL
 
 #include <hardware/hw_auth_token.h>
 
@@ -22,7 +23,17 @@
 #include <hardware/fingerprint.h>
 #include "BiometricsFingerprint.h"
 
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <errno.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 namespace android {
@@ -40,23 +51,83 @@ using RequestStatus =
 
 BiometricsFingerprint *BiometricsFingerprint::sInstance = nullptr;
 
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 BiometricsFingerprint::BiometricsFingerprint() : mClientCallback(nullptr), mDevice(nullptr) {
     sInstance = this; // keep track of the most recent instance
-    mDevice = openHal();
-    if (!mDevice) {
+    // Up before openHal(), the vendor HAL may notify as soon as it's registered
+    mMessageEvent = eventfd(0, EFD_CLOEXEC);
+    if (mMessageEvent < 0) {
+        ALOGE("Can't create callback dispatcher event: %s", strerror(errno));
+    } else {
+        mDispatchThread = std::thread(&BiometricsFingerprint::dispatchLoop, this);
+    }
+    // Vendor HALs load firmware and calibrate the sensor in open(), don't hold
+    // up service registration for it
+    mConstructedNs = nowNs();
+    mOpenThread = std::thread(&BiometricsFingerprint::openDevice, this);
+}
+
+void BiometricsFingerprint::openDevice() {
+    DeviceOpenTiming timing;
+    fingerprint_device_t* device = openHal(&timing);
+    if (!device) {
         ALOGE("Can't open HAL module");
     }
+    timing.readyNs = nowNs() - mConstructedNs;
+    ALOGI("Fingerprint device %s after %" PRId64 " ms", device ? "ready" : "failed",
+          timing.readyNs / 1000000);
+
+    std::lock_guard<std::mutex> lock(mDeviceMutex);
+    mDevice = device;
+    mOpenTiming = timing;
+    mDeviceOpenDone = true;
+    mDeviceReady.notify_all();
+}
+
+fingerprint_device_t* BiometricsFingerprint::waitForDevice() {
+    std::unique_lock<std::mutex> lock(mDeviceMutex);
+    if (!mDeviceOpenDone) {
+        int64_t startNs = nowNs();
+        bool done = mDeviceReady.wait_for(lock, kDeviceOpenTimeout,
+                                          [this] { return mDeviceOpenDone; });
+        int64_t waitedNs = nowNs() - startNs;
+        mDeviceWaiters++;
+        mDeviceMaxWaitNs = std::max(mDeviceMaxWaitNs, waitedNs);
+        if (!done) {
+            ALOGE("Fingerprint device still opening after %" PRId64 " ms", waitedNs / 1000000);
+            return nullptr;
+        }
+    }
+    return mDevice.load();
 }
 
 BiometricsFingerprint::~BiometricsFingerprint() {
     ALOGV("~BiometricsFingerprint()");
-    if (mDevice == nullptr) {
+    if (mOpenThread.joinable()) {
+        mOpenThread.join();
+    }
+    if (mDispatchThread.joinable()) {
+        mDispatchExit = true;
+        uint64_t one = 1;
+        if (write(mMessageEvent, &one, sizeof(one)) == sizeof(one)) {
+            mDispatchThread.join();
+            close(mMessageEvent);
+        } else {
+            mDispatchThread.detach();
+        }
+    }
+    fingerprint_device_t* device = mDevice.load();
+    if (device == nullptr) {
         ALOGE("No valid device");
         return;
     }
     int err;
-    if (0 != (err = mDevice->common.close(
-            reinterpret_cast<hw_device_t*>(mDevice)))) {
+    if (0 != (err = device->common.close(
+            reinterpret_cast<hw_device_t*>(device)))) {
         ALOGE("Can't close fingerprint module, error: %d", err);
         return;
     }
@@ -145,36 +216,48 @@ FingerprintAcquiredInfo BiometricsFingerprint::VendorAcquiredFilter(
 
 Return<uint64_t> BiometricsFingerprint::setNotify(
         const sp<IBiometricsFingerprintClientCallback>& clientCallback) {
+    // A zero token tells the framework the HAL isn't usable, it retries later
+    fingerprint_device_t* device = waitForDevice();
     std::lock_guard<std::mutex> lock(mClientCallbackMutex);
     mClientCallback = clientCallback;
     // This is here because HAL 2.1 doesn't have a way to propagate a
     // unique token for its driver. Subsequent versions should send a unique
     // token for each call to setNotify(). This is fine as long as there's only
     // one fingerprint device on the platform.
-    return reinterpret_cast<uint64_t>(mDevice);
+    return reinterpret_cast<uint64_t>(device);
 }
 
 Return<uint64_t> BiometricsFingerprint::preEnroll()  {
-    return mDevice->pre_enroll(mDevice);
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return 0;
+    return device->pre_enroll(device);
 }
 
 Return<RequestStatus> BiometricsFingerprint::enroll(const hidl_array<uint8_t, 69>& hat,
         uint32_t gid, uint32_t timeoutSec) {
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
     const hw_auth_token_t* authToken =
         reinterpret_cast<const hw_auth_token_t*>(hat.data());
-    return ErrorFilter(mDevice->enroll(mDevice, authToken, gid, timeoutSec));
+    return ErrorFilter(device->enroll(device, authToken, gid, timeoutSec));
 }
 
 Return<RequestStatus> BiometricsFingerprint::postEnroll() {
-    return ErrorFilter(mDevice->post_enroll(mDevice));
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
+    return ErrorFilter(device->post_enroll(device));
 }
 
 Return<uint64_t> BiometricsFingerprint::getAuthenticatorId() {
-    return mDevice->get_authenticator_id(mDevice);
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return 0;
+    return device->get_authenticator_id(device);
 }
 
 Return<RequestStatus> BiometricsFingerprint::cancel() {
-    return ErrorFilter(mDevice->cancel(mDevice));
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
+    return ErrorFilter(device->cancel(device));
 }
 
 #define MAX_FINGERPRINTS 100
@@ -183,15 +266,17 @@ typedef int (*enumerate_2_0)(struct fingerprint_device *dev, fingerprint_finger_
         uint32_t *max_size);
 
 Return<RequestStatus> BiometricsFingerprint::enumerate()  {
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
     fingerprint_finger_id_t results[MAX_FINGERPRINTS];
     uint32_t n = MAX_FINGERPRINTS;
-    enumerate_2_0 enumerate = (enumerate_2_0) mDevice->enumerate;
-    int ret = enumerate(mDevice, results, &n);
+    enumerate_2_0 enumerate = (enumerate_2_0) device->enumerate;
+    int ret = enumerate(device, results, &n);
 
     if (ret == 0 && mClientCallback != nullptr) {
         ALOGD("Got %d enumerated templates", n);
         for (uint32_t i = 0; i < n; i++) {
-            const uint64_t devId = reinterpret_cast<uint64_t>(mDevice);
+            const uint64_t devId = reinterpret_cast<uint64_t>(device);
             const auto& fp = results[i];
             ALOGD("onEnumerate(fid=%d, gid=%d)", fp.fid, fp.gid);
             if (!mClientCallback->onEnumerate(devId, fp.fid, fp.gid, n - i - 1).isOk()) {
@@ -204,7 +289,9 @@ Return<RequestStatus> BiometricsFingerprint::enumerate()  {
 }
 
 Return<RequestStatus> BiometricsFingerprint::remove(uint32_t gid, uint32_t fid) {
-    return ErrorFilter(mDevice->remove(mDevice, gid, fid));
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
+    return ErrorFilter(device->remove(device, gid, fid));
 }
 
 Return<RequestStatus> BiometricsFingerprint::setActiveGroup(uint32_t gid,
@@ -217,13 +304,99 @@ Return<RequestStatus> BiometricsFingerprint::setActiveGroup(uint32_t gid,
         return RequestStatus::SYS_EINVAL;
     }
 
-    return ErrorFilter(mDevice->set_active_group(mDevice, gid,
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
+    return ErrorFilter(device->set_active_group(device, gid,
                                                     storePath.c_str()));
 }
 
 Return<RequestStatus> BiometricsFingerprint::authenticate(uint64_t operationId,
         uint32_t gid) {
-    return ErrorFilter(mDevice->authenticate(mDevice, operationId, gid));
+    fingerprint_device_t* device = waitForDevice();
+    if (device == nullptr) return RequestStatus::SYS_UNKNOWN;
+    beginAuthSession();
+    int ret = device->authenticate(device, operationId, gid);
+    if (ret != 0) {
+        std::lock_guard<std::mutex> lock(mAuthAttemptMutex);
+        endAuthSessionLocked();
+    }
+    return ErrorFilter(ret);
+}
+
+static void dumpPercentiles(int fd, const char* name, std::vector<int64_t> samples) {
+    if (samples.empty()) {
+        dprintf(fd, "  %s: no samples\n", name);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](size_t p) {
+        return samples[(samples.size() - 1) * p / 100] / 1000000.0;
+    };
+    dprintf(fd, "  %s: p50 %.1f ms, p90 %.1f ms, p99 %.1f ms over %zu\n", name,
+            percentile(50), percentile(90), percentile(99), samples.size());
+}
+
+Return<void> BiometricsFingerprint::debug(const hidl_handle& handle,
+        const hidl_vec<hidl_string>& /*args*/) {
+    if (handle == nullptr || handle->numFds < 1) return Void();
+    int fd = handle->data[0];
+
+    {
+        std::lock_guard<std::mutex> lock(mDeviceMutex);
+        if (!mDeviceOpenDone) {
+            dprintf(fd, "Device open: in progress for %.1f ms\n",
+                    (nowNs() - mConstructedNs) / 1000000.0);
+        } else {
+            dprintf(fd, "Device open: %s after %.1f ms (hw_get_module %.1f ms, open %.1f ms, "
+                    "set_notify %.1f ms)\n", mDevice.load() ? "ready" : "failed",
+                    mOpenTiming.readyNs / 1000000.0, mOpenTiming.getModuleNs / 1000000.0,
+                    mOpenTiming.openNs / 1000000.0, mOpenTiming.setNotifyNs / 1000000.0);
+        }
+        dprintf(fd, "  %u calls waited for it, longest %.1f ms\n", mDeviceWaiters,
+                mDeviceMaxWaitNs / 1000000.0);
+    }
+
+    std::lock_guard<std::mutex> lock(mAuthAttemptMutex);
+    size_t count = std::min(mAuthAttemptCount, kAuthAttemptHistorySize);
+    std::vector<int64_t> touchToResult, resultToClient, requestToMatch;
+    for (size_t i = 0; i < count; i++) {
+        const AuthAttempt& attempt = mAuthAttempts[i];
+        if (attempt.acquiredNs != 0) {
+            touchToResult.push_back(attempt.resultNs - attempt.acquiredNs);
+        }
+        if (attempt.deliveredNs != 0) {
+            resultToClient.push_back(attempt.deliveredNs - attempt.resultNs);
+        }
+        if (attempt.requestNs != 0 && attempt.deliveredNs != 0 &&
+                attempt.result == AuthAttempt::Result::MATCHED) {
+            requestToMatch.push_back(attempt.deliveredNs - attempt.requestNs);
+        }
+    }
+
+    dprintf(fd, "Authentication latency, last %zu of %zu touches:\n", count, mAuthAttemptCount);
+    dumpPercentiles(fd, "first acquired -> HAL result", touchToResult);
+    dumpPercentiles(fd, "HAL result -> client", resultToClient);
+    dumpPercentiles(fd, "authenticate() -> match delivered", requestToMatch);
+
+    dprintf(fd, "Recent touches, ms relative to the first acquired:\n");
+    for (size_t i = 0; i < count; i++) {
+        // Oldest first
+        const AuthAttempt& attempt =
+                mAuthAttempts[(mAuthAttemptCount - count + i) % kAuthAttemptHistorySize];
+        int64_t baseNs = attempt.acquiredNs ? attempt.acquiredNs : attempt.resultNs;
+        auto relMs = [baseNs](int64_t ns) { return ns ? (ns - baseNs) / 1000000.0 : 0.0; };
+        const char* result = attempt.result == AuthAttempt::Result::MATCHED ? "matched"
+                : attempt.result == AuthAttempt::Result::REJECTED ? "rejected" : "error";
+        dprintf(fd, "  %s", result);
+        if (attempt.result == AuthAttempt::Result::ERROR) dprintf(fd, " %d", attempt.error);
+        if (attempt.requestNs) dprintf(fd, ", request %.1f", relMs(attempt.requestNs));
+        dprintf(fd, ", %u acquired, result %.1f", attempt.acquiredCount,
+                relMs(attempt.resultNs));
+        if (attempt.deliveredNs) dprintf(fd, ", delivered %.1f", relMs(attempt.deliveredNs));
+        dprintf(fd, "\n");
+    }
+
+    return Void();
 }
 
 IBiometricsFingerprint* BiometricsFingerprint::getInstance() {
@@ -233,11 +406,14 @@ IBiometricsFingerprint* BiometricsFingerprint::getInstance() {
     return sInstance;
 }
 
-fingerprint_device_t* BiometricsFingerprint::openHal() {
+fingerprint_device_t* BiometricsFingerprint::openHal(DeviceOpenTiming* timing) {
     int err;
     const hw_module_t *hw_mdl = nullptr;
     ALOGD("Opening fingerprint hal library...");
-    if (0 != (err = hw_get_module(FINGERPRINT_HARDWARE_MODULE_ID, &hw_mdl))) {
+    int64_t startNs = nowNs();
+    err = hw_get_module(FINGERPRINT_HARDWARE_MODULE_ID, &hw_mdl);
+    timing->getModuleNs = nowNs() - startNs;
+    if (0 != err) {
         ALOGE("Can't open fingerprint HW Module, error: %d", err);
         return nullptr;
     }
@@ -256,7 +432,10 @@ fingerprint_device_t* BiometricsFingerprint::openHal() {
 
     hw_device_t *device = nullptr;
 
-    if (0 != (err = module->common.methods->open(hw_mdl, nullptr, &device))) {
+    startNs = nowNs();
+    err = module->common.methods->open(hw_mdl, nullptr, &device);
+    timing->openNs = nowNs() - startNs;
+    if (0 != err) {
         ALOGE("Can't open fingerprint methods, error: %d", err);
         return nullptr;
     }
@@ -270,8 +449,10 @@ fingerprint_device_t* BiometricsFingerprint::openHal() {
     fingerprint_device_t* fp_device =
         reinterpret_cast<fingerprint_device_t*>(device);
 
-    if (0 != (err =
-            fp_device->set_notify(fp_device, BiometricsFingerprint::notify))) {
+    startNs = nowNs();
+    err = fp_device->set_notify(fp_device, BiometricsFingerprint::notify);
+    timing->setNotifyNs = nowNs() - startNs;
+    if (0 != err) {
         ALOGE("Can't register fingerprint module callback, error: %d", err);
         return nullptr;
     }
@@ -282,18 +463,86 @@ fingerprint_device_t* BiometricsFingerprint::openHal() {
 void BiometricsFingerprint::notify(const fingerprint_msg_t *msg) {
     BiometricsFingerprint* thisPtr = static_cast<BiometricsFingerprint*>(
             BiometricsFingerprint::getInstance());
-    std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
-    if (thisPtr == nullptr || thisPtr->mClientCallback == nullptr) {
-        ALOGE("Receiving callbacks before the client callback is registered.");
+    if (thisPtr == nullptr) {
+        ALOGE("Receiving callbacks without an instance.");
         return;
     }
-    const uint64_t devId = reinterpret_cast<uint64_t>(thisPtr->mDevice);
-    switch (msg->type) {
+    if (thisPtr->mMessageEvent < 0) {
+        // No dispatcher, deliver on the vendor HAL's thread like before
+        std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
+        if (thisPtr->mClientCallback == nullptr) {
+            ALOGE("Receiving callbacks before the client callback is registered.");
+            return;
+        }
+        thisPtr->recordAuthMessage(*msg, nowNs());
+        thisPtr->dispatchMessage(thisPtr->mClientCallback, *msg);
+        thisPtr->finishAuthMessage(*msg, true);
+        return;
+    }
+    thisPtr->enqueueMessage(msg);
+}
+
+void BiometricsFingerprint::enqueueMessage(const fingerprint_msg_t *msg) {
+    // Some vendor HALs also notify from inside cancel() and friends, so keep
+    // producers in line
+    while (mMessageProducerLock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    size_t head = mMessageHead.load(std::memory_order_relaxed);
+    while (head - mMessageTail.load(std::memory_order_acquire) == kMessageQueueSize) {
+        // Only when system_server has been stuck for a whole queue of messages
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mMessages[head & (kMessageQueueSize - 1)] = { *msg, nowNs() };
+    mMessageHead.store(head + 1, std::memory_order_release);
+    mMessageProducerLock.clear(std::memory_order_release);
+
+    uint64_t one = 1;
+    if (write(mMessageEvent, &one, sizeof(one)) != sizeof(one)) {
+        ALOGE("Can't wake up callback dispatcher: %s", strerror(errno));
+    }
+}
+
+void BiometricsFingerprint::dispatchLoop() {
+    while (true) {
+        uint64_t count;
+        if (read(mMessageEvent, &count, sizeof(count)) < 0 && errno != EINTR) {
+            ALOGE("Can't wait for fingerprint messages: %s", strerror(errno));
+            return;
+        }
+
+        size_t tail = mMessageTail.load(std::memory_order_relaxed);
+        while (tail != mMessageHead.load(std::memory_order_acquire)) {
+            QueuedMessage queued = mMessages[tail & (kMessageQueueSize - 1)];
+            mMessageTail.store(++tail, std::memory_order_release);
+            recordAuthMessage(queued.msg, queued.whenNs);
+
+            sp<IBiometricsFingerprintClientCallback> callback;
+            {
+                std::lock_guard<std::mutex> lock(mClientCallbackMutex);
+                callback = mClientCallback;
+            }
+            if (callback == nullptr) {
+                ALOGE("Receiving callbacks before the client callback is registered.");
+            } else {
+                dispatchMessage(callback, queued.msg);
+            }
+            finishAuthMessage(queued.msg, callback != nullptr);
+        }
+
+        if (mDispatchExit.load()) return;
+    }
+}
+
+void BiometricsFingerprint::dispatchMessage(
+        const sp<IBiometricsFingerprintClientCallback>& callback, const fingerprint_msg_t& msg) {
+    const uint64_t devId = reinterpret_cast<uint64_t>(mDevice.load());
+    switch (msg.type) {
         case FINGERPRINT_ERROR: {
                 int32_t vendorCode = 0;
-                FingerprintError result = VendorErrorFilter(msg->data.error, &vendorCode);
+                FingerprintError result = VendorErrorFilter(msg.data.error, &vendorCode);
                 ALOGD("onError(%d)", result);
-                if (!thisPtr->mClientCallback->onError(devId, result, vendorCode).isOk()) {
+                if (!callback->onError(devId, result, vendorCode).isOk()) {
                     ALOGE("failed to invoke fingerprint onError callback");
                 }
             }
@@ -301,57 +550,57 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t *msg) {
         case FINGERPRINT_ACQUIRED: {
                 int32_t vendorCode = 0;
                 FingerprintAcquiredInfo result =
-                    VendorAcquiredFilter(msg->data.acquired.acquired_info, &vendorCode);
-                ALOGD("onAcquired(%d)", result);
-                if (!thisPtr->mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
+                    VendorAcquiredFilter(msg.data.acquired.acquired_info, &vendorCode);
+                ALOGV("onAcquired(%d)", result);
+                if (!callback->onAcquired(devId, result, vendorCode).isOk()) {
                     ALOGE("failed to invoke fingerprint onAcquired callback");
                 }
             }
             break;
         case FINGERPRINT_TEMPLATE_ENROLLING:
             ALOGD("onEnrollResult(fid=%d, gid=%d, rem=%d)",
-                msg->data.enroll.finger.fid,
-                msg->data.enroll.finger.gid,
-                msg->data.enroll.samples_remaining);
-            if (!thisPtr->mClientCallback->onEnrollResult(devId,
-                    msg->data.enroll.finger.fid,
-                    msg->data.enroll.finger.gid,
-                    msg->data.enroll.samples_remaining).isOk()) {
+                msg.data.enroll.finger.fid,
+                msg.data.enroll.finger.gid,
+                msg.data.enroll.samples_remaining);
+            if (!callback->onEnrollResult(devId,
+                    msg.data.enroll.finger.fid,
+                    msg.data.enroll.finger.gid,
+                    msg.data.enroll.samples_remaining).isOk()) {
                 ALOGE("failed to invoke fingerprint onEnrollResult callback");
             }
             break;
         case FINGERPRINT_TEMPLATE_REMOVED:
             ALOGD("onRemove(fid=%d, gid=%d, rem=%d)",
-                msg->data.removed.finger.fid,
-                msg->data.removed.finger.gid,
-                msg->data.removed.remaining_templates);
-            if (!thisPtr->mClientCallback->onRemoved(devId,
-                    msg->data.removed.finger.fid,
-                    msg->data.removed.finger.gid,
-                    msg->data.removed.remaining_templates).isOk()) {
+                msg.data.removed.finger.fid,
+                msg.data.removed.finger.gid,
+                msg.data.removed.remaining_templates);
+            if (!callback->onRemoved(devId,
+                    msg.data.removed.finger.fid,
+                    msg.data.removed.finger.gid,
+                    msg.data.removed.remaining_templates).isOk()) {
                 ALOGE("failed to invoke fingerprint onRemoved callback");
             }
             break;
         case FINGERPRINT_AUTHENTICATED:
-            if (msg->data.authenticated.finger.fid != 0) {
+            if (msg.data.authenticated.finger.fid != 0) {
                 ALOGD("onAuthenticated(fid=%d, gid=%d)",
-                    msg->data.authenticated.finger.fid,
-                    msg->data.authenticated.finger.gid);
+                    msg.data.authenticated.finger.fid,
+                    msg.data.authenticated.finger.gid);
                 const uint8_t* hat =
-                    reinterpret_cast<const uint8_t *>(&msg->data.authenticated.hat);
+                    reinterpret_cast<const uint8_t *>(&msg.data.authenticated.hat);
                 const hidl_vec<uint8_t> token(
-                    std::vector<uint8_t>(hat, hat + sizeof(msg->data.authenticated.hat)));
-                if (!thisPtr->mClientCallback->onAuthenticated(devId,
-                        msg->data.authenticated.finger.fid,
-                        msg->data.authenticated.finger.gid,
+                    std::vector<uint8_t>(hat, hat + sizeof(msg.data.authenticated.hat)));
+                if (!callback->onAuthenticated(devId,
+                        msg.data.authenticated.finger.fid,
+                        msg.data.authenticated.finger.gid,
                         token).isOk()) {
                     ALOGE("failed to invoke fingerprint onAuthenticated callback");
                 }
             } else {
                 // Not a recognized fingerprint
-                if (!thisPtr->mClientCallback->onAuthenticated(devId,
-                        msg->data.authenticated.finger.fid,
-                        msg->data.authenticated.finger.gid,
+                if (!callback->onAuthenticated(devId,
+                        msg.data.authenticated.finger.fid,
+                        msg.data.authenticated.finger.gid,
                         hidl_vec<uint8_t>()).isOk()) {
                     ALOGE("failed to invoke fingerprint onAuthenticated callback");
                 }
@@ -363,6 +612,86 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t *msg) {
     }
 }
 
+void BiometricsFingerprint::beginAuthSession() {
+    std::lock_guard<std::mutex> lock(mAuthAttemptMutex);
+    // The framework may restart authentication without an error in between
+    endAuthSessionLocked();
+    mAuthSessionActive = true;
+    mAuthSessionCookie++;
+    mAuthRequestNs = nowNs();
+    ATRACE_ASYNC_BEGIN("FP authenticate", mAuthSessionCookie);
+}
+
+void BiometricsFingerprint::endAuthSessionLocked() {
+    if (mAuthAttemptOpen) {
+        mAuthAttemptOpen = false;
+        ATRACE_ASYNC_END("FP touch", mAuthSessionCookie);
+    }
+    if (mAuthSessionActive) {
+        mAuthSessionActive = false;
+        ATRACE_ASYNC_END("FP authenticate", mAuthSessionCookie);
+    }
+}
+
+void BiometricsFingerprint::recordAuthMessage(const fingerprint_msg_t& msg, int64_t whenNs) {
+    if (msg.type != FINGERPRINT_ACQUIRED && msg.type != FINGERPRINT_AUTHENTICATED &&
+            msg.type != FINGERPRINT_ERROR) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mAuthAttemptMutex);
+    if (!mAuthSessionActive) return; // enrolling
+    if (msg.type == FINGERPRINT_ERROR && !mAuthAttemptOpen) {
+        // Canceled or timed out without a touch, nothing to time
+        endAuthSessionLocked();
+        return;
+    }
+
+    if (!mAuthAttemptOpen) {
+        mAuthAttemptOpen = true;
+        mAuthAttempt = AuthAttempt();
+        // Only the first touch after authenticate() waited on the request
+        mAuthAttempt.requestNs = mAuthRequestNs;
+        mAuthRequestNs = 0;
+        ATRACE_ASYNC_BEGIN("FP touch", mAuthSessionCookie);
+    }
+
+    switch (msg.type) {
+        case FINGERPRINT_ACQUIRED:
+            if (mAuthAttempt.acquiredCount++ == 0) mAuthAttempt.acquiredNs = whenNs;
+            break;
+        case FINGERPRINT_AUTHENTICATED:
+            mAuthAttempt.resultNs = whenNs;
+            mAuthAttempt.result = msg.data.authenticated.finger.fid != 0
+                    ? AuthAttempt::Result::MATCHED : AuthAttempt::Result::REJECTED;
+            break;
+        case FINGERPRINT_ERROR:
+            mAuthAttempt.resultNs = whenNs;
+            mAuthAttempt.result = AuthAttempt::Result::ERROR;
+            mAuthAttempt.error = msg.data.error;
+            break;
+        default:
+            break;
+    }
+}
+
+void BiometricsFingerprint::finishAuthMessage(const fingerprint_msg_t& msg, bool delivered) {
+    if (msg.type != FINGERPRINT_AUTHENTICATED && msg.type != FINGERPRINT_ERROR) return;
+
+    std::lock_guard<std::mutex> lock(mAuthAttemptMutex);
+    if (!mAuthAttemptOpen || mAuthAttempt.resultNs == 0) return;
+
+    if (delivered) mAuthAttempt.deliveredNs = nowNs();
+    mAuthAttempts[mAuthAttemptCount++ % kAuthAttemptHistorySize] = mAuthAttempt;
+    mAuthAttemptOpen = false;
+    ATRACE_ASYNC_END("FP touch", mAuthSessionCookie);
+
+    // A rejected touch leaves the HAL waiting for the next one
+    if (mAuthAttempt.result != AuthAttempt::Result::REJECTED) {
+        endAuthSessionLocked();
+    }
+}
+
 } // namespace implementation
 }  // namespace V2_1
 }  // namespace fingerprint
@@ -25,6 +25,13 @@
 #include <hidl/Status.h>
 #include <android/hardware/biometrics/fingerprint/2.1/IBiometricsFingerprint.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace android {
 namespace hardware {
 namespace biometrics {
@@ -35,6 +42,7 @@ namespace implementation {
 using ::android::hardware::biometrics::fingerprint::V2_1::IBiometricsFingerprint;
 using ::android::hardware::biometrics::fingerprint::V2_1::IBiometricsFingerprintClientCallback;
 using ::android::hardware::biometrics::fingerprint::V2_1::RequestStatus;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 using ::android::hardware::hidl_vec;
@@ -61,17 +69,93 @@ public:
     Return<RequestStatus> setActiveGroup(uint32_t gid, const hidl_string& storePath) override;
     Return<RequestStatus> authenticate(uint64_t operationId, uint32_t gid) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& args) override;
+
 private:
-    static fingerprint_device_t* openHal();
+    // How long each step of opening the vendor HAL took
+    struct DeviceOpenTiming {
+        int64_t getModuleNs = 0;
+        int64_t openNs = 0;
+        int64_t setNotifyNs = 0;
+        int64_t readyNs = 0; // since construction
+    };
+
+    static fingerprint_device_t* openHal(DeviceOpenTiming* timing);
     static void notify(const fingerprint_msg_t *msg); /* Static callback for legacy HAL implementation */
     static Return<RequestStatus> ErrorFilter(int32_t error);
     static FingerprintError VendorErrorFilter(int32_t error, int32_t* vendorCode);
     static FingerprintAcquiredInfo VendorAcquiredFilter(int32_t error, int32_t* vendorCode);
     static BiometricsFingerprint* sInstance;
 
+    // notify() only queues a copy of each message, mDispatchThread delivers it
+    // so the vendor HAL's thread never waits for system_server
+    void enqueueMessage(const fingerprint_msg_t *msg);
+    void dispatchLoop();
+    void dispatchMessage(const sp<IBiometricsFingerprintClientCallback>& callback,
+                         const fingerprint_msg_t& msg);
+
+    // One touch while authenticating, from the first FINGERPRINT_ACQUIRED to
+    // the client having been told the result. Times are CLOCK_MONOTONIC ns.
+    struct AuthAttempt {
+        enum class Result : uint8_t { MATCHED, REJECTED, ERROR };
+        int64_t requestNs = 0;   // authenticate(), only on the first touch after it
+        int64_t acquiredNs = 0;  // 0 when the HAL went straight to a result
+        int64_t resultNs = 0;    // FINGERPRINT_AUTHENTICATED or FINGERPRINT_ERROR from the HAL
+        int64_t deliveredNs = 0; // client callback returned, 0 without a client
+        uint32_t acquiredCount = 0;
+        Result result = Result::ERROR;
+        int32_t error = 0;
+    };
+
+    void beginAuthSession();
+    void endAuthSessionLocked();
+    void recordAuthMessage(const fingerprint_msg_t& msg, int64_t whenNs);
+    void finishAuthMessage(const fingerprint_msg_t& msg, bool delivered);
+
     std::mutex mClientCallbackMutex;
     sp<IBiometricsFingerprintClientCallback> mClientCallback;
-    fingerprint_device_t *mDevice;
+    std::atomic<fingerprint_device_t*> mDevice;
+
+    // openHal() runs on mOpenThread, calls arriving before it's done wait for
+    // it for up to kDeviceOpenTimeout
+    void openDevice();
+    fingerprint_device_t* waitForDevice();
+
+    static constexpr std::chrono::seconds kDeviceOpenTimeout{5};
+    std::mutex mDeviceMutex;
+    std::condition_variable mDeviceReady;
+    bool mDeviceOpenDone = false;
+    int64_t mConstructedNs = 0;
+    DeviceOpenTiming mOpenTiming;
+    uint32_t mDeviceWaiters = 0;
+    int64_t mDeviceMaxWaitNs = 0;
+    std::thread mOpenThread;
+
+    struct QueuedMessage {
+        fingerprint_msg_t msg;
+        int64_t whenNs; // when the vendor HAL sent it
+    };
+
+    static constexpr size_t kMessageQueueSize = 64; // power of two
+    std::array<QueuedMessage, kMessageQueueSize> mMessages;
+    std::atomic<size_t> mMessageHead{0}; // written by producers only
+    std::atomic<size_t> mMessageTail{0}; // written by mDispatchThread only
+    std::atomic_flag mMessageProducerLock = ATOMIC_FLAG_INIT;
+    int mMessageEvent = -1;
+    std::atomic<bool> mDispatchExit{false};
+    std::thread mDispatchThread;
+
+    // authenticate() runs on binder threads, everything else on the dispatcher
+    std::mutex mAuthAttemptMutex;
+    bool mAuthSessionActive = false;
+    int32_t mAuthSessionCookie = 0;
+    int64_t mAuthRequestNs = 0;
+    bool mAuthAttemptOpen = false;
+    AuthAttempt mAuthAttempt;
+    static constexpr size_t kAuthAttemptHistorySize = 32;
+    std::array<AuthAttempt, kAuthAttemptHistorySize> mAuthAttempts;
+    size_t mAuthAttemptCount = 0; // ever recorded, mAuthAttempts wraps around
 };
 
 }  // namespace implementation
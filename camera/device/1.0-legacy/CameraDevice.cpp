@@ -15,6 +15,11 @@
  */
 
 #define LOG_TAG "CamDev@1.0-impl.legacy"
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <cutils/properties.h>
 #include <hardware/camera.h>
 #include <hardware/gralloc1.h>
 #include <hidlmemory/mapping.h>
@@ -38,6 +43,18 @@ HandleImporter CameraDevice::sHandleImporter;
 
 static CameraDevice *sCameraDevice;
 
+// sDataCb hands the HAL's face array to the client without converting each
+// field, which relies on both structs sharing one layout.
+static_assert(sizeof(CameraFace) == sizeof(camera_face_t), "CameraFace layout mismatch");
+static_assert(offsetof(CameraFace, rect) == offsetof(camera_face_t, rect), "rect offset");
+static_assert(offsetof(CameraFace, score) == offsetof(camera_face_t, score), "score offset");
+static_assert(offsetof(CameraFace, id) == offsetof(camera_face_t, id), "id offset");
+static_assert(offsetof(CameraFace, leftEye) == offsetof(camera_face_t, left_eye),
+              "leftEye offset");
+static_assert(offsetof(CameraFace, rightEye) == offsetof(camera_face_t, right_eye),
+              "rightEye offset");
+static_assert(offsetof(CameraFace, mouth) == offsetof(camera_face_t, mouth), "mouth offset");
+
 Status CameraDevice::getHidlStatus(const int& status) {
     switch (status) {
         case 0: return Status::OK;
@@ -120,6 +137,8 @@ CameraDevice::~CameraDevice() {
         ALOGW("%s: camera %s is deleted while open", __FUNCTION__, mCameraId.c_str());
         closeLocked();
     }
+    mHalPreviewWindow.stopLookahead();
+    stopBatchThread();
     mHalPreviewWindow.cleanUpCirculatingBuffers();
 }
 
@@ -146,26 +165,26 @@ void CameraDevice::CameraPreviewWindow::cleanUpCirculatingBuffers() {
     mBufferIdMap.clear();
 }
 
-int CameraDevice::sDequeueBuffer(struct preview_stream_ops* w,
-                                   buffer_handle_t** buffer, int *stride) {
-    CameraPreviewWindow* object = static_cast<CameraPreviewWindow*>(w);
-    if (object->mPreviewCallback == nullptr) {
-        ALOGE("%s: camera HAL calling preview ops while there is no preview window!", __FUNCTION__);
-        return INVALID_OPERATION;
-    }
+void CameraDevice::CameraPreviewWindow::OpTiming::record(nsecs_t ns) {
+    count++;
+    totalNs += ns;
+    maxNs = std::max(maxNs, ns);
+}
 
-    if (buffer == nullptr || stride == nullptr) {
-        ALOGE("%s: buffer (%p) and stride (%p) must not be null!", __FUNCTION__, buffer, stride);
-        return BAD_VALUE;
-    }
+void CameraDevice::CameraPreviewWindow::OpTiming::dump(int fd, const char* name) const {
+    dprintf(fd, "  %s: %" PRIu64 " calls, avg %" PRId64 " us, max %" PRId64 " us\n", name,
+            count, count ? totalNs / (nsecs_t) count / 1000 : 0, maxNs / 1000);
+}
 
+Status CameraDevice::CameraPreviewWindow::dequeueFromCallback(
+        const sp<ICameraDevicePreviewCallback>& callback, buffer_handle_t** buffer, int* stride) {
     Status s;
-    object->mPreviewCallback->dequeueBuffer(
+    callback->dequeueBuffer(
         [&](auto status, uint64_t bufferId, const auto& buf, uint32_t strd) {
             s = status;
             if (s == Status::OK) {
-                Mutex::Autolock _l(object->mLock);
-                if (object->mCirculatingBuffers.count(bufferId) == 0) {
+                Mutex::Autolock _l(mLock);
+                if (mCirculatingBuffers.count(bufferId) == 0) {
                     buffer_handle_t importedBuf = buf.getNativeHandle();
                     sHandleImporter.importBuffer(importedBuf);
                     if (importedBuf == nullptr) {
@@ -173,14 +192,129 @@ int CameraDevice::sDequeueBuffer(struct preview_stream_ops* w,
                         s = Status::INTERNAL_ERROR;
                         return;
                     } else {
-                        object->mCirculatingBuffers[bufferId] = importedBuf;
-                        object->mBufferIdMap[&(object->mCirculatingBuffers[bufferId])] = bufferId;
+                        mCirculatingBuffers[bufferId] = importedBuf;
+                        mBufferIdMap[&(mCirculatingBuffers[bufferId])] = bufferId;
                     }
                 }
-                *buffer = &(object->mCirculatingBuffers[bufferId]);
+                *buffer = &(mCirculatingBuffers[bufferId]);
                 *stride = strd;
             }
         });
+    return s;
+}
+
+void CameraDevice::CameraPreviewWindow::requestLookaheadLocked() {
+    if (!mLookaheadEnabled || mLookaheadState != LookaheadState::IDLE) {
+        return;
+    }
+    if (!mLookaheadThread.joinable()) {
+        mLookaheadThread = std::thread(&CameraPreviewWindow::lookaheadLoop, this);
+    }
+    mLookaheadState = LookaheadState::REQUESTED;
+    mLookaheadCond.broadcast();
+}
+
+bool CameraDevice::CameraPreviewWindow::takeLookaheadLocked(
+        buffer_handle_t** buffer, int* stride, Status* status) {
+    if (mLookaheadState == LookaheadState::REQUESTED) {
+        // The worker hasn't picked it up yet, dequeueing directly is quicker
+        mLookaheadState = LookaheadState::IDLE;
+        return false;
+    }
+    while (mLookaheadState == LookaheadState::IN_FLIGHT) {
+        mLookaheadCond.wait(mLock);
+    }
+    if (mLookaheadState != LookaheadState::READY) {
+        return false;
+    }
+    mLookaheadState = LookaheadState::IDLE;
+    mLookaheadHits++;
+    *status = mLookaheadStatus;
+    if (mLookaheadStatus == Status::OK) {
+        *buffer = mLookaheadBuffer;
+        *stride = mLookaheadStride;
+    }
+    return true;
+}
+
+void CameraDevice::CameraPreviewWindow::cancelLookahead() {
+    Mutex::Autolock _l(mLock);
+    if (mLookaheadState == LookaheadState::REQUESTED) {
+        mLookaheadState = LookaheadState::IDLE;
+    }
+    while (mLookaheadState == LookaheadState::IN_FLIGHT) {
+        mLookaheadCond.wait(mLock);
+    }
+    if (mLookaheadState != LookaheadState::READY) {
+        return;
+    }
+    mLookaheadState = LookaheadState::IDLE;
+    if (mLookaheadStatus == Status::OK && mPreviewCallback != nullptr) {
+        // The HAL never saw this buffer, give it back to the window
+        mPreviewCallback->cancelBuffer(mBufferIdMap.at(mLookaheadBuffer));
+    }
+}
+
+void CameraDevice::CameraPreviewWindow::stopLookahead() {
+    cancelLookahead();
+    {
+        Mutex::Autolock _l(mLock);
+        mLookaheadExit = true;
+        mLookaheadCond.broadcast();
+    }
+    if (mLookaheadThread.joinable()) {
+        mLookaheadThread.join();
+    }
+}
+
+void CameraDevice::CameraPreviewWindow::lookaheadLoop() {
+    Mutex::Autolock _l(mLock);
+    while (!mLookaheadExit) {
+        if (mLookaheadState != LookaheadState::REQUESTED || mPreviewCallback == nullptr) {
+            mLookaheadCond.wait(mLock);
+            continue;
+        }
+        mLookaheadState = LookaheadState::IN_FLIGHT;
+        sp<ICameraDevicePreviewCallback> callback = mPreviewCallback;
+        buffer_handle_t* buffer = nullptr;
+        int stride = 0;
+        mLock.unlock();
+        Status s = dequeueFromCallback(callback, &buffer, &stride);
+        mLock.lock();
+        mLookaheadStatus = s;
+        mLookaheadBuffer = buffer;
+        mLookaheadStride = stride;
+        mLookaheadState = LookaheadState::READY;
+        mLookaheadCond.broadcast();
+    }
+}
+
+int CameraDevice::sDequeueBuffer(struct preview_stream_ops* w,
+                                   buffer_handle_t** buffer, int *stride) {
+    CameraPreviewWindow* object = static_cast<CameraPreviewWindow*>(w);
+    if (object->mPreviewCallback == nullptr) {
+        ALOGE("%s: camera HAL calling preview ops while there is no preview window!", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+
+    if (buffer == nullptr || stride == nullptr) {
+        ALOGE("%s: buffer (%p) and stride (%p) must not be null!", __FUNCTION__, buffer, stride);
+        return BAD_VALUE;
+    }
+
+    nsecs_t start = systemTime();
+    Status s;
+    {
+        Mutex::Autolock _l(object->mLock);
+        if (object->takeLookaheadLocked(buffer, stride, &s)) {
+            object->mDequeueTiming.record(systemTime() - start);
+            return getStatusT(s);
+        }
+    }
+
+    s = object->dequeueFromCallback(object->mPreviewCallback, buffer, stride);
+    Mutex::Autolock _l(object->mLock);
+    object->mDequeueTiming.record(systemTime() - start);
     return getStatusT(s);
 }
 
@@ -194,8 +328,20 @@ int CameraDevice::sEnqueueBuffer(struct preview_stream_ops* w, buffer_handle_t*
         ALOGE("%s: camera HAL calling preview ops while there is no preview window!", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    uint64_t bufferId = object->mBufferIdMap.at(buffer);
-    return getStatusT(object->mPreviewCallback->enqueueBuffer(bufferId));
+    nsecs_t start = systemTime();
+    uint64_t bufferId;
+    {
+        // The lookahead thread may be importing a buffer into the map
+        Mutex::Autolock _l(object->mLock);
+        bufferId = object->mBufferIdMap.at(buffer);
+    }
+    status_t ret = getStatusT(object->mPreviewCallback->enqueueBuffer(bufferId));
+    Mutex::Autolock _l(object->mLock);
+    object->mEnqueueTiming.record(systemTime() - start);
+    if (ret == OK) {
+        object->requestLookaheadLocked();
+    }
+    return ret;
 }
 
 int CameraDevice::sCancelBuffer(struct preview_stream_ops* w, buffer_handle_t* buffer) {
@@ -204,8 +350,17 @@ int CameraDevice::sCancelBuffer(struct preview_stream_ops* w, buffer_handle_t* b
         ALOGE("%s: camera HAL calling preview ops while there is no preview window!", __FUNCTION__);
         return INVALID_OPERATION;
     }
-    uint64_t bufferId = object->mBufferIdMap.at(buffer);
-    return getStatusT(object->mPreviewCallback->cancelBuffer(bufferId));
+    nsecs_t start = systemTime();
+    uint64_t bufferId;
+    {
+        // The lookahead thread may be importing a buffer into the map
+        Mutex::Autolock _l(object->mLock);
+        bufferId = object->mBufferIdMap.at(buffer);
+    }
+    status_t ret = getStatusT(object->mPreviewCallback->cancelBuffer(bufferId));
+    Mutex::Autolock _l(object->mLock);
+    object->mCancelTiming.record(systemTime() - start);
+    return ret;
 }
 
 int CameraDevice::sSetBufferCount(struct preview_stream_ops* w, int count) {
@@ -215,6 +370,7 @@ int CameraDevice::sSetBufferCount(struct preview_stream_ops* w, int count) {
         return INVALID_OPERATION;
     }
 
+    object->cancelLookahead();
     object->cleanUpCirculatingBuffers();
     return getStatusT(object->mPreviewCallback->setBufferCount(count));
 }
@@ -227,6 +383,7 @@ int CameraDevice::sSetBuffersGeometry(struct preview_stream_ops* w,
         return INVALID_OPERATION;
     }
 
+    object->cancelLookahead();
     object->cleanUpCirculatingBuffers();
     return getStatusT(
             object->mPreviewCallback->setBuffersGeometry(width, height, (PixelFormat) format));
@@ -260,6 +417,7 @@ int CameraDevice::sSetUsage(struct preview_stream_ops* w, int usage) {
         return INVALID_OPERATION;
     }
 
+    object->cancelLookahead();
     object->cleanUpCirculatingBuffers();
     return getStatusT(object->mPreviewCallback->setUsage((BufferUsage)usage));
 }
@@ -314,7 +472,8 @@ CameraDevice::CameraHeapMemory::CameraHeapMemory(
     sp<IAllocator> ashmemAllocator,
     size_t buf_size, uint_t num_buffers) :
         mBufSize(buf_size),
-        mNumBufs(num_buffers) {
+        mNumBufs(num_buffers),
+        mFromAllocator(true) {
     const size_t pagesize = getpagesize();
     size_t size = ((buf_size * num_buffers + pagesize-1) & ~(pagesize-1));
     ashmemAllocator->allocate(size,
@@ -372,6 +531,10 @@ camera_memory_t* CameraDevice::sGetMemory(int fd, size_t buf_size, uint_t num_bu
 
     CameraHeapMemory* mem;
     if (fd < 0) {
+        mem = object->takePooledHeap(buf_size, num_bufs);
+        if (mem != nullptr) {
+            return &mem->handle;
+        }
         mem = new CameraHeapMemory(object->mAshmemAllocator, buf_size, num_bufs);
     } else {
         mem = new CameraHeapMemory(fd, buf_size, num_bufs);
@@ -382,10 +545,10 @@ camera_memory_t* CameraDevice::sGetMemory(int fd, size_t buf_size, uint_t num_bu
     mem->handle.mId = id;
     {
         Mutex::Autolock _l(object->mMemoryMapLock);
-        if (object->mMemoryMap.count(id) != 0) {
+        if (object->lookupMemoryLocked(id) != nullptr) {
             ALOGE("%s: duplicate MemoryId %d returned by client!", __FUNCTION__, id);
         }
-        object->mMemoryMap[id] = mem;
+        object->storeMemoryLocked(id, mem);
     }
     mem->handle.mDevice = object;
     return &mem->handle;
@@ -405,18 +568,97 @@ void CameraDevice::sPutMemory(camera_memory_t *data) {
         ALOGE("%s: camera HAL return memory while camera is not opened!", __FUNCTION__);
         return;
     }
+    if (device->poolHeap(mem)) {
+        return;
+    }
     device->mDeviceCallback->unregisterMemory(mem->handle.mId);
     {
         Mutex::Autolock _l(device->mMemoryMapLock);
-        device->mMemoryMap.erase(mem->handle.mId);
+        device->storeMemoryLocked(mem->handle.mId, nullptr);
     }
     mem->decStrong(mem);
 }
 
+CameraDevice::CameraHeapMemory* CameraDevice::takePooledHeap(size_t bufSize, uint_t numBufs) {
+    CameraHeapMemory* mem = nullptr;
+    {
+        Mutex::Autolock _l(mMemoryMapLock);
+        for (auto it = mHeapPool.begin(); it != mHeapPool.end(); ++it) {
+            if ((*it)->mBufSize == bufSize && (*it)->mNumBufs == numBufs) {
+                mem = *it;
+                mHeapPool.erase(it);
+                mHeapPoolBytes -= mem->mHidlHeap.size();
+                storeMemoryLocked(mem->handle.mId, mem);
+                break;
+            }
+        }
+        if (mem == nullptr) {
+            mHeapPoolMisses++;
+            return nullptr;
+        }
+        mHeapPoolHits++;
+    }
+    // A new heap comes zeroed, don't hand out what the last user left in it
+    memset(mem->mHidlHeapMemData, 0, mem->mHidlHeap.size());
+    return mem;
+}
+
+bool CameraDevice::poolHeap(CameraHeapMemory* mem) {
+    // Heaps wrapping a HAL provided fd can't be handed out for another one
+    if (!mem->mFromAllocator || mem->mHidlHeapMemory == nullptr) {
+        return false;
+    }
+    Mutex::Autolock _l(mMemoryMapLock);
+    if (mHeapPool.size() >= kHeapPoolSize ||
+        mHeapPoolBytes + mem->mHidlHeap.size() > kHeapPoolMaxBytes) {
+        return false;
+    }
+    // Stays registered with the client, but frames can't be released into it
+    storeMemoryLocked(mem->handle.mId, nullptr);
+    mHeapPool.push_back(mem);
+    mHeapPoolBytes += mem->mHidlHeap.size();
+    return true;
+}
+
+void CameraDevice::drainHeapPool() {
+    std::vector<CameraHeapMemory*> pool;
+    {
+        Mutex::Autolock _l(mMemoryMapLock);
+        pool.swap(mHeapPool);
+        mHeapPoolBytes = 0;
+    }
+    for (CameraHeapMemory* mem : pool) {
+        if (mDeviceCallback != nullptr) {
+            mDeviceCallback->unregisterMemory(mem->handle.mId);
+        }
+        mem->decStrong(mem);
+    }
+}
+
+CameraDevice::CameraHeapMemory* CameraDevice::lookupMemoryLocked(MemoryId id) const {
+    if (id < kMemorySlabSize) {
+        return mMemorySlab[id];
+    }
+    auto it = mMemoryMap.find(id);
+    return it == mMemoryMap.end() ? nullptr : it->second;
+}
+
+void CameraDevice::storeMemoryLocked(MemoryId id, CameraHeapMemory* mem) {
+    if (id < kMemorySlabSize) {
+        mMemorySlab[id] = mem;
+    } else if (mem != nullptr) {
+        mMemoryMap[id] = mem;
+    } else {
+        mMemoryMap.erase(id);
+    }
+}
+
 // Callback forwarding methods
 void CameraDevice::sNotifyCb(int32_t msg_type, int32_t ext1, int32_t ext2, void *user __unused) {
     ALOGV("%s", __FUNCTION__);
     CameraDevice* object = sCameraDevice;
+    // Focus, zoom and similar events come with the HAL updating its parameters
+    object->invalidateParameters();
     if (object->mDeviceCallback != nullptr) {
         object->mDeviceCallback->notifyCallback((NotifyCallbackMsg) msg_type, ext1, ext2);
     }
@@ -426,7 +668,9 @@ void CameraDevice::sDataCb(int32_t msg_type, const camera_memory_t *data, unsign
         camera_frame_metadata_t *metadata, void *user __unused) {
     ALOGV("%s", __FUNCTION__);
     CameraDevice* object = sCameraDevice;
-    sp<CameraHeapMemory> mem(static_cast<CameraHeapMemory*>(data->handle));
+    // The HAL holds a strong reference from sGetMemory until sPutMemory, so
+    // there is no need to take another one for every frame.
+    CameraHeapMemory* mem = static_cast<CameraHeapMemory*>(data->handle);
     if (index >= mem->mNumBufs) {
         ALOGE("%s: invalid buffer index %d, max allowed is %d", __FUNCTION__,
              index, mem->mNumBufs);
@@ -434,61 +678,116 @@ void CameraDevice::sDataCb(int32_t msg_type, const camera_memory_t *data, unsign
     }
     if (object->mDeviceCallback != nullptr) {
         CameraFrameMetadata hidlMetadata;
-        if (metadata) {
-            hidlMetadata.faces.resize(metadata->number_of_faces);
-            for (size_t i = 0; i < hidlMetadata.faces.size(); i++) {
-                hidlMetadata.faces[i].score = metadata->faces[i].score;
-                hidlMetadata.faces[i].id = metadata->faces[i].id;
-                for (int k = 0; k < 4; k++) {
-                    hidlMetadata.faces[i].rect[k] = metadata->faces[i].rect[k];
-                }
-                for (int k = 0; k < 2; k++) {
-                    hidlMetadata.faces[i].leftEye[k] = metadata->faces[i].left_eye[k];
-                }
-                for (int k = 0; k < 2; k++) {
-                    hidlMetadata.faces[i].rightEye[k] = metadata->faces[i].right_eye[k];
-                }
-                for (int k = 0; k < 2; k++) {
-                    hidlMetadata.faces[i].mouth[k] = metadata->faces[i].mouth[k];
-                }
+        if (metadata && metadata->number_of_faces > 0) {
+            size_t numFaces = metadata->number_of_faces;
+            // Only ever grows, so steady-state face detection does not allocate.
+            if (object->mFaceBuffer.size() < numFaces) {
+                object->mFaceBuffer.resize(numFaces);
             }
+            memcpy(object->mFaceBuffer.data(), metadata->faces, numFaces * sizeof(camera_face_t));
+            hidlMetadata.faces.setToExternal(object->mFaceBuffer.data(), numFaces);
         }
-        CameraHeapMemory* mem = static_cast<CameraHeapMemory *>(data->handle);
         object->mDeviceCallback->dataCallback(
                 (DataCallbackMsg) msg_type, mem->handle.mId, index, hidlMetadata);
     }
 }
 
+void CameraDevice::updateBatchSizeLocked(nsecs_t timestamp) {
+    nsecs_t delta = timestamp - mLastFrameTimestamp;
+    mLastFrameTimestamp = timestamp;
+    if (delta <= 0 || delta > kMaxBatchLatencyNs) {
+        // First frame or a stall, deliver frames one by one until the rate is known again
+        mFrameIntervalNs = 0;
+        mBatchSize = 0;
+        return;
+    }
+
+    mFrameIntervalNs = mFrameIntervalNs == 0 ? delta : (mFrameIntervalNs * 7 + delta) / 8;
+    mBatchSize = std::clamp<nsecs_t>(kMaxBatchLatencyNs / mFrameIntervalNs, 1, kMaxBatchSize);
+}
+
+void CameraDevice::flushBatch(std::unique_lock<Mutex>& batchLock) {
+    mBatchDeadline = 0;
+    if (mInflightCount == 0) {
+        batchLock.unlock();
+        return;
+    }
+    std::array<HandleTimestampMessage, kMaxBatchSize> frames;
+    uint32_t count = mInflightCount;
+    int32_t msgType = mBatchMsgType;
+    std::copy_n(mInflightBatch.begin(), count, frames.begin());
+    mInflightCount = 0;
+
+    Mutex::Autolock _d(mDeliveryLock);
+    batchLock.unlock();
+    if (mDeviceCallback != nullptr) {
+        hidl_vec<HandleTimestampMessage> batch;
+        batch.setToExternal(frames.data(), count);
+        mDeviceCallback->handleCallbackTimestampBatch((DataCallbackMsg) msgType, batch);
+    }
+}
+
+void CameraDevice::batchLoop() {
+    std::unique_lock<Mutex> lock(mBatchLock);
+    while (!mBatchThreadExit) {
+        if (mBatchDeadline == 0) {
+            mBatchCond.wait(mBatchLock);
+            continue;
+        }
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < mBatchDeadline) {
+            mBatchCond.waitRelative(mBatchLock, mBatchDeadline - now);
+            continue;
+        }
+        flushBatch(lock);
+        lock.lock();
+    }
+}
+
+void CameraDevice::stopBatchThread() {
+    {
+        Mutex::Autolock _b(mBatchLock);
+        mBatchThreadExit = true;
+        mBatchCond.signal();
+    }
+    if (mBatchThread.joinable()) {
+        mBatchThread.join();
+    }
+}
+
 void CameraDevice::handleCallbackTimestamp(
         nsecs_t timestamp, int32_t msg_type,
         MemoryId memId , unsigned index, native_handle_t* handle) {
-    uint32_t batchSize = 0;
-    {
-        Mutex::Autolock _l(mBatchLock);
-        batchSize = mBatchSize;
-    }
+    std::unique_lock<Mutex> lock(mBatchLock);
+    updateBatchSizeLocked(timestamp);
 
-    if (batchSize == 0) { // non-batch mode
+    if (mBatchSize <= 1 && mInflightCount == 0) { // non-batch mode
+        Mutex::Autolock _d(mDeliveryLock);
+        lock.unlock();
         mDeviceCallback->handleCallbackTimestamp(
                 (DataCallbackMsg) msg_type, handle, memId, index, timestamp);
-    } else { // batch mode
-        Mutex::Autolock _l(mBatchLock);
-        size_t inflightSize = mInflightBatch.size();
-        if (inflightSize == 0) {
-            mBatchMsgType = msg_type;
-        } else if (mBatchMsgType != msg_type) {
-            ALOGE("%s: msg_type change (from %d to %d) is not supported!",
-                    __FUNCTION__, mBatchMsgType, msg_type);
-            return;
-        }
-        mInflightBatch.push_back({handle, memId, index, timestamp});
+        return;
+    }
 
-        // Send batched frames to camera framework
-        if (mInflightBatch.size() >= batchSize) {
-            mDeviceCallback->handleCallbackTimestampBatch(
-                    (DataCallbackMsg) mBatchMsgType, mInflightBatch);
-            mInflightBatch.clear();
+    if (mInflightCount == 0) {
+        mBatchMsgType = msg_type;
+        mBatchDeadline = systemTime(SYSTEM_TIME_MONOTONIC) + kMaxBatchLatencyNs;
+        if (!mBatchThread.joinable()) {
+            mBatchThread = std::thread(&CameraDevice::batchLoop, this);
         }
+        mBatchCond.signal();
+    } else if (mBatchMsgType != msg_type) {
+        ALOGE("%s: msg_type change (from %d to %d) is not supported!",
+                __FUNCTION__, mBatchMsgType, msg_type);
+        return;
+    }
+    mInflightBatch[mInflightCount++] = {handle, memId, index, timestamp};
+
+    // Send batched frames to camera framework once the batch is full or its
+    // oldest frame has been held back for long enough
+    if (mInflightCount >= mBatchSize ||
+            timestamp - mInflightBatch[0].timestamp >= kMaxBatchLatencyNs) {
+        flushBatch(lock);
     }
 }
 
@@ -529,6 +828,11 @@ void CameraDevice::sDataCbTimestamp(nsecs_t timestamp, int32_t msg_type,
 
 void CameraDevice::initHalPreviewWindow()
 {
+    {
+        Mutex::Autolock _l(mHalPreviewWindow.mLock);
+        mHalPreviewWindow.mLookaheadEnabled =
+                property_get_bool("persist.vendor.camera.preview_lookahead", false);
+    }
     mHalPreviewWindow.cancel_buffer = sCancelBuffer;
     mHalPreviewWindow.lock_buffer = sLockBuffer;
     mHalPreviewWindow.dequeue_buffer = sDequeueBuffer;
@@ -634,6 +938,28 @@ Return<Status> CameraDevice::dumpState(const hidl_handle& handle) {
     }
     int fd = handle->data[0];
 
+    {
+        Mutex::Autolock _m(mMemoryMapLock);
+        uint32_t requests = mHeapPoolHits + mHeapPoolMisses;
+        dprintf(fd,
+                "Heap pool: %zu/%zu heaps parked, %zu/%zu bytes, %u/%u requests reused (%u%%)\n",
+                mHeapPool.size(), kHeapPoolSize, mHeapPoolBytes, kHeapPoolMaxBytes, mHeapPoolHits,
+                requests, requests ? mHeapPoolHits * 100 / requests : 0);
+    }
+    uint32_t parametersHits = mParametersHits;
+    uint32_t queries = parametersHits + mParametersMisses;
+    dprintf(fd, "Parameters cache: %u/%u queries answered without the HAL (%u%%)\n",
+            parametersHits, queries, queries ? parametersHits * 100 / queries : 0);
+    {
+        Mutex::Autolock _w(mHalPreviewWindow.mLock);
+        dprintf(fd, "Preview window (lookahead %s, %" PRIu64 " hits):\n",
+                mHalPreviewWindow.mLookaheadEnabled ? "on" : "off",
+                mHalPreviewWindow.mLookaheadHits);
+        mHalPreviewWindow.mDequeueTiming.dump(fd, "dequeue");
+        mHalPreviewWindow.mEnqueueTiming.dump(fd, "enqueue");
+        mHalPreviewWindow.mCancelTiming.dump(fd, "cancel");
+    }
+
     if (mDevice != nullptr) {
         if (mDevice->ops->dump) { // It's fine if the HAL doesn't implement dump()
             return getHidlStatus(mDevice->ops->dump(mDevice, fd));
@@ -645,6 +971,7 @@ Return<Status> CameraDevice::dumpState(const hidl_handle& handle) {
 Return<Status> CameraDevice::open(const sp<ICameraDeviceCallback>& callback) {
     ALOGI("Opening camera %s", mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    dropCachedParametersLocked();
 
     camera_info info;
     status_t res = mModule->getCameraInfo(mCameraIdInt, &info);
@@ -688,8 +1015,14 @@ Return<Status> CameraDevice::setPreviewWindow(const sp<ICameraDevicePreviewCallb
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
     }
+    // the preview size and format may follow the new window
+    dropCachedParametersLocked();
 
-    mHalPreviewWindow.mPreviewCallback = window;
+    mHalPreviewWindow.cancelLookahead();
+    {
+        Mutex::Autolock _w(mHalPreviewWindow.mLock);
+        mHalPreviewWindow.mPreviewCallback = window;
+    }
     if (mDevice->ops->set_preview_window) {
         return getHidlStatus(mDevice->ops->set_preview_window(mDevice,
                 (window == nullptr) ? nullptr : &mHalPreviewWindow));
@@ -739,6 +1072,7 @@ Return<bool> CameraDevice::msgTypeEnabled(uint32_t msgType) {
 Return<Status> CameraDevice::startPreview() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -752,6 +1086,7 @@ Return<Status> CameraDevice::startPreview() {
 Return<void> CameraDevice::stopPreview() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Void();
@@ -759,6 +1094,7 @@ Return<void> CameraDevice::stopPreview() {
     if (mDevice->ops->stop_preview) {
         mDevice->ops->stop_preview(mDevice);
     }
+    mHalPreviewWindow.cancelLookahead();
     return Void();
 }
 
@@ -778,6 +1114,7 @@ Return<bool> CameraDevice::previewEnabled() {
 Return<Status> CameraDevice::storeMetaDataInBuffers(bool enable) {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -795,6 +1132,7 @@ Return<Status> CameraDevice::storeMetaDataInBuffers(bool enable) {
 Return<Status> CameraDevice::startRecording() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -808,6 +1146,7 @@ Return<Status> CameraDevice::startRecording() {
 Return<void> CameraDevice::stopRecording() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Void();
@@ -815,6 +1154,13 @@ Return<void> CameraDevice::stopRecording() {
     if (mDevice->ops->stop_recording) {
         mDevice->ops->stop_recording(mDevice);
     }
+
+    // Don't hold the tail of the recording back until the next session
+    std::unique_lock<Mutex> batchLock(mBatchLock);
+    mLastFrameTimestamp = 0;
+    mFrameIntervalNs = 0;
+    mBatchSize = 0;
+    flushBatch(batchLock);
     return Void();
 }
 
@@ -841,39 +1187,43 @@ void CameraDevice::releaseRecordingFrameLocked(
         CameraHeapMemory* camMemory;
         {
             Mutex::Autolock _l(mMemoryMapLock);
-            auto it = mMemoryMap.find(memId);
-            if (it == mMemoryMap.end() || it->second == nullptr) {
-                ALOGE("%s unknown memoryId %d", __FUNCTION__, memId);
-                return;
-            }
-            camMemory = it->second;
+            camMemory = lookupMemoryLocked(memId);
         }
+        releaseRecordingFrameLocked(camMemory, memId, bufferIndex, handle);
+    }
+}
 
-        if (bufferIndex >= camMemory->mNumBufs) {
-            ALOGE("%s: bufferIndex %d exceeds number of buffers %d",
-                    __FUNCTION__, bufferIndex, camMemory->mNumBufs);
-            return;
-        }
-        void *data = ((uint8_t *) camMemory->mHidlHeapMemData) + bufferIndex * camMemory->mBufSize;
-        if (handle) {
-            VideoNativeHandleMetadata* md = (VideoNativeHandleMetadata*) data;
-            if (md->eType == kMetadataBufferTypeNativeHandleSource) {
-                // Input handle will be closed by HIDL transport later, so clone it
-                // HAL implementation is responsible to close/delete the clone
-                native_handle_t* clone = native_handle_clone(handle);
-                if (!clone) {
-                    ALOGE("%s: failed to clone buffer %p", __FUNCTION__, handle);
-                    return;
-                }
-                md->pHandle = clone;
-            } else {
-                ALOGE("%s:Malform VideoNativeHandleMetadata at memId %d, bufferId %d",
-                        __FUNCTION__, memId, bufferIndex);
+void CameraDevice::releaseRecordingFrameLocked(CameraHeapMemory* camMemory,
+        uint32_t memId, uint32_t bufferIndex, const native_handle_t* handle) {
+    if (camMemory == nullptr) {
+        ALOGE("%s unknown memoryId %d", __FUNCTION__, memId);
+        return;
+    }
+
+    if (bufferIndex >= camMemory->mNumBufs) {
+        ALOGE("%s: bufferIndex %d exceeds number of buffers %d",
+                __FUNCTION__, bufferIndex, camMemory->mNumBufs);
+        return;
+    }
+    void *data = ((uint8_t *) camMemory->mHidlHeapMemData) + bufferIndex * camMemory->mBufSize;
+    if (handle) {
+        VideoNativeHandleMetadata* md = (VideoNativeHandleMetadata*) data;
+        if (md->eType == kMetadataBufferTypeNativeHandleSource) {
+            // Input handle will be closed by HIDL transport later, so clone it
+            // HAL implementation is responsible to close/delete the clone
+            native_handle_t* clone = native_handle_clone(handle);
+            if (!clone) {
+                ALOGE("%s: failed to clone buffer %p", __FUNCTION__, handle);
                 return;
             }
+            md->pHandle = clone;
+        } else {
+            ALOGE("%s:Malform VideoNativeHandleMetadata at memId %d, bufferId %d",
+                    __FUNCTION__, memId, bufferIndex);
+            return;
         }
-        mDevice->ops->release_recording_frame(mDevice, data);
     }
+    mDevice->ops->release_recording_frame(mDevice, data);
 }
 
 Return<void> CameraDevice::releaseRecordingFrame(uint32_t memId, uint32_t bufferIndex) {
@@ -896,9 +1246,26 @@ Return<void> CameraDevice::releaseRecordingFrameHandleBatch(
         const hidl_vec<VideoFrameMessage>& msgs) {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
-    for (auto& msg : msgs) {
-        releaseRecordingFrameLocked(
-                msg.data, msg.bufferIndex, msg.frameData.getNativeHandle());
+    if (!mDevice) {
+        ALOGE("%s called while camera is not opened", __FUNCTION__);
+        return Void();
+    }
+    if (!mDevice->ops->release_recording_frame) {
+        return Void();
+    }
+
+    // Resolve the whole batch under one mMemoryMapLock acquisition, the frames
+    // themselves are released without it like in the single frame path
+    std::vector<CameraHeapMemory*> memories(msgs.size());
+    {
+        Mutex::Autolock _m(mMemoryMapLock);
+        for (size_t i = 0; i < msgs.size(); i++) {
+            memories[i] = lookupMemoryLocked(msgs[i].data);
+        }
+    }
+    for (size_t i = 0; i < msgs.size(); i++) {
+        releaseRecordingFrameLocked(memories[i], msgs[i].data, msgs[i].bufferIndex,
+                msgs[i].frameData.getNativeHandle());
     }
     return Void();
 }
@@ -906,6 +1273,7 @@ Return<void> CameraDevice::releaseRecordingFrameHandleBatch(
 Return<Status> CameraDevice::autoFocus() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -919,6 +1287,7 @@ Return<Status> CameraDevice::autoFocus() {
 Return<Status> CameraDevice::cancelAutoFocus() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -932,6 +1301,7 @@ Return<Status> CameraDevice::cancelAutoFocus() {
 Return<Status> CameraDevice::takePicture() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -945,6 +1315,7 @@ Return<Status> CameraDevice::takePicture() {
 Return<Status> CameraDevice::cancelPicture() {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -958,6 +1329,7 @@ Return<Status> CameraDevice::cancelPicture() {
 Return<Status> CameraDevice::setParameters(const hidl_string& params) {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    dropCachedParametersLocked();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -977,6 +1349,15 @@ Return<void> CameraDevice::getParameters(getParameters_cb _hidl_cb) {
         _hidl_cb(outStr);
         return Void();
     }
+
+    uint32_t generation = mParametersGeneration;
+    if (mCachedParametersValid && mCachedParametersGeneration == generation) {
+        mParametersHits++;
+        _hidl_cb(mCachedParameters);
+        return Void();
+    }
+    mParametersMisses++;
+
     if (mDevice->ops->get_parameters) {
         char *temp = mDevice->ops->get_parameters(mDevice);
         outStr = temp;
@@ -985,6 +1366,9 @@ Return<void> CameraDevice::getParameters(getParameters_cb _hidl_cb) {
         } else {
             free(temp);
         }
+        mCachedParameters = outStr;
+        mCachedParametersGeneration = generation;
+        mCachedParametersValid = true;
     }
     _hidl_cb(outStr);
     return Void();
@@ -993,6 +1377,7 @@ Return<void> CameraDevice::getParameters(getParameters_cb _hidl_cb) {
 Return<Status> CameraDevice::sendCommand(CommandType cmd, int32_t arg1, int32_t arg2) {
     ALOGV("%s(%s)", __FUNCTION__, mCameraId.c_str());
     Mutex::Autolock _l(mLock);
+    invalidateParameters();
     if (!mDevice) {
         ALOGE("%s called while camera is not opened", __FUNCTION__);
         return Status::OPERATION_NOT_SUPPORTED;
@@ -1011,6 +1396,7 @@ Return<void> CameraDevice::close() {
 
 void CameraDevice::closeLocked() {
     ALOGI("Closing camera %s", mCameraId.c_str());
+    dropCachedParametersLocked();
     if(mDevice) {
         int rc = mDevice->common.close(&mDevice->common);
         if (rc != OK) {
@@ -1018,6 +1404,8 @@ void CameraDevice::closeLocked() {
         }
         mDevice = nullptr;
     }
+    // The registrations belong to this session's client
+    drainHeapPool();
 }
 
 }  // namespace implementation
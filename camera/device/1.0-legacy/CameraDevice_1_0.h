@@ -17,7 +17,12 @@
 #ifndef ANDROID_HARDWARE_CAMERA_DEVICE_V1_0_CAMERADEVICE_H
 #define ANDROID_HARDWARE_CAMERA_DEVICE_V1_0_CAMERADEVICE_H
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include "utils/Condition.h"
 #include "utils/Mutex.h"
 #include "utils/SortedVector.h"
 #include "CameraModule.h"
@@ -122,6 +127,8 @@ private:
 
         size_t mBufSize;
         uint_t mNumBufs;
+        // Allocated by this HAL rather than wrapping a HAL provided fd
+        bool mFromAllocator = false;
 
         // Shared memory related members
         hidl_memory      mHidlHeap;
@@ -146,10 +153,47 @@ private:
         // Called when we expect buffer will be re-allocated
         void cleanUpCirculatingBuffers();
 
+        // Dequeues from the window and imports the buffer if it is a new one
+        Status dequeueFromCallback(const sp<ICameraDevicePreviewCallback>& callback,
+                                   buffer_handle_t** buffer, int* stride);
+
+        // Lookahead mode dequeues the next buffer on mLookaheadThread as soon as
+        // the HAL enqueues one, so that the HAL's own dequeue usually finds it
+        // ready instead of waiting for a binder round trip.
+        void requestLookaheadLocked();
+        bool takeLookaheadLocked(buffer_handle_t** buffer, int* stride, Status* status);
+        // Returns a buffer dequeued ahead to the window, needed before reconfiguring it
+        void cancelLookahead();
+        void stopLookahead();
+        void lookaheadLoop();
+
+        struct OpTiming {
+            uint64_t count = 0;
+            nsecs_t totalNs = 0;
+            nsecs_t maxNs = 0;
+            void record(nsecs_t ns);
+            void dump(int fd, const char* name) const;
+        };
+
         Mutex mLock;
         sp<ICameraDevicePreviewCallback> mPreviewCallback = nullptr;
         std::unordered_map<uint64_t, buffer_handle_t> mCirculatingBuffers;
         std::unordered_map<buffer_handle_t*, uint64_t> mBufferIdMap;
+
+        OpTiming mDequeueTiming;
+        OpTiming mEnqueueTiming;
+        OpTiming mCancelTiming;
+
+        enum class LookaheadState { IDLE, REQUESTED, IN_FLIGHT, READY };
+        bool mLookaheadEnabled = false;
+        bool mLookaheadExit = false;
+        LookaheadState mLookaheadState = LookaheadState::IDLE;
+        Condition mLookaheadCond;
+        std::thread mLookaheadThread;
+        Status mLookaheadStatus = Status::OK;
+        buffer_handle_t* mLookaheadBuffer = nullptr;
+        int mLookaheadStride = 0;
+        uint64_t mLookaheadHits = 0;
     } mHalPreviewWindow;
 
     // gating access to mDevice, mInitFail, mDisconnected
@@ -165,23 +209,88 @@ private:
 
     sp<ICameraDeviceCallback> mDeviceCallback = nullptr;
 
-    mutable Mutex mMemoryMapLock; // gating access to mMemoryMap
+    mutable Mutex mMemoryMapLock; // gating access to mMemorySlab and mMemoryMap
                                  // must not hold mLock after this lock is acquired
+    // Clients hand out small sequential ids, those are looked up by index and
+    // only the ones past the slab go through the map
+    static constexpr MemoryId kMemorySlabSize = 64;
+    std::array<CameraHeapMemory*, kMemorySlabSize> mMemorySlab{};
     std::unordered_map<MemoryId, CameraHeapMemory*> mMemoryMap;
+    CameraHeapMemory* lookupMemoryLocked(MemoryId id) const;
+    void storeMemoryLocked(MemoryId id, CameraHeapMemory* mem); // nullptr removes
+
+    // Heaps the HAL puts back stay mapped and registered with the client so a
+    // request of the same size can reuse them; also gated by mMemoryMapLock.
+    // Capped by count and by the bytes they keep mapped.
+    static constexpr size_t kHeapPoolSize = 4;
+    static constexpr size_t kHeapPoolMaxBytes = 32 * 1024 * 1024;
+    std::vector<CameraHeapMemory*> mHeapPool;
+    size_t mHeapPoolBytes = 0;
+    uint32_t mHeapPoolHits = 0;
+    uint32_t mHeapPoolMisses = 0;
+    CameraHeapMemory* takePooledHeap(size_t bufSize, uint_t numBufs);
+    bool poolHeap(CameraHeapMemory* mem);
+    void drainHeapPool();
 
     bool mMetadataMode = false;
 
+    // Parameters as last read from the HAL, gated by mLock. They are reused
+    // until mParametersGeneration moves, which happens on every call that may
+    // make the HAL change them, including ones arriving from HAL threads.
+    hidl_string mCachedParameters;
+    uint32_t mCachedParametersGeneration = 0;
+    bool mCachedParametersValid = false;
+    std::atomic<uint32_t> mParametersGeneration{0};
+    // read by dumpState without mLock
+    std::atomic<uint32_t> mParametersHits{0};
+    std::atomic<uint32_t> mParametersMisses{0};
+    void invalidateParameters() { mParametersGeneration++; }
+    // For calls holding mLock which replace or reconfigure the device
+    void dropCachedParametersLocked() {
+        invalidateParameters();
+        mCachedParametersValid = false;
+        mCachedParameters.clear();
+    }
+
+    // Reused by sDataCb to pass face metadata without a per-frame allocation
+    std::vector<CameraFace> mFaceBuffer;
+
+    // Video frames are batched only while they arrive fast enough for
+    // several to fit in kMaxBatchLatencyNs, which also bounds how long the
+    // oldest frame of a batch is held back: mBatchThread flushes a batch by
+    // its deadline even if no further frame arrives.
+    static constexpr nsecs_t kMaxBatchLatencyNs = 20000000; // 20ms
+    static constexpr uint32_t kMaxBatchSize = 8;
+
     mutable Mutex mBatchLock;
     // Start of protection scope for mBatchLock
-    uint32_t mBatchSize = 0; // 0 for non-batch mode, set to other value to start batching
+    uint32_t mBatchSize = 0; // 0 for non-batch mode, adapted to the observed frame rate
     int32_t mBatchMsgType;   // Maybe only allow DataCallbackMsg::VIDEO_FRAME?
-    std::vector<HandleTimestampMessage> mInflightBatch;
+    std::array<HandleTimestampMessage, kMaxBatchSize> mInflightBatch;
+    uint32_t mInflightCount = 0;
+    nsecs_t mLastFrameTimestamp = 0;
+    nsecs_t mFrameIntervalNs = 0; // smoothed, 0 until two frames are seen
+    nsecs_t mBatchDeadline = 0;   // CLOCK_MONOTONIC, 0 while no batch is pending
+    bool mBatchThreadExit = false;
+    Condition mBatchCond;
+    std::thread mBatchThread;
     // End of protection scope for mBatchLock
 
+    // Taken before mBatchLock is released for a delivery, so that frames
+    // reach the framework in order without binder calls under mBatchLock
+    Mutex mDeliveryLock;
+
+    void updateBatchSizeLocked(nsecs_t timestamp);
+    // Releases batchLock, which holds mBatchLock, before calling the framework
+    void flushBatch(std::unique_lock<Mutex>& batchLock);
+    void batchLoop();
+    void stopBatchThread();
     void handleCallbackTimestamp(
             nsecs_t timestamp, int32_t msg_type,
             MemoryId memId , unsigned index, native_handle_t* handle);
     void releaseRecordingFrameLocked(uint32_t memId, uint32_t bufferIndex, const native_handle_t*);
+    void releaseRecordingFrameLocked(CameraHeapMemory* camMemory, uint32_t memId,
+            uint32_t bufferIndex, const native_handle_t*);
 
     // shared memory methods
     static camera_memory_t* sGetMemory(int fd, size_t buf_size, uint_t num_bufs, void *user);
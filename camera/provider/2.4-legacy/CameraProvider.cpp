@@ -19,7 +19,10 @@
 
 #include "CameraProvider.h"
 #include "CameraDevice_1_0.h"
+#include <cutils/properties.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <utils/Trace.h>
 
 
@@ -38,6 +41,9 @@ const char *kHAL3_2 = "3.2";
 const char *kHAL1_0 = "1.0";
 const int kMaxCameraDeviceNameLen = 128;
 const int kMaxCameraIdLen = 16;
+// open_legacy probe results, keyed by the module and vendor build they were taken on
+const char *kOpenLegacyCachePath = "/data/vendor/camera/provider_open_legacy";
+const char *kOpenLegacyCacheTmpPath = "/data/vendor/camera/provider_open_legacy.tmp";
 
 bool matchDeviceName(const hidl_string& deviceName, std::string* deviceVersion,
                      std::string* cameraId) {
@@ -55,6 +61,58 @@ bool matchDeviceName(const hidl_string& deviceName, std::string* deviceVersion,
     return false;
 }
 
+std::string getOpenLegacyCacheKey(const camera_module_t* rawModule, int numCameras) {
+    char fingerprint[PROPERTY_VALUE_MAX];
+    property_get("ro.vendor.build.fingerprint", fingerprint, "");
+    char key[512];
+    snprintf(key, sizeof(key), "%s %x %x %d %s", rawModule->common.name,
+            rawModule->common.module_api_version, rawModule->common.hal_api_version,
+            numCameras, fingerprint);
+    return key;
+}
+
+bool loadOpenLegacyCache(const std::string& key, std::map<std::string, bool>* supported) {
+    FILE* file = fopen(kOpenLegacyCachePath, "re");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[512];
+    bool valid = fgets(line, sizeof(line), file) != nullptr &&
+            strcspn(line, "\n") == key.size() && strncmp(line, key.c_str(), key.size()) == 0;
+    char cameraId[kMaxCameraIdLen];
+    int value;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        if (sscanf(line, "%15s %d", cameraId, &value) != 2) {
+            valid = false;
+            break;
+        }
+        (*supported)[cameraId] = value != 0;
+    }
+    fclose(file);
+
+    if (!valid) {
+        supported->clear();
+    }
+    return valid;
+}
+
+void storeOpenLegacyCache(const std::string& key, const std::map<std::string, bool>& supported) {
+    FILE* file = fopen(kOpenLegacyCacheTmpPath, "we");
+    if (file == nullptr) {
+        ALOGW("%s: cannot write %s: %s", __FUNCTION__, kOpenLegacyCacheTmpPath, strerror(errno));
+        return;
+    }
+    fprintf(file, "%s\n", key.c_str());
+    for (auto const& entry : supported) {
+        fprintf(file, "%s %d\n", entry.first.c_str(), entry.second ? 1 : 0);
+    }
+    if (fclose(file) != 0 || rename(kOpenLegacyCacheTmpPath, kOpenLegacyCachePath) != 0) {
+        ALOGW("%s: cannot store %s: %s", __FUNCTION__, kOpenLegacyCachePath, strerror(errno));
+        unlink(kOpenLegacyCacheTmpPath);
+    }
+}
+
 } // anonymous namespace
 
 using ::android::hardware::camera::common::V1_0::CameraMetadataType;
@@ -190,6 +248,17 @@ bool CameraProvider::initialize() {
     }
 
     mNumberOfLegacyCameras = mModule->getNumberOfCameras();
+
+    // Trial opens take long on legacy modules, so reuse the results of an
+    // earlier boot as long as neither the module nor the vendor build changed.
+    // The probes themselves stay serial as HAL1 modules are rarely reentrant.
+    std::string cacheKey = getOpenLegacyCacheKey(rawModule, mNumberOfLegacyCameras);
+    std::map<std::string, bool> openLegacyProbed; // only cameras which were tried
+    bool haveCache = mModule->isOpenLegacyDefined() &&
+            loadOpenLegacyCache(cacheKey, &openLegacyProbed);
+    bool probed = false;
+    bool probeComplete = true;
+
     for (int i = 0; i < mNumberOfLegacyCameras; i++) {
         struct camera_info info;
         auto rc = mModule->getCameraInfo(i, &info);
@@ -219,24 +288,39 @@ bool CameraProvider::initialize() {
                                getHidlDeviceName(cameraIdStr, deviceVersion)));
         if (deviceVersion >= CAMERA_DEVICE_API_VERSION_3_2 &&
                 mModule->isOpenLegacyDefined()) {
-            // try open_legacy to see if it actually works
-            struct hw_device_t* halDev = nullptr;
-            int ret = mModule->openLegacy(cameraId, CAMERA_DEVICE_API_VERSION_1_0, &halDev);
-            if (ret == 0) {
-                mOpenLegacySupported[cameraIdStr] = true;
-                halDev->close(halDev);
+            auto cached = openLegacyProbed.find(cameraIdStr);
+            if (haveCache && cached != openLegacyProbed.end()) {
+                mOpenLegacySupported[cameraIdStr] = cached->second;
+            } else {
+                // try open_legacy to see if it actually works
+                struct hw_device_t* halDev = nullptr;
+                int ret = mModule->openLegacy(cameraId, CAMERA_DEVICE_API_VERSION_1_0, &halDev);
+                probed = true;
+                if (ret == 0) {
+                    mOpenLegacySupported[cameraIdStr] = true;
+                    halDev->close(halDev);
+                } else if (ret == -EBUSY || ret == -EUSERS) {
+                    // Looks like this provider instance is not initialized during
+                    // system startup and there are other camera users already.
+                    // Not a good sign but not fatal.
+                    ALOGW("%s: open_legacy try failed!", __FUNCTION__);
+                    probeComplete = false;
+                }
+                openLegacyProbed[cameraIdStr] = mOpenLegacySupported[cameraIdStr];
+            }
+            if (mOpenLegacySupported[cameraIdStr]) {
                 mCameraDeviceNames.add(
                         std::make_pair(cameraIdStr,
                                 getHidlDeviceName(cameraIdStr, CAMERA_DEVICE_API_VERSION_1_0)));
-            } else if (ret == -EBUSY || ret == -EUSERS) {
-                // Looks like this provider instance is not initialized during
-                // system startup and there are other camera users already.
-                // Not a good sign but not fatal.
-                ALOGW("%s: open_legacy try failed!", __FUNCTION__);
             }
         }
     }
 
+    // A busy camera says nothing about open_legacy support, probe again next time
+    if (probed && probeComplete) {
+        storeOpenLegacyCache(cacheKey, openLegacyProbed);
+    }
+
     return false; // mInitFailed
 }
 
@@ -16,10 +16,10 @@
 
 #include "Fastboot.h"
 
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 #include <android-base/properties.h>
-#include <android-base/strings.h>
 
 namespace android {
 namespace hardware {
@@ -27,7 +27,10 @@ namespace fastboot {
 namespace V1_1 {
 namespace implementation {
 
-using OEMCommandHandler = std::function<Result(const std::vector<std::string>&)>;
+using OEMCommandHandler = Result (*)(const std::vector<std::string_view>&);
+
+// fastbootd sends the message after "OKAY" in a 256 byte response
+constexpr size_t kMaxMessageSize = 252;
 
 // Methods from ::android::hardware::fastboot::V1_1::IFastboot follow.
 Return<void> Fastboot::getPartitionType(const hidl_string& /* partitionName */,
@@ -36,39 +39,77 @@ Return<void> Fastboot::getPartitionType(const hidl_string& /* partitionName */,
     return Void();
 }
 
-Result GetProp(const std::vector<std::string>& args) {
+// "oem getprop a b c" answers "a: x; b: y; c: z" so scripts can query
+// several properties with one command
+Result GetProp(const std::vector<std::string_view>& args) {
     if (!args.size()) {
         return { Status::INVALID_ARGUMENT, "Property unspecified" };
     }
 
-    auto property = android::base::GetProperty(args[0], "");
+    if (args.size() == 1) {
+        std::string name(args[0]);
+        auto property = android::base::GetProperty(name, "");
+
+        if (!property.empty()) {
+            return { Status::SUCCESS, name + ": " + property };
+        }
+
+        return { Status::FAILURE_UNKNOWN, "Unable to get property" };
+    }
 
-    if (!property.empty()) {
-        return { Status::SUCCESS, args[0] + ": " + property };
+    std::string message;
+    for (const auto& arg : args) {
+        std::string name(arg);
+        if (!message.empty()) message += "; ";
+        message += name + ": " + android::base::GetProperty(name, "");
+        if (message.size() > kMaxMessageSize) {
+            return { Status::FAILURE_UNKNOWN, "Response too long, query fewer properties" };
+        }
     }
 
-    return { Status::FAILURE_UNKNOWN, "Unable to get property" };
+    return { Status::SUCCESS, message };
 }
 
-Return<void> Fastboot::doOemCommand(const hidl_string& oemCmdArgs, doOemCommand_cb _hidl_cb) {
-    const std::unordered_map<std::string, OEMCommandHandler> kOEMCmdMap = {
-        {FB_OEM_GET_PROP, GetProp},
-    };
+struct OEMCommand {
+    std::string_view name;
+    OEMCommandHandler handler;
+};
+
+constexpr OEMCommand kOEMCommands[] = {
+    { FB_OEM_GET_PROP, GetProp },
+};
+
+// Splits on spaces without copying, runs of spaces don't produce empty args
+std::vector<std::string_view> SplitArgs(std::string_view args) {
+    std::vector<std::string_view> result;
+    while (!args.empty()) {
+        size_t start = args.find_first_not_of(' ');
+        if (start == std::string_view::npos) break;
+        args.remove_prefix(start);
+        size_t end = args.find(' ');
+        result.push_back(args.substr(0, end));
+        args.remove_prefix(end == std::string_view::npos ? args.size() : end);
+    }
+    return result;
+}
 
-    auto args = android::base::Split(oemCmdArgs, " ");
+Return<void> Fastboot::doOemCommand(const hidl_string& oemCmdArgs, doOemCommand_cb _hidl_cb) {
+    auto args = SplitArgs(std::string_view(oemCmdArgs.c_str(), oemCmdArgs.size()));
     if (args.size() < 2) {
         _hidl_cb({ Status::INVALID_ARGUMENT, "Invalid OEM command" });
         return Void();
     }
 
     // args[0] will be "oem", args[1] will be the command name
-    auto cmd_handler = kOEMCmdMap.find(args[1]);
-    if (cmd_handler != kOEMCmdMap.end()) {
-        _hidl_cb(cmd_handler->second(std::vector<std::string>(args.begin() + 2, args.end())));
-    } else {
-        _hidl_cb({ Status::FAILURE_UNKNOWN, "Unknown OEM command" });
+    for (const auto& command : kOEMCommands) {
+        if (command.name == args[1]) {
+            args.erase(args.begin(), args.begin() + 2);
+            _hidl_cb(command.handler(args));
+            return Void();
+        }
     }
 
+    _hidl_cb({ Status::FAILURE_UNKNOWN, "Unknown OEM command" });
     return Void();
 }
 
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "FastCharge.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using ::android::base::GetIntProperty;
+using ::android::base::GetProperty;
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+
+namespace vendor {
+namespace lineage {
+namespace fastcharge {
+namespace V1_0 {
+namespace implementation {
+
+static const std::vector<FastChargeNode> kFastChargeNodes = {
+#ifdef FASTCHARGE_PATH
+        {FASTCHARGE_PATH, FASTCHARGE_ENABLED, FASTCHARGE_DISABLED},
+#endif
+        {"/sys/kernel/fast_charge/force_fast_charge", "1", "0"},
+        {"/sys/class/sec/switch/afc_disable", "0", "1"},
+        {"/sys/class/power_supply/battery/fastchg_enable", "1", "0"},
+};
+
+static constexpr const char* kThermalDir = "/sys/class/thermal";
+
+// Thermal zones don't send uevents, look at the temperature at least this
+// often while fast charge is wanted and throttling is configured
+static constexpr int kThermalPollIntervalMs = 10000;
+
+static const FastChargeNode* findNode() {
+    for (const auto& node : kFastChargeNodes) {
+        if (access(node.path.c_str(), R_OK | W_OK) == 0) {
+            return &node;
+        }
+    }
+    LOG(ERROR) << "No accessible fast charge node";
+    return nullptr;
+}
+
+// Thermal zones are numbered in probe order, find the one by its type
+static std::string findThermalZone(const std::string& type) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kThermalDir), closedir);
+    if (!dir) {
+        PLOG(ERROR) << "Failed to open " << kThermalDir;
+        return "";
+    }
+
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (!android::base::StartsWith(entry->d_name, "thermal_zone")) {
+            continue;
+        }
+        std::string zone = std::string(kThermalDir) + "/" + entry->d_name;
+        std::string zoneType;
+        if (ReadFileToString(zone + "/type", &zoneType) &&
+            android::base::Trim(zoneType) == type) {
+            return zone + "/temp";
+        }
+    }
+
+    LOG(ERROR) << "No thermal zone of type " << type;
+    return "";
+}
+
+FastCharge::FastCharge()
+    : mNode(findNode()),
+      mEnabled(-1),
+      mThrottleHighMc(GetIntProperty("ro.vendor.fastcharge.throttle_high_mc", 42000)),
+      mThrottleLowMc(GetIntProperty("ro.vendor.fastcharge.throttle_low_mc", 38000)),
+      mWanted(false),
+      mThrottled(false) {
+    refreshEnabled();
+    mWanted = mEnabled == 1;
+
+    std::string zone = GetProperty("ro.vendor.fastcharge.thermal_zone", "");
+    if (!zone.empty()) {
+        if (mThrottleLowMc >= mThrottleHighMc) {
+            LOG(ERROR) << "Throttle low " << mThrottleLowMc << " not below high "
+                       << mThrottleHighMc << ", not throttling";
+        } else {
+            mThermalZonePath = findThermalZone(zone);
+        }
+    }
+
+    // Both live as long as the service, like this object
+    if (mNode != nullptr && mUevents.ok()) {
+        std::thread(&FastCharge::ueventLoop, this).detach();
+    } else if (mNode != nullptr && !mThermalZonePath.empty()) {
+        LOG(WARNING) << "No uevent socket, polling the temperature";
+        std::thread(&FastCharge::pollLoop, this).detach();
+    }
+}
+
+bool FastCharge::refreshEnabled() {
+    if (mNode == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mRefreshLock);
+    std::string value;
+
+    if (!ReadFileToString(mNode->path, &value)) {
+        LOG(ERROR) << "Failed to read current fast charge value";
+        mEnabled = -1;
+        return false;
+    }
+
+    value = android::base::Trim(value);
+
+    if (value == mNode->value_true) {
+        mEnabled = 1;
+    } else if (value == mNode->value_false) {
+        mEnabled = 0;
+    } else {
+        LOG(ERROR) << "Unknown value " << value;
+        mEnabled = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool FastCharge::writeEnabled(bool enable) {
+    if (mNode == nullptr) {
+        return false;
+    }
+
+    const auto& value = enable ? mNode->value_true : mNode->value_false;
+    if (!WriteStringToFile(value, mNode->path, true)) {
+        LOG(ERROR) << "Failed to write fast charge value";
+        refreshEnabled();
+        return false;
+    }
+
+    if (!refreshEnabled()) {
+        mEnabled = enable;
+    }
+
+    return true;
+}
+
+void FastCharge::applyThrottleLocked() {
+    if (mThermalZonePath.empty()) {
+        return;
+    }
+
+    std::string content;
+    int temp;
+    if (!ReadFileToString(mThermalZonePath, &content, true) ||
+        !android::base::ParseInt(android::base::Trim(content), &temp)) {
+        LOG(ERROR) << "Failed to read " << mThermalZonePath;
+        return;
+    }
+
+    // Only flip at the edges of the window, anything inside keeps the current state
+    if (!mThrottled && temp >= mThrottleHighMc) {
+        mThrottled = true;
+        if (mWanted) {
+            LOG(INFO) << "Temperature at " << temp << " mC, throttling fast charge";
+            writeEnabled(false);
+        }
+    } else if (mThrottled && temp <= mThrottleLowMc) {
+        mThrottled = false;
+        if (mWanted) {
+            LOG(INFO) << "Temperature at " << temp << " mC, resuming fast charge";
+            writeEnabled(true);
+        }
+    }
+}
+
+void FastCharge::ueventLoop() {
+    while (true) {
+        int timeoutMs = -1;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (!mThermalZonePath.empty() && mWanted) {
+                timeoutMs = kThermalPollIntervalMs;
+            }
+        }
+
+        if (mUevents.waitForPowerSupplyEvent(timeoutMs)) {
+            refreshEnabled();
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        applyThrottleLocked();
+    }
+}
+
+void FastCharge::pollLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        if (mWanted) {
+            mPollCond.wait_for(lock, std::chrono::milliseconds(kThermalPollIntervalMs));
+        } else {
+            mPollCond.wait(lock);
+        }
+        applyThrottleLocked();
+    }
+}
+
+Return<bool> FastCharge::isEnabled() {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mThrottled) {
+        // Still on as far as the framework is concerned, it comes back once cooled down
+        return mWanted;
+    }
+
+    int enabled = mEnabled;
+    if (enabled < 0 || !mUevents.ok()) {
+        // Nothing keeps the cache fresh without uevents
+        refreshEnabled();
+        enabled = mEnabled;
+    }
+
+    return enabled > 0;
+}
+
+Return<bool> FastCharge::setEnabled(bool enable) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mWanted = enable;
+    // Start or stop watching the temperature
+    mUevents.wake();
+    mPollCond.notify_one();
+    if (mThrottled && enable) {
+        // Applied once the temperature drops below mThrottleLowMc
+        return true;
+    }
+
+    return writeEnabled(enable);
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace fastcharge
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#define LOG_TAG "vendor.lineage.fastcharge@1.0-service.default"
+
+#include <android-base/logging.h>
+
+#include <vendor/lineage/fastcharge/1.0/IFastCharge.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include <sysfsnode/UeventListener.h>
+
+namespace vendor {
+namespace lineage {
+namespace fastcharge {
+namespace V1_0 {
+namespace implementation {
+
+using ::android::sp;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::vendor::lineage::sysfs::UeventListener;
+
+struct FastChargeNode {
+    const std::string path;
+    const std::string value_true;
+    const std::string value_false;
+};
+
+class FastCharge : public IFastCharge {
+  public:
+    FastCharge();
+
+    Return<bool> isEnabled() override;
+    Return<bool> setEnabled(bool enable) override;
+
+  private:
+    bool refreshEnabled();
+    bool writeEnabled(bool enable);
+    // Steps fast charge down above mThrottleHighMc and back up below
+    // mThrottleLowMc, if a thermal zone was configured
+    void applyThrottleLocked();
+    void ueventLoop();
+    // Keeps throttling without the uevent socket
+    void pollLoop();
+
+    UeventListener mUevents;
+    const FastChargeNode* mNode;
+    std::mutex mRefreshLock;
+    // -1 until the node was read successfully
+    std::atomic<int> mEnabled;
+
+    std::string mThermalZonePath;
+    int mThrottleHighMc;
+    int mThrottleLowMc;
+
+    std::mutex mLock;
+    // What the framework asked for, the node differs while throttled
+    bool mWanted;
+    bool mThrottled;
+    // Wakes pollLoop() when mWanted changes
+    std::condition_variable mPollCond;
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace fastcharge
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "FastCharge.h"
+
+#include <hidl/HidlTransportSupport.h>
+
+using android::hardware::configureRpcThreadpool;
+using android::hardware::joinRpcThreadpool;
+using android::sp;
+
+using vendor::lineage::fastcharge::V1_0::IFastCharge;
+using vendor::lineage::fastcharge::V1_0::implementation::FastCharge;
+
+int main() {
+    sp<IFastCharge> fastChargeService = new FastCharge();
+
+    configureRpcThreadpool(1, true /*callerWillJoin*/);
+
+    if (fastChargeService->registerAsService() != android::OK) {
+        LOG(ERROR) << "Can't register FastCharge HAL service";
+        return 1;
+    }
+
+    joinRpcThreadpool();
+
+    return 0; // should never get here
+}
@@ -6,11 +6,12 @@
 
 #include "ChargingControl.h"
 
-#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/strings.h>
 #include <android/binder_status.h>
+#include <sys/timerfd.h>
 #include <fstream>
+#include <thread>
 #include "android/binder_auto_utils.h"
 
 #define LOG_TAG "vendor.lineage.health-service.default"
@@ -20,6 +21,26 @@ namespace vendor {
 namespace lineage {
 namespace health {
 
+// Not every node shows up together with a power_supply uevent, so look again at least this often
+static constexpr int kNodeRecheckIntervalMs = 1000;
+
+template <typename T, typename PathFn>
+static const T* waitForNode(const std::vector<T>& nodes, PathFn path, UeventListener& uevents) {
+    while (true) {
+        for (const auto& node : nodes) {
+            if (access(path(node).c_str(), R_OK | W_OK) == 0) {
+                return &node;
+            }
+        }
+        LOG(WARNING) << "No accessible charging control node yet, waiting";
+        if (uevents.ok()) {
+            uevents.waitForPowerSupplyEvent(kNodeRecheckIntervalMs);
+        } else {
+            usleep(100000);
+        }
+    }
+}
+
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_TOGGLE
 static const std::vector<ChargingEnabledNode> kChargingEnabledNodes = {
         {HEALTH_CHARGING_CONTROL_CHARGING_PATH, HEALTH_CHARGING_CONTROL_CHARGING_ENABLED,
@@ -30,50 +51,194 @@ static const std::vector<ChargingEnabledNode> kChargingEnabledNodes = {
         {"/sys/class/qcom-battery/input_suspend", "0", "1"},
 };
 
-ChargingControl::ChargingControl() : mChargingEnabledNode(nullptr) {
-    while (!mChargingEnabledNode) {
-        for (const auto& node : kChargingEnabledNodes) {
-            if (access(node.path.c_str(), R_OK | W_OK) == 0) {
-                mChargingEnabledNode = &node;
-                break;
-            }
-            PLOG(WARNING) << "Failed to access() file " << node.path;
-            usleep(100000);
-        }
+static const std::string kBatteryCapacityNode = "/sys/class/power_supply/battery/capacity";
+
+ChargingControl::ChargingControl()
+    : mChargingEnabledNode(nullptr),
+      mChargingEnabled(-1),
+      mBatteryCapacityAttr(kBatteryCapacityNode, SysfsNode::kReadable) {
+    mChargingEnabledNode = waitForNode(
+            kChargingEnabledNodes, [](const ChargingEnabledNode& node) { return node.path; },
+            mUevents);
+    mChargingEnabledAttr =
+            SysfsNode(mChargingEnabledNode->path, SysfsNode::kReadable | SysfsNode::kWritable);
+    refreshChargingEnabled();
+
+    // An alarm timer needs CAP_WAKE_ALARM, without it the deadline is still
+    // kept in boot time but waits for the device to wake up on its own
+    mDeadlineTimer.reset(timerfd_create(CLOCK_BOOTTIME_ALARM, TFD_NONBLOCK | TFD_CLOEXEC));
+    if (!mDeadlineTimer.ok()) {
+        PLOG(WARNING) << "Failed to create an alarm timer, the limit deadline won't wake the device";
+        mDeadlineTimer.reset(timerfd_create(CLOCK_BOOTTIME, TFD_NONBLOCK | TFD_CLOEXEC));
+    }
+
+    if (mUevents.ok()) {
+        // Lives as long as the service, like this object
+        std::thread(&ChargingControl::ueventLoop, this).detach();
     }
 }
 
-ndk::ScopedAStatus ChargingControl::getChargingEnabled(bool* _aidl_return) {
+bool ChargingControl::refreshChargingEnabled() {
+    std::lock_guard<std::mutex> lock(mRefreshLock);
     std::string content;
-    if (!android::base::ReadFileToString(mChargingEnabledNode->path, &content, true)) {
+    if (!mChargingEnabledAttr.read(&content)) {
         LOG(ERROR) << "Failed to read current charging enabled value";
-        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+        mChargingEnabled = -1;
+        return false;
     }
 
     content = android::base::Trim(content);
 
     if (content == mChargingEnabledNode->value_true) {
-        *_aidl_return = true;
+        mChargingEnabled = 1;
     } else if (content == mChargingEnabledNode->value_false) {
-        *_aidl_return = false;
+        mChargingEnabled = 0;
     } else {
         LOG(ERROR) << "Unknown value " << content;
-        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+        mChargingEnabled = -1;
+        return false;
     }
 
-    return ndk::ScopedAStatus::ok();
+    return true;
 }
 
-ndk::ScopedAStatus ChargingControl::setChargingEnabled(bool enabled) {
+bool ChargingControl::writeChargingEnabled(bool enabled) {
     const auto& value =
             enabled ? mChargingEnabledNode->value_true : mChargingEnabledNode->value_false;
-    if (!android::base::WriteStringToFile(value, mChargingEnabledNode->path, true)) {
-        LOG(ERROR) << "Failed to write to charging enable node: " << strerror(errno);
+    {
+        std::lock_guard<std::mutex> lock(mRefreshLock);
+        if (!mChargingEnabledAttr.write(value)) {
+            LOG(ERROR) << "Failed to write to charging enable node";
+            return false;
+        }
+    }
+    refreshChargingEnabled();
+
+    return true;
+}
+
+void ChargingControl::applyChargingLimitLocked() {
+    if (!mChargingLimit) {
+        return;
+    }
+
+    if (mChargingLimit->deadline &&
+        android::base::boot_clock::now() >= *mChargingLimit->deadline) {
+        LOG(INFO) << "Charging limit deadline reached, resuming charging";
+        mChargingLimit.reset();
+        writeChargingEnabled(true);
+        return;
+    }
+
+    int capacity;
+    if (!mBatteryCapacityAttr.read(&capacity)) {
+        LOG(ERROR) << "Failed to read battery capacity";
+        return;
+    }
+
+    // Only flip at the edges of the window, anything inside keeps the current state
+    int enabled = mChargingEnabled;
+    if (capacity >= mChargingLimit->upperSoc && enabled != 0) {
+        writeChargingEnabled(false);
+    } else if (capacity <= mChargingLimit->lowerSoc && enabled != 1) {
+        writeChargingEnabled(true);
+    }
+}
+
+void ChargingControl::armDeadlineTimerLocked() {
+    if (!mDeadlineTimer.ok()) {
+        return;
+    }
+
+    struct itimerspec spec = {};
+    if (mChargingLimit && mChargingLimit->deadline) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          mChargingLimit->deadline->time_since_epoch())
+                          .count();
+        // A zero it_value disarms, a deadline at boot time 0 can't happen
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+    if (timerfd_settime(mDeadlineTimer.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        PLOG(ERROR) << "Failed to arm the charging limit deadline timer";
+    }
+}
+
+void ChargingControl::ueventLoop() {
+    while (true) {
+        int timeoutMs = -1;
+        if (!mDeadlineTimer.ok()) {
+            std::lock_guard<std::mutex> lock(mLimitLock);
+            if (mChargingLimit && mChargingLimit->deadline) {
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                        *mChargingLimit->deadline - android::base::boot_clock::now());
+                timeoutMs = std::max<int64_t>(0, std::min<int64_t>(remaining.count(), INT32_MAX));
+            }
+        }
+
+        if (mUevents.waitForPowerSupplyEvent(timeoutMs, mDeadlineTimer.get())) {
+            refreshChargingEnabled();
+        }
+        if (mDeadlineTimer.ok()) {
+            uint64_t expirations;
+            read(mDeadlineTimer.get(), &expirations, sizeof(expirations));
+        }
+
+        std::lock_guard<std::mutex> lock(mLimitLock);
+        applyChargingLimitLocked();
+    }
+}
+
+ndk::ScopedAStatus ChargingControl::getChargingEnabled(bool* _aidl_return) {
+    int enabled = mChargingEnabled;
+    if (enabled < 0) {
+        // Never read successfully, or the driver reported garbage, retry before giving up
+        if (!refreshChargingEnabled()) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+        }
+        enabled = mChargingEnabled;
+    }
+
+    *_aidl_return = enabled > 0;
+
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus ChargingControl::setChargingEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mLimitLock);
+    // An explicit request from the framework takes over from the limit
+    mChargingLimit.reset();
+    armDeadlineTimerLocked();
+    if (!writeChargingEnabled(enabled)) {
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
     }
 
     return ndk::ScopedAStatus::ok();
 }
+
+ndk::ScopedAStatus ChargingControl::setChargingLimit(int32_t lowerSoc, int32_t upperSoc,
+                                                     int64_t deadline) {
+    if (lowerSoc < 0 || lowerSoc >= upperSoc || upperSoc > 100) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+    if (!mUevents.ok()) {
+        // Nothing would watch the battery level
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+
+    std::lock_guard<std::mutex> lock(mLimitLock);
+    mChargingLimit = ChargingLimit{lowerSoc, upperSoc, std::nullopt};
+    if (deadline > 0) {
+        mChargingLimit->deadline =
+                android::base::boot_clock::now() + std::chrono::seconds(deadline);
+    }
+    armDeadlineTimerLocked();
+    applyChargingLimitLocked();
+    // Without a timer the uevent thread has to pick up the new deadline
+    mUevents.wake();
+
+    return ndk::ScopedAStatus::ok();
+}
 #else
 ndk::ScopedAStatus ChargingControl::getChargingEnabled(bool* /* _aidl_return */) {
     return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
@@ -82,6 +247,12 @@ ndk::ScopedAStatus ChargingControl::getChargingEnabled(bool* /* _aidl_return */)
 ndk::ScopedAStatus ChargingControl::setChargingEnabled(bool /* enabled */) {
     return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
 }
+
+ndk::ScopedAStatus ChargingControl::setChargingLimit(int32_t /* lowerSoc */,
+                                                     int32_t /* upperSoc */,
+                                                     int64_t /* deadline */) {
+    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+}
 #endif
 
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_DEADLINE
@@ -91,22 +262,15 @@ static const std::vector<std::string> kChargingDeadlineNodes = {
 };
 
 ChargingControl::ChargingControl() : mChargingDeadlineNode(nullptr) {
-    while (!mChargingDeadlineNode) {
-        for (const auto& node : kChargingDeadlineNodes) {
-            if (access(node.c_str(), R_OK | W_OK) == 0) {
-                mChargingDeadlineNode = &node;
-                break;
-            }
-            PLOG(WARNING) << "Failed to access() file " << node;
-            usleep(100000);
-        }
-    }
+    mChargingDeadlineNode = waitForNode(
+            kChargingDeadlineNodes, [](const std::string& node) { return node; }, mUevents);
+    mChargingDeadlineAttr = SysfsNode(*mChargingDeadlineNode, SysfsNode::kWritable);
 }
 
 ndk::ScopedAStatus ChargingControl::setChargingDeadline(int64_t deadline) {
-    std::string content = std::to_string(deadline);
-    if (!android::base::WriteStringToFile(content, *mChargingDeadlineNode, true)) {
-        LOG(ERROR) << "Failed to write to charging deadline node: " << strerror(errno);
+    std::lock_guard<std::mutex> lock(mDeadlineLock);
+    if (!mChargingDeadlineAttr.write(deadline)) {
+        LOG(ERROR) << "Failed to write to charging deadline node";
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
     }
 
@@ -123,6 +287,9 @@ ndk::ScopedAStatus ChargingControl::getSupportedMode(int* _aidl_return) {
 
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_TOGGLE
     mode |= static_cast<int>(ChargingControlSupportedMode::TOGGLE);
+    if (mUevents.ok()) {
+        mode |= static_cast<int>(ChargingControlSupportedMode::LIMIT);
+    }
 #endif
 
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_BYPASS
@@ -147,6 +314,13 @@ binder_status_t ChargingControl::dump(int fd, const char** /* args */, uint32_t
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_TOGGLE
     dprintf(fd, "Charging control node selected: %s\n", mChargingEnabledNode->path.c_str());
     dprintf(fd, "Charging enabled: %s\n", isChargingEnabled ? "true" : "false");
+    {
+        std::lock_guard<std::mutex> lock(mLimitLock);
+        if (mChargingLimit) {
+            dprintf(fd, "Charging limit: %d%% - %d%%%s\n", mChargingLimit->lowerSoc,
+                    mChargingLimit->upperSoc, mChargingLimit->deadline ? " with deadline" : "");
+        }
+    }
 #endif
 
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_DEADLINE
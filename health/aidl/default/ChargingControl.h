@@ -8,7 +8,15 @@
 
 #include <aidl/vendor/lineage/health/BnChargingControl.h>
 #include <aidl/vendor/lineage/health/ChargingControlSupportedMode.h>
+#include <android-base/chrono_utils.h>
+#include <android-base/unique_fd.h>
 #include <android/binder_status.h>
+#include <sysfsnode/SysfsNode.h>
+#include <sysfsnode/UeventListener.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
 #include <string>
 #include "android/binder_auto_utils.h"
 
@@ -17,6 +25,9 @@ namespace vendor {
 namespace lineage {
 namespace health {
 
+using ::vendor::lineage::sysfs::SysfsNode;
+using ::vendor::lineage::sysfs::UeventListener;
+
 struct ChargingEnabledNode {
     const std::string path;
     const std::string value_true;
@@ -30,15 +41,46 @@ struct ChargingControl : public BnChargingControl {
     ndk::ScopedAStatus setChargingEnabled(bool enabled) override;
     ndk::ScopedAStatus setChargingDeadline(int64_t deadline) override;
     ndk::ScopedAStatus getSupportedMode(int* _aidl_return) override;
+    ndk::ScopedAStatus setChargingLimit(int32_t lowerSoc, int32_t upperSoc,
+                                        int64_t deadline) override;
     binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
 
   private:
+    UeventListener mUevents;
+
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_TOGGLE
+    struct ChargingLimit {
+        int lowerSoc;
+        int upperSoc;
+        // Boot time, which keeps counting while the device is suspended
+        std::optional<android::base::boot_clock::time_point> deadline;
+    };
+
+    bool refreshChargingEnabled();
+    bool writeChargingEnabled(bool enabled);
+    // Toggles charging to keep the battery inside mChargingLimit, if any
+    void applyChargingLimitLocked();
+    // Arms mDeadlineTimer for the deadline of mChargingLimit, or disarms it
+    void armDeadlineTimerLocked();
+    void ueventLoop();
+
     const ChargingEnabledNode* mChargingEnabledNode;
+    std::mutex mRefreshLock;
+    SysfsNode mChargingEnabledAttr;  // protected by mRefreshLock
+    // -1 until the node was read successfully
+    std::atomic<int> mChargingEnabled;
+
+    std::mutex mLimitLock;
+    std::optional<ChargingLimit> mChargingLimit;
+    // Wakes the uevent thread, and the device, at the limit deadline
+    android::base::unique_fd mDeadlineTimer;
+    SysfsNode mBatteryCapacityAttr;  // protected by mLimitLock
 #endif
 
 #ifdef HEALTH_CHARGING_CONTROL_SUPPORTS_DEADLINE
     const std::string* mChargingDeadlineNode;
+    std::mutex mDeadlineLock;
+    SysfsNode mChargingDeadlineAttr;  // protected by mDeadlineLock
 #endif
 };
 
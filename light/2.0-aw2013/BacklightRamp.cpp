@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "LightService"
+
+#include "BacklightRamp.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+namespace {
+
+constexpr uint32_t kMaxLevel = 255;
+// don't step faster than a 60Hz panel can show it
+constexpr std::chrono::microseconds kMinStepTime(16667);
+
+}  // anonymous namespace
+
+BacklightRamp::BacklightRamp(Writer writer, uint32_t rampMs)
+    : mWriter(std::move(writer)),
+      mStepTime(std::chrono::microseconds(rampMs * 1000ULL) / kMaxLevel),
+      mThread(&BacklightRamp::run, this) {}
+
+BacklightRamp::~BacklightRamp() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_one();
+    mThread.join();
+}
+
+void BacklightRamp::setTarget(uint32_t level) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTarget = std::min(level, kMaxLevel);
+    }
+    mCond.notify_one();
+}
+
+void BacklightRamp::run() {
+    pthread_setname_np(pthread_self(), "BacklightRamp");
+    // Several levels per step when the ramp is fast, so steps never come
+    // faster than kMinStepTime.
+    const std::chrono::microseconds stepTime = std::max(mStepTime, kMinStepTime);
+    const int32_t stepLevels = std::max<int32_t>(1, kMinStepTime / std::max(
+            mStepTime, std::chrono::microseconds(1)));
+
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCond.wait(lock, [this] { return mExit || (mTarget >= 0 && mCurrent != mTarget); });
+        if (mExit) {
+            return;
+        }
+
+        int32_t target = mTarget;
+        if (mCurrent < 0 || target == 0) {
+            mCurrent = target;
+        } else if (mCurrent < target) {
+            mCurrent = std::min(mCurrent + stepLevels, target);
+        } else {
+            mCurrent = std::max(mCurrent - stepLevels, target);
+        }
+        uint32_t level = mCurrent;
+
+        lock.unlock();
+        mWriter(level);
+        lock.lock();
+
+        if (mCurrent != mTarget) {
+            // keep a steady pace even when targets keep coming in
+            mCond.wait_for(lock, stepTime, [this] { return mExit; });
+        }
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
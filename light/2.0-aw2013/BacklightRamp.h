@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANDROID_HARDWARE_LIGHT_V2_0_BACKLIGHTRAMP_H
+#define ANDROID_HARDWARE_LIGHT_V2_0_BACKLIGHTRAMP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+// Moves the backlight towards the latest requested level in small steps
+// from a single worker, so one binder call gives a smooth transition.
+// Levels are in the 0..255 framework range; a target set mid ramp just
+// redirects the ramp in progress.
+class BacklightRamp {
+  public:
+    using Writer = std::function<void(uint32_t level)>;
+
+    // rampMs is the time a full 0..255 transition takes
+    BacklightRamp(Writer writer, uint32_t rampMs);
+    ~BacklightRamp();
+
+    // Turning the backlight off is applied immediately
+    void setTarget(uint32_t level);
+
+  private:
+    void run();
+
+    const Writer mWriter;
+    const std::chrono::microseconds mStepTime;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    int32_t mCurrent = -1;  // -1 until the first level is written
+    int32_t mTarget = -1;   // -1 until the first level is requested
+    bool mExit = false;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_LIGHT_V2_0_BACKLIGHTRAMP_H
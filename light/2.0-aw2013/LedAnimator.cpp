@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "LightService"
+
+#include "LedAnimator.h"
+
+#include <android-base/logging.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+namespace {
+
+// frame interval while ramping, ~30 fps is smooth enough for an LED
+constexpr milliseconds kFrameInterval(33);
+constexpr milliseconds kMaxRamp(500);
+constexpr uint32_t kFullLevel = 1024;
+
+uint32_t scaleChannel(uint32_t color, int shift, uint32_t level) {
+    return ((color >> shift) & 0xff) * level / kFullLevel;
+}
+
+}  // anonymous namespace
+
+LedAnimator::LedAnimator(Writer writer)
+    : mWriter(std::move(writer)),
+      mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      mEventFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      mEpollFd(epoll_create1(EPOLL_CLOEXEC)) {
+    if (!mTimerFd.ok() || !mEventFd.ok() || !mEpollFd.ok()) {
+        PLOG(ERROR) << "Failed to set up LED animation fds";
+        return;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = mTimerFd.get();
+    epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mTimerFd.get(), &ev);
+    ev.data.fd = mEventFd.get();
+    epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mEventFd.get(), &ev);
+    mThread = std::thread(&LedAnimator::run, this);
+}
+
+LedAnimator::~LedAnimator() {
+    if (!mThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    uint64_t val = 1;
+    write(mEventFd.get(), &val, sizeof(val));
+    mThread.join();
+}
+
+void LedAnimator::start(uint32_t color, int onMs, int offMs) {
+    std::lock_guard<std::mutex> lock(mLock);
+    milliseconds on(std::max(onMs, 1));
+    milliseconds off(std::max(offMs, 0));
+    if (mActive && mColor == color && mOn == on && mOff == off) {
+        return;
+    }
+    mActive = true;
+    mColor = color;
+    mOn = on;
+    mOff = off;
+    mRamp = std::min(kMaxRamp, on / 4);
+    mStart = Clock::now();
+    // let the thread render the first frame right away
+    armTimer(mStart);
+}
+
+void LedAnimator::stop() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mActive = false;
+    armTimer(Clock::time_point());
+}
+
+void LedAnimator::armTimer(Clock::time_point deadline) {
+    struct itimerspec spec = {};
+    if (deadline != Clock::time_point()) {
+        // steady_clock is CLOCK_MONOTONIC, an already passed deadline fires at once
+        nanoseconds ns = std::max(deadline.time_since_epoch(), nanoseconds(1));
+        spec.it_value.tv_sec = ns.count() / 1000000000LL;
+        spec.it_value.tv_nsec = ns.count() % 1000000000LL;
+    }
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        PLOG(ERROR) << "Failed to arm LED animation timer";
+    }
+}
+
+// One cycle ramps up, stays lit, ramps down within the on time, then stays
+// dark for the off time. Returns when the next frame is due.
+LedAnimator::Clock::time_point LedAnimator::renderLocked(Clock::time_point now) {
+    milliseconds period = mOn + mOff;
+    milliseconds elapsed = duration_cast<milliseconds>(now - mStart);
+    milliseconds t = elapsed % period;
+    Clock::time_point cycleStart = mStart + (elapsed / period) * period;
+
+    uint32_t level;
+    Clock::time_point next;
+    if (t < mRamp) {
+        level = t.count() * kFullLevel / mRamp.count();
+        next = now + kFrameInterval;
+    } else if (t < mOn - mRamp) {
+        level = kFullLevel;
+        next = cycleStart + mOn - mRamp;
+    } else if (t < mOn) {
+        level = mRamp.count() > 0 ? (mOn - t).count() * kFullLevel / mRamp.count() : kFullLevel;
+        next = mRamp.count() > 0 ? now + kFrameInterval : cycleStart + mOn;
+    } else {
+        level = 0;
+        next = cycleStart + period;
+    }
+
+    mWriter(scaleChannel(mColor, 16, level), scaleChannel(mColor, 8, level),
+            scaleChannel(mColor, 0, level));
+    return next;
+}
+
+void LedAnimator::run() {
+    pthread_setname_np(pthread_self(), "LedAnimator");
+    struct epoll_event events[2];
+    while (true) {
+        int n = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd.get(), events, 2, -1));
+        if (n < 0) {
+            PLOG(ERROR) << "LED animation wait failed";
+            return;
+        }
+        uint64_t val;
+        for (int i = 0; i < n; i++) {
+            // drain, both fds are non blocking
+            read(events[i].data.fd, &val, sizeof(val));
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mExit) {
+            return;
+        }
+        if (!mActive) {
+            continue;
+        }
+        armTimer(renderLocked(Clock::now()));
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
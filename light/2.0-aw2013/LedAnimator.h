@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANDROID_HARDWARE_LIGHT_V2_0_LEDANIMATOR_H
+#define ANDROID_HARDWARE_LIGHT_V2_0_LEDANIMATOR_H
+
+#include <android-base/unique_fd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+// Renders flash patterns in software through the brightness nodes, for
+// colors and timings the hardware breathing engine can't do. A single
+// timerfd driven thread ticks only while ramping and sleeps until the next
+// phase otherwise, so a lit or stopped LED causes no wakeups.
+class LedAnimator {
+  public:
+    // Writes all three channels of one frame
+    using Writer = std::function<void(uint32_t red, uint32_t green, uint32_t blue)>;
+
+    explicit LedAnimator(Writer writer);
+    ~LedAnimator();
+
+    void start(uint32_t color, int onMs, int offMs);
+    // No frame is written once this returns
+    void stop();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    Clock::time_point renderLocked(Clock::time_point now);
+    void armTimer(Clock::time_point deadline);
+
+    const Writer mWriter;
+    android::base::unique_fd mTimerFd;
+    android::base::unique_fd mEventFd;
+    android::base::unique_fd mEpollFd;
+
+    std::mutex mLock;
+    bool mActive = false;
+    bool mExit = false;
+    uint32_t mColor = 0;
+    std::chrono::milliseconds mOn{0};
+    std::chrono::milliseconds mOff{0};
+    std::chrono::milliseconds mRamp{0};
+    Clock::time_point mStart;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_LIGHT_V2_0_LEDANIMATOR_H
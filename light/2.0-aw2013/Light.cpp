@@ -19,12 +19,29 @@
 #include "Light.h"
 
 #include <android-base/logging.h>
+#include <android-base/parsedouble.h>
+#include <android-base/properties.h>
+
+#include <array>
+#include <cmath>
 
 namespace {
 using android::hardware::light::V2_0::LightState;
 
 static constexpr int DEFAULT_MAX_BRIGHTNESS = 255;
 
+// Render blinking in software so any color and timing can be shown, instead
+// of the nearest pure color breathing in whole seconds.
+static const bool kSoftwareBlink =
+        android::base::GetBoolProperty("ro.vendor.light.aw2013.software_blink", false);
+
+// Time a full backlight transition takes when ramping, 0 to apply levels at once
+static const uint32_t kBacklightRampMs =
+        android::base::GetUintProperty("ro.vendor.light.aw2013.backlight_ramp_ms", 0U);
+// Exponent of the curve from framework level to panel level, 1 is linear.
+static const std::string kBacklightGamma =
+        android::base::GetProperty("ro.vendor.light.aw2013.backlight_gamma", "1.0");
+
 static uint32_t rgbToBrightness(const LightState& state) {
     uint32_t color = state.color & 0x00ffffff;
     return ((77 * ((color >> 16) & 0xff)) + (150 * ((color >> 8) & 0xff)) +
@@ -125,15 +142,14 @@ static void rgb2lab(unsigned int R, unsigned int G, unsigned int B,
 }
 
 // find the color with the shortest distance
-static struct color *
-nearest_color(unsigned int r, unsigned int g, unsigned int b)
+static int nearest_color_index(unsigned int r, unsigned int g, unsigned int b)
 {
     int i = 0;
     float _L, _a, _b;
     double L_dist, a_dist, b_dist, total;
     double distance = 3 * 255;
 
-    struct color *nearest = NULL;
+    int nearest = 0;
 
     rgb2lab(r, g, b, &_L, &_a, &_b);
 
@@ -143,7 +159,7 @@ nearest_color(unsigned int r, unsigned int g, unsigned int b)
         b_dist = pow(_b - colors[i]._b, 2);
         total = sqrt(L_dist + a_dist + b_dist);
         if (total < distance) {
-            nearest = &colors[i];
+            nearest = i;
             distance = total;
         }
     }
@@ -151,6 +167,37 @@ nearest_color(unsigned int r, unsigned int g, unsigned int b)
     return nearest;
 }
 
+// Nearest palette entry for every color quantized to 5 bits per channel,
+// filled once at startup so blinking never does Lab math under mLock.
+static constexpr int LUT_BITS = 5;
+static constexpr int LUT_LEVELS = 1 << LUT_BITS;
+static std::array<uint8_t, LUT_LEVELS * LUT_LEVELS * LUT_LEVELS> nearest_lut;
+
+static int lut_index(unsigned int r, unsigned int g, unsigned int b) {
+    constexpr int shift = 8 - LUT_BITS;
+    return ((r >> shift) << (2 * LUT_BITS)) | ((g >> shift) << LUT_BITS) | (b >> shift);
+}
+
+static void build_nearest_lut() {
+    // Sample every cell at its center
+    constexpr int half = 1 << (7 - LUT_BITS);
+    for (int r = 0; r < LUT_LEVELS; r++) {
+        for (int g = 0; g < LUT_LEVELS; g++) {
+            for (int b = 0; b < LUT_LEVELS; b++) {
+                nearest_lut[(r << (2 * LUT_BITS)) | (g << LUT_BITS) | b] = nearest_color_index(
+                        (r << (8 - LUT_BITS)) + half, (g << (8 - LUT_BITS)) + half,
+                        (b << (8 - LUT_BITS)) + half);
+            }
+        }
+    }
+}
+
+static struct color *
+nearest_color(unsigned int r, unsigned int g, unsigned int b)
+{
+    return &colors[nearest_lut[lut_index(r, g, b)]];
+}
+
 }  // anonymous namespace
 
 namespace android {
@@ -159,10 +206,10 @@ namespace light {
 namespace V2_0 {
 namespace implementation {
 
-Light::Light(std::pair<std::ofstream, uint32_t>&& lcd_backlight, std::ofstream&& button_backlight,
-             std::ofstream&& red_led, std::ofstream&& green_led, std::ofstream&& blue_led,
-             std::ofstream&& red_blink, std::ofstream&& green_blink, std::ofstream&& blue_blink,
-             std::ofstream&& red_led_time, std::ofstream&& green_led_time, std::ofstream&& blue_led_time)
+Light::Light(std::pair<SysfsNode, uint32_t>&& lcd_backlight, SysfsNode&& button_backlight,
+             SysfsNode&& red_led, SysfsNode&& green_led, SysfsNode&& blue_led,
+             SysfsNode&& red_blink, SysfsNode&& green_blink, SysfsNode&& blue_blink,
+             SysfsNode&& red_led_time, SysfsNode&& green_led_time, SysfsNode&& blue_led_time)
     : mLcdBacklight(std::move(lcd_backlight)),
       mButtonBacklight(std::move(button_backlight)),
       mRedLed(std::move(red_led)),
@@ -189,6 +236,37 @@ Light::Light(std::pair<std::ofstream, uint32_t>&& lcd_backlight, std::ofstream&&
         rgb2lab(colors[i].r, colors[i].g, colors[i].b,
                 &colors[i]._L, &colors[i]._a, &colors[i]._b);
     }
+    build_nearest_lut();
+
+    double gamma = 1.0;
+    if (!android::base::ParseDouble(kBacklightGamma, &gamma, 0.1, 10.0)) {
+        LOG(ERROR) << "Invalid backlight gamma " << kBacklightGamma << ", using linear";
+        gamma = 1.0;
+    }
+    mLinearCurve = gamma == 1.0;
+    // If max panel brightness is not the default (255), the curve spreads
+    // the levels across the accepted range.
+    for (uint32_t i = 0; i <= DEFAULT_MAX_BRIGHTNESS; i++) {
+        mBrightnessCurve[i] =
+                mLinearCurve ? i * mLcdBacklight.second / DEFAULT_MAX_BRIGHTNESS
+                             : std::lround(pow(i / (double)DEFAULT_MAX_BRIGHTNESS, gamma) *
+                                           mLcdBacklight.second);
+        // a steep curve must not turn the panel off for a non zero level
+        if (!mLinearCurve && i > 0 && mBrightnessCurve[i] == 0) {
+            mBrightnessCurve[i] = 1;
+        }
+    }
+    if (kBacklightRampMs > 0) {
+        mBacklightRamp = std::make_unique<BacklightRamp>(
+                std::bind(&Light::writeLcdBacklight, this, std::placeholders::_1),
+                kBacklightRampMs);
+    }
+
+    if (kSoftwareBlink) {
+        mAnimator = std::make_unique<LedAnimator>(
+                std::bind(&Light::writeSpeakerLight, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+    }
 }
 
 // Methods from ::android::hardware::light::V2_0::ILight follow.
@@ -227,15 +305,24 @@ void Light::setLcdBacklight(const LightState& state) {
 
     uint32_t brightness = rgbToBrightness(state);
 
-    // If max panel brightness is not the default (255),
-    // apply linear scaling across the accepted range.
-    if (mLcdBacklight.second != DEFAULT_MAX_BRIGHTNESS) {
+    if (mBacklightRamp) {
+        mBacklightRamp->setTarget(brightness);
+        return;
+    }
+
+    writeLcdBacklight(brightness);
+}
+
+// Maps a framework level through the brightness curve and writes it. When
+// ramping this is only called from the ramp worker.
+void Light::writeLcdBacklight(uint32_t brightness) {
+    if (mLcdBacklight.second != DEFAULT_MAX_BRIGHTNESS || !mLinearCurve) {
         int old_brightness = brightness;
-        brightness = brightness * mLcdBacklight.second / DEFAULT_MAX_BRIGHTNESS;
+        brightness = mBrightnessCurve[std::min<uint32_t>(brightness, DEFAULT_MAX_BRIGHTNESS)];
         LOG(VERBOSE) << "scaling brightness " << old_brightness << " => " << brightness;
     }
 
-    mLcdBacklight.first << brightness << std::endl;
+    mLcdBacklight.first.write(brightness);
 }
 
 void Light::setButtonsBacklight(const LightState& state) {
@@ -243,7 +330,7 @@ void Light::setButtonsBacklight(const LightState& state) {
 
     uint32_t brightness = rgbToBrightness(state);
 
-    mButtonBacklight << brightness << std::endl;
+    mButtonBacklight.write(brightness);
 }
 
 void Light::setBatteryLight(const LightState& state) {
@@ -267,12 +354,15 @@ void Light::setSpeakerBatteryLightLocked() {
         setSpeakerLightLocked(mBatteryState);
     } else {
         // Lights off
-        mRedLed << 0 << std::endl;
-        mGreenLed << 0 << std::endl;
-        mBlueLed << 0 << std::endl;
-        mRedBlink << 0 << std::endl;
-        mGreenBlink << 0 << std::endl;
-        mBlueBlink << 0 << std::endl;
+        if (mAnimator) {
+            mAnimator->stop();
+        }
+        mRedLed.write(0);
+        mGreenLed.write(0);
+        mBlueLed.write(0);
+        mRedBlink.write(0);
+        mGreenBlink.write(0);
+        mBlueBlink.write(0);
     }
 }
 
@@ -300,10 +390,18 @@ void Light::setSpeakerLightLocked(const LightState& state) {
     blue = colorRGB & 0xff;
     blink = onMs > 0 && offMs > 0;
 
-    // Disable all blinking to start
-    mRedLed << 0 << std::endl;
-    mGreenLed << 0 << std::endl;
-    mBlueLed << 0 << std::endl;
+    if (blink && mAnimator) {
+        // keep the hardware pattern off, the animator owns the brightness now
+        mRedBlink.write(0);
+        mGreenBlink.write(0);
+        mBlueBlink.write(0);
+        mAnimator->start(colorRGB & 0x00ffffff, onMs, offMs);
+        return;
+    }
+    if (mAnimator) {
+        // start() keeps the phase of an unchanged blink, so only stop here
+        mAnimator->stop();
+    }
 
     if (blink) {
         // Driver doesn't permit us to set individual duty cycles, so only
@@ -332,17 +430,41 @@ void Light::setSpeakerLightLocked(const LightState& state) {
         sprintf(breath_pattern, "1 2 1 2");
     }
 
+    int redBlink = blink && red ? 1 : 0;
+    int greenBlink = blink && green ? 1 : 0;
+    int blueBlink = blink && blue ? 1 : 0;
+
+    // Battery updates mostly re-send what is already lit, leave it alone.
+    if (mRedLedTime.isCurrent(breath_pattern) && mRedBlink.isCurrent(redBlink) &&
+        mGreenLedTime.isCurrent(breath_pattern) && mGreenBlink.isCurrent(greenBlink) &&
+        mBlueLedTime.isCurrent(breath_pattern) && mBlueBlink.isCurrent(blueBlink) &&
+        mRedLed.isCurrent(red) && mGreenLed.isCurrent(green) && mBlueLed.isCurrent(blue)) {
+        return;
+    }
+
+    // Disable all blinking to start
+    mRedLed.write(0);
+    mGreenLed.write(0);
+    mBlueLed.write(0);
+
     // Do everything with the lights out, then turn up the brightness
-    mRedLedTime << breath_pattern << std::endl;
-    mRedBlink << (blink && red ? 1 : 0) << std::endl;
-    mGreenLedTime << breath_pattern << std::endl;
-    mGreenBlink << (blink && green ? 1 : 0) << std::endl;
-    mBlueLedTime << breath_pattern << std::endl;
-    mBlueBlink << (blink && blue ? 1 : 0) << std::endl;
-
-    mRedLed << red << std::endl;
-    mGreenLed << green << std::endl;
-    mBlueLed << blue << std::endl;
+    mRedLedTime.write(breath_pattern);
+    mRedBlink.write(redBlink);
+    mGreenLedTime.write(breath_pattern);
+    mGreenBlink.write(greenBlink);
+    mBlueLedTime.write(breath_pattern);
+    mBlueBlink.write(blueBlink);
+
+    mRedLed.write(red);
+    mGreenLed.write(green);
+    mBlueLed.write(blue);
+}
+
+// Called from the animator thread, which serializes it against stop()
+void Light::writeSpeakerLight(uint32_t red, uint32_t green, uint32_t blue) {
+    mRedLed.write(red);
+    mGreenLed.write(green);
+    mBlueLed.write(blue);
 }
 
 }  // namespace implementation
@@ -19,22 +19,29 @@
 
 #include <android/hardware/light/2.0/ILight.h>
 #include <hidl/Status.h>
+#include <sysfsnode/SysfsNode.h>
 
-#include <fstream>
+#include <array>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
+#include "BacklightRamp.h"
+#include "LedAnimator.h"
+
 namespace android {
 namespace hardware {
 namespace light {
 namespace V2_0 {
 namespace implementation {
 
+using ::vendor::lineage::sysfs::SysfsNode;
+
 struct Light : public ILight {
-    Light(std::pair<std::ofstream, uint32_t>&& lcd_backlight, std::ofstream&& button_backlight,
-          std::ofstream&& red_led, std::ofstream&& green_led, std::ofstream&& blue_led,
-          std::ofstream&& red_blink, std::ofstream&& green_blink, std::ofstream&& blue_blink,
-          std::ofstream&& red_led_time, std::ofstream&& green_led_time, std::ofstream&& blue_led_time);
+    Light(std::pair<SysfsNode, uint32_t>&& lcd_backlight, SysfsNode&& button_backlight,
+          SysfsNode&& red_led, SysfsNode&& green_led, SysfsNode&& blue_led,
+          SysfsNode&& red_blink, SysfsNode&& green_blink, SysfsNode&& blue_blink,
+          SysfsNode&& red_led_time, SysfsNode&& green_led_time, SysfsNode&& blue_led_time);
 
     // Methods from ::android::hardware::light::V2_0::ILight follow.
     Return<Status> setLight(Type type, const LightState& state) override;
@@ -45,21 +52,23 @@ struct Light : public ILight {
     void setBatteryLight(const LightState& state);
     void setButtonsBacklight(const LightState& state);
     void setLcdBacklight(const LightState& state);
+    void writeLcdBacklight(uint32_t brightness);
     void setNotificationLight(const LightState& state);
     void setSpeakerBatteryLightLocked();
     void setSpeakerLightLocked(const LightState& state);
+    void writeSpeakerLight(uint32_t red, uint32_t green, uint32_t blue);
 
-    std::pair<std::ofstream, uint32_t> mLcdBacklight;
-    std::ofstream mButtonBacklight;
-    std::ofstream mRedLed;
-    std::ofstream mGreenLed;
-    std::ofstream mBlueLed;
-    std::ofstream mRedBlink;
-    std::ofstream mGreenBlink;
-    std::ofstream mBlueBlink;
-    std::ofstream mRedLedTime;
-    std::ofstream mGreenLedTime;
-    std::ofstream mBlueLedTime;
+    std::pair<SysfsNode, uint32_t> mLcdBacklight;
+    SysfsNode mButtonBacklight;
+    SysfsNode mRedLed;
+    SysfsNode mGreenLed;
+    SysfsNode mBlueLed;
+    SysfsNode mRedBlink;
+    SysfsNode mGreenBlink;
+    SysfsNode mBlueBlink;
+    SysfsNode mRedLedTime;
+    SysfsNode mGreenLedTime;
+    SysfsNode mBlueLedTime;
 
     LightState mAttentionState;
     LightState mBatteryState;
@@ -67,6 +76,16 @@ struct Light : public ILight {
 
     std::unordered_map<Type, std::function<void(const LightState&)>> mLights;
     std::mutex mLock;
+
+    // Only set up when software blinking is enabled. While it animates, the
+    // brightness nodes are written from its thread instead of under mLock.
+    std::unique_ptr<LedAnimator> mAnimator;
+
+    // Panel level for each framework level 0..255
+    std::array<uint32_t, 256> mBrightnessCurve;
+    bool mLinearCurve;
+    // Only set up when ramping is enabled, it then owns the backlight node.
+    std::unique_ptr<BacklightRamp> mBacklightRamp;
 };
 
 }  // namespace implementation
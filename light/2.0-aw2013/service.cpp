@@ -29,6 +29,7 @@ using android::hardware::joinRpcThreadpool;
 // Generated HIDL files
 using android::hardware::light::V2_0::ILight;
 using android::hardware::light::V2_0::implementation::Light;
+using vendor::lineage::sysfs::SysfsNode;
 
 const static std::string kLcdBacklightPath = "/sys/class/leds/lcd-backlight/brightness";
 const static std::string kLcdMaxBacklightPath = "/sys/class/leds/lcd-backlight/max_brightness";
@@ -43,81 +44,85 @@ const static std::string kRedLedTimePath = "/sys/class/leds/red/led_time";
 const static std::string kGreenLedTimePath = "/sys/class/leds/green/led_time";
 const static std::string kBlueLedTimePath = "/sys/class/leds/blue/led_time";
 
+// Nothing else writes these, so repeated values can be skipped
+constexpr int kNodeFlags = SysfsNode::kWritable | SysfsNode::kSkipRedundantWrites;
+// Not every device has buttons or all three LEDs, the light simply doesn't
+// work then instead of reopening and logging on every update.
+constexpr int kOptionalNodeFlags = kNodeFlags | SysfsNode::kOptional;
+
 int main() {
     uint32_t lcdMaxBrightness = 255;
 
-    std::ofstream lcdBacklight(kLcdBacklightPath);
-    if (!lcdBacklight) {
+    SysfsNode lcdBacklight(kLcdBacklightPath, kNodeFlags);
+    if (!lcdBacklight.isOpen()) {
         LOG(ERROR) << "Failed to open " << kLcdBacklightPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
         return -errno;
     }
 
-    std::ifstream lcdMaxBacklight(kLcdMaxBacklightPath);
-    if (!lcdMaxBacklight) {
-        LOG(ERROR) << "Failed to open " << kLcdMaxBacklightPath << ", error=" << errno
+    SysfsNode lcdMaxBacklight(kLcdMaxBacklightPath, SysfsNode::kReadable);
+    if (!lcdMaxBacklight.read(&lcdMaxBrightness)) {
+        LOG(ERROR) << "Failed to read " << kLcdMaxBacklightPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
         return -errno;
-    } else {
-        lcdMaxBacklight >> lcdMaxBrightness;
     }
 
-    std::ofstream buttonBacklight(kButtonBacklightPath);
-    if (!buttonBacklight) {
+    SysfsNode buttonBacklight(kButtonBacklightPath, kOptionalNodeFlags);
+    if (!buttonBacklight.isOpen()) {
         LOG(WARNING) << "Failed to open " << kButtonBacklightPath << ", error=" << errno
                      << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream redLed(kRedLedPath);
-    if (!redLed) {
+    SysfsNode redLed(kRedLedPath, kOptionalNodeFlags);
+    if (!redLed.isOpen()) {
         LOG(ERROR) << "Failed to open " << kRedLedPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream greenLed(kGreenLedPath);
-    if (!greenLed) {
+    SysfsNode greenLed(kGreenLedPath, kOptionalNodeFlags);
+    if (!greenLed.isOpen()) {
         LOG(ERROR) << "Failed to open " << kGreenLedPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream blueLed(kBlueLedPath);
-    if (!blueLed) {
+    SysfsNode blueLed(kBlueLedPath, kOptionalNodeFlags);
+    if (!blueLed.isOpen()) {
         LOG(ERROR) << "Failed to open " << kBlueLedPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream redBlink(kRedBlinkPath);
-    if (!redBlink) {
+    SysfsNode redBlink(kRedBlinkPath, kOptionalNodeFlags);
+    if (!redBlink.isOpen()) {
         LOG(ERROR) << "Failed to open " << kRedBlinkPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream greenBlink(kGreenBlinkPath);
-    if (!greenBlink) {
+    SysfsNode greenBlink(kGreenBlinkPath, kOptionalNodeFlags);
+    if (!greenBlink.isOpen()) {
         LOG(ERROR) << "Failed to open " << kGreenBlinkPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream blueBlink(kBlueBlinkPath);
-    if (!blueBlink) {
+    SysfsNode blueBlink(kBlueBlinkPath, kOptionalNodeFlags);
+    if (!blueBlink.isOpen()) {
         LOG(ERROR) << "Failed to open " << kBlueBlinkPath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream redLedTime(kRedLedTimePath);
-    if (!redLedTime) {
+    SysfsNode redLedTime(kRedLedTimePath, kOptionalNodeFlags);
+    if (!redLedTime.isOpen()) {
         LOG(ERROR) << "Failed to open " << kRedLedTimePath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream greenLedTime(kGreenLedTimePath);
-    if (!greenLedTime) {
+    SysfsNode greenLedTime(kGreenLedTimePath, kOptionalNodeFlags);
+    if (!greenLedTime.isOpen()) {
         LOG(ERROR) << "Failed to open " << kGreenLedTimePath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
 
-    std::ofstream blueLedTime(kBlueLedTimePath);
-    if (!blueLedTime) {
+    SysfsNode blueLedTime(kBlueLedTimePath, kOptionalNodeFlags);
+    if (!blueLedTime.isOpen()) {
         LOG(ERROR) << "Failed to open " << kBlueLedTimePath << ", error=" << errno
                    << " (" << strerror(errno) << ")";
     }
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "livedisplay-ramp"
+
+#include <livedisplay/RampEngine.h>
+
+#include <android-base/logging.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace common {
+
+using ::vendor::lineage::livedisplay::V2_2::DisplayStateField;
+
+static bool hasField(uint32_t fields, DisplayStateField field) {
+    return (fields & static_cast<uint32_t>(field)) != 0;
+}
+
+static float lerp(float from, float to, float t) {
+    return from + (to - from) * t;
+}
+
+static int32_t lerp(int32_t from, int32_t to, float t) {
+    return static_cast<int32_t>(std::lround(from + (to - from) * static_cast<double>(t)));
+}
+
+RampEngine::RampEngine(ApplyFn apply, std::chrono::nanoseconds framePeriod)
+    : mApply(std::move(apply)), mFramePeriod(framePeriod) {
+    mThread = std::thread(&RampEngine::run, this);
+}
+
+RampEngine::~RampEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+        mCond.notify_all();
+    }
+    mThread.join();
+}
+
+void RampEngine::start(const DisplayState& from, const DisplayState& to,
+                       std::chrono::milliseconds duration) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mFrom = from;
+    mTo = to;
+    mStart = std::chrono::steady_clock::now();
+    mDuration = duration;
+    mActive = true;
+    mFirstFrame = true;
+    mGeneration++;
+    mCond.notify_all();
+}
+
+void RampEngine::cancel() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mActive = false;
+    mCond.notify_all();
+    mCond.wait(lock, [this] { return !mApplying; });
+}
+
+bool RampEngine::active() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mActive;
+}
+
+void RampEngine::setFrameTiming(std::chrono::nanoseconds period,
+                                std::chrono::steady_clock::time_point anchor) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mFramePeriod = period;
+    mAnchor = anchor;
+}
+
+DisplayState RampEngine::interpolate(const DisplayState& from, const DisplayState& to, float t) {
+    DisplayState state = to;
+    if (t >= 1.0f) {
+        return state;
+    }
+
+    // A field only the target has can't be interpolated, it jumps
+    uint32_t common = from.fields & to.fields;
+    if (hasField(common, DisplayStateField::PICTURE_ADJUSTMENT)) {
+        const auto& a = from.pictureAdjustment;
+        const auto& b = to.pictureAdjustment;
+        state.pictureAdjustment.hue = lerp(a.hue, b.hue, t);
+        state.pictureAdjustment.saturation = lerp(a.saturation, b.saturation, t);
+        state.pictureAdjustment.intensity = lerp(a.intensity, b.intensity, t);
+        state.pictureAdjustment.contrast = lerp(a.contrast, b.contrast, t);
+        state.pictureAdjustment.saturationThreshold =
+                lerp(a.saturationThreshold, b.saturationThreshold, t);
+    }
+    if (hasField(common, DisplayStateField::COLOR_BALANCE)) {
+        state.colorBalance = lerp(from.colorBalance, to.colorBalance, t);
+    }
+    if (hasField(common, DisplayStateField::COLOR_CALIBRATION) &&
+        from.colorCalibration.size() == to.colorCalibration.size()) {
+        for (size_t i = 0; i < to.colorCalibration.size(); i++) {
+            state.colorCalibration[i] = lerp(from.colorCalibration[i], to.colorCalibration[i], t);
+        }
+    }
+
+    return state;
+}
+
+std::chrono::steady_clock::time_point RampEngine::nextFrameLocked(
+        std::chrono::steady_clock::time_point now) const {
+    auto period = std::max(mFramePeriod, std::chrono::nanoseconds(1000000));
+    auto sinceAnchor = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mAnchor);
+    return mAnchor + (sinceAnchor / period + 1) * period;
+}
+
+void RampEngine::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCond.wait(lock, [this] { return mExit || mActive; });
+        if (mExit) {
+            return;
+        }
+
+        auto next = nextFrameLocked(std::chrono::steady_clock::now());
+        // Woken early by start(), cancel() or exit, those are rechecked first
+        if (mCond.wait_until(lock, next, [this] { return mExit || !mActive; })) {
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        float t = mDuration.count() > 0
+                          ? std::min(1.0f, std::chrono::duration<float>(now - mStart) /
+                                                   std::chrono::duration<float>(mDuration))
+                          : 1.0f;
+        DisplayState state = interpolate(mFrom, mTo, t);
+        if (!mFirstFrame) {
+            // The mode switch went out with the first frame
+            state.fields &= ~static_cast<uint32_t>(DisplayStateField::DISPLAY_MODE);
+        }
+        mFirstFrame = false;
+        if (t >= 1.0f) {
+            mActive = false;
+        }
+
+        uint64_t generation = mGeneration;
+        mApplying = true;
+        lock.unlock();
+        bool ok = mApply(state);
+        lock.lock();
+        mApplying = false;
+        mCond.notify_all();
+
+        // A ramp started during the apply is not the one that failed
+        if (!ok && generation == mGeneration) {
+            LOG(ERROR) << "Failed to apply ramp frame, stopping";
+            mActive = false;
+        }
+    }
+}
+
+}  // namespace common
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
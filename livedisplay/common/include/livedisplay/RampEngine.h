@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <vendor/lineage/livedisplay/2.2/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace common {
+
+using ::vendor::lineage::livedisplay::V2_2::DisplayState;
+
+// Runs IDisplayState::rampDisplayState() for an implementation: interpolates
+// between two states and hands one state per frame to the apply function,
+// on frame boundaries of the configured period.
+class RampEngine {
+  public:
+    // Programs the hardware with one state, called on the ramp thread
+    using ApplyFn = std::function<bool(const DisplayState& state)>;
+
+    RampEngine(ApplyFn apply, std::chrono::nanoseconds framePeriod);
+    ~RampEngine();
+
+    // Moves from `from` to `to` over duration, replacing a ramp in progress
+    void start(const DisplayState& from, const DisplayState& to,
+               std::chrono::milliseconds duration);
+    // Stops a ramp in progress where it is, e.g. before an immediate apply.
+    // Returns once no apply call is running any more.
+    void cancel();
+    bool active();
+
+    // Vendor HALs have no vsync signal from SurfaceFlinger. Frames are
+    // aligned to steps of the period since the anchor, which should be a
+    // vsync timestamp if the panel driver exposes one.
+    void setFrameTiming(std::chrono::nanoseconds period,
+                        std::chrono::steady_clock::time_point anchor = {});
+
+    // Between from and to, at progress t in [0, 1]
+    static DisplayState interpolate(const DisplayState& from, const DisplayState& to, float t);
+
+  private:
+    void run();
+    std::chrono::steady_clock::time_point nextFrameLocked(
+            std::chrono::steady_clock::time_point now) const;
+
+    const ApplyFn mApply;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::chrono::nanoseconds mFramePeriod;         // protected by mLock
+    std::chrono::steady_clock::time_point mAnchor;  // protected by mLock
+    bool mActive = false;                           // protected by mLock
+    bool mApplying = false;                         // protected by mLock
+    bool mExit = false;                             // protected by mLock
+    bool mFirstFrame = false;                       // protected by mLock
+    uint64_t mGeneration = 0;                       // protected by mLock, bumped by start()
+    DisplayState mFrom;                             // protected by mLock
+    DisplayState mTo;                               // protected by mLock
+    std::chrono::steady_clock::time_point mStart;   // protected by mLock
+    std::chrono::nanoseconds mDuration;             // protected by mLock
+    std::thread mThread;
+};
+
+}  // namespace common
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "MotHealth.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+using ::android::base::ReadFileToString;
+
+namespace motorola {
+namespace hardware {
+namespace health {
+namespace V1_1 {
+namespace implementation {
+
+// Mod battery as exposed by the greybus power_supply driver
+static const std::string kModBatteryPath = "/sys/class/power_supply/gb_battery";
+static const std::string kModPtpPath = "/sys/class/power_supply/gb_ptp";
+static const std::string kBatteryPath = "/sys/class/power_supply/battery";
+
+static int32_t readInt(const std::string& path, int32_t defaultValue) {
+    std::string content;
+    int32_t value;
+    if (!ReadFileToString(path, &content, true) ||
+        !android::base::ParseInt(android::base::Trim(content), &value)) {
+        return defaultValue;
+    }
+    return value;
+}
+
+// Same values as android.os.BatteryManager.BATTERY_STATUS_*
+static int32_t readStatus(const std::string& path) {
+    std::string content;
+    if (!ReadFileToString(path, &content, true)) {
+        return 1;
+    }
+
+    content = android::base::Trim(content);
+    if (content == "Charging") return 2;
+    if (content == "Discharging") return 3;
+    if (content == "Not charging") return 4;
+    if (content == "Full") return 5;
+    return 1;
+}
+
+MotHealth::MotHealth() : mSnapshot(readSnapshot()) {
+    if (mUevents.ok()) {
+        // Lives as long as the service, like this object
+        std::thread(&MotHealth::ueventLoop, this).detach();
+    }
+}
+
+HealthSnapshot MotHealth::readSnapshot() {
+    HealthSnapshot snapshot = {};
+    snapshot.props.modLevel = readInt(kModBatteryPath + "/capacity", -1);
+    snapshot.props.modStatus = readStatus(kModBatteryPath + "/status");
+    snapshot.props.modFlag = readInt(kModPtpPath + "/internal_send", 0);
+    snapshot.props.modType = readInt(kModPtpPath + "/mod_type", 0);
+    snapshot.props.modPowerSource = readInt(kModPtpPath + "/power_source", 0);
+    snapshot.props.batteryLevel = readInt(kBatteryPath + "/capacity", -1);
+    snapshot.modChargeFull = readInt(kModBatteryPath + "/charge_full_design", -1);
+    snapshot.batteryChargeFull = readInt(kBatteryPath + "/charge_full", -1);
+    return snapshot;
+}
+
+HealthSnapshot MotHealth::getSnapshot() {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mUevents.ok()) {
+        // Nothing keeps the cache fresh without uevents
+        mSnapshot = readSnapshot();
+    }
+    return mSnapshot;
+}
+
+void MotHealth::ueventLoop() {
+    while (true) {
+        if (!mUevents.waitForPowerSupplyEvent(-1)) {
+            continue;
+        }
+
+        HealthSnapshot snapshot = readSnapshot();
+        std::lock_guard<std::mutex> delivery(mDeliveryLock);
+        std::vector<sp<IMotHealthCallback>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            bool propsChanged = snapshot.props != mSnapshot.props;
+            mSnapshot = snapshot;
+            if (!propsChanged) {
+                continue;
+            }
+            callbacks = mCallbacks;
+        }
+
+        for (const auto& callback : callbacks) {
+            if (!callback->modBatteryPropertiesChanged(snapshot.props).isOk()) {
+                LOG(WARNING) << "Dropping dead mod battery callback";
+                unregisterCallback(callback);
+            }
+        }
+    }
+}
+
+// Methods from ::motorola::hardware::health::V1_0::IMotHealth follow.
+Return<int32_t> MotHealth::getModChargeFull() {
+    return getSnapshot().modChargeFull;
+}
+
+Return<int32_t> MotHealth::getBatteryChargeFull() {
+    return getSnapshot().batteryChargeFull;
+}
+
+Return<void> MotHealth::getModBatteryProperties(getModBatteryProperties_cb _hidl_cb) {
+    _hidl_cb(getSnapshot().props);
+    return Void();
+}
+
+// Methods from ::motorola::hardware::health::V1_1::IMotHealth follow.
+Return<void> MotHealth::getHealthSnapshot(getHealthSnapshot_cb _hidl_cb) {
+    _hidl_cb(getSnapshot());
+    return Void();
+}
+
+Return<bool> MotHealth::registerCallback(const sp<IMotHealthCallback>& callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+
+    // Held until the first delivery is sent, so it can't overtake a newer one
+    std::lock_guard<std::mutex> delivery(mDeliveryLock);
+    BatteryProperties props;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const auto& registered : mCallbacks) {
+            if (::android::hardware::interfacesEqual(registered, callback)) {
+                return true;
+            }
+        }
+        mCallbacks.push_back(callback);
+        props = mSnapshot.props;
+    }
+
+    // Start from the current state so the client never has to poll
+    if (!callback->modBatteryPropertiesChanged(props).isOk()) {
+        unregisterCallback(callback);
+        return false;
+    }
+
+    return true;
+}
+
+Return<bool> MotHealth::unregisterCallback(const sp<IMotHealthCallback>& callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = std::find_if(mCallbacks.begin(), mCallbacks.end(), [&](const auto& registered) {
+        return ::android::hardware::interfacesEqual(registered, callback);
+    });
+    if (it == mCallbacks.end()) {
+        return false;
+    }
+
+    mCallbacks.erase(it);
+
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace V1_1
+}  // namespace health
+}  // namespace hardware
+}  // namespace motorola
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#define LOG_TAG "motorola.hardware.health@1.1-service"
+
+#include <android-base/logging.h>
+
+#include <motorola/hardware/health/1.1/IMotHealth.h>
+
+#include <mutex>
+#include <vector>
+
+#include <sysfsnode/UeventListener.h>
+
+namespace motorola {
+namespace hardware {
+namespace health {
+namespace V1_1 {
+namespace implementation {
+
+using ::android::sp;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::motorola::hardware::health::V1_0::BatteryProperties;
+using ::vendor::lineage::sysfs::UeventListener;
+
+class MotHealth : public IMotHealth {
+  public:
+    MotHealth();
+
+    // Methods from ::motorola::hardware::health::V1_0::IMotHealth follow.
+    Return<int32_t> getModChargeFull() override;
+    Return<int32_t> getBatteryChargeFull() override;
+    Return<void> getModBatteryProperties(getModBatteryProperties_cb _hidl_cb) override;
+
+    // Methods from ::motorola::hardware::health::V1_1::IMotHealth follow.
+    Return<void> getHealthSnapshot(getHealthSnapshot_cb _hidl_cb) override;
+    Return<bool> registerCallback(const sp<IMotHealthCallback>& callback) override;
+    Return<bool> unregisterCallback(const sp<IMotHealthCallback>& callback) override;
+
+  private:
+    static HealthSnapshot readSnapshot();
+    // Cached while uevents keep it fresh, read from sysfs otherwise
+    HealthSnapshot getSnapshot();
+    void ueventLoop();
+
+    UeventListener mUevents;
+    // Orders callback deliveries, taken before mLock
+    std::mutex mDeliveryLock;
+    std::mutex mLock;
+    HealthSnapshot mSnapshot;
+    std::vector<sp<IMotHealthCallback>> mCallbacks;
+};
+
+}  // namespace implementation
+}  // namespace V1_1
+}  // namespace health
+}  // namespace hardware
+}  // namespace motorola
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "MotHealth.h"
+
+#include <hidl/HidlTransportSupport.h>
+
+using android::hardware::configureRpcThreadpool;
+using android::hardware::joinRpcThreadpool;
+using android::sp;
+
+using motorola::hardware::health::V1_1::IMotHealth;
+using motorola::hardware::health::V1_1::implementation::MotHealth;
+
+int main() {
+    sp<IMotHealth> motHealthService = new MotHealth();
+
+    configureRpcThreadpool(1, true /*callerWillJoin*/);
+
+    if (motHealthService->registerAsService() != android::OK) {
+        LOG(ERROR) << "Can't register MotHealth HAL service";
+        return 1;
+    }
+
+    joinRpcThreadpool();
+
+    return 0; // should never get here
+}
@@ -1,31 +1,202 @@
 #define LOG_TAG "android.hardware.nfc@1.0-impl"
 
+#include <android-base/properties.h>
 #include <log/log.h>
 
 #include <hardware/hardware.h>
 #include <hardware/nfc.h>
 #include "Nfc.h"
 
+#include <algorithm>
+#include <chrono>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 namespace android {
 namespace hardware {
 namespace nfc {
 namespace V1_0 {
 namespace implementation {
 
-sp<INfcClientCallback> Nfc::mCallback = nullptr;
+Nfc* Nfc::sInstance = nullptr;
+
+// NCI control and data packets both start with a 3 byte header whose last
+// byte is the payload length
+static constexpr size_t kNciHeaderSize = 3;
 
 Nfc::Nfc(nfc_nci_device_t* device) : mDevice(device),
-    mDeathRecipient(new NfcDeathRecipient(this)) {
+    mDeathRecipient(new NfcDeathRecipient(this)),
+    mBatchedWrite(android::base::GetBoolProperty("ro.vendor.nfc.bcm.batched_write", false)),
+    mMutableCoreInit(android::base::GetBoolProperty("ro.vendor.nfc.bcm.mutable_core_init", false)) {
+    sInstance = this;
+    mFrameEvent = eventfd(0, EFD_CLOEXEC);
+    if (mFrameEvent < 0) {
+        ALOGE("Can't create callback dispatcher event: %s", strerror(errno));
+    } else {
+        mDispatchThread = std::thread(&Nfc::dispatchLoop, this);
+    }
+}
+
+Nfc::~Nfc() {
+    if (mDispatchThread.joinable()) {
+        mDispatchExit = true;
+        uint64_t one = 1;
+        if (::write(mFrameEvent, &one, sizeof(one)) == sizeof(one)) {
+            mDispatchThread.join();
+            ::close(mFrameEvent);
+        } else {
+            mDispatchThread.detach();
+        }
+    }
+    if (sInstance == this) {
+        sInstance = nullptr;
+    }
+}
+
+void Nfc::eventCallback(uint8_t event, uint8_t status) {
+    Nfc* nfc = sInstance;
+    if (nfc == nullptr) return;
+
+    nfc->mStats.recordEvent();
+    Frame frame;
+    frame.isEvent = true;
+    frame.event = event;
+    frame.status = status;
+    frame.size = 0;
+    frame.whenNs = NfcStats::nowNs();
+    frame.heapData = nullptr;
+    if (!nfc->enqueueFrame(frame)) {
+        nfc->deliverFrame(nfc->getCallback(), frame, nullptr);
+    }
+}
+
+void Nfc::dataCallback(uint16_t data_len, uint8_t* p_data) {
+    Nfc* nfc = sInstance;
+    if (nfc == nullptr) return;
+
+    nfc->mStats.recordData(data_len);
+    Frame frame;
+    frame.isEvent = false;
+    frame.event = 0;
+    frame.status = 0;
+    frame.size = data_len;
+    frame.whenNs = NfcStats::nowNs();
+    frame.heapData = nullptr;
+    if (data_len > kMaxFrameSize) {
+        if (nfc->mFrameEvent < 0) {
+            nfc->deliverFrame(nfc->getCallback(), frame, p_data);
+            return;
+        }
+        // Rare, queueing it as well keeps the order without waiting here
+        frame.heapData = new uint8_t[data_len];
+        memcpy(frame.heapData, p_data, data_len);
+        nfc->enqueueFrame(frame);
+        return;
+    }
+
+    memcpy(frame.data, p_data, data_len);
+    if (!nfc->enqueueFrame(frame)) {
+        nfc->deliverFrame(nfc->getCallback(), frame, frame.data);
+    }
+}
+
+// Returns false when there's no dispatcher and the caller has to deliver
+bool Nfc::enqueueFrame(const Frame& frame) {
+    if (mFrameEvent < 0) return false;
+
+    // Events can come from the caller of open() as well as the reader thread
+    while (mFrameProducerLock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    size_t head = mFrameHead.load(std::memory_order_relaxed);
+    while (head - mFrameTail.load(std::memory_order_acquire) == kFrameQueueSize) {
+        // Only when the NFC process has been stuck for a whole queue of frames
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Frame& slot = mFrames[head & (kFrameQueueSize - 1)];
+    slot.isEvent = frame.isEvent;
+    slot.event = frame.event;
+    slot.status = frame.status;
+    slot.size = frame.size;
+    slot.whenNs = frame.whenNs;
+    slot.heapData = frame.heapData;
+    if (!frame.isEvent && frame.heapData == nullptr) {
+        memcpy(slot.data, frame.data, frame.size);
+    }
+    mFrameHead.store(head + 1, std::memory_order_release);
+    mFrameProducerLock.clear(std::memory_order_release);
+
+    uint64_t one = 1;
+    if (::write(mFrameEvent, &one, sizeof(one)) != sizeof(one)) {
+        ALOGE("Can't wake up callback dispatcher: %s", strerror(errno));
+    }
+    return true;
+}
+
+void Nfc::dispatchLoop() {
+    while (true) {
+        uint64_t count;
+        if (::read(mFrameEvent, &count, sizeof(count)) < 0 && errno != EINTR) {
+            ALOGE("Can't wait for NFC callbacks: %s", strerror(errno));
+            return;
+        }
+
+        size_t tail = mFrameTail.load(std::memory_order_relaxed);
+        while (tail != mFrameHead.load(std::memory_order_acquire)) {
+            // Delivered straight from the slot, the producer won't reuse it
+            // before the tail moves past it
+            Frame& frame = mFrames[tail & (kFrameQueueSize - 1)];
+            deliverFrame(getCallback(), frame,
+                         frame.heapData != nullptr ? frame.heapData : frame.data);
+            delete[] frame.heapData;
+            frame.heapData = nullptr;
+            mFrameTail.store(++tail, std::memory_order_release);
+        }
+
+        if (mDispatchExit.load()) return;
+    }
+}
+
+sp<INfcClientCallback> Nfc::getCallback() {
+    std::lock_guard<std::mutex> lock(mCallbackLock);
+    return mCallback;
+}
+
+void Nfc::deliverFrame(const sp<INfcClientCallback>& callback, const Frame& frame,
+                       const uint8_t* data) {
+    if (callback == nullptr) return;
+
+    int64_t startNs = NfcStats::nowNs();
+    Return<void> ret;
+    if (frame.isEvent) {
+        ret = callback->sendEvent((::android::hardware::nfc::V1_0::NfcEvent) frame.event,
+                                  (::android::hardware::nfc::V1_0::NfcStatus) frame.status);
+    } else {
+        hidl_vec<uint8_t> hidlData;
+        hidlData.setToExternal(const_cast<uint8_t*>(data), frame.size);
+        ret = callback->sendData(hidlData);
+    }
+    mStats.recordDelivery(frame.whenNs, startNs, NfcStats::nowNs());
+    if (!ret.isOk()) {
+        ALOGW("Failed to call back into NFC process.");
+    }
 }
 
 // Methods from ::android::hardware::nfc::V1_0::INfc follow.
 ::android::hardware::Return<NfcStatus> Nfc::open(const sp<INfcClientCallback>& clientCallback)  {
-    mCallback = clientCallback;
+    {
+        std::lock_guard<std::mutex> lock(mCallbackLock);
+        mCallback = clientCallback;
+    }
 
-    if (mDevice == nullptr || mCallback == nullptr) {
+    if (mDevice == nullptr || clientCallback == nullptr) {
         return NfcStatus::FAILED;
     }
-    mCallback->linkToDeath(mDeathRecipient, 0 /*cookie*/);
+    clientCallback->linkToDeath(mDeathRecipient, 0 /*cookie*/);
+    mStats.startSession();
     int ret = mDevice->open(mDevice, eventCallback, dataCallback);
     return ret == 0 ? NfcStatus::OK : NfcStatus::FAILED;
 }
@@ -34,16 +205,50 @@ Nfc::Nfc(nfc_nci_device_t* device) : mDevice(device),
     if (mDevice == nullptr) {
         return -1;
     }
-    return mDevice->write(mDevice, data.size(), &data[0]);
+    if (mBatchedWrite) {
+        return writeBatch(data.data(), data.size());
+    }
+    mStats.recordWrite(data.size());
+    return mDevice->write(mDevice, data.size(), data.data());
 }
 
-::android::hardware::Return<NfcStatus> Nfc::coreInitialized(const hidl_vec<uint8_t>& data)  {
-    hidl_vec<uint8_t> copy = data;
+// Clients may pack several NCI packets into one write() so a transceive
+// sequence costs a single HIDL call. The vendor HAL still wants them one by
+// one, returns how many bytes made it.
+uint32_t Nfc::writeBatch(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t packetSize = size - offset;
+        if (packetSize > kNciHeaderSize) {
+            packetSize = std::min(packetSize, kNciHeaderSize + data[offset + 2]);
+        }
+        mStats.recordWrite(packetSize);
+        int ret = mDevice->write(mDevice, packetSize, data + offset);
+        if (ret != static_cast<int>(packetSize)) {
+            ALOGE("NCI write of %zu bytes at %zu/%zu failed: %d", packetSize, offset, size, ret);
+            return offset == 0 ? ret : offset;
+        }
+        offset += packetSize;
+    }
+    return offset;
+}
 
+::android::hardware::Return<NfcStatus> Nfc::coreInitialized(const hidl_vec<uint8_t>& data)  {
     if (mDevice == nullptr) {
         return NfcStatus::FAILED;
     }
-    int ret = mDevice->core_initialized(mDevice, &copy[0]);
+
+    // The parameters sit in the read-only hwbinder buffer. Stock Broadcom HALs
+    // only read them despite the non-const prototype, so only copy for those
+    // which don't.
+    if (!mMutableCoreInit) {
+        int ret = mDevice->core_initialized(mDevice, const_cast<uint8_t*>(data.data()));
+        return ret == 0 ? NfcStatus::OK : NfcStatus::FAILED;
+    }
+
+    std::lock_guard<std::mutex> lock(mScratchLock);
+    mScratch.assign(data.begin(), data.end());
+    int ret = mDevice->core_initialized(mDevice, mScratch.data());
     return ret == 0 ? NfcStatus::OK : NfcStatus::FAILED;
 }
 
@@ -55,11 +260,14 @@ Nfc::Nfc(nfc_nci_device_t* device) : mDevice(device),
 }
 
 ::android::hardware::Return<NfcStatus> Nfc::close()  {
-    if (mDevice == nullptr || mCallback == nullptr) {
+    sp<INfcClientCallback> callback = getCallback();
+    if (mDevice == nullptr || callback == nullptr) {
         return NfcStatus::FAILED;
     }
-    mCallback->unlinkToDeath(mDeathRecipient);
-    return mDevice->close(mDevice) ? NfcStatus::FAILED : NfcStatus::OK;
+    callback->unlinkToDeath(mDeathRecipient);
+    int ret = mDevice->close(mDevice);
+    mStats.endSession();
+    return ret ? NfcStatus::FAILED : NfcStatus::OK;
 }
 
 ::android::hardware::Return<NfcStatus> Nfc::controlGranted()  {
@@ -76,6 +284,14 @@ Nfc::Nfc(nfc_nci_device_t* device) : mDevice(device),
     return mDevice->power_cycle(mDevice) ? NfcStatus::FAILED : NfcStatus::OK;
 }
 
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+::android::hardware::Return<void> Nfc::debug(const hidl_handle& handle,
+                                             const hidl_vec<hidl_string>& /*args*/)  {
+    if (handle == nullptr || handle->numFds < 1) return Void();
+    mStats.dump(handle->data[0]);
+    return Void();
+}
+
 
 INfc* HIDL_FETCH_INfc(const char * /*name*/) {
     nfc_nci_device_t* nfc_device;
@@ -5,6 +5,15 @@
 #include <hidl/Status.h>
 #include <hardware/hardware.h>
 #include <hardware/nfc.h>
+
+#include "NfcStats.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace android {
 namespace hardware {
 namespace nfc {
@@ -13,6 +22,7 @@ namespace implementation {
 
 using ::android::hardware::nfc::V1_0::INfc;
 using ::android::hardware::nfc::V1_0::INfcClientCallback;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 using ::android::hardware::hidl_vec;
@@ -31,6 +41,7 @@ struct NfcDeathRecipient : hidl_death_recipient {
 
 struct Nfc : public INfc {
   Nfc(nfc_nci_device_t* device);
+  ~Nfc();
   ::android::hardware::Return<NfcStatus> open(const sp<INfcClientCallback>& clientCallback)  override;
   ::android::hardware::Return<uint32_t> write(const hidl_vec<uint8_t>& data)  override;
   ::android::hardware::Return<NfcStatus> coreInitialized(const hidl_vec<uint8_t>& data)  override;
@@ -39,30 +50,60 @@ struct Nfc : public INfc {
   ::android::hardware::Return<NfcStatus> controlGranted()  override;
   ::android::hardware::Return<NfcStatus> powerCycle()  override;
 
-  static void eventCallback(uint8_t event, uint8_t status) {
-      if (mCallback != nullptr) {
-          auto ret = mCallback->sendEvent(
-                  (::android::hardware::nfc::V1_0::NfcEvent) event,
-                  (::android::hardware::nfc::V1_0::NfcStatus) status);
-          if (!ret.isOk()) {
-              ALOGW("Failed to call back into NFC process.");
-          }
-      }
-  }
-  static void dataCallback(uint16_t data_len, uint8_t* p_data) {
-      hidl_vec<uint8_t> data;
-      data.setToExternal(p_data, data_len);
-      if (mCallback != nullptr) {
-          auto ret = mCallback->sendData(data);
-          if (!ret.isOk()) {
-              ALOGW("Failed to call back into NFC process.");
-          }
-      }
-  }
+  // Methods from ::android::hidl::base::V1_0::IBase follow.
+  ::android::hardware::Return<void> debug(const hidl_handle& handle,
+                                          const hidl_vec<hidl_string>& args)  override;
+
+  // Called on the Broadcom stack's threads, they only queue a copy and
+  // mDispatchThread makes the binder call
+  static void eventCallback(uint8_t event, uint8_t status);
+  static void dataCallback(uint16_t data_len, uint8_t* p_data);
+
   private:
-    static sp<INfcClientCallback> mCallback;
+    // Largest NCI packet, 3 byte header and 255 byte payload. Anything bigger
+    // is copied to the heap and queued by pointer.
+    static constexpr size_t kMaxFrameSize = 258;
+    static constexpr size_t kFrameQueueSize = 128; // power of two
+
+    struct Frame {
+        bool     isEvent;
+        uint8_t  event;
+        uint8_t  status;
+        uint16_t size;
+        int64_t  whenNs; // when the vendor HAL called back
+        uint8_t* heapData; // oversize payload, freed by the dispatcher
+        uint8_t  data[kMaxFrameSize];
+    };
+
+    uint32_t writeBatch(const uint8_t* data, size_t size);
+    bool enqueueFrame(const Frame& frame);
+    void dispatchLoop();
+    sp<INfcClientCallback> getCallback();
+    void deliverFrame(const sp<INfcClientCallback>& callback, const Frame& frame,
+                      const uint8_t* data);
+
+    static Nfc*                   sInstance;
+    std::mutex                    mCallbackLock;
+    sp<INfcClientCallback>        mCallback;
     const nfc_nci_device_t*       mDevice;
     sp<NfcDeathRecipient>         mDeathRecipient;
+    // Split write() payloads into NCI packets, ro.vendor.nfc.bcm.batched_write
+    const bool                    mBatchedWrite;
+    // Vendor HAL writes to the core_initialized() parameters,
+    // ro.vendor.nfc.bcm.mutable_core_init
+    const bool                    mMutableCoreInit;
+    std::mutex                    mScratchLock;
+    std::vector<uint8_t>          mScratch;
+
+    std::array<Frame, kFrameQueueSize> mFrames;
+    std::atomic<size_t>           mFrameHead{0}; // written by producers only
+    std::atomic<size_t>           mFrameTail{0}; // written by mDispatchThread only
+    std::atomic_flag              mFrameProducerLock = ATOMIC_FLAG_INIT;
+    int                           mFrameEvent = -1;
+    std::atomic<bool>             mDispatchExit{false};
+    std::thread                   mDispatchThread;
+
+    NfcStats                      mStats;
 };
 
 extern "C" INfc* HIDL_FETCH_INfc(const char* name);
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "NfcStats.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace android {
+namespace hardware {
+namespace nfc {
+namespace V1_0 {
+namespace implementation {
+
+int64_t NfcStats::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+void NfcStats::Histogram::record(int64_t ns) {
+    uint32_t us = std::min<int64_t>(std::max<int64_t>(ns, 0) / 1000, UINT32_MAX);
+    uint32_t scaled = us >> 7;
+    size_t bucket = 0;
+    while (scaled != 0 && bucket < kBuckets - 1) {
+        scaled >>= 1;
+        bucket++;
+    }
+
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(us, std::memory_order_relaxed);
+    uint32_t max = maxUs.load(std::memory_order_relaxed);
+    while (us > max && !maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void NfcStats::Histogram::reset() {
+    for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    totalUs.store(0, std::memory_order_relaxed);
+    maxUs.store(0, std::memory_order_relaxed);
+}
+
+void NfcStats::Histogram::dump(int fd, const char* name) const {
+    uint32_t counts[kBuckets];
+    uint32_t total = 0;
+    for (size_t b = 0; b < kBuckets; b++) {
+        counts[b] = buckets[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    if (total == 0) {
+        dprintf(fd, "    %s: no samples\n", name);
+        return;
+    }
+
+    dprintf(fd, "    %s: %u samples, avg %.2f ms, max %.2f ms\n     ", name, total,
+            totalUs.load(std::memory_order_relaxed) / 1000.0 / total,
+            maxUs.load(std::memory_order_relaxed) / 1000.0);
+    // Trailing empty buckets carry no information
+    size_t last = kBuckets;
+    while (last > 0 && counts[last - 1] == 0) last--;
+    for (size_t b = 0; b < last; b++) dprintf(fd, " %u", counts[b]);
+    dprintf(fd, "\n");
+}
+
+void NfcStats::Session::reset(int64_t now) {
+    startNs.store(now, std::memory_order_relaxed);
+    endNs.store(0, std::memory_order_relaxed);
+    txFrames.store(0, std::memory_order_relaxed);
+    txBytes.store(0, std::memory_order_relaxed);
+    rxFrames.store(0, std::memory_order_relaxed);
+    rxBytes.store(0, std::memory_order_relaxed);
+    events.store(0, std::memory_order_relaxed);
+    pendingWriteNs.store(0, std::memory_order_relaxed);
+    response.reset();
+    queueing.reset();
+    delivery.reset();
+}
+
+void NfcStats::Session::dump(int fd, const char* name) const {
+    int64_t start = startNs.load(std::memory_order_relaxed);
+    if (start == 0) return;
+    int64_t end = endNs.load(std::memory_order_relaxed);
+    int64_t durationNs = (end ? end : nowNs()) - start;
+
+    dprintf(fd, "  %s session, %s %.1f s:\n", name, end ? "closed after" : "open for",
+            durationNs / 1e9);
+    dprintf(fd, "    tx %" PRIu64 " frames %" PRIu64 " bytes, rx %" PRIu64 " frames %" PRIu64
+            " bytes, %" PRIu64 " events\n",
+            txFrames.load(std::memory_order_relaxed), txBytes.load(std::memory_order_relaxed),
+            rxFrames.load(std::memory_order_relaxed), rxBytes.load(std::memory_order_relaxed),
+            events.load(std::memory_order_relaxed));
+    response.dump(fd, "write to response");
+    queueing.dump(fd, "callback queueing");
+    delivery.dump(fd, "callback delivery");
+}
+
+void NfcStats::startSession() {
+    size_t next = mCurrent.load(std::memory_order_relaxed) ^ 1;
+    mSessions[next].reset(nowNs());
+    mCurrent.store(next, std::memory_order_release);
+}
+
+void NfcStats::endSession() {
+    current().endNs.store(nowNs(), std::memory_order_relaxed);
+}
+
+void NfcStats::recordWrite(size_t bytes) {
+    Session& session = current();
+    session.txFrames.fetch_add(1, std::memory_order_relaxed);
+    session.txBytes.fetch_add(bytes, std::memory_order_relaxed);
+    int64_t none = 0;
+    session.pendingWriteNs.compare_exchange_strong(none, nowNs(), std::memory_order_relaxed);
+}
+
+void NfcStats::recordData(size_t bytes) {
+    Session& session = current();
+    session.rxFrames.fetch_add(1, std::memory_order_relaxed);
+    session.rxBytes.fetch_add(bytes, std::memory_order_relaxed);
+    int64_t writeNs = session.pendingWriteNs.exchange(0, std::memory_order_relaxed);
+    if (writeNs != 0) {
+        session.response.record(nowNs() - writeNs);
+    }
+}
+
+void NfcStats::recordEvent() {
+    current().events.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NfcStats::recordDelivery(int64_t queuedNs, int64_t startNs, int64_t endNs) {
+    Session& session = current();
+    session.queueing.record(startNs - queuedNs);
+    session.delivery.record(endNs - startNs);
+}
+
+void NfcStats::dump(int fd) const {
+    size_t currentIndex = mCurrent.load(std::memory_order_acquire);
+    dprintf(fd, "NFC traffic, latency bucket i counts samples below 0.128 ms << i:\n");
+    mSessions[currentIndex].dump(fd, "Current");
+    mSessions[currentIndex ^ 1].dump(fd, "Previous");
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace nfc
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+namespace hardware {
+namespace nfc {
+namespace V1_0 {
+namespace implementation {
+
+// Traffic and latency counters for the current and the previous open()
+// session. Recording only touches relaxed atomics so it stays on.
+class NfcStats {
+  public:
+    static int64_t nowNs();
+
+    void startSession();
+    void endSession();
+
+    // write() handing an NCI packet to the vendor HAL
+    void recordWrite(size_t bytes);
+    // The vendor HAL calling back, on its own thread
+    void recordData(size_t bytes);
+    void recordEvent();
+    // A frame queued at queuedNs whose binder call ran from startNs to endNs
+    void recordDelivery(int64_t queuedNs, int64_t startNs, int64_t endNs);
+
+    void dump(int fd) const;
+
+  private:
+    // Bucket i counts samples below 128 us << i, the last one everything slower
+    static constexpr size_t kBuckets = 16;
+
+    struct Histogram {
+        std::atomic<uint32_t> buckets[kBuckets] = {};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint32_t> maxUs{0};
+
+        void record(int64_t ns);
+        void reset();
+        void dump(int fd, const char* name) const;
+    };
+
+    struct Session {
+        std::atomic<int64_t> startNs{0};
+        std::atomic<int64_t> endNs{0}; // 0 while open
+        std::atomic<uint64_t> txFrames{0};
+        std::atomic<uint64_t> txBytes{0};
+        std::atomic<uint64_t> rxFrames{0};
+        std::atomic<uint64_t> rxBytes{0};
+        std::atomic<uint64_t> events{0};
+        // First write not answered by the vendor HAL yet, 0 if none
+        std::atomic<int64_t> pendingWriteNs{0};
+        Histogram response;  // write() to the next data callback
+        Histogram queueing;  // data callback to the binder call
+        Histogram delivery;  // binder call into the NFC process
+
+        void reset(int64_t now);
+        void dump(int fd, const char* name) const;
+    };
+
+    Session& current() { return mSessions[mCurrent.load(std::memory_order_relaxed)]; }
+
+    std::array<Session, 2> mSessions;
+    std::atomic<size_t> mCurrent{0};
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace nfc
+}  // namespace hardware
+}  // namespace android
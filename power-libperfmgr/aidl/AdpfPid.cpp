@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "AdpfPid.h"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+namespace {
+
+static inline int64_t ns_to_100us(int64_t ns) {
+    return ns / 100000;
+}
+
+static inline uint64_t lowBits(uint64_t n) {
+    return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+}  // namespace
+
+void PidErrorWindow::reset(uint64_t samplingWindowP, uint64_t samplingWindowD,
+                           int64_t lastError) {
+    windowP = samplingWindowP;
+    windowD = samplingWindowD;
+    // One extra slot so the far end of the D window is still in the ring.
+    errors.assign(std::max<uint64_t>({windowP, windowD + 1, 1}), 0);
+    head = 0;
+    errors[head] = lastError;
+    samples = 0;
+    errSum = 0;
+}
+
+void PidErrorWindow::push(int64_t error) {
+    if (windowP > 0 && samples >= windowP) {
+        errSum -= at(windowP - 1);
+    }
+    head = (head + 1) % errors.size();
+    errors[head] = error;
+    samples++;
+    if (windowP > 0) {
+        errSum += error;
+    }
+}
+
+void LoadPredictor::push(int64_t error) {
+    bool heavy = error > 0;
+    heavyMask = (heavyMask << 1) | heavy;
+    samples++;
+    if (heavy) {
+        // EMA with a 1/4 weight on the newest heavy frame
+        heavyError = heavyError == 0 ? error : heavyError + (error - heavyError) / 4;
+    }
+
+    // Pick the period at which heavy frames most reliably repeat, the shortest
+    // one on ties. Mostly heavy sessions are left to the PID.
+    period = 0;
+    uint64_t valid = std::min<uint64_t>(samples, 64);
+    uint64_t heavyCount = __builtin_popcountll(heavyMask & lowBits(valid));
+    if (heavyCount * 2 > valid) {
+        return;
+    }
+    int bestScore = 0;
+    for (int n = kMinPeriod; n <= kMaxPeriod && static_cast<uint64_t>(n) < valid; n++) {
+        uint64_t window = lowBits(valid - n);
+        int older = __builtin_popcountll((heavyMask >> n) & window);
+        if (older < 3) {
+            continue;
+        }
+        int matches = __builtin_popcountll(heavyMask & (heavyMask >> n) & window);
+        // score in percent, require 80% of the heavy frames to repeat
+        int score = matches * 100 / older;
+        if (score >= 80 && score > bestScore) {
+            bestScore = score;
+            period = n;
+        }
+    }
+}
+
+int64_t LoadPredictor::predictNextError() const {
+    if (period == 0 || !(heavyMask & (1ULL << (period - 1)))) {
+        return 0;
+    }
+    return heavyError;
+}
+
+void PidState::beginBatch(const AdpfConfigSnapshot &config, int64_t targetDurationNanos,
+                          size_t length) {
+    uint64_t samplingWindowI = config.samplingWindowI;
+    mTargetDurationNanos = targetDurationNanos;
+    mDt = ns_to_100us(targetDurationNanos);
+    mLength = length;
+    mIStart = samplingWindowI == 0 || samplingWindowI > length ? 0 : length - samplingWindowI;
+    mIndex = 0;
+    mBatchErrSum = 0;
+    mBatchFirstError = previous_error;
+}
+
+void PidState::addSample(const AdpfConfigSnapshot &config, int64_t actualDurationNanos) {
+    if (std::abs(actualDurationNanos) > mTargetDurationNanos * 20) {
+        ALOGW("The actual duration is way far from the target (%" PRId64 " >> %" PRId64 ")",
+              actualDurationNanos, mTargetDurationNanos);
+    }
+    // PID control algorithm
+    int64_t error = ns_to_100us(actualDurationNanos - mTargetDurationNanos);
+    if (mIndex >= mIStart) {
+        integral_error += error * mDt;
+        integral_error = std::min(config.pidIHighDivI, integral_error);
+        integral_error = std::max(config.pidILowDivI, integral_error);
+    }
+    window.push(error);
+    if (config.predictOn) {
+        predictor.push(error);
+    }
+    mBatchErrSum += error;
+    previous_error = error;
+    mIndex++;
+}
+
+PidOutput PidState::endBatch(const AdpfConfigSnapshot &config) {
+    int64_t err_sum = mBatchErrSum;
+    int64_t p_count = mLength;
+    if (window.windowP > 0) {
+        err_sum = window.errSum;
+        p_count = std::min(window.samples, window.windowP);
+    }
+    int64_t derivative_sum = previous_error - mBatchFirstError;
+    int64_t d_count = mLength;
+    if (window.windowD > 0) {
+        d_count = std::min(window.samples, window.windowD);
+        derivative_sum = previous_error - window.at(d_count);
+    }
+
+    PidOutput out;
+    out.err = err_sum / p_count;
+    out.derivative = derivative_sum / mDt / d_count;
+    out.pOut = static_cast<int64_t>((err_sum > 0 ? config.pidPo : config.pidPu) * err_sum /
+                                    p_count);
+    out.iOut = static_cast<int64_t>(config.pidI * integral_error);
+    out.dOut = static_cast<int64_t>((derivative_sum > 0 ? config.pidDo : config.pidDu) *
+                                    derivative_sum / mDt / d_count);
+    return out;
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The ADPF PID controller, kept free of binder and libperfmgr dependencies so
+// recorded WorkDuration traces can be replayed through it offline.
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+// The AdpfConfig values used on the reporting path, copied out of the active
+// profile so a report does not need to take a reference on it.
+struct AdpfConfigSnapshot {
+    // PowerSessionManager profile generation the values were taken from
+    uint64_t generation = 0;
+    bool pidOn = false;
+    double pidPo = 0;
+    double pidPu = 0;
+    double pidI = 0;
+    double pidDo = 0;
+    double pidDu = 0;
+    int64_t pidIHighDivI = 0;
+    int64_t pidILowDivI = 0;
+    uint32_t uclampMinHigh = 0;
+    uint32_t uclampMinLow = 0;
+    uint64_t samplingWindowP = 0;
+    uint64_t samplingWindowI = 0;
+    uint64_t samplingWindowD = 0;
+    // whether the profile is listed in vendor.powerhal.adpf.predictive_profiles
+    bool predictOn = false;
+};
+
+// Streaming error window for the PID controller. The ring covers both the P
+// and D sampling windows and keeps a running sum for P; the D term telescopes,
+// so it only needs the error at the far end of its window.
+struct PidErrorWindow {
+    void reset(uint64_t windowP, uint64_t windowD, int64_t lastError);
+    void push(int64_t error);
+    // k-th most recent error, 0 being the newest one
+    int64_t at(size_t k) const { return errors[(head + errors.size() - k) % errors.size()]; }
+    std::vector<int64_t> errors;
+    uint64_t windowP = 0;
+    uint64_t windowD = 0;
+    size_t head = 0;
+    uint64_t samples = 0;
+    int64_t errSum = 0;
+};
+
+// Learns a periodic pattern of over-budget frames, such as physics running
+// every N frames, so the next heavy frame can be boosted ahead of time
+// instead of the PID reacting one frame late. History is one bit per frame.
+struct LoadPredictor {
+    static constexpr int kMinPeriod = 2;
+    static constexpr int kMaxPeriod = 16;
+    void push(int64_t error);
+    // Expected error of the next frame in 100us units, 0 if it isn't
+    // predicted to be heavy.
+    int64_t predictNextError() const;
+    uint64_t heavyMask = 0;
+    uint64_t samples = 0;
+    int period = 0;
+    int64_t heavyError = 0;
+};
+
+struct PidOutput {
+    int64_t pOut = 0;
+    int64_t iOut = 0;
+    int64_t dOut = 0;
+    // averaged P error and D derivative the terms were computed from
+    int64_t err = 0;
+    int64_t derivative = 0;
+    int64_t total() const { return pOut + iOut + dOut; }
+};
+
+// Streaming PID state of a session. Each reported sample is visited once.
+struct PidState {
+    // Feeds a reported batch; Samples is a container of WorkDuration-like
+    // elements with a durationNanos member.
+    template <typename Samples>
+    PidOutput update(const AdpfConfigSnapshot &config, int64_t targetDurationNanos,
+                     const Samples &samples) {
+        beginBatch(config, targetDurationNanos, samples.size());
+        for (const auto &sample : samples) {
+            addSample(config, sample.durationNanos);
+        }
+        return endBatch(config);
+    }
+
+    int64_t integral_error = 0;
+    int64_t previous_error = 0;
+    PidErrorWindow window;
+    LoadPredictor predictor;
+
+  private:
+    void beginBatch(const AdpfConfigSnapshot &config, int64_t targetDurationNanos, size_t length);
+    void addSample(const AdpfConfigSnapshot &config, int64_t actualDurationNanos);
+    PidOutput endBatch(const AdpfConfigSnapshot &config);
+
+    // scratch of the batch being fed
+    int64_t mTargetDurationNanos = 0;
+    int64_t mDt = 0;
+    int64_t mLength = 0;
+    int64_t mIStart = 0;
+    int64_t mIndex = 0;
+    // Only used by a zero sized P or D window, which covers the current batch.
+    int64_t mBatchErrSum = 0;
+    int64_t mBatchFirstError = 0;
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_POWER | ATRACE_TAG_HAL)
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "BoostQueue.h"
+
+#include <pthread.h>
+#include <utils/Trace.h>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+BoostQueue::BoostQueue(Handler handler)
+    : mHandler(std::move(handler)), mExit(false), mThread(&BoostQueue::run, this) {}
+
+BoostQueue::~BoostQueue() {
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        mExit = true;
+    }
+    mCond.notify_one();
+    mThread.join();
+}
+
+void BoostQueue::push(Boost type, int32_t durationMs) {
+    Request request{durationMs, steady_clock::now() + milliseconds(std::max(durationMs, 0))};
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        auto [it, inserted] = mPending.emplace(type, request);
+        if (!inserted) {
+            Request &pending = it->second;
+            if (durationMs <= 0 || pending.durationMs <= 0 || request.deadline > pending.deadline) {
+                pending = request;
+            }
+            return;
+        }
+    }
+    mCond.notify_one();
+}
+
+void BoostQueue::run() {
+    pthread_setname_np(pthread_self(), "BoostQueue");
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCond.wait(lock, [this] { return mExit || !mPending.empty(); });
+        if (mExit) {
+            return;
+        }
+        mDraining.swap(mPending);
+        lock.unlock();
+
+        ATRACE_NAME("BoostQueue::drain");
+        auto now = steady_clock::now();
+        for (const auto &[type, request] : mDraining) {
+            int32_t durationMs = request.durationMs;
+            if (durationMs > 0) {
+                // what is left of the merged deadline, it may have passed while queued
+                durationMs = duration_cast<milliseconds>(request.deadline - now).count();
+                if (durationMs <= 0) {
+                    continue;
+                }
+            }
+            mHandler(type, durationMs);
+        }
+        mDraining.clear();
+
+        lock.lock();
+    }
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
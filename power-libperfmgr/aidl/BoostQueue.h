@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/power/Boost.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::aidl::android::hardware::power::Boost;
+
+// Hands boosts over to a worker thread so binder callers never wait on
+// HintManager. Requests of the same type queued before the worker gets to
+// them are merged: timed boosts keep the latest deadline, while untimed
+// (0) and end (< 0) requests replace whatever was pending.
+class BoostQueue {
+  public:
+    using Handler = std::function<void(Boost type, int32_t durationMs)>;
+
+    explicit BoostQueue(Handler handler);
+    ~BoostQueue();
+    void push(Boost type, int32_t durationMs);
+
+  private:
+    struct Request {
+        int32_t durationMs;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void run();
+
+    const Handler mHandler;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::map<Boost, Request> mPending;
+    std::map<Boost, Request> mDraining;  // only used by run()
+    bool mExit;
+    std::thread mThread;
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
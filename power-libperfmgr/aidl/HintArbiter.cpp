@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "HintArbiter.h"
+
+#include <perfmgr/HintManager.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+
+#include "StateSnapshot.h"
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::android::perfmgr::HintManager;
+
+void HintArbiter::setMode(const std::string &hint, HintPriority priority, bool enabled) {
+    std::lock_guard<std::mutex> guard(mLock);
+    auto it = mLive.find(hint);
+    if (enabled == (it != mLive.end())) {
+        return;
+    }
+    if (enabled) {
+        mLive.emplace(hint, priority);
+        if (priority == HINT_PRIORITY_EXCLUSIVE) {
+            mExclusive.push_back(hint);
+        }
+    } else {
+        if (it->second == HINT_PRIORITY_EXCLUSIVE) {
+            mExclusive.erase(std::find(mExclusive.begin(), mExclusive.end(), hint));
+        }
+        mLive.erase(it);
+    }
+    resolveLocked();
+}
+
+void HintArbiter::setBoost(const std::string &hint, HintPriority priority, int32_t durationMs) {
+    if (durationMs == 0) {
+        setMode(hint, priority, true);
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mLock);
+    if (durationMs < 0) {
+        // Cancels either kind, a timed boost is only tracked in mTimed
+        bool timed = mTimed.erase(hint) > 0;
+        auto it = mLive.find(hint);
+        if (it != mLive.end()) {
+            if (it->second == HINT_PRIORITY_EXCLUSIVE) {
+                mExclusive.erase(std::find(mExclusive.begin(), mExclusive.end(), hint));
+            }
+            mLive.erase(it);
+            resolveLocked();
+        }
+        if (timed) {
+            HintManager::GetInstance()->EndHint(hint);
+        }
+        return;
+    }
+    if (!isAllowedLocked(hint, priority)) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto end = now + std::chrono::milliseconds(durationMs);
+    for (auto it = mTimed.begin(); it != mTimed.end();) {
+        it = it->second <= now ? mTimed.erase(it) : std::next(it);
+    }
+    auto it = mTimed.find(hint);
+    // HintManager extends a running hint, skip requests it already covers
+    if (it != mTimed.end() && it->second >= end) {
+        return;
+    }
+    mTimed[hint] = end;
+    HintManager::GetInstance()->DoHint(hint, std::chrono::milliseconds(durationMs));
+}
+
+bool HintArbiter::isActive(const std::string &hint) const {
+    std::lock_guard<std::mutex> guard(mLock);
+    return mLive.count(hint) > 0;
+}
+
+bool HintArbiter::isSuppressed() const {
+    std::lock_guard<std::mutex> guard(mLock);
+    return !mExclusive.empty();
+}
+
+bool HintArbiter::isAllowedLocked(const std::string &hint, HintPriority priority) const {
+    switch (priority) {
+        case HINT_PRIORITY_ALWAYS:
+            return true;
+        case HINT_PRIORITY_EXCLUSIVE:
+            // e.g. SUSTAINED_PERFORMANCE and LOW_POWER write the same nodes
+            return !mExclusive.empty() && mExclusive.back() == hint;
+        case HINT_PRIORITY_NORMAL:
+            return mExclusive.empty();
+    }
+    return false;
+}
+
+void HintArbiter::resolveLocked() {
+    std::set<std::string> resolved;
+    for (const auto &[hint, priority] : mLive) {
+        if (isAllowedLocked(hint, priority)) {
+            resolved.insert(hint);
+        }
+    }
+
+    std::shared_ptr<HintManager> hm = HintManager::GetInstance();
+    // End first so an exiting exclusive mode releases its nodes before the
+    // hints it suppressed are restored.
+    for (const auto &hint : mApplied) {
+        if (!resolved.count(hint)) {
+            hm->EndHint(hint);
+        }
+    }
+    if (!mExclusive.empty()) {
+        for (const auto &[hint, end] : mTimed) {
+            hm->EndHint(hint);
+        }
+        mTimed.clear();
+    }
+    for (const auto &hint : resolved) {
+        if (!mApplied.count(hint) && !hm->DoHint(hint)) {
+            ALOGV("Failed to start hint %s", hint.c_str());
+        }
+    }
+    mApplied = std::move(resolved);
+}
+
+void HintArbiter::snapshot(StateSnapshot *snapshot) const {
+    std::lock_guard<std::mutex> guard(mLock);
+    for (const auto &[hint, priority] : mLive) {
+        if (priority != HINT_PRIORITY_EXCLUSIVE) {
+            snapshot->modes.emplace_back(hint, priority);
+        }
+    }
+    // in order, so the same exclusive mode wins after a restore
+    for (const auto &hint : mExclusive) {
+        snapshot->modes.emplace_back(hint, HINT_PRIORITY_EXCLUSIVE);
+    }
+    auto now = std::chrono::steady_clock::now();
+    int64_t nowMs = StateSnapshot::nowMs();
+    for (const auto &[hint, end] : mTimed) {
+        if (end > now) {
+            snapshot->boosts.emplace_back(
+                    hint, nowMs + std::chrono::duration_cast<std::chrono::milliseconds>(end - now)
+                                          .count());
+        }
+    }
+}
+
+void HintArbiter::restore(const StateSnapshot &snapshot) {
+    for (const auto &[hint, priority] : snapshot.modes) {
+        setMode(hint, priority, true);
+    }
+    int64_t nowMs = StateSnapshot::nowMs();
+    for (const auto &[hint, deadline] : snapshot.boosts) {
+        if (deadline > nowMs) {
+            setBoost(hint, HINT_PRIORITY_NORMAL, static_cast<int32_t>(deadline - nowMs));
+        }
+    }
+}
+
+void HintArbiter::dumpToStream(std::ostream &stream) const {
+    std::lock_guard<std::mutex> guard(mLock);
+    stream << "HintArbiter live:";
+    for (const auto &[hint, priority] : mLive) {
+        stream << " " << hint << (mApplied.count(hint) ? "" : "(suppressed)");
+    }
+    stream << "\n";
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
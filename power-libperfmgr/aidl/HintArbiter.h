@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+struct StateSnapshot;
+
+enum HintPriority {
+    // Always applied, e.g. DOUBLE_TAP_TO_WAKE or DISPLAY_INACTIVE
+    HINT_PRIORITY_ALWAYS,
+    // Suppresses every NORMAL hint while active, e.g. SUSTAINED_PERFORMANCE.
+    // Exclusive hints also exclude each other, the last one enabled wins and
+    // the previous one comes back when it ends.
+    HINT_PRIORITY_EXCLUSIVE,
+    HINT_PRIORITY_NORMAL,
+};
+
+// Keeps the live set of modes and boosts requested from the framework and
+// resolves it into the set of libperfmgr hints that should be on. Only hints
+// whose resolved state changed are started or ended, and hints suppressed by
+// an exclusive mode are restored once it exits.
+class HintArbiter {
+  public:
+    void setMode(const std::string &hint, HintPriority priority, bool enabled);
+    // durationMs follows IPower::setBoost: > 0 timed, 0 until ended, < 0 ends it
+    void setBoost(const std::string &hint, HintPriority priority, int32_t durationMs);
+    bool isActive(const std::string &hint) const;
+    bool isSuppressed() const;
+    // Adds the live modes and running timed boosts to the snapshot
+    void snapshot(StateSnapshot *snapshot) const;
+    // Brings back what a previous instance saved in its snapshot
+    void restore(const StateSnapshot &snapshot);
+    void dumpToStream(std::ostream &stream) const;
+
+  private:
+    bool isAllowedLocked(const std::string &hint, HintPriority priority) const;
+    void resolveLocked();
+
+    mutable std::mutex mLock;
+    // requested hints which stay on until ended
+    std::unordered_map<std::string, HintPriority> mLive;
+    // hints currently started on HintManager from mLive
+    std::set<std::string> mApplied;
+    // timed boosts handed to HintManager, ended when an exclusive mode starts
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> mTimed;
+    // live exclusive hints in the order they were enabled
+    std::vector<std::string> mExclusive;
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "HintRegistry.h"
+
+#include <android-base/parseint.h>
+#include <android/binder_enums.h>
+#include <log/log.h>
+#include <perfmgr/HintManager.h>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::android::perfmgr::HintManager;
+
+namespace {
+
+constexpr size_t kMaxOverflowHints = 64;
+constexpr uint32_t kMaxSeedTries = 256;
+constexpr std::string_view kRefreshPrefix = "REFRESH_";
+constexpr std::string_view kRefreshSuffix = "FPS";
+const std::vector<std::string> kRefreshModes = {"REFRESH_120FPS", "REFRESH_90FPS",
+                                                "REFRESH_60FPS"};
+
+int parseRefreshRate(std::string_view name) {
+    if (name.size() <= kRefreshPrefix.size() + kRefreshSuffix.size() ||
+        name.substr(0, kRefreshPrefix.size()) != kRefreshPrefix ||
+        name.substr(name.size() - kRefreshSuffix.size()) != kRefreshSuffix) {
+        return 0;
+    }
+    int rate = 0;
+    std::string digits(name.substr(kRefreshPrefix.size(),
+                                   name.size() - kRefreshPrefix.size() - kRefreshSuffix.size()));
+    return ::android::base::ParseInt(digits, &rate, 1) ? rate : 0;
+}
+
+}  // namespace
+
+HintRegistry &HintRegistry::getInstance() {
+    static HintRegistry instance;
+    return instance;
+}
+
+HintRegistry::HintRegistry() : mSeed(0) {
+    std::shared_ptr<HintManager> hm = HintManager::GetInstance();
+    for (const auto &name : hm->GetHints()) {
+        addStatic(name);
+    }
+    for (const auto &name : kRefreshModes) {
+        addStatic(name);
+    }
+    for (Mode mode : ndk::enum_range<Mode>()) {
+        addStatic(toString(mode));
+    }
+    for (Boost boost : ndk::enum_range<Boost>()) {
+        addStatic(toString(boost));
+    }
+    for (auto &info : mStatic) {
+        info.supported = hm->IsHintSupported(info.name);
+        info.refreshRate = parseRefreshRate(info.name);
+    }
+
+    // Look for a seed without collisions, growing the table if none is found.
+    uint32_t size = 1;
+    while (size < mStatic.size() * 2) {
+        size <<= 1;
+    }
+    for (bool built = false; !built; size <<= 1) {
+        for (uint32_t seed = 1; seed <= kMaxSeedTries && !built; seed++) {
+            built = buildTable(size, seed);
+        }
+    }
+
+    for (Mode mode : ndk::enum_range<Mode>()) {
+        size_t idx = static_cast<size_t>(mode);
+        if (idx >= mModeIds.size()) {
+            mModeIds.resize(idx + 1, kInvalidHintId);
+        }
+        mModeIds[idx] = lookup(toString(mode));
+    }
+    for (Boost boost : ndk::enum_range<Boost>()) {
+        size_t idx = static_cast<size_t>(boost);
+        if (idx >= mBoostIds.size()) {
+            mBoostIds.resize(idx + 1, kInvalidHintId);
+        }
+        mBoostIds[idx] = lookup(toString(boost));
+    }
+    ALOGI("Interned %zu hints into a %zu slot table", mStatic.size(), mTable.size());
+}
+
+HintId HintRegistry::addStatic(std::string name) {
+    for (size_t i = 0; i < mStatic.size(); i++) {
+        if (mStatic[i].name == name) {
+            return i;
+        }
+    }
+    mStatic.emplace_back(std::move(name));
+    return mStatic.size() - 1;
+}
+
+// FNV-1a with the seed folded into the offset basis
+uint32_t HintRegistry::hash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 16777619u);
+    for (char c : name) {
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return h;
+}
+
+bool HintRegistry::buildTable(uint32_t size, uint32_t seed) {
+    mTable.assign(size, kInvalidHintId);
+    for (size_t i = 0; i < mStatic.size(); i++) {
+        HintId &slot = mTable[hash(mStatic[i].name, seed) & (size - 1)];
+        if (slot != kInvalidHintId) {
+            return false;
+        }
+        slot = i;
+    }
+    mSeed = seed;
+    return true;
+}
+
+HintId HintRegistry::find(std::string_view name) {
+    HintId id = mTable[hash(name, mSeed) & (mTable.size() - 1)];
+    if (id != kInvalidHintId && mStatic[id].name == name) {
+        return id;
+    }
+    std::lock_guard<std::mutex> guard(mLock);
+    auto it = mOverflow.find(std::string(name));
+    return it == mOverflow.end() ? kInvalidHintId : it->second;
+}
+
+HintId HintRegistry::lookup(std::string_view name) {
+    HintId id = mTable[hash(name, mSeed) & (mTable.size() - 1)];
+    if (id != kInvalidHintId && mStatic[id].name == name) {
+        return id;
+    }
+
+    std::lock_guard<std::mutex> guard(mLock);
+    std::string key(name);
+    auto it = mOverflow.find(key);
+    if (it != mOverflow.end()) {
+        return it->second;
+    }
+    if (mOverflow.size() >= kMaxOverflowHints) {
+        ALOGW("Too many runtime hint names, not interning %s", key.c_str());
+        return kInvalidHintId;
+    }
+    id = mStatic.size() + mDynamic.size();
+    mDynamic.emplace_back(key);
+    mDynamic.back().refreshRate = parseRefreshRate(key);
+    mOverflow.emplace(std::move(key), id);
+    return id;
+}
+
+HintId HintRegistry::modeId(Mode mode) const {
+    size_t idx = static_cast<size_t>(mode);
+    return idx < mModeIds.size() ? mModeIds[idx] : kInvalidHintId;
+}
+
+HintId HintRegistry::boostId(Boost boost) const {
+    size_t idx = static_cast<size_t>(boost);
+    return idx < mBoostIds.size() ? mBoostIds[idx] : kInvalidHintId;
+}
+
+HintInfo &HintRegistry::info(HintId id) {
+    if (static_cast<size_t>(id) < mStatic.size()) {
+        return mStatic[id];
+    }
+    std::lock_guard<std::mutex> guard(mLock);
+    return mDynamic[id - mStatic.size()];
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/power/Boost.h>
+#include <aidl/android/hardware/power/Mode.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::aidl::android::hardware::power::Boost;
+using ::aidl::android::hardware::power::Mode;
+
+using HintId = int32_t;
+constexpr HintId kInvalidHintId = -1;
+
+struct HintInfo {
+    explicit HintInfo(std::string name) : name(std::move(name)) {}
+    const std::string name;
+    bool supported = false;
+    // refresh rate selected by a REFRESH_<N>FPS mode, 0 otherwise
+    int refreshRate = 0;
+    // whether an ADPF profile has this name: -1 not known yet, 0 no, 1 yes
+    std::atomic<int> adpfProfile{-1};
+};
+
+// Interns hint names into dense ids. The names of the libperfmgr config and
+// of the AIDL modes and boosts go into a perfect hash built at startup, so a
+// lookup is one hash and one compare; names only seen at runtime are kept in
+// a small locked overflow table.
+class HintRegistry {
+  public:
+    static HintRegistry &getInstance();
+
+    // Interns the name if needed, kInvalidHintId once the overflow table is full
+    HintId lookup(std::string_view name);
+    // Like lookup() but never interns
+    HintId find(std::string_view name);
+    HintId modeId(Mode mode) const;
+    HintId boostId(Boost boost) const;
+    HintInfo &info(HintId id);
+
+  private:
+    HintRegistry();
+    HintId addStatic(std::string name);
+    bool buildTable(uint32_t size, uint32_t seed);
+    static uint32_t hash(std::string_view name, uint32_t seed);
+
+    // Immutable once constructed, read without locking
+    std::deque<HintInfo> mStatic;
+    std::vector<HintId> mTable;
+    uint32_t mSeed;
+    std::vector<HintId> mModeIds;
+    std::vector<HintId> mBoostIds;
+    // Names first seen at runtime. Entries are never removed and a deque
+    // keeps references stable, so an info can be used after unlocking.
+    std::mutex mLock;
+    std::deque<HintInfo> mDynamic;                      // protected by mLock
+    std::unordered_map<std::string, HintId> mOverflow;  // protected by mLock
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
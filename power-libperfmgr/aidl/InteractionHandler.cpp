@@ -20,15 +20,19 @@
 #include "InteractionHandler.h"
 
 #include <android-base/properties.h>
+#include <android-base/strings.h>
 #include <fcntl.h>
+#include <glob.h>
 #include <perfmgr/HintManager.h>
 #include <poll.h>
+#include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <array>
 #include <memory>
 
@@ -48,8 +52,15 @@ namespace {
 
 static const bool kDisplayIdleSupport =
         ::android::base::GetBoolProperty("vendor.powerhal.disp.idle_support", true);
-static const std::array<const char *, 2> kDispIdlePath = {"/sys/class/drm/card0/device/idle_state",
-                                                          "/sys/class/graphics/fb0/idle_state"};
+// Every DRM card/connector is watched; fb0 is only used when there is none.
+static const std::array<const char *, 2> kDispIdleGlob = {"/sys/class/drm/card*/device/idle_state",
+                                                          "/sys/class/drm/card*-*/idle_state"};
+static const char *kFbIdlePath = "/sys/class/graphics/fb0/idle_state";
+// Optional comma separated frame signal nodes (e.g. vsync_event), one per display
+static const std::string kDispVsyncPaths =
+        ::android::base::GetProperty("vendor.powerhal.disp.vsync_paths", "");
+static const uint32_t kVsyncIdleMs =
+        ::android::base::GetUintProperty("vendor.powerhal.disp.vsync_idle", /*default*/ 50U);
 static const uint32_t kWaitMs =
         ::android::base::GetUintProperty("vendor.powerhal.disp.idle_wait", /*default*/ 100U);
 static const uint32_t kMinDurationMs =
@@ -59,6 +70,14 @@ static const uint32_t kMaxDurationMs =
 static const uint32_t kDurationOffsetMs =
         ::android::base::GetUintProperty("vendor.powerhal.interaction.offset", /*default*/ 650U);
 
+// Size the boost from the observed touch-to-idle latency instead of the
+// requested duration, never going above the latter.
+static const bool kAdaptiveDuration =
+        ::android::base::GetBoolProperty("vendor.powerhal.interaction.adaptive", false);
+static const uint32_t kAdaptiveMinMs =
+        ::android::base::GetUintProperty("vendor.powerhal.interaction.adaptive_min", 300U);
+static constexpr uint32_t kLatencyMinSamples = 8;
+
 static size_t CalcTimespecDiffMs(struct timespec start, struct timespec end) {
     size_t diff_in_ms = 0;
     diff_in_ms += (end.tv_sec - start.tv_sec) * MSINSEC;
@@ -66,23 +85,66 @@ static size_t CalcTimespecDiffMs(struct timespec start, struct timespec end) {
     return diff_in_ms;
 }
 
-static int FbIdleOpen(void) {
-    int fd;
-    for (const auto &path : kDispIdlePath) {
-        fd = open(path, O_RDONLY);
-        if (fd >= 0)
-            return fd;
+static void AddIdleSource(std::vector<DisplayIdleSource> *sources, const std::string &path,
+                          bool vsync) {
+    for (const auto &source : *sources) {
+        if (source.path == path)
+            return;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ALOGW("Unable to open display idle source %s (%d)", path.c_str(), errno);
+        return;
+    }
+    sources->push_back({path, fd, vsync, false, {}});
+}
+
+static std::vector<DisplayIdleSource> DisplayIdleOpen(void) {
+    std::vector<DisplayIdleSource> sources;
+    for (const auto &pattern : kDispIdleGlob) {
+        glob_t g;
+        if (glob(pattern, 0, nullptr, &g) == 0) {
+            for (size_t i = 0; i < g.gl_pathc; i++) {
+                AddIdleSource(&sources, g.gl_pathv[i], false);
+            }
+        }
+        globfree(&g);
+    }
+    if (sources.empty())
+        AddIdleSource(&sources, kFbIdlePath, false);
+    for (const auto &path : ::android::base::Split(kDispVsyncPaths, ",")) {
+        if (!path.empty())
+            AddIdleSource(&sources, path, true);
     }
-    ALOGE("Unable to open fb idle state path (%d)", errno);
-    return -1;
+    if (sources.empty())
+        ALOGE("Unable to open any display idle state path");
+    return sources;
 }
 
 }  // namespace
 
 using ::android::perfmgr::HintManager;
 
+void InteractionLatencyEstimator::AddSample(int32_t latency_ms) {
+    if (mSamples++ == 0) {
+        mMeanMs = latency_ms;
+        mDevMs = latency_ms / 2;
+        return;
+    }
+    // gains of 1/8 and 1/4, as for TCP round trip estimation
+    int32_t err = latency_ms - mMeanMs;
+    mMeanMs += err / 8;
+    mDevMs += (std::abs(err) - mDevMs) / 4;
+}
+
+int32_t InteractionLatencyEstimator::Estimate() const {
+    if (mSamples < kLatencyMinSamples)
+        return 0;
+    return mMeanMs + 4 * mDevMs;
+}
+
 InteractionHandler::InteractionHandler()
-    : mState(INTERACTION_STATE_UNINITIALIZED), mDurationMs(0) {}
+    : mState(INTERACTION_STATE_UNINITIALIZED), mEventFd(-1), mEpollFd(-1), mDurationMs(0) {}
 
 InteractionHandler::~InteractionHandler() {
     Exit();
@@ -94,17 +156,38 @@ bool InteractionHandler::Init() {
     if (mState != INTERACTION_STATE_UNINITIALIZED)
         return true;
 
-    int fd = FbIdleOpen();
-    if (fd < 0)
+    std::vector<DisplayIdleSource> sources = DisplayIdleOpen();
+    if (sources.empty())
         return false;
-    mIdleFd = fd;
+    mIdleSources = std::move(sources);
 
     mEventFd = eventfd(0, EFD_NONBLOCK);
     if (mEventFd < 0) {
         ALOGE("Unable to create event fd (%d)", errno);
-        close(mIdleFd);
+        CloseFds();
+        return false;
+    }
+
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        ALOGE("Unable to create epoll fd (%d)", errno);
+        CloseFds();
         return false;
     }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = UINT32_MAX;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &ev) < 0) {
+        ALOGE("Unable to watch event fd (%d)", errno);
+        CloseFds();
+        return false;
+    }
+    for (uint32_t i = 0; i < mIdleSources.size(); i++) {
+        ev.events = EPOLLPRI | EPOLLERR;
+        ev.data.u32 = i;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mIdleSources[i].fd, &ev) < 0)
+            ALOGW("Unable to watch %s (%d)", mIdleSources[i].path.c_str(), errno);
+    }
 
     mState = INTERACTION_STATE_IDLE;
     mThread = std::unique_ptr<std::thread>(new std::thread(&InteractionHandler::Routine, this));
@@ -124,8 +207,20 @@ void InteractionHandler::Exit() {
     mCond.notify_all();
     mThread->join();
 
-    close(mEventFd);
-    close(mIdleFd);
+    CloseFds();
+}
+
+void InteractionHandler::CloseFds() {
+    for (auto &source : mIdleSources) {
+        close(source.fd);
+    }
+    mIdleSources.clear();
+    if (mEventFd >= 0)
+        close(mEventFd);
+    if (mEpollFd >= 0)
+        close(mEpollFd);
+    mEventFd = -1;
+    mEpollFd = -1;
 }
 
 void InteractionHandler::PerfLock() {
@@ -156,6 +251,13 @@ void InteractionHandler::Acquire(int32_t duration) {
     else
         finalDuration = kMinDurationMs;
 
+    int32_t estimate = kAdaptiveDuration ? mLatency.Estimate() : 0;
+    if (estimate > 0) {
+        // the floor can be above a short requested duration, which clamp doesn't allow
+        int32_t adaptiveMin = std::min(static_cast<int32_t>(kAdaptiveMinMs), finalDuration);
+        finalDuration = std::clamp(estimate, adaptiveMin, finalDuration);
+    }
+
     // Fallback to do boost directly
     // 1) override property is set OR
     // 2) InteractionHandler not initialized
@@ -213,49 +315,119 @@ void InteractionHandler::AbortWaitLocked() {
         ALOGW("Unable to write to event fd (%zd)", ret);
 }
 
-void InteractionHandler::WaitForIdle(int32_t wait_ms, int32_t timeout_ms) {
+// Refreshes the idle state of a source, notified tells whether its fd just
+// signalled. Returns false if the node cannot be read.
+bool InteractionHandler::UpdateIdleSource(DisplayIdleSource *source, bool notified) {
     char data[MAX_LENGTH];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (source->vsync && !notified) {
+        // only re-evaluate, reading would swallow a pending frame notification
+        source->idle = CalcTimespecDiffMs(source->lastEvent, now) >= kVsyncIdleMs;
+        return true;
+    }
+
+    // reading rearms the sysfs notification
+    ssize_t ret = pread(source->fd, data, sizeof(data), 0);
+    if (ret <= 0) {
+        ALOGE("%s: Unexpected EOF on %s!", __func__, source->path.c_str());
+        return false;
+    }
+
+    if (source->vsync) {
+        source->lastEvent = now;
+        source->idle = false;
+    } else {
+        source->idle = !strncmp(data, "idle", 4);
+    }
+    return true;
+}
+
+bool InteractionHandler::AllSourcesIdle() const {
+    return std::all_of(mIdleSources.begin(), mIdleSources.end(),
+                       [](const DisplayIdleSource &source) { return source.idle; });
+}
+
+WaitResult InteractionHandler::WaitForIdle(int32_t wait_ms, int32_t timeout_ms) {
     ssize_t ret;
-    struct pollfd pfd[2];
+    struct pollfd pfd;
 
     ATRACE_CALL();
 
     ALOGV("%s: wait:%d timeout:%d", __func__, wait_ms, timeout_ms);
 
-    pfd[0].fd = mEventFd;
-    pfd[0].events = POLLIN;
-    pfd[1].fd = mIdleFd;
-    pfd[1].events = POLLPRI | POLLERR;
+    pfd.fd = mEventFd;
+    pfd.events = POLLIN;
 
-    ret = poll(pfd, 1, wait_ms);
+    ret = poll(&pfd, 1, wait_ms);
     if (ret > 0) {
         ALOGV("%s: wait aborted", __func__);
-        return;
+        return WAIT_RESULT_ABORTED;
     } else if (ret < 0) {
         ALOGE("%s: error in poll while waiting", __func__);
-        return;
+        return WAIT_RESULT_ERROR;
     }
 
-    ret = pread(mIdleFd, data, sizeof(data), 0);
-    if (!ret) {
-        ALOGE("%s: Unexpected EOF!", __func__);
-        return;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (auto &source : mIdleSources) {
+        // a frame signal counts as busy until it has been quiet for kVsyncIdleMs
+        if (source.vsync)
+            source.lastEvent = start;
+        if (!UpdateIdleSource(&source, false))
+            return WAIT_RESULT_ERROR;
     }
 
-    if (!strncmp(data, "idle", 4)) {
+    if (AllSourcesIdle()) {
         ALOGV("%s: already idle", __func__);
-        return;
+        return WAIT_RESULT_IDLE;
     }
 
-    ret = poll(pfd, 2, timeout_ms);
-    if (ret < 0)
-        ALOGE("%s: Error on waiting for idle (%zd)", __func__, ret);
-    else if (ret == 0)
-        ALOGV("%s: timed out waiting for idle", __func__);
-    else if (pfd[0].revents)
-        ALOGV("%s: wait for idle aborted", __func__);
-    else if (pfd[1].revents)
-        ALOGV("%s: idle detected", __func__);
+    std::array<struct epoll_event, 8> events;
+    while (true) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int32_t remaining = timeout_ms - static_cast<int32_t>(CalcTimespecDiffMs(start, now));
+        if (remaining <= 0) {
+            ALOGV("%s: timed out waiting for idle", __func__);
+            return WAIT_RESULT_TIMEOUT;
+        }
+        // wake up when a busy frame signal would turn idle
+        int32_t wait = remaining;
+        for (const auto &source : mIdleSources) {
+            if (source.vsync && !source.idle) {
+                int32_t quiet = static_cast<int32_t>(CalcTimespecDiffMs(source.lastEvent, now));
+                wait = std::min(wait, std::max<int32_t>(kVsyncIdleMs - quiet, 1));
+            }
+        }
+
+        int n = epoll_wait(mEpollFd, events.data(), events.size(), wait);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: Error on waiting for idle (%d)", __func__, errno);
+            return WAIT_RESULT_ERROR;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == UINT32_MAX) {
+                ALOGV("%s: wait for idle aborted", __func__);
+                return WAIT_RESULT_ABORTED;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (!UpdateIdleSource(&mIdleSources[events[i].data.u32], true))
+                return WAIT_RESULT_ERROR;
+        }
+        for (auto &source : mIdleSources) {
+            if (source.vsync)
+                UpdateIdleSource(&source, false);
+        }
+        if (AllSourcesIdle()) {
+            ALOGV("%s: idle detected", __func__);
+            return WAIT_RESULT_IDLE;
+        }
+    }
 }
 
 void InteractionHandler::Routine() {
@@ -268,9 +440,22 @@ void InteractionHandler::Routine() {
         if (mState == INTERACTION_STATE_UNINITIALIZED)
             return;
         mState = INTERACTION_STATE_WAITING;
+        struct timespec start = mLastTimespec;
         lk.unlock();
 
-        WaitForIdle(kWaitMs, mDurationMs);
+        WaitResult result = WaitForIdle(kWaitMs, mDurationMs);
+        if (result == WAIT_RESULT_IDLE || result == WAIT_RESULT_TIMEOUT) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int32_t latency = CalcTimespecDiffMs(start, now);
+            // A timeout only tells the render tail was longer than the lock,
+            // push the estimate up quickly rather than learn the cut-off value.
+            if (result == WAIT_RESULT_TIMEOUT)
+                latency = std::min<int32_t>(latency * 2, kMaxDurationMs);
+            lk.lock();
+            mLatency.AddSample(latency);
+            lk.unlock();
+        }
         Release();
     }
 }
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace aidl {
 namespace google {
@@ -36,6 +37,38 @@ enum InteractionState {
     INTERACTION_STATE_WAITING,
 };
 
+// A display signal the interaction boost waits on. Idle state nodes report
+// "idle"/"active" and notify on change; vsync nodes notify on every frame and
+// count as idle once no frame has been signalled for a while.
+struct DisplayIdleSource {
+    std::string path;
+    int fd;
+    bool vsync;
+    bool idle;
+    struct timespec lastEvent;
+};
+
+enum WaitResult {
+    WAIT_RESULT_IDLE,
+    WAIT_RESULT_TIMEOUT,
+    WAIT_RESULT_ABORTED,
+    WAIT_RESULT_ERROR,
+};
+
+// Online estimate of how long the display stays busy after an interaction,
+// tracked as a smoothed mean and mean deviation of the observed latency.
+class InteractionLatencyEstimator {
+  public:
+    void AddSample(int32_t latency_ms);
+    // Upper bound covering most interactions, 0 until enough samples are seen
+    int32_t Estimate() const;
+
+  private:
+    int32_t mMeanMs = 0;
+    int32_t mDevMs = 0;
+    uint32_t mSamples = 0;
+};
+
 class InteractionHandler {
   public:
     InteractionHandler();
@@ -46,18 +79,23 @@ class InteractionHandler {
 
   private:
     void Release();
-    void WaitForIdle(int32_t wait_ms, int32_t timeout_ms);
+    WaitResult WaitForIdle(int32_t wait_ms, int32_t timeout_ms);
     void AbortWaitLocked();
+    bool UpdateIdleSource(DisplayIdleSource *source, bool notified);
+    bool AllSourcesIdle() const;
+    void CloseFds();
     void Routine();
 
     void PerfLock();
     void PerfRel();
 
     enum InteractionState mState;
-    int mIdleFd;
+    std::vector<DisplayIdleSource> mIdleSources;
     int mEventFd;
+    int mEpollFd;
     int32_t mDurationMs;
     struct timespec mLastTimespec;
+    InteractionLatencyEstimator mLatency;
     std::unique_ptr<std::thread> mThread;
     std::mutex mLock;
     std::condition_variable mCond;
@@ -27,9 +27,13 @@
 #include <utils/Log.h>
 
 #include <mutex>
+#include <sstream>
 
+#include "HintRegistry.h"
 #include "PowerHintSession.h"
 #include "PowerSessionManager.h"
+#include "StateSnapshot.h"
+#include "TouchLatencyController.h"
 
 namespace aidl {
 namespace google {
@@ -60,11 +64,39 @@ Power::Power()
       mBatterySaverOn(false) {
     mInteractionHandler = std::make_unique<InteractionHandler>();
     mInteractionHandler->Init();
+    mBoostQueue = std::make_unique<BoostQueue>(
+            [this](Boost type, int32_t durationMs) { doBoost(type, durationMs); });
 
+    StateSnapshot snapshot;
+    if (snapshot.load()) {
+        LOG(INFO) << "Initialize PowerHAL from state snapshot";
+        mHintArbiter.restore(snapshot);
+        mSustainedPerfModeOn = mHintArbiter.isActive("SUSTAINED_PERFORMANCE");
+        mBatterySaverOn = mHintArbiter.isActive("LOW_POWER");
+        // the rest of what setMode() does for these, the arbiter only applies the hints
+        for (const auto &[mode, priority] : snapshot.modes) {
+            if (HintManager::GetInstance()->GetAdpfProfile() &&
+                HintManager::GetInstance()->GetAdpfProfile()->mReportingRateLimitNs > 0) {
+                PowerSessionManager::getInstance()->updateHintMode(
+                        HintRegistry::getInstance().lookup(mode), true);
+            }
+            if (mode == toString(Mode::GAME)) {
+                TouchLatencyController::getInstance().setGameMode(true);
+            }
+        }
+        PowerSessionManager::getInstance()->restoreSessionSnapshots(snapshot.sessions);
+    } else {
+        restoreStateFromProperties();
+    }
+    PowerSessionManager::getInstance()->setSnapshotProvider(
+            [this](StateSnapshot *snapshot) { mHintArbiter.snapshot(snapshot); });
+}
+
+void Power::restoreStateFromProperties() {
     std::string state = ::android::base::GetProperty(kPowerHalStateProp, "");
     if (state == "SUSTAINED_PERFORMANCE") {
         LOG(INFO) << "Initialize with SUSTAINED_PERFORMANCE on";
-        HintManager::GetInstance()->DoHint("SUSTAINED_PERFORMANCE");
+        mHintArbiter.setMode("SUSTAINED_PERFORMANCE", HINT_PRIORITY_EXCLUSIVE, true);
         mSustainedPerfModeOn = true;
     } else {
         LOG(INFO) << "Initialize PowerHAL";
@@ -73,85 +105,47 @@ Power::Power()
     state = ::android::base::GetProperty(kPowerHalAudioProp, "");
     if (state == "AUDIO_STREAMING_LOW_LATENCY") {
         LOG(INFO) << "Initialize with AUDIO_LOW_LATENCY on";
-        HintManager::GetInstance()->DoHint(state);
+        mHintArbiter.setMode(state, HINT_PRIORITY_NORMAL, true);
     }
 
     state = ::android::base::GetProperty(kPowerHalRenderingProp, "");
     if (state == "EXPENSIVE_RENDERING") {
         LOG(INFO) << "Initialize with EXPENSIVE_RENDERING on";
-        HintManager::GetInstance()->DoHint("EXPENSIVE_RENDERING");
+        mHintArbiter.setMode("EXPENSIVE_RENDERING", HINT_PRIORITY_NORMAL, true);
     }
 }
 
-static void endAllHints() {
-    std::shared_ptr<HintManager> hm = HintManager::GetInstance();
-    for (auto hint : hm->GetHints()) {
-        if (std::any_of(kAlwaysAllowedModes.begin(), kAlwaysAllowedModes.end(),
-                [hint](auto mode) { return hint == toString(mode); })) {
-            continue;
-        }
-        hm->EndHint(hint);
+static HintPriority modePriority(Mode type) {
+    if (type == Mode::SUSTAINED_PERFORMANCE || type == Mode::LOW_POWER) {
+        return HINT_PRIORITY_EXCLUSIVE;
     }
+    if (std::find(kAlwaysAllowedModes.begin(), kAlwaysAllowedModes.end(), type) !=
+        kAlwaysAllowedModes.end()) {
+        return HINT_PRIORITY_ALWAYS;
+    }
+    return HINT_PRIORITY_NORMAL;
 }
 
 ndk::ScopedAStatus Power::setMode(Mode type, bool enabled) {
     LOG(DEBUG) << "Power setMode: " << toString(type) << " to: " << enabled;
     if (HintManager::GetInstance()->GetAdpfProfile() &&
         HintManager::GetInstance()->GetAdpfProfile()->mReportingRateLimitNs > 0) {
-        PowerSessionManager::getInstance()->updateHintMode(toString(type), enabled);
+        PowerSessionManager::getInstance()->updateHintMode(
+                HintRegistry::getInstance().modeId(type), enabled);
+    }
+    if (type == Mode::GAME) {
+        TouchLatencyController::getInstance().setGameMode(enabled);
     }
     if (setDeviceSpecificMode(type, enabled)) {
         return ndk::ScopedAStatus::ok();
     }
 
-    switch (type) {
-        case Mode::SUSTAINED_PERFORMANCE:
-            if (enabled) {
-                endAllHints();
-                HintManager::GetInstance()->DoHint("SUSTAINED_PERFORMANCE");
-            } else {
-                HintManager::GetInstance()->EndHint("SUSTAINED_PERFORMANCE");
-            }
-            mSustainedPerfModeOn = enabled;
-            break;
-        case Mode::LOW_POWER:
-            if (enabled) {
-                endAllHints();
-                HintManager::GetInstance()->DoHint("LOW_POWER");
-            } else {
-                HintManager::GetInstance()->EndHint("LOW_POWER");
-            }
-            mBatterySaverOn = enabled;
-            break;
-        case Mode::LAUNCH:
-            [[fallthrough]];
-        case Mode::DOUBLE_TAP_TO_WAKE:
-            [[fallthrough]];
-        case Mode::FIXED_PERFORMANCE:
-            [[fallthrough]];
-        case Mode::EXPENSIVE_RENDERING:
-            [[fallthrough]];
-        case Mode::INTERACTIVE:
-            [[fallthrough]];
-        case Mode::DEVICE_IDLE:
-            [[fallthrough]];
-        case Mode::DISPLAY_INACTIVE:
-            [[fallthrough]];
-        case Mode::AUDIO_STREAMING_LOW_LATENCY:
-            [[fallthrough]];
-        case Mode::GAME_LOADING:
-            [[fallthrough]];
-        default:
-            if ((mBatterySaverOn || mSustainedPerfModeOn) && std::find(kAlwaysAllowedModes.begin(),
-                    kAlwaysAllowedModes.end(), type) == kAlwaysAllowedModes.end()) {
-                break;
-            }
-            if (enabled) {
-                HintManager::GetInstance()->DoHint(toString(type));
-            } else {
-                HintManager::GetInstance()->EndHint(toString(type));
-            }
-            break;
+    mHintArbiter.setMode(toString(type), modePriority(type), enabled);
+    PowerSessionManager::getInstance()->requestSnapshotSave();
+    if (type == Mode::SUSTAINED_PERFORMANCE) {
+        mSustainedPerfModeOn = enabled;
+    } else if (type == Mode::LOW_POWER) {
+        mBatterySaverOn = enabled;
     }
 
     return ndk::ScopedAStatus::ok();
@@ -172,11 +166,18 @@ ndk::ScopedAStatus Power::setBoost(Boost type, int32_t durationMs) {
     LOG(DEBUG) << "Power setBoost: " << toString(type) << " duration: " << durationMs;
     if (HintManager::GetInstance()->GetAdpfProfile() &&
         HintManager::GetInstance()->GetAdpfProfile()->mReportingRateLimitNs > 0) {
-        PowerSessionManager::getInstance()->updateHintBoost(toString(type), durationMs);
+        PowerSessionManager::getInstance()->updateHintBoost(
+                HintRegistry::getInstance().boostId(type), durationMs);
     }
+    mBoostQueue->push(type, durationMs);
+
+    return ndk::ScopedAStatus::ok();
+}
+
+void Power::doBoost(Boost type, int32_t durationMs) {
     switch (type) {
         case Boost::INTERACTION:
-            if (mSustainedPerfModeOn || mBatterySaverOn) {
+            if (mHintArbiter.isSuppressed()) {
                 break;
             }
             mInteractionHandler->Acquire(durationMs);
@@ -188,21 +189,10 @@ ndk::ScopedAStatus Power::setBoost(Boost type, int32_t durationMs) {
         case Boost::AUDIO_LAUNCH:
             [[fallthrough]];
         default:
-            if (mSustainedPerfModeOn || mBatterySaverOn) {
-                break;
-            }
-            if (durationMs > 0) {
-                HintManager::GetInstance()->DoHint(toString(type),
-                                                   std::chrono::milliseconds(durationMs));
-            } else if (durationMs == 0) {
-                HintManager::GetInstance()->DoHint(toString(type));
-            } else {
-                HintManager::GetInstance()->EndHint(toString(type));
-            }
+            mHintArbiter.setBoost(toString(type), HINT_PRIORITY_NORMAL, durationMs);
+            PowerSessionManager::getInstance()->requestSnapshotSave();
             break;
     }
-
-    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Power::isBoostSupported(Boost type, bool *_aidl_return) {
@@ -224,9 +214,13 @@ binder_status_t Power::dump(int fd, const char **, uint32_t) {
             boolToString(HintManager::GetInstance()->IsRunning()),
             boolToString(mSustainedPerfModeOn),
             boolToString(mBatterySaverOn)));
+    std::ostringstream arbiter_buf;
+    mHintArbiter.dumpToStream(arbiter_buf);
+    buf += arbiter_buf.str();
     // Dump nodes through libperfmgr
     HintManager::GetInstance()->DumpToFd(fd);
     PowerSessionManager::getInstance()->dumpToFd(fd);
+    TouchLatencyController::getInstance().dumpToFd(fd);
     if (!::android::base::WriteStringToFd(buf, fd)) {
         PLOG(ERROR) << "Failed to dump state to fd";
     }
@@ -248,8 +242,9 @@ ndk::ScopedAStatus Power::createHintSession(int32_t tgid, int32_t uid,
         *_aidl_return = nullptr;
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
-    std::shared_ptr<IPowerHintSession> session = ndk::SharedRefBase::make<PowerHintSession>(
+    std::shared_ptr<PowerHintSession> session = ndk::SharedRefBase::make<PowerHintSession>(
             tgid, uid, threadIds, durationNanos);
+    session->init();
     *_aidl_return = session;
     return ndk::ScopedAStatus::ok();
 }
@@ -22,6 +22,8 @@
 #include <memory>
 #include <thread>
 
+#include "BoostQueue.h"
+#include "HintArbiter.h"
 #include "InteractionHandler.h"
 
 namespace aidl {
@@ -50,9 +52,15 @@ class Power : public ::aidl::android::hardware::power::BnPower {
     binder_status_t dump(int fd, const char **args, uint32_t numArgs) override;
 
   private:
+    void restoreStateFromProperties();
+    void doBoost(Boost type, int32_t durationMs);
+
     std::unique_ptr<InteractionHandler> mInteractionHandler;
+    HintArbiter mHintArbiter;
     std::atomic<bool> mSustainedPerfModeOn;
     std::atomic<bool> mBatterySaverOn;
+    // declared last so its worker is joined before the state it uses goes away
+    std::unique_ptr<BoostQueue> mBoostQueue;
 };
 
 }  // namespace pixel
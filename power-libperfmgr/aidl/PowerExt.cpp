@@ -28,6 +28,7 @@
 
 #include <mutex>
 
+#include "HintRegistry.h"
 #include "PowerSessionManager.h"
 
 namespace aidl {
@@ -42,21 +43,24 @@ using ::android::perfmgr::HintManager;
 ndk::ScopedAStatus PowerExt::setMode(const std::string &mode, bool enabled) {
     LOG(DEBUG) << "PowerExt setMode: " << mode << " to: " << enabled;
 
-    if (enabled) {
-        HintManager::GetInstance()->DoHint(mode);
-    } else {
-        HintManager::GetInstance()->EndHint(mode);
+    HintId id = HintRegistry::getInstance().lookup(mode);
+    if (isHintSupported(id)) {
+        if (enabled) {
+            HintManager::GetInstance()->DoHint(mode);
+        } else {
+            HintManager::GetInstance()->EndHint(mode);
+        }
     }
     if (HintManager::GetInstance()->GetAdpfProfile() &&
         HintManager::GetInstance()->GetAdpfProfile()->mReportingRateLimitNs > 0) {
-        PowerSessionManager::getInstance()->updateHintMode(mode, enabled);
+        PowerSessionManager::getInstance()->updateHintMode(id, enabled);
     }
 
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus PowerExt::isModeSupported(const std::string &mode, bool *_aidl_return) {
-    bool supported = HintManager::GetInstance()->IsHintSupported(mode);
+    bool supported = isHintSupported(HintRegistry::getInstance().find(mode));
     LOG(INFO) << "PowerExt mode " << mode << " isModeSupported: " << supported;
     *_aidl_return = supported;
     return ndk::ScopedAStatus::ok();
@@ -64,9 +68,13 @@ ndk::ScopedAStatus PowerExt::isModeSupported(const std::string &mode, bool *_aid
 
 ndk::ScopedAStatus PowerExt::setBoost(const std::string &boost, int32_t durationMs) {
     LOG(DEBUG) << "PowerExt setBoost: " << boost << " duration: " << durationMs;
+    HintId id = HintRegistry::getInstance().lookup(boost);
     if (HintManager::GetInstance()->GetAdpfProfile() &&
         HintManager::GetInstance()->GetAdpfProfile()->mReportingRateLimitNs > 0) {
-        PowerSessionManager::getInstance()->updateHintBoost(boost, durationMs);
+        PowerSessionManager::getInstance()->updateHintBoost(id, durationMs);
+    }
+    if (!isHintSupported(id)) {
+        return ndk::ScopedAStatus::ok();
     }
 
     if (durationMs > 0) {
@@ -81,12 +89,17 @@ ndk::ScopedAStatus PowerExt::setBoost(const std::string &boost, int32_t duration
 }
 
 ndk::ScopedAStatus PowerExt::isBoostSupported(const std::string &boost, bool *_aidl_return) {
-    bool supported = HintManager::GetInstance()->IsHintSupported(boost);
+    bool supported = isHintSupported(HintRegistry::getInstance().find(boost));
     LOG(INFO) << "PowerExt boost " << boost << " isBoostSupported: " << supported;
     *_aidl_return = supported;
     return ndk::ScopedAStatus::ok();
 }
 
+// Support is resolved once from the libperfmgr config when the names are interned
+bool PowerExt::isHintSupported(HintId id) {
+    return id != kInvalidHintId && HintRegistry::getInstance().info(id).supported;
+}
+
 }  // namespace pixel
 }  // namespace impl
 }  // namespace power
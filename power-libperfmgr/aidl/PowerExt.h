@@ -23,6 +23,8 @@
 #include <aidl/google/hardware/power/extension/pixel/BnPowerExt.h>
 #include <perfmgr/HintManager.h>
 
+#include "HintRegistry.h"
+
 namespace aidl {
 namespace google {
 namespace hardware {
@@ -39,6 +41,7 @@ class PowerExt : public ::aidl::google::hardware::power::extension::pixel::BnPow
     ndk::ScopedAStatus isBoostSupported(const std::string &boost, bool *_aidl_return) override;
 
   private:
+    static bool isHintSupported(HintId id);
 };
 
 }  // namespace pixel
@@ -23,15 +23,19 @@
 #include <android-base/parsedouble.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <perfmgr/AdpfConfig.h>
 #include <private/android_filesystem_config.h>
 #include <sys/syscall.h>
 #include <time.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <atomic>
 
+#include "AdpfPid.h"
 #include "PowerSessionManager.h"
+#include "TouchLatencyController.h"
 
 namespace aidl {
 namespace google {
@@ -48,73 +52,75 @@ using std::chrono::nanoseconds;
 
 namespace {
 
-static inline int64_t ns_to_100us(int64_t ns) {
-    return ns / 100000;
-}
+// Comma separated AdpfConfig profile names which also run the load predictor.
+static const std::vector<std::string> kPredictiveProfiles = ::android::base::Split(
+        ::android::base::GetProperty("vendor.powerhal.adpf.predictive_profiles", ""), ",");
 
 }  // namespace
 
+const AdpfConfigSnapshot &PowerHintSession::getAdpfConfigSnapshot() {
+    AdpfConfigSnapshot &snapshot = mDescriptor->adpf;
+    uint64_t generation = PowerSessionManager::getInstance()->getAdpfProfileGeneration();
+    if (snapshot.generation == generation) {
+        return snapshot;
+    }
+    std::shared_ptr<AdpfConfig> adpfConfig = HintManager::GetInstance()->GetAdpfProfile();
+    snapshot.generation = generation;
+    snapshot.pidOn = adpfConfig->mPidOn;
+    snapshot.pidPo = adpfConfig->mPidPo;
+    snapshot.pidPu = adpfConfig->mPidPu;
+    snapshot.pidI = adpfConfig->mPidI;
+    snapshot.pidDo = adpfConfig->mPidDo;
+    snapshot.pidDu = adpfConfig->mPidDu;
+    snapshot.pidIHighDivI = adpfConfig->getPidIHighDivI();
+    snapshot.pidILowDivI = adpfConfig->getPidILowDivI();
+    snapshot.uclampMinHigh = adpfConfig->mUclampMinHigh;
+    snapshot.uclampMinLow = adpfConfig->mUclampMinLow;
+    snapshot.samplingWindowP = adpfConfig->mSamplingWindowP;
+    snapshot.samplingWindowI = adpfConfig->mSamplingWindowI;
+    snapshot.samplingWindowD = adpfConfig->mSamplingWindowD;
+    snapshot.predictOn = std::find(kPredictiveProfiles.begin(), kPredictiveProfiles.end(),
+                                   adpfConfig->mName) != kPredictiveProfiles.end();
+    PidState &pid = mDescriptor->pid;
+    if (pid.window.errors.empty() || pid.window.windowP != snapshot.samplingWindowP ||
+        pid.window.windowD != snapshot.samplingWindowD) {
+        pid.window.reset(snapshot.samplingWindowP, snapshot.samplingWindowD, pid.previous_error);
+    }
+    return snapshot;
+}
+
 int64_t PowerHintSession::convertWorkDurationToBoostByPid(
         const std::vector<WorkDuration> &actualDurations) {
-    std::shared_ptr<AdpfConfig> adpfConfig = HintManager::GetInstance()->GetAdpfProfile();
-    const nanoseconds &targetDuration = mDescriptor->duration;
-    int64_t &integral_error = mDescriptor->integral_error;
-    int64_t &previous_error = mDescriptor->previous_error;
-    uint64_t samplingWindowP = adpfConfig->mSamplingWindowP;
-    uint64_t samplingWindowI = adpfConfig->mSamplingWindowI;
-    uint64_t samplingWindowD = adpfConfig->mSamplingWindowD;
-    int64_t targetDurationNanos = (int64_t)targetDuration.count();
-    int64_t length = actualDurations.size();
-    int64_t p_start =
-            samplingWindowP == 0 || samplingWindowP > length ? 0 : length - samplingWindowP;
-    int64_t i_start =
-            samplingWindowI == 0 || samplingWindowI > length ? 0 : length - samplingWindowI;
-    int64_t d_start =
-            samplingWindowD == 0 || samplingWindowD > length ? 0 : length - samplingWindowD;
-    int64_t dt = ns_to_100us(targetDurationNanos);
-    int64_t err_sum = 0;
-    int64_t derivative_sum = 0;
-    for (int64_t i = std::min({p_start, i_start, d_start}); i < length; i++) {
-        int64_t actualDurationNanos = actualDurations[i].durationNanos;
-        if (std::abs(actualDurationNanos) > targetDurationNanos * 20) {
-            ALOGW("The actual duration is way far from the target (%" PRId64 " >> %" PRId64 ")",
-                  actualDurationNanos, targetDurationNanos);
-        }
-        // PID control algorithm
-        int64_t error = ns_to_100us(actualDurationNanos - targetDurationNanos);
-        if (i >= d_start) {
-            derivative_sum += error - previous_error;
-        }
-        if (i >= p_start) {
-            err_sum += error;
-        }
-        if (i >= i_start) {
-            integral_error += error * dt;
-            integral_error = std::min(adpfConfig->getPidIHighDivI(), integral_error);
-            integral_error = std::max(adpfConfig->getPidILowDivI(), integral_error);
-        }
-        previous_error = error;
+    const AdpfConfigSnapshot &adpfConfig = getAdpfConfigSnapshot();
+    PidOutput &out = mDescriptor->pid_out;
+    {
+        // the integral error is read for the snapshot from the looper
+        std::lock_guard<std::mutex> guard(mSessionLock);
+        out = mDescriptor->pid.update(adpfConfig, mDescriptor->duration.count(), actualDurations);
     }
-    int64_t pOut = static_cast<int64_t>((err_sum > 0 ? adpfConfig->mPidPo : adpfConfig->mPidPu) *
-                                        err_sum / (length - p_start));
-    int64_t iOut = static_cast<int64_t>(adpfConfig->mPidI * integral_error);
-    int64_t dOut =
-            static_cast<int64_t>((derivative_sum > 0 ? adpfConfig->mPidDo : adpfConfig->mPidDu) *
-                                 derivative_sum / dt / (length - d_start));
-
-    int64_t output = pOut + iOut + dOut;
+    int64_t output = out.total();
     if (ATRACE_ENABLED()) {
-        traceSessionVal("pid.err", err_sum / (length - p_start));
-        traceSessionVal("pid.integral", integral_error);
-        traceSessionVal("pid.derivative", derivative_sum / dt / (length - d_start));
-        traceSessionVal("pid.pOut", pOut);
-        traceSessionVal("pid.iOut", iOut);
-        traceSessionVal("pid.dOut", dOut);
+        traceSessionVal("pid.err", out.err);
+        traceSessionVal("pid.integral", mDescriptor->pid.integral_error);
+        traceSessionVal("pid.derivative", out.derivative);
+        traceSessionVal("pid.pOut", out.pOut);
+        traceSessionVal("pid.iOut", out.iOut);
+        traceSessionVal("pid.dOut", out.dOut);
         traceSessionVal("pid.output", output);
     }
     return output;
 }
 
+int PowerHintSession::predictBoost(const AdpfConfigSnapshot &adpfConfig) {
+    int64_t error = mDescriptor->pid.predictor.predictNextError();
+    int boost = static_cast<int>(adpfConfig.pidPo * error);
+    if (ATRACE_ENABLED()) {
+        traceSessionVal("predict.period", mDescriptor->pid.predictor.period);
+        traceSessionVal("predict.boost", boost);
+    }
+    return std::max(0, boost);
+}
+
 PowerHintSession::PowerHintSession(int32_t tgid, int32_t uid, const std::vector<int32_t> &threadIds,
                                    int64_t durationNanos)
     : mStaleTimerHandler(sp<StaleTimerHandler>::make(this)),
@@ -124,13 +130,21 @@ PowerHintSession::PowerHintSession(int32_t tgid, int32_t uid, const std::vector<
     mIdString = StringPrintf("%" PRId32 "-%" PRId32 "-%" PRIxPTR, mDescriptor->tgid,
                              mDescriptor->uid, reinterpret_cast<uintptr_t>(this) & 0xffff);
 
-    mPowerManagerHandler = PowerSessionManager::getInstance();
     mLastUpdatedTime.store(std::chrono::steady_clock::now());
     if (ATRACE_ENABLED()) {
         traceSessionVal("target", mDescriptor->duration.count());
         traceSessionVal("active", mDescriptor->is_active.load());
     }
-    PowerSessionManager::getInstance()->addPowerSession(this);
+    SessionSnapshot snapshot;
+    if (PowerSessionManager::getInstance()->takeSessionSnapshot(tgid, uid, &snapshot)) {
+        // picked up where the session of the previous HAL instance left off
+        mDescriptor->pid.integral_error = snapshot.integralError;
+        mDescriptor->current_min = snapshot.currentMin;
+    }
+}
+
+void PowerHintSession::init() {
+    PowerSessionManager::getInstance()->addPowerSession(ref<PowerHintSession>());
     // init boost
     sendHint(SessionHint::CPU_LOAD_RESET);
     ALOGV("PowerHintSession created: %s", mDescriptor->toString().c_str());
@@ -151,22 +165,40 @@ void PowerHintSession::traceSessionVal(char const *identifier, int64_t val) cons
     ATRACE_INT(StringPrintf("adpf.%s-%s", mIdString.c_str(), identifier).c_str(), val);
 }
 
+SessionSnapshot PowerHintSession::getSnapshot() {
+    std::lock_guard<std::mutex> guard(mSessionLock);
+    return {mDescriptor->tgid, mDescriptor->uid, mDescriptor->pid.integral_error,
+            mDescriptor->current_min};
+}
+
 bool PowerHintSession::isAppSession() {
     // Check if uid is in range reserved for applications
     return mDescriptor->uid >= AID_APP_START;
 }
 
-void PowerHintSession::updateUniveralBoostMode() {
+void PowerHintSession::updateAppSessionActivity() {
     if (!isAppSession()) {
         return;
     }
-    if (ATRACE_ENABLED()) {
-        const std::string tag = StringPrintf("%s:updateUniveralBoostMode()", mIdString.c_str());
-        ATRACE_BEGIN(tag.c_str());
+    std::lock_guard<std::mutex> guard(mSessionLock);
+    bool active = !mSessionClosed && mDescriptor->is_active.load() && !mIsStale.load();
+    TouchLatencyController &touch = TouchLatencyController::getInstance();
+    bool lowLatency = active && touch.enabled() && touch.isLowLatencyTarget(mDescriptor->duration);
+    if (lowLatency != mCountedLowLatency) {
+        mCountedLowLatency = lowLatency;
+        touch.updateLowLatencySessionCount(lowLatency);
     }
-    PowerHintMonitor::getInstance()->getLooper()->sendMessage(mPowerManagerHandler, NULL);
-    if (ATRACE_ENABLED()) {
-        ATRACE_END();
+    if (active == mCountedActive) {
+        return;
+    }
+    mCountedActive = active;
+    PowerSessionManager::getInstance()->updateActiveAppSessionCount(active);
+}
+
+void PowerHintSession::markUpdated() {
+    mLastUpdatedTime.store(std::chrono::steady_clock::now());
+    if (mIsStale.exchange(false)) {
+        updateAppSessionActivity();
     }
 }
 
@@ -184,7 +216,8 @@ int PowerHintSession::setSessionUclampMin(int32_t min, bool resetStale) {
         std::lock_guard<std::mutex> guard(mSessionLock);
         mDescriptor->current_min = min;
     }
-    if (min != 0 && resetStale) {
+    // Also armed for a zero min, the timer is what marks the session stale.
+    if (resetStale) {
         mStaleTimerHandler->updateTimer();
     }
     PowerSessionManager::getInstance()->setUclampMin(this, min);
@@ -206,6 +239,10 @@ void PowerHintSession::dumpToStream(std::ostream &stream) {
     stream << ", " << isTimeout() << ")";
 }
 
+void PowerHintSession::dumpTelemetryToStream(std::ostream &stream) {
+    mTelemetry.dumpToStream(stream);
+}
+
 ndk::ScopedAStatus PowerHintSession::pause() {
     if (mSessionClosed) {
         ALOGE("Error: session is dead");
@@ -219,7 +256,6 @@ ndk::ScopedAStatus PowerHintSession::pause() {
     if (ATRACE_ENABLED()) {
         traceSessionVal("active", mDescriptor->is_active.load());
     }
-    updateUniveralBoostMode();
     PowerSessionManager::getInstance()->removeThreadsFromPowerSession(this);
     return ndk::ScopedAStatus::ok();
 }
@@ -238,7 +274,7 @@ ndk::ScopedAStatus PowerHintSession::resume() {
     if (ATRACE_ENABLED()) {
         traceSessionVal("active", mDescriptor->is_active.load());
     }
-    updateUniveralBoostMode();
+    updateAppSessionActivity();
     return ndk::ScopedAStatus::ok();
 }
 
@@ -251,9 +287,10 @@ ndk::ScopedAStatus PowerHintSession::close() {
     PowerSessionManager::getInstance()->removePowerSession(this);
     mStaleTimerHandler->setSessionDead();
     mBoostTimerHandler->setSessionDead();
-    setSessionUclampMin(0);
+    setSessionUclampMin(0, false);
     mDescriptor->is_active.store(false);
-    updateUniveralBoostMode();
+    updateAppSessionActivity();
+    PowerSessionManager::getInstance()->requestSnapshotSave();
     return ndk::ScopedAStatus::ok();
 }
 
@@ -274,6 +311,8 @@ ndk::ScopedAStatus PowerHintSession::updateTargetWorkDuration(int64_t targetDura
     if (ATRACE_ENABLED()) {
         traceSessionVal("target", mDescriptor->duration.count());
     }
+    // The target decides whether the session wants low touch latency
+    updateAppSessionActivity();
 
     return ndk::ScopedAStatus::ok();
 }
@@ -296,7 +335,7 @@ ndk::ScopedAStatus PowerHintSession::reportActualWorkDuration(
         ALOGE("Error: shouldn't report duration during pause state.");
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
     }
-    std::shared_ptr<AdpfConfig> adpfConfig = HintManager::GetInstance()->GetAdpfProfile();
+    const AdpfConfigSnapshot &adpfConfig = getAdpfConfigSnapshot();
     mDescriptor->update_count++;
     bool isFirstFrame = isTimeout();
     if (ATRACE_ENABLED()) {
@@ -308,28 +347,44 @@ ndk::ScopedAStatus PowerHintSession::reportActualWorkDuration(
                         actualDurations.back().durationNanos - mDescriptor->duration.count() > 0);
     }
 
-    mLastUpdatedTime.store(std::chrono::steady_clock::now());
-    if (isFirstFrame) {
-        if (isAppSession()) {
-            tryToSendPowerHint("ADPF_FIRST_FRAME");
-        }
-        updateUniveralBoostMode();
+    markUpdated();
+    if (isFirstFrame && isAppSession()) {
+        tryToSendPowerHint("ADPF_FIRST_FRAME");
     }
 
     disableTemporaryBoost();
 
-    if (!adpfConfig->mPidOn) {
-        setSessionUclampMin(adpfConfig->mUclampMinHigh);
+    const int64_t targetNs = mDescriptor->duration.count();
+    for (const WorkDuration &d : actualDurations) {
+        mTelemetry.recordSample(d.durationNanos, targetNs);
+    }
+
+    if (!adpfConfig.pidOn) {
+        setSessionUclampMin(adpfConfig.uclampMinHigh);
+        mTelemetry.recordReport({actualDurations.back().durationNanos, targetNs,
+                                 mDescriptor->current_min, 0, 0, 0});
         return ndk::ScopedAStatus::ok();
     }
 
     int64_t output = convertWorkDurationToBoostByPid(actualDurations);
 
     /* apply to all the threads in the group */
-    int next_min = std::min(static_cast<int>(adpfConfig->mUclampMinHigh),
+    int next_min = std::min(static_cast<int>(adpfConfig.uclampMinHigh),
                             mDescriptor->current_min + static_cast<int>(output));
-    next_min = std::max(static_cast<int>(adpfConfig->mUclampMinLow), next_min);
+    next_min = std::max(static_cast<int>(adpfConfig.uclampMinLow), next_min);
+
+    int boost = adpfConfig.predictOn ? predictBoost(adpfConfig) : 0;
+    if (boost > 0) {
+        // Raise the next frame as a temporary boost, the PID keeps working
+        // from next_min once that frame is reported.
+        mNextUclampMin.store(next_min);
+        mBoostTimerHandler->updateTimer(mDescriptor->duration * 2);
+        next_min = std::min(static_cast<int>(adpfConfig.uclampMinHigh), next_min + boost);
+    }
     setSessionUclampMin(next_min);
+    mTelemetry.recordReport({actualDurations.back().durationNanos, targetNs, next_min,
+                             mDescriptor->pid_out.pOut, mDescriptor->pid_out.iOut,
+                             mDescriptor->pid_out.dOut});
 
     return ndk::ScopedAStatus::ok();
 }
@@ -365,7 +420,7 @@ ndk::ScopedAStatus PowerHintSession::sendHint(SessionHint hint) {
             return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
     tryToSendPowerHint(toString(hint));
-    mLastUpdatedTime.store(std::chrono::steady_clock::now());
+    markUpdated();
     if (ATRACE_ENABLED()) {
         mLastHintSent = static_cast<int>(hint);
         traceSessionVal("session_hint", static_cast<int>(hint));
@@ -384,8 +439,10 @@ ndk::ScopedAStatus PowerHintSession::setThreads(const std::vector<int32_t> &thre
     }
 
     PowerSessionManager::getInstance()->removeThreadsFromPowerSession(this);
-    mDescriptor->threadIds.resize(threadIds.size());
-    std::copy(threadIds.begin(), threadIds.end(), back_inserter(mDescriptor->threadIds));
+    {
+        std::lock_guard<std::mutex> guard(mThreadIdsLock);
+        mDescriptor->threadIds = threadIds;
+    }
     PowerSessionManager::getInstance()->addThreadsFromPowerSession(this);
     // init boost
     setSessionUclampMin(HintManager::GetInstance()->GetAdpfProfile()->mUclampMinInit);
@@ -427,10 +484,6 @@ bool PowerHintSession::isTimeout() {
     return now >= staleTime;
 }
 
-const std::vector<int32_t> &PowerHintSession::getTidList() const {
-    return mDescriptor->threadIds;
-}
-
 bool PowerHintSession::disableTemporaryBoost() {
     if (ATRACE_ENABLED()) {
         if (mLastHintSent != -1) {
@@ -456,40 +509,35 @@ void PowerHintSession::setStale() {
     disableTemporaryBoost();
     // Reset to default uclamp value.
     PowerSessionManager::getInstance()->setUclampMin(this, 0);
-    // Deliver a task to check if all sessions are inactive.
-    updateUniveralBoostMode();
+    mIsStale.store(true);
+    updateAppSessionActivity();
+    // a running session changes every frame, its state is saved once it settles
+    PowerSessionManager::getInstance()->requestSnapshotSave();
     if (ATRACE_ENABLED()) {
         traceSessionVal("min", 0);
     }
 }
 
 void PowerHintSession::SessionTimerHandler::updateTimer(nanoseconds delay) {
-    mTimeout.store(steady_clock::now() + delay);
-    {
-        std::lock_guard<std::mutex> guard(mMessageLock);
-        sp<MessageHandler> selfPtr = sp<MessageHandler>::fromExisting(this);
-        PowerHintMonitor::getInstance()->getLooper()->removeMessages(selfPtr);
-        PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(delay.count(), selfPtr,
-                                                                         NULL);
-    }
+    time_point<steady_clock> deadline = steady_clock::now() + delay;
+    mTimeout.store(deadline);
+    PowerHintMonitor::getInstance()->getTimerQueue()->schedule(this, deadline);
     if (ATRACE_ENABLED()) {
         mSession->traceSessionVal(("timer." + mName).c_str(), 0);
     }
 }
 
-void PowerHintSession::SessionTimerHandler::handleMessage(const Message &) {
+void PowerHintSession::SessionTimerHandler::onExpired() {
     std::lock_guard<std::mutex> guard(mClosedLock);
     if (mIsSessionDead) {
         return;
     }
     time_point now = steady_clock::now();
-    int64_t next = (mTimeout.load() - now).count();
+    time_point<steady_clock> deadline = mTimeout.load();
+    int64_t next = (deadline - now).count();
     if (next > 0) {
-        // Schedule for the stale timeout check.
-        std::lock_guard<std::mutex> guard(mMessageLock);
-        sp<MessageHandler> selfPtr = sp<MessageHandler>::fromExisting(this);
-        PowerHintMonitor::getInstance()->getLooper()->removeMessages(selfPtr);
-        PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(next, selfPtr, NULL);
+        // The deadline was pushed out since the timer got queued.
+        PowerHintMonitor::getInstance()->getTimerQueue()->schedule(this, deadline);
     } else {
         onTimeout();
     }
@@ -501,8 +549,7 @@ void PowerHintSession::SessionTimerHandler::handleMessage(const Message &) {
 void PowerHintSession::SessionTimerHandler::setSessionDead() {
     std::lock_guard<std::mutex> guard(mClosedLock);
     mIsSessionDead = true;
-    PowerHintMonitor::getInstance()->getLooper()->removeMessages(
-            sp<MessageHandler>::fromExisting(this));
+    PowerHintMonitor::getInstance()->getTimerQueue()->cancel(this);
 }
 
 void PowerHintSession::StaleTimerHandler::updateTimer() {
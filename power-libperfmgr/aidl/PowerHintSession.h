@@ -25,6 +25,11 @@
 #include <mutex>
 #include <unordered_map>
 
+#include "AdpfPid.h"
+#include "SessionTelemetry.h"
+#include "SessionTimerQueue.h"
+#include "StateSnapshot.h"
+
 namespace aidl {
 namespace google {
 namespace hardware {
@@ -51,9 +56,7 @@ struct AppHintDesc {
           duration(0LL),
           current_min(0),
           is_active(true),
-          update_count(0),
-          integral_error(0),
-          previous_error(0) {}
+          update_count(0) {}
     std::string toString() const;
     const int32_t tgid;
     const int32_t uid;
@@ -64,8 +67,10 @@ struct AppHintDesc {
     std::atomic<bool> is_active;
     // pid
     uint64_t update_count;
-    int64_t integral_error;
-    int64_t previous_error;
+    PidState pid;
+    // last PID output, kept for the session telemetry
+    PidOutput pid_out;
+    AdpfConfigSnapshot adpf;
 };
 
 class PowerHintSession : public BnPowerHintSession {
@@ -73,6 +78,8 @@ class PowerHintSession : public BnPowerHintSession {
     explicit PowerHintSession(int32_t tgid, int32_t uid, const std::vector<int32_t> &threadIds,
                               int64_t durationNanos);
     ~PowerHintSession();
+    // Registers with PowerSessionManager, once a shared_ptr owns the session
+    void init();
     ndk::ScopedAStatus close() override;
     ndk::ScopedAStatus pause() override;
     ndk::ScopedAStatus resume() override;
@@ -83,12 +90,22 @@ class PowerHintSession : public BnPowerHintSession {
     ndk::ScopedAStatus setThreads(const std::vector<int32_t> &threadIds) override;
     bool isActive();
     bool isTimeout();
+    SessionSnapshot getSnapshot();
     void setStale();
     // Is this hint session for a user application
     bool isAppSession();
-    const std::vector<int> &getTidList() const;
+    // Calls fn for each thread under mThreadIdsLock, so setThreads() can't
+    // replace them meanwhile. fn may take a TidShard lock but not call out.
+    template <typename F>
+    void forEachTid(F &&fn) const {
+        std::lock_guard<std::mutex> guard(mThreadIdsLock);
+        for (int32_t tid : mDescriptor->threadIds) {
+            fn(tid);
+        }
+    }
     int getUclampMin();
     void dumpToStream(std::ostream &stream);
+    void dumpTelemetryToStream(std::ostream &stream);
 
     // Disable any temporary boost and return to normal operation. It does not
     // reset the actual uclamp value, and relies on the caller to do so, to
@@ -96,19 +113,18 @@ class PowerHintSession : public BnPowerHintSession {
     bool disableTemporaryBoost();
 
   private:
-    class SessionTimerHandler : public MessageHandler {
+    class SessionTimerHandler : public SessionTimer {
       public:
         SessionTimerHandler(PowerHintSession *session, std::string name)
             : mSession(session), mIsSessionDead(false), mName(name) {}
         void updateTimer(nanoseconds delay);
-        void handleMessage(const Message &message) override;
+        void onExpired() override;
         void setSessionDead();
         virtual void onTimeout() = 0;
 
       protected:
         PowerHintSession *mSession;
         std::mutex mClosedLock;
-        std::mutex mMessageLock;
         std::atomic<time_point<steady_clock>> mTimeout;
         bool mIsSessionDead;
         const std::string mName;
@@ -128,18 +144,29 @@ class PowerHintSession : public BnPowerHintSession {
     };
 
   private:
-    void updateUniveralBoostMode();
+    // Report active/inactive transitions of app sessions to PowerSessionManager
+    void updateAppSessionActivity();
+    void markUpdated();
     int setSessionUclampMin(int32_t min, bool resetStale = true);
     void tryToSendPowerHint(std::string hint);
+    const AdpfConfigSnapshot &getAdpfConfigSnapshot();
     int64_t convertWorkDurationToBoostByPid(const std::vector<WorkDuration> &actualDurations);
+    int predictBoost(const AdpfConfigSnapshot &adpfConfig);
     void traceSessionVal(char const *identifier, int64_t val) const;
     AppHintDesc *mDescriptor = nullptr;
     sp<StaleTimerHandler> mStaleTimerHandler;
     sp<BoostTimerHandler> mBoostTimerHandler;
     std::atomic<time_point<steady_clock>> mLastUpdatedTime;
-    sp<MessageHandler> mPowerManagerHandler;
     std::mutex mSessionLock;
+    // Protects mDescriptor->threadIds, without calling out while held
+    mutable std::mutex mThreadIdsLock;
     std::atomic<bool> mSessionClosed = false;
+    // Set by the stale timer, cleared by the next report or hint
+    std::atomic<bool> mIsStale = true;
+    // Whether this session is counted as an active app session, protected by mSessionLock
+    bool mCountedActive = false;
+    // Whether it's counted by TouchLatencyController, protected by mSessionLock
+    bool mCountedLowLatency = false;
     std::string mIdString;
     // Used when setting a temporary boost value to hold the true boost
     std::atomic<std::optional<int>> mNextUclampMin;
@@ -147,6 +174,7 @@ class PowerHintSession : public BnPowerHintSession {
     std::unordered_map<std::string, std::optional<bool>> mSupportedHints;
     // Last session hint sent, used for logging
     int mLastHintSent = -1;
+    SessionTelemetry mTelemetry;
 };
 
 }  // namespace pixel
@@ -20,12 +20,17 @@
 #include "PowerSessionManager.h"
 
 #include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
 #include <log/log.h>
 #include <perfmgr/HintManager.h>
 #include <processgroup/processgroup.h>
 #include <sys/syscall.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace aidl {
 namespace google {
 namespace hardware {
@@ -35,8 +40,40 @@ namespace pixel {
 
 using ::android::perfmgr::AdpfConfig;
 using ::android::perfmgr::HintManager;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
 
 namespace {
+
+static const bool kThreadWeighting =
+        ::android::base::GetBoolProperty("vendor.powerhal.adpf.thread_weighting", false);
+static const uint32_t kThreadLoadSampleMs =
+        ::android::base::GetUintProperty("vendor.powerhal.adpf.thread_sample_ms", 100U);
+// Lightest share of the session uclamp.min a thread gets, out of kFullWeight
+static const int kMinThreadWeight = ::android::base::GetUintProperty(
+        "vendor.powerhal.adpf.thread_weight_min", TidUclampState::kFullWeight / 4);
+// Task profiles applied to a session's heavy (>= half the heaviest runtime)
+// and light threads, e.g. to steer them to big and little cores.
+static const std::string kHeavyThreadProfile =
+        ::android::base::GetProperty("vendor.powerhal.adpf.heavy_thread_profile", "");
+static const std::string kLightThreadProfile =
+        ::android::base::GetProperty("vendor.powerhal.adpf.light_thread_profile", "");
+// Task profile undoing the above once a thread leaves its last session
+static const std::string kDefaultThreadProfile =
+        ::android::base::GetProperty("vendor.powerhal.adpf.default_thread_profile", "");
+
+// First field of /proc/<tid>/schedstat is the time spent on cpu in ns.
+static bool readThreadRuntime(int tid, uint64_t *runtimeNs) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", tid);
+    std::string content;
+    if (!::android::base::ReadFileToString(path, &content)) {
+        return false;
+    }
+    return ::android::base::ParseUint(content.substr(0, content.find(' ')), runtimeNs);
+}
+
 /* there is no glibc or bionic wrapper */
 struct sched_attr {
     __u32 size;
@@ -81,104 +118,369 @@ static void set_uclamp_min(int tid, int min) {
 }
 }  // namespace
 
-void PowerSessionManager::updateHintMode(const std::string &mode, bool enabled) {
-    ALOGV("PowerSessionManager::updateHintMode: mode: %s, enabled: %d", mode.c_str(), enabled);
-    if (enabled && mode.compare(0, 8, "REFRESH_") == 0) {
-        if (mode.compare("REFRESH_120FPS") == 0) {
-            mDisplayRefreshRate = 120;
-        } else if (mode.compare("REFRESH_90FPS") == 0) {
-            mDisplayRefreshRate = 90;
-        } else if (mode.compare("REFRESH_60FPS") == 0) {
-            mDisplayRefreshRate = 60;
-        }
+void TidUclampState::addVote(PowerHintSession *session, int val) {
+    auto [it, inserted] = votes.emplace(session, Vote{val, kFullWeight});
+    if (inserted) {
+        updateMaxVote(0, it->second.value());
+    }
+}
+
+void TidUclampState::setVote(PowerHintSession *session, int val) {
+    auto it = votes.find(session);
+    if (it == votes.end() || it->second.requested == val) {
+        return;
+    }
+    updateVote(it->second, val, it->second.weight);
+}
+
+void TidUclampState::setWeight(PowerHintSession *session, int weight) {
+    auto it = votes.find(session);
+    if (it == votes.end() || it->second.weight == weight) {
+        return;
+    }
+    updateVote(it->second, it->second.requested, weight);
+}
+
+bool TidUclampState::removeVote(PowerHintSession *session) {
+    auto it = votes.find(session);
+    if (it == votes.end()) {
+        return false;
+    }
+    int oldVal = it->second.value();
+    votes.erase(it);
+    updateMaxVote(oldVal, 0);
+    return true;
+}
+
+void TidUclampState::updateVote(Vote &vote, int requested, int weight) {
+    int oldVal = vote.value();
+    vote.requested = requested;
+    vote.weight = weight;
+    updateMaxVote(oldVal, vote.value());
+}
+
+void TidUclampState::updateMaxVote(int oldVal, int newVal) {
+    if (newVal >= maxVote) {
+        maxVote = newVal;
+        return;
     }
-    if (HintManager::GetInstance()->GetAdpfProfile()) {
-        HintManager::GetInstance()->SetAdpfProfile(mode);
+    if (oldVal != maxVote) {
+        return;
+    }
+    // The max vote went down, find the new one.
+    maxVote = 0;
+    for (const auto &[s, vote] : votes) {
+        maxVote = std::max(maxVote, vote.value());
     }
 }
 
-void PowerSessionManager::updateHintBoost(const std::string &boost, int32_t durationMs) {
+void PowerSessionManager::updateHintMode(HintId mode, bool enabled) {
+    if (mode == kInvalidHintId) {
+        return;
+    }
+    HintInfo &info = HintRegistry::getInstance().info(mode);
+    ALOGV("PowerSessionManager::updateHintMode: mode: %s, enabled: %d", info.name.c_str(),
+          enabled);
+    if (enabled && info.refreshRate > 0) {
+        mDisplayRefreshRate = info.refreshRate;
+    }
+    // The profiles never change at runtime, so a name that isn't one is
+    // never tried again.
+    if (info.adpfProfile.load(std::memory_order_relaxed) != 0 &&
+        HintManager::GetInstance()->GetAdpfProfile()) {
+        bool isProfile = HintManager::GetInstance()->SetAdpfProfile(info.name);
+        info.adpfProfile.store(isProfile, std::memory_order_relaxed);
+        if (isProfile) {
+            mAdpfProfileGeneration.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void PowerSessionManager::updateHintBoost(HintId boost, int32_t durationMs) {
     ATRACE_CALL();
-    ALOGV("PowerSessionManager::updateHintBoost: boost: %s, durationMs: %d", boost.c_str(),
-          durationMs);
+    ALOGV("PowerSessionManager::updateHintBoost: boost: %d, durationMs: %d", boost, durationMs);
 }
 
 int PowerSessionManager::getDisplayRefreshRate() {
     return mDisplayRefreshRate;
 }
 
-void PowerSessionManager::addPowerSession(PowerHintSession *session) {
-    std::lock_guard<std::mutex> guard(mLock);
-    mSessions.insert(session);
-    addThreadsFromPowerSessionLocked(session);
+uint64_t PowerSessionManager::getAdpfProfileGeneration() const {
+    return mAdpfProfileGeneration.load(std::memory_order_relaxed);
 }
 
-void PowerSessionManager::removePowerSession(PowerHintSession *session) {
-    std::lock_guard<std::mutex> guard(mLock);
-    mSessions.erase(session);
-    removeThreadsFromPowerSessionLocked(session);
+PowerSessionManager::TidShard &PowerSessionManager::getTidShard(int tid) {
+    return mTidShards[static_cast<uint32_t>(tid) % kTidShardCount];
 }
 
-void PowerSessionManager::addThreadsFromPowerSession(PowerHintSession *session) {
-    std::lock_guard<std::mutex> guard(mLock);
-    addThreadsFromPowerSessionLocked(session);
+std::shared_ptr<const PowerSessionManager::SessionList> PowerSessionManager::getSessions() const {
+    return std::atomic_load(&mSessions);
+}
+
+std::vector<std::shared_ptr<PowerHintSession>> PowerSessionManager::lockSessions() const {
+    std::shared_ptr<const SessionList> sessions = getSessions();
+    std::vector<std::shared_ptr<PowerHintSession>> locked;
+    locked.reserve(sessions->size());
+    for (const SessionEntry &entry : *sessions) {
+        if (auto session = entry.ref.lock()) {
+            locked.push_back(std::move(session));
+        }
+    }
+    return locked;
+}
+
+void PowerSessionManager::addPowerSession(const std::shared_ptr<PowerHintSession> &session) {
+    {
+        std::lock_guard<std::mutex> guard(mSessionsWriteLock);
+        auto sessions = std::make_shared<SessionList>(*getSessions());
+        sessions->push_back({session.get(), session});
+        std::atomic_store(&mSessions, std::shared_ptr<const SessionList>(std::move(sessions)));
+    }
+    addThreadsFromPowerSession(session.get());
+}
+
+void PowerSessionManager::removePowerSession(PowerHintSession *session) {
+    {
+        std::lock_guard<std::mutex> guard(mSessionsWriteLock);
+        std::shared_ptr<const SessionList> current = getSessions();
+        auto sessions = std::make_shared<SessionList>();
+        sessions->reserve(current->size());
+        std::copy_if(current->begin(), current->end(), std::back_inserter(*sessions),
+                     [session](const SessionEntry &e) { return e.session != session; });
+        std::atomic_store(&mSessions, std::shared_ptr<const SessionList>(std::move(sessions)));
+    }
+    // Readers of an older list only reach the session through a strong
+    // reference, so it can't go away under them.
+    removeThreadsFromPowerSession(session);
 }
 
-void PowerSessionManager::addThreadsFromPowerSessionLocked(PowerHintSession *session) {
-    for (auto t : session->getTidList()) {
-        if (mTidSessionListMap[t].empty()) {
+void PowerSessionManager::addThreadsFromPowerSession(PowerHintSession *session) {
+    int vote = session->isActive() && !session->isTimeout() ? session->getUclampMin() : 0;
+    session->forEachTid([&](int t) {
+        TidShard &shard = getTidShard(t);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        TidUclampState &state = shard.tids[t];
+        if (state.votes.empty()) {
             if (!SetTaskProfiles(t, {"ResetUclampGrp"})) {
                 ALOGW("Failed to set ResetUclampGrp task profile for tid:%d", t);
             }
         }
-        mTidSessionListMap[t].insert(session);
+        state.addVote(session, vote);
+    });
+    if (kThreadWeighting) {
+        scheduleThreadLoadSample(false);
     }
 }
 
 void PowerSessionManager::removeThreadsFromPowerSession(PowerHintSession *session) {
-    std::lock_guard<std::mutex> guard(mLock);
-    removeThreadsFromPowerSessionLocked(session);
-}
-
-void PowerSessionManager::removeThreadsFromPowerSessionLocked(PowerHintSession *session) {
-    for (auto t : session->getTidList()) {
-        size_t cnt = mTidSessionListMap[t].erase(session);
-        if (cnt != 0 && mTidSessionListMap[t].empty()) {
+    session->forEachTid([&](int t) {
+        TidShard &shard = getTidShard(t);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.tids.find(t);
+        if (it == shard.tids.end() || !it->second.removeVote(session)) {
+            return;
+        }
+        // Fall back to what the remaining sessions ask for, or 0 if none.
+        applyTidUclampLocked(shard, t, it->second);
+        if (it->second.votes.empty()) {
             if (!SetTaskProfiles(t, {"NoResetUclampGrp"})) {
                 ALOGW("Failed to set NoResetUclampGrp task profile for tid:%d", t);
             }
+            if (it->second.heavy >= 0 && !kDefaultThreadProfile.empty() &&
+                !SetTaskProfiles(t, {kDefaultThreadProfile})) {
+                ALOGW("Failed to set %s task profile for tid:%d", kDefaultThreadProfile.c_str(),
+                      t);
+            }
+            shard.tids.erase(it);
         }
-    }
+    });
 }
 
 void PowerSessionManager::setUclampMin(PowerHintSession *session, int val) {
-    std::lock_guard<std::mutex> guard(mLock);
-    setUclampMinLocked(session, val);
-}
-
-void PowerSessionManager::setUclampMinLocked(PowerHintSession *session, int val) {
-    for (auto t : session->getTidList()) {
-        // Get thex max uclamp.min across sessions which include the tid.
-        int tidMax = 0;
-        for (PowerHintSession *s : mTidSessionListMap[t]) {
-            if (!s->isActive() || s->isTimeout())
-                continue;
-            tidMax = std::max(tidMax, s->getUclampMin());
+    session->forEachTid([&](int t) {
+        TidShard &shard = getTidShard(t);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.tids.find(t);
+        if (it == shard.tids.end()) {
+            return;
         }
-        set_uclamp_min(t, std::max(val, tidMax));
+        it->second.setVote(session, val);
+        applyTidUclampLocked(shard, t, it->second);
+    });
+    if (kThreadWeighting && val > 0) {
+        scheduleThreadLoadSample(false);
     }
 }
 
-std::optional<bool> PowerSessionManager::isAnyAppSessionActive() {
-    std::lock_guard<std::mutex> guard(mLock);
-    bool active = false;
-    for (PowerHintSession *s : mSessions) {
-        // session active and not stale is actually active.
-        if (s->isActive() && !s->isTimeout() && s->isAppSession()) {
-            active = true;
-            break;
+void PowerSessionManager::applyTidUclampLocked(TidShard &shard, int tid, TidUclampState &state) {
+    if (state.maxVote == state.applied) {
+        return;
+    }
+    state.applied = state.maxVote;
+    // Only the latest value queued for a tid before the flush gets written.
+    if (state.pendingIdx >= 0) {
+        shard.pendingUclamp[state.pendingIdx].second = state.maxVote;
+        return;
+    }
+    state.pendingIdx = shard.pendingUclamp.size();
+    shard.pendingUclamp.emplace_back(tid, state.maxVote);
+    scheduleUclampFlush();
+}
+
+void PowerSessionManager::scheduleUclampFlush() {
+    if (mUclampFlushScheduled.exchange(true)) {
+        return;
+    }
+    // Flush right away if the last one is more than a frame ago, otherwise
+    // on the next frame boundary.
+    nanoseconds frame = nanoseconds(std::chrono::seconds(1)) / std::max(1, getDisplayRefreshRate());
+    nanoseconds delay =
+            duration_cast<nanoseconds>(mLastUclampFlush.load() + frame - steady_clock::now());
+    delay = std::max(nanoseconds(0), delay);
+    PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(
+            delay.count(), sp<MessageHandler>::fromExisting(this), Message(MSG_FLUSH_UCLAMP));
+}
+
+void PowerSessionManager::flushUclamp() {
+    // Clear the flag first, anything queued from now on schedules a new flush.
+    mUclampFlushScheduled.store(false);
+    mLastUclampFlush.store(steady_clock::now());
+    for (TidShard &shard : mTidShards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const auto &[tid, val] : shard.pendingUclamp) {
+            auto it = shard.tids.find(tid);
+            if (it != shard.tids.end()) {
+                it->second.pendingIdx = -1;
+            }
+        }
+        mUclampFlushBuf.insert(mUclampFlushBuf.end(), shard.pendingUclamp.begin(),
+                               shard.pendingUclamp.end());
+        shard.pendingUclamp.clear();
+    }
+    ATRACE_INT("adpf.uclamp_flush", mUclampFlushBuf.size());
+    for (const auto &[tid, val] : mUclampFlushBuf) {
+        set_uclamp_min(tid, val);
+    }
+    mUclampFlushBuf.clear();
+}
+
+void PowerSessionManager::scheduleThreadLoadSample(bool delayed) {
+    if (!delayed) {
+        mThreadLoadActivity.store(true);
+        if (mThreadLoadSampling.exchange(true)) {
+            return;
+        }
+    }
+    PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(
+            delayed ? nanoseconds(std::chrono::milliseconds(kThreadLoadSampleMs)).count() : 0,
+            sp<MessageHandler>::fromExisting(this), Message(MSG_SAMPLE_THREAD_LOAD));
+}
+
+void PowerSessionManager::sampleThreadLoad() {
+    // Stop while every session is paused, closed or idle, the next boost
+    // starts sampling again.
+    if (!mThreadLoadActivity.exchange(false)) {
+        mThreadLoadSampling.store(false);
+        // A boost may have come in after the check and seen sampling running.
+        if (mThreadLoadActivity.load()) {
+            scheduleThreadLoadSample(false);
+        }
+        return;
+    }
+
+    // Read the runtimes without holding any shard lock.
+    mSampleTids.clear();
+    for (TidShard &shard : mTidShards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const auto &[tid, state] : shard.tids) {
+            mSampleTids.push_back(tid);
+        }
+    }
+    mSampleRuntimes.clear();
+    for (int tid : mSampleTids) {
+        uint64_t runtimeNs;
+        if (readThreadRuntime(tid, &runtimeNs)) {
+            mSampleRuntimes.emplace_back(tid, runtimeNs);
         }
     }
+    for (const auto &[tid, runtimeNs] : mSampleRuntimes) {
+        TidShard &shard = getTidShard(tid);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.tids.find(tid);
+        if (it == shard.tids.end()) {
+            continue;
+        }
+        TidUclampState &state = it->second;
+        state.runtimeDeltaNs =
+                state.runtimeNs == 0 || runtimeNs < state.runtimeNs ? 0 : runtimeNs - state.runtimeNs;
+        state.runtimeNs = runtimeNs;
+    }
+
+    // Weigh every thread of a session against the session's heaviest thread.
+    const int minWeight = std::min(kMinThreadWeight, TidUclampState::kFullWeight);
+    for (const auto &session : lockSessions()) {
+        PowerHintSession *s = session.get();
+        uint64_t maxDeltaNs = 0;
+        s->forEachTid([&](int tid) {
+            TidShard &shard = getTidShard(tid);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.tids.find(tid);
+            if (it != shard.tids.end()) {
+                maxDeltaNs = std::max(maxDeltaNs, it->second.runtimeDeltaNs);
+            }
+        });
+        s->forEachTid([&](int tid) {
+            TidShard &shard = getTidShard(tid);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.tids.find(tid);
+            if (it == shard.tids.end()) {
+                return;
+            }
+            TidUclampState &state = it->second;
+            int weight = TidUclampState::kFullWeight;
+            if (maxDeltaNs > 0) {
+                weight = state.runtimeDeltaNs * TidUclampState::kFullWeight / maxDeltaNs;
+                weight = std::clamp(weight, minWeight, TidUclampState::kFullWeight);
+            }
+            state.setWeight(s, weight);
+            applyTidUclampLocked(shard, tid, state);
+        });
+    }
+
+    if (!kHeavyThreadProfile.empty() || !kLightThreadProfile.empty()) {
+        for (TidShard &shard : mTidShards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            for (auto &[tid, state] : shard.tids) {
+                int heavy = 0;
+                for (const auto &[session, vote] : state.votes) {
+                    heavy |= vote.weight >= TidUclampState::kFullWeight / 2;
+                }
+                if (heavy == state.heavy) {
+                    continue;
+                }
+                state.heavy = heavy;
+                const std::string &profile = heavy ? kHeavyThreadProfile : kLightThreadProfile;
+                if (!profile.empty() && !SetTaskProfiles(tid, {profile})) {
+                    ALOGW("Failed to set %s task profile for tid:%d", profile.c_str(), tid);
+                }
+            }
+        }
+    }
+
+    scheduleThreadLoadSample(true);
+}
+
+void PowerSessionManager::updateActiveAppSessionCount(bool active) {
+    int prev = mActiveAppSessions.fetch_add(active ? 1 : -1);
+    // The top-app boost only cares about the count crossing zero.
+    if ((active && prev == 0) || (!active && prev == 1)) {
+        PowerHintMonitor::getInstance()->getLooper()->sendMessage(
+                sp<MessageHandler>::fromExisting(this), Message(MSG_UPDATE_TOP_APP_BOOST));
+    }
+}
+
+std::optional<bool> PowerSessionManager::isAnyAppSessionActive() {
+    bool active = mActiveAppSessions.load() > 0;
     if (active == mActive) {
         return std::nullopt;
     } else {
@@ -188,7 +490,19 @@ std::optional<bool> PowerSessionManager::isAnyAppSessionActive() {
     return active;
 }
 
-void PowerSessionManager::handleMessage(const Message &) {
+void PowerSessionManager::handleMessage(const Message &message) {
+    if (message.what == MSG_FLUSH_UCLAMP) {
+        flushUclamp();
+        return;
+    }
+    if (message.what == MSG_SAMPLE_THREAD_LOAD) {
+        sampleThreadLoad();
+        return;
+    }
+    if (message.what == MSG_SAVE_SNAPSHOT) {
+        saveSnapshot();
+        return;
+    }
     auto active = isAnyAppSessionActive();
     if (!active.has_value()) {
         return;
@@ -200,21 +514,83 @@ void PowerSessionManager::handleMessage(const Message &) {
     }
 }
 
+void PowerSessionManager::setSnapshotProvider(std::function<void(StateSnapshot *)> provider) {
+    std::lock_guard<std::mutex> guard(mSnapshotLock);
+    mSnapshotProvider = std::move(provider);
+}
+
+void PowerSessionManager::requestSnapshotSave() {
+    if (StateSnapshot::path().empty() || mSnapshotScheduled.exchange(true)) {
+        return;
+    }
+    PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(
+            nanoseconds(std::chrono::seconds(1)).count(), sp<MessageHandler>::fromExisting(this),
+            Message(MSG_SAVE_SNAPSHOT));
+}
+
+void PowerSessionManager::saveSnapshot() {
+    mSnapshotScheduled.store(false);
+    StateSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> guard(mSnapshotLock);
+        if (mSnapshotProvider) {
+            mSnapshotProvider(&snapshot);
+        }
+        // keep what was restored but not claimed yet for a while, the app may
+        // still come back
+        if (std::chrono::steady_clock::now() - mRestoredTime > kRestoredSessionTimeout) {
+            mRestoredSessions.clear();
+        }
+        snapshot.sessions = mRestoredSessions;
+    }
+    for (const auto &s : lockSessions()) {
+        snapshot.sessions.push_back(s->getSnapshot());
+    }
+    if (snapshot != mSavedSnapshot && snapshot.save()) {
+        mSavedSnapshot = std::move(snapshot);
+    }
+}
+
+void PowerSessionManager::restoreSessionSnapshots(const std::vector<SessionSnapshot> &sessions) {
+    std::lock_guard<std::mutex> guard(mSnapshotLock);
+    mRestoredSessions = sessions;
+    mRestoredTime = std::chrono::steady_clock::now();
+}
+
+bool PowerSessionManager::takeSessionSnapshot(int32_t tgid, int32_t uid,
+                                              SessionSnapshot *snapshot) {
+    std::lock_guard<std::mutex> guard(mSnapshotLock);
+    auto it = std::find_if(mRestoredSessions.begin(), mRestoredSessions.end(),
+                           [&](const SessionSnapshot &s) { return s.tgid == tgid && s.uid == uid; });
+    if (it == mRestoredSessions.end()) {
+        return false;
+    }
+    *snapshot = *it;
+    mRestoredSessions.erase(it);
+    return true;
+}
+
 void PowerSessionManager::dumpToFd(int fd) {
     std::ostringstream dump_buf;
-    std::lock_guard<std::mutex> guard(mLock);
+    std::vector<std::shared_ptr<PowerHintSession>> sessions = lockSessions();
     dump_buf << "========== Begin PowerSessionManager ADPF list ==========\n";
-    for (PowerHintSession *s : mSessions) {
+    for (const auto &s : sessions) {
         s->dumpToStream(dump_buf);
         dump_buf << " Tid:Ref[";
-        for (size_t i = 0, len = s->getTidList().size(); i < len; i++) {
-            int t = s->getTidList()[i];
-            dump_buf << t << ":" << mTidSessionListMap[t].size();
-            if (i < len - 1) {
-                dump_buf << ", ";
+        const char *separator = "";
+        s->forEachTid([&](int t) {
+            TidShard &shard = getTidShard(t);
+            size_t refs = 0;
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                auto it = shard.tids.find(t);
+                refs = it == shard.tids.end() ? 0 : it->second.votes.size();
             }
-        }
+            dump_buf << separator << t << ":" << refs;
+            separator = ", ";
+        });
         dump_buf << "]\n";
+        s->dumpTelemetryToStream(dump_buf);
     }
     dump_buf << "========== End PowerSessionManager ADPF list ==========\n";
     if (!::android::base::WriteStringToFd(dump_buf.str(), fd)) {
@@ -254,6 +630,10 @@ sp<Looper> PowerHintMonitor::getLooper() {
     return mLooper;
 }
 
+const sp<SessionTimerQueue> &PowerHintMonitor::getTimerQueue() {
+    return mTimerQueue;
+}
+
 }  // namespace pixel
 }  // namespace impl
 }  // namespace power
@@ -20,11 +20,21 @@
 #include <perfmgr/HintManager.h>
 #include <utils/Looper.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <unordered_set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "HintRegistry.h"
 #include "PowerHintSession.h"
+#include "SessionTimerQueue.h"
+#include "StateSnapshot.h"
 
 namespace aidl {
 namespace google {
@@ -41,23 +51,71 @@ using ::android::perfmgr::HintManager;
 
 constexpr char kPowerHalAdpfDisableTopAppBoost[] = "vendor.powerhal.adpf.disable.hint";
 
+enum PowerSessionManagerMessage : int {
+    MSG_UPDATE_TOP_APP_BOOST = 0,
+    MSG_FLUSH_UCLAMP,
+    MSG_SAMPLE_THREAD_LOAD,
+    MSG_SAVE_SNAPSHOT,
+};
+
+// uclamp.min votes of all the sessions sharing a tid. The effective value of
+// the tid is the max vote, which is cached and only rescanned when the vote
+// holding it goes down or away.
+struct TidUclampState {
+    static constexpr int kFullWeight = 1024;
+    struct Vote {
+        int requested = 0;
+        // share of the session uclamp.min given to this tid, out of kFullWeight
+        int weight = kFullWeight;
+        int value() const { return requested * weight / kFullWeight; }
+    };
+
+    void addVote(PowerHintSession *session, int val);
+    void setVote(PowerHintSession *session, int val);
+    void setWeight(PowerHintSession *session, int weight);
+    bool removeVote(PowerHintSession *session);
+    std::unordered_map<PowerHintSession *, Vote> votes;
+    int maxVote = 0;
+    // last value handed to sched_setattr, -1 if none yet
+    int applied = -1;
+    // index of the tid in the pending uclamp writes, -1 if not queued
+    int pendingIdx = -1;
+    // schedstat runtime at the last load sample and its growth since the one before
+    uint64_t runtimeNs = 0;
+    uint64_t runtimeDeltaNs = 0;
+    // whether the heavy thread task profile is applied, -1 if no profile set yet
+    int heavy = -1;
+
+  private:
+    void updateVote(Vote &vote, int requested, int weight);
+    void updateMaxVote(int oldVal, int newVal);
+};
+
 class PowerSessionManager : public MessageHandler {
   public:
     // current hint info
-    void updateHintMode(const std::string &mode, bool enabled);
-    void updateHintBoost(const std::string &boost, int32_t durationMs);
+    void updateHintMode(HintId mode, bool enabled);
+    void updateHintBoost(HintId boost, int32_t durationMs);
     int getDisplayRefreshRate();
+    // bumped every time the active ADPF profile is switched
+    uint64_t getAdpfProfileGeneration() const;
     // monitoring session status
-    void addPowerSession(PowerHintSession *session);
+    void addPowerSession(const std::shared_ptr<PowerHintSession> &session);
     void removePowerSession(PowerHintSession *session);
     void addThreadsFromPowerSession(PowerHintSession *session);
-    void addThreadsFromPowerSessionLocked(PowerHintSession *session);
     void removeThreadsFromPowerSession(PowerHintSession *session);
-    void removeThreadsFromPowerSessionLocked(PowerHintSession *session);
     void setUclampMin(PowerHintSession *session, int min);
-    void setUclampMinLocked(PowerHintSession *session, int min);
+    void updateActiveAppSessionCount(bool active);
     void handleMessage(const Message &message) override;
     void dumpToFd(int fd);
+    // Warm-start snapshot: the provider fills in the non-ADPF state, sessions
+    // are added here. Saves are coalesced to at most one per second and
+    // skipped when nothing changed since the last one.
+    void setSnapshotProvider(std::function<void(StateSnapshot *)> provider);
+    void requestSnapshotSave();
+    void restoreSessionSnapshots(const std::vector<SessionSnapshot> &sessions);
+    // Hands out the restored state of a recreated session, at most once
+    bool takeSessionSnapshot(int32_t tgid, int32_t uid, SessionSnapshot *snapshot);
 
     // Singleton
     static sp<PowerSessionManager> getInstance() {
@@ -66,25 +124,80 @@ class PowerSessionManager : public MessageHandler {
     }
 
   private:
+    // Entries don't keep their session alive: a reader promotes the weak
+    // reference for as long as it uses the session, which fails once the
+    // session is being destroyed.
+    struct SessionEntry {
+        PowerHintSession *session;
+        std::weak_ptr<PowerHintSession> ref;
+    };
+    using SessionList = std::vector<SessionEntry>;
+    static constexpr size_t kTidShardCount = 16;
+    // Per-tid state is sharded by tid, so reports from sessions that don't
+    // share threads don't contend on a single lock.
+    struct TidShard {
+        std::mutex lock;
+        std::unordered_map<int, TidUclampState> tids;    // protected by lock
+        std::vector<std::pair<int, int>> pendingUclamp;  // protected by lock
+    };
+
+    TidShard &getTidShard(int tid);
+    void applyTidUclampLocked(TidShard &shard, int tid, TidUclampState &state);
+    void scheduleUclampFlush();
+    void flushUclamp();
+    void scheduleThreadLoadSample(bool delayed);
+    void sampleThreadLoad();
+    void saveSnapshot();
+    std::shared_ptr<const SessionList> getSessions() const;
+    // Strong references to the live sessions of the current list. Must be
+    // dropped outside any lock, the last one may destroy its session.
+    std::vector<std::shared_ptr<PowerHintSession>> lockSessions() const;
     std::optional<bool> isAnyAppSessionActive();
     void disableSystemTopAppBoost();
     void enableSystemTopAppBoost();
     const std::string kDisableBoostHintName;
 
-    std::unordered_set<PowerHintSession *> mSessions;  // protected by mLock
-    std::unordered_map<int, std::unordered_set<PowerHintSession *>> mTidSessionListMap;
-    bool mActive;  // protected by mLock
-    /**
-     * mLock to pretect the above data objects opertions.
-     **/
-    std::mutex mLock;
+    // Published copy-on-write: readers take a reference on the current list
+    // without locking, writers serialize on mSessionsWriteLock.
+    std::shared_ptr<const SessionList> mSessions;
+    std::mutex mSessionsWriteLock;
+    std::array<TidShard, kTidShardCount> mTidShards;
+    // Number of app sessions that are active and not stale
+    std::atomic<int> mActiveAppSessions;
+    bool mActive;  // only accessed from the PowerHintMonitor thread
+    // Coalesced sched_setattr writes, flushed once per frame on the monitor thread.
+    std::vector<std::pair<int, int>> mUclampFlushBuf;  // only used by flushUclamp()
+    std::atomic<bool> mUclampFlushScheduled;
+    std::atomic<std::chrono::steady_clock::time_point> mLastUclampFlush;
+    // Per thread weighting of session uclamp.min from schedstat runtime
+    std::atomic<bool> mThreadLoadSampling;
+    // Set by every boost since the last sample, sampling stops once a sample finds it clear
+    std::atomic<bool> mThreadLoadActivity;
+    std::vector<int> mSampleTids;                           // only used by sampleThreadLoad()
+    std::vector<std::pair<int, uint64_t>> mSampleRuntimes;  // only used by sampleThreadLoad()
     int mDisplayRefreshRate;
+    std::atomic<uint64_t> mAdpfProfileGeneration;
+    std::atomic<bool> mSnapshotScheduled;
+    std::mutex mSnapshotLock;
+    std::function<void(StateSnapshot *)> mSnapshotProvider;  // protected by mSnapshotLock
+    std::vector<SessionSnapshot> mRestoredSessions;          // protected by mSnapshotLock
+    std::chrono::steady_clock::time_point mRestoredTime;     // protected by mSnapshotLock
+    StateSnapshot mSavedSnapshot;                            // only used by saveSnapshot()
+    static constexpr std::chrono::seconds kRestoredSessionTimeout{30};
     // Singleton
     PowerSessionManager()
         : kDisableBoostHintName(::android::base::GetProperty(kPowerHalAdpfDisableTopAppBoost,
                                                              "ADPF_DISABLE_TA_BOOST")),
+          mSessions(std::make_shared<const SessionList>()),
+          mActiveAppSessions(0),
           mActive(false),
-          mDisplayRefreshRate(60) {}
+          mUclampFlushScheduled(false),
+          mLastUclampFlush(std::chrono::steady_clock::time_point()),
+          mThreadLoadSampling(false),
+          mThreadLoadActivity(false),
+          mDisplayRefreshRate(60),
+          mAdpfProfileGeneration(1),
+          mSnapshotScheduled(false) {}
     PowerSessionManager(PowerSessionManager const &) = delete;
     void operator=(PowerSessionManager const &) = delete;
 };
@@ -94,6 +207,7 @@ class PowerHintMonitor : public Thread {
     void start();
     bool threadLoop() override;
     sp<Looper> getLooper();
+    const sp<SessionTimerQueue> &getTimerQueue();
     // Singleton
     static sp<PowerHintMonitor> getInstance() {
         static sp<PowerHintMonitor> instance = new PowerHintMonitor();
@@ -104,8 +218,10 @@ class PowerHintMonitor : public Thread {
 
   private:
     sp<Looper> mLooper;
+    sp<SessionTimerQueue> mTimerQueue;
     // Singleton
-    PowerHintMonitor() : Thread(false), mLooper(new Looper(true)) {}
+    PowerHintMonitor()
+        : Thread(false), mLooper(new Looper(true)), mTimerQueue(new SessionTimerQueue()) {}
 };
 
 }  // namespace pixel
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SessionTelemetry.h"
+
+#include <algorithm>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+size_t SessionTelemetry::durationBucket(int64_t us) {
+    if (us < (1 << kSubBucketBits)) {
+        return std::max<int64_t>(us, 0);
+    }
+    int msb = 63 - __builtin_clzll(us);
+    size_t sub = (us >> (msb - kSubBucketBits)) & ((1 << kSubBucketBits) - 1);
+    size_t bucket = ((msb - kSubBucketBits + 1) << kSubBucketBits) + sub;
+    return std::min(bucket, kDurationBuckets - 1);
+}
+
+int64_t SessionTelemetry::durationBucketLowUs(size_t bucket) {
+    if (bucket < (1 << kSubBucketBits)) {
+        return bucket;
+    }
+    int msb = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    int64_t sub = bucket & ((1 << kSubBucketBits) - 1);
+    return (1LL << msb) + (sub << (msb - kSubBucketBits));
+}
+
+template <size_t N>
+size_t SessionTelemetry::percentileBucket(const std::array<uint32_t, N> &histogram,
+                                          uint64_t total, int percentile) {
+    uint64_t rank = (total * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < N; i++) {
+        seen += histogram[i];
+        if (seen >= rank) {
+            return i;
+        }
+    }
+    return N - 1;
+}
+
+void SessionTelemetry::recordSample(int64_t actualNs, int64_t targetNs) {
+    std::lock_guard<std::mutex> guard(mLock);
+    mDurationHist[durationBucket(actualNs / 1000)]++;
+    if (targetNs > 0) {
+        size_t ratio = std::max<int64_t>(actualNs, 0) * 10 / targetNs;
+        mRatioHist[std::min(ratio, kRatioBuckets - 1)]++;
+    }
+    mSampleCount++;
+    mOverTargetCount += actualNs > targetNs;
+    mMaxActualNs = std::max(mMaxActualNs, actualNs);
+}
+
+void SessionTelemetry::recordReport(const Report &report) {
+    std::lock_guard<std::mutex> guard(mLock);
+    mReportHead = (mReportHead + 1) % kReportHistory;
+    mReports[mReportHead] = report;
+    mReportCount++;
+}
+
+void SessionTelemetry::dumpToStream(std::ostream &stream) {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mSampleCount == 0) {
+        stream << "  no reports\n";
+        return;
+    }
+    stream << "  Samples.OverTarget(" << mSampleCount << ", " << mOverTargetCount << ")";
+    stream << " Actual(us) p50/p90/p99/max["
+           << durationBucketLowUs(percentileBucket(mDurationHist, mSampleCount, 50)) << "/"
+           << durationBucketLowUs(percentileBucket(mDurationHist, mSampleCount, 90)) << "/"
+           << durationBucketLowUs(percentileBucket(mDurationHist, mSampleCount, 99)) << "/"
+           << mMaxActualNs / 1000 << "]";
+    stream << " Actual/Target(%) p50/p90/p99["
+           << percentileBucket(mRatioHist, mSampleCount, 50) * 10 << "/"
+           << percentileBucket(mRatioHist, mSampleCount, 90) * 10 << "/"
+           << percentileBucket(mRatioHist, mSampleCount, 99) * 10 << "]\n";
+
+    stream << "  Actual.Target.Min.P.I.D[";
+    size_t count = std::min<uint64_t>(mReportCount, kReportHistory);
+    for (size_t i = 0; i < count; i++) {
+        const Report &r = mReports[(mReportHead + kReportHistory - i) % kReportHistory];
+        stream << (i == 0 ? "" : ", ") << r.actualNs / 1000 << "." << r.targetNs / 1000 << "."
+               << r.uclampMin << "." << r.pOut << "." << r.iOut << "." << r.dOut;
+    }
+    stream << "]\n";
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
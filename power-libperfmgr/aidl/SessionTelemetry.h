@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+// Fixed size history of an ADPF session, recorded whether or not atrace is
+// enabled so PID tuning can be checked from a bugreport.
+class SessionTelemetry {
+  public:
+    struct Report {
+        int64_t actualNs;
+        int64_t targetNs;
+        int32_t uclampMin;
+        int64_t pOut;
+        int64_t iOut;
+        int64_t dOut;
+    };
+
+    // Every sample of a reported batch
+    void recordSample(int64_t actualNs, int64_t targetNs);
+    // One entry per reportActualWorkDuration() call
+    void recordReport(const Report &report);
+    void dumpToStream(std::ostream &stream);
+
+  private:
+    static constexpr size_t kReportHistory = 16;
+    // Log-linear histogram: 4 buckets per power of two of microseconds.
+    static constexpr int kSubBucketBits = 2;
+    static constexpr size_t kDurationBuckets = 21 << kSubBucketBits;
+    // Actual over target in 10% steps, the last bucket collects >= 300%.
+    static constexpr size_t kRatioBuckets = 31;
+
+    static size_t durationBucket(int64_t us);
+    static int64_t durationBucketLowUs(size_t bucket);
+    template <size_t N>
+    static size_t percentileBucket(const std::array<uint32_t, N> &histogram, uint64_t total,
+                                   int percentile);
+
+    std::mutex mLock;
+    std::array<Report, kReportHistory> mReports{};          // protected by mLock
+    size_t mReportHead = 0;                                  // protected by mLock
+    uint64_t mReportCount = 0;                               // protected by mLock
+    std::array<uint32_t, kDurationBuckets> mDurationHist{};  // protected by mLock
+    std::array<uint32_t, kRatioBuckets> mRatioHist{};        // protected by mLock
+    uint64_t mSampleCount = 0;                               // protected by mLock
+    uint64_t mOverTargetCount = 0;                           // protected by mLock
+    int64_t mMaxActualNs = 0;                                // protected by mLock
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
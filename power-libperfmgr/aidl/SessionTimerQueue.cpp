@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+#define ATRACE_TAG (ATRACE_TAG_POWER | ATRACE_TAG_HAL)
+
+#include "SessionTimerQueue.h"
+
+#include <utils/Trace.h>
+
+#include "PowerSessionManager.h"
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+SessionTimerQueue::SessionTimerQueue() : mArmedTick(kNotQueued) {}
+
+int64_t SessionTimerQueue::toTick(steady_clock::time_point time, bool roundUp) {
+    int64_t ns = duration_cast<nanoseconds>(time.time_since_epoch()).count();
+    return roundUp ? (ns + kTickNs - 1) / kTickNs : ns / kTickNs;
+}
+
+void SessionTimerQueue::schedule(SessionTimer *timer, steady_clock::time_point deadline) {
+    int64_t tick = toTick(deadline, true);
+    // Already queued to expire no later than asked, onExpired() re-arms it.
+    if (timer->mQueuedTick.load() <= tick) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mLock);
+    if (timer->mHeapIndex >= 0) {
+        if (timer->mQueuedTick.load() <= tick) {
+            return;
+        }
+        timer->mQueuedTick.store(tick);
+        siftUpLocked(timer->mHeapIndex);
+    } else {
+        pushLocked(timer, tick);
+    }
+    armLocked();
+}
+
+void SessionTimerQueue::cancel(SessionTimer *timer) {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (timer->mHeapIndex >= 0) {
+        removeLocked(timer);
+    }
+}
+
+void SessionTimerQueue::handleMessage(const Message &) {
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        mArmedTick = kNotQueued;
+        int64_t now = toTick(steady_clock::now(), false);
+        while (!mHeap.empty() && mHeap[0]->mQueuedTick.load() <= now) {
+            SessionTimer *timer = mHeap[0];
+            removeLocked(timer);
+            mExpired.push_back(sp<SessionTimer>::fromExisting(timer));
+        }
+        armLocked();
+    }
+    ATRACE_INT("adpf.timer_expired", mExpired.size());
+    for (auto &timer : mExpired) {
+        timer->onExpired();
+    }
+    mExpired.clear();
+}
+
+void SessionTimerQueue::pushLocked(SessionTimer *timer, int64_t tick) {
+    timer->mQueuedTick.store(tick);
+    timer->mHeapIndex = mHeap.size();
+    mHeap.push_back(timer);
+    siftUpLocked(timer->mHeapIndex);
+}
+
+void SessionTimerQueue::removeLocked(SessionTimer *timer) {
+    size_t index = timer->mHeapIndex;
+    size_t last = mHeap.size() - 1;
+    if (index != last) {
+        swapLocked(index, last);
+    }
+    mHeap.pop_back();
+    timer->mHeapIndex = -1;
+    timer->mQueuedTick.store(kNotQueued);
+    if (index < mHeap.size()) {
+        siftDownLocked(index);
+        siftUpLocked(index);
+    }
+}
+
+void SessionTimerQueue::siftUpLocked(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (mHeap[parent]->mQueuedTick.load() <= mHeap[index]->mQueuedTick.load()) {
+            break;
+        }
+        swapLocked(parent, index);
+        index = parent;
+    }
+}
+
+void SessionTimerQueue::siftDownLocked(size_t index) {
+    while (true) {
+        size_t smallest = index;
+        for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < mHeap.size();
+             child++) {
+            if (mHeap[child]->mQueuedTick.load() < mHeap[smallest]->mQueuedTick.load()) {
+                smallest = child;
+            }
+        }
+        if (smallest == index) {
+            return;
+        }
+        swapLocked(smallest, index);
+        index = smallest;
+    }
+}
+
+void SessionTimerQueue::swapLocked(size_t a, size_t b) {
+    std::swap(mHeap[a], mHeap[b]);
+    mHeap[a]->mHeapIndex = a;
+    mHeap[b]->mHeapIndex = b;
+}
+
+void SessionTimerQueue::armLocked() {
+    if (mHeap.empty()) {
+        return;
+    }
+    int64_t tick = mHeap[0]->mQueuedTick.load();
+    if (tick >= mArmedTick) {
+        return;
+    }
+    mArmedTick = tick;
+    int64_t delay = tick * kTickNs -
+                    duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    sp<MessageHandler> selfPtr = sp<MessageHandler>::fromExisting(this);
+    PowerHintMonitor::getInstance()->getLooper()->removeMessages(selfPtr);
+    PowerHintMonitor::getInstance()->getLooper()->sendMessageDelayed(std::max<int64_t>(0, delay),
+                                                                     selfPtr, NULL);
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <utils/Looper.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::android::Message;
+using ::android::MessageHandler;
+using ::android::sp;
+
+// A timer serviced by the SessionTimerQueue.
+class SessionTimer : public virtual ::android::RefBase {
+  public:
+    // Called on the PowerHintMonitor thread once the queued deadline passed.
+    virtual void onExpired() = 0;
+
+  private:
+    friend class SessionTimerQueue;
+    // Tick the timer is queued for, SessionTimerQueue::kNotQueued if none.
+    std::atomic<int64_t> mQueuedTick = std::numeric_limits<int64_t>::max();
+    // Position in the queue heap, protected by the queue lock.
+    ssize_t mHeapIndex = -1;
+};
+
+// Deadline queue shared by all the ADPF session timers.
+//
+// Deadlines are rounded up to kTickNs so timers expiring close to each other
+// share a single wakeup of the monitor thread, and only the earliest tick is
+// posted to the looper. Re-arming a timer to a later deadline, which happens
+// on nearly every report, leaves it queued at its old tick: the timer checks
+// its real deadline in onExpired() and re-arms itself if that moved.
+class SessionTimerQueue : public MessageHandler {
+  public:
+    static constexpr int64_t kTickNs = 2000000;
+    static constexpr int64_t kNotQueued = std::numeric_limits<int64_t>::max();
+
+    SessionTimerQueue();
+    void schedule(SessionTimer *timer, std::chrono::steady_clock::time_point deadline);
+    void cancel(SessionTimer *timer);
+    void handleMessage(const Message &message) override;
+
+  private:
+    static int64_t toTick(std::chrono::steady_clock::time_point time, bool roundUp);
+    void pushLocked(SessionTimer *timer, int64_t tick);
+    void removeLocked(SessionTimer *timer);
+    void siftUpLocked(size_t index);
+    void siftDownLocked(size_t index);
+    void swapLocked(size_t a, size_t b);
+    void armLocked();
+
+    std::mutex mLock;
+    std::vector<SessionTimer *> mHeap;  // protected by mLock
+    int64_t mArmedTick;                 // protected by mLock
+    // Reused on every expiry so firing timers does not allocate.
+    std::vector<sp<SessionTimer>> mExpired;  // only used by handleMessage()
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "StateSnapshot.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+#include <time.h>
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::android::base::ParseInt;
+using ::android::base::StringAppendF;
+
+namespace {
+
+constexpr char kSnapshotVersion[] = "v1";
+
+}  // namespace
+
+int64_t StateSnapshot::nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+const std::string &StateSnapshot::path() {
+    static const std::string kPath = ::android::base::GetProperty(
+            "vendor.powerhal.snapshot_path", "/dev/powerhal/state");
+    return kPath;
+}
+
+bool StateSnapshot::save() const {
+    if (path().empty()) {
+        return false;
+    }
+    std::string buf = kSnapshotVersion;
+    buf += "\n";
+    for (const auto &[name, priority] : modes) {
+        StringAppendF(&buf, "mode %s %d\n", name.c_str(), priority);
+    }
+    for (const auto &[name, deadline] : boosts) {
+        StringAppendF(&buf, "boost %s %" PRId64 "\n", name.c_str(), deadline);
+    }
+    for (const auto &s : sessions) {
+        StringAppendF(&buf, "session %d %d %" PRId64 " %d\n", s.tgid, s.uid, s.integralError,
+                      s.currentMin);
+    }
+
+    // write and rename so a crash mid-write never leaves a torn snapshot
+    std::string tmp = path() + ".tmp";
+    if (!::android::base::WriteStringToFile(buf, tmp)) {
+        ALOGW("Failed to write state snapshot %s (%d)", tmp.c_str(), errno);
+        return false;
+    }
+    if (rename(tmp.c_str(), path().c_str()) != 0) {
+        ALOGW("Failed to publish state snapshot %s (%d)", path().c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+bool StateSnapshot::load() {
+    std::string content;
+    if (path().empty() || !::android::base::ReadFileToString(path(), &content)) {
+        return false;
+    }
+    std::vector<std::string> lines = ::android::base::Split(content, "\n");
+    if (lines.empty() || lines[0] != kSnapshotVersion) {
+        ALOGW("Ignoring state snapshot with unknown version");
+        return false;
+    }
+    for (size_t i = 1; i < lines.size(); i++) {
+        std::vector<std::string> f = ::android::base::Split(lines[i], " ");
+        if (f[0] == "mode" && f.size() == 3) {
+            int priority;
+            if (ParseInt(f[2], &priority, 0, static_cast<int>(HINT_PRIORITY_NORMAL))) {
+                modes.emplace_back(f[1], static_cast<HintPriority>(priority));
+            }
+        } else if (f[0] == "boost" && f.size() == 3) {
+            int64_t deadline;
+            if (ParseInt(f[2], &deadline)) {
+                boosts.emplace_back(f[1], deadline);
+            }
+        } else if (f[0] == "session" && f.size() == 5) {
+            SessionSnapshot s;
+            if (ParseInt(f[1], &s.tgid) && ParseInt(f[2], &s.uid) &&
+                ParseInt(f[3], &s.integralError) && ParseInt(f[4], &s.currentMin)) {
+                sessions.push_back(s);
+            }
+        } else if (!lines[i].empty()) {
+            ALOGW("Ignoring malformed state snapshot line: %s", lines[i].c_str());
+        }
+    }
+    return true;
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HintArbiter.h"
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+// ADPF tuning state of a session, matched on tgid and uid when the app
+// recreates its session after a HAL restart.
+struct SessionSnapshot {
+    int32_t tgid;
+    int32_t uid;
+    int64_t integralError;
+    int currentMin;
+
+    bool operator==(const SessionSnapshot &other) const {
+        return tgid == other.tgid && uid == other.uid && integralError == other.integralError &&
+               currentMin == other.currentMin;
+    }
+};
+
+// Compact copy of the live power state kept in tmpfs, so that a restarted
+// HAL can bring it back before the framework re-sends anything. Deadlines
+// are CLOCK_BOOTTIME milliseconds, making them survive the restart.
+struct StateSnapshot {
+    std::vector<std::pair<std::string, HintPriority>> modes;
+    std::vector<std::pair<std::string, int64_t>> boosts;
+    std::vector<SessionSnapshot> sessions;
+
+    static int64_t nowMs();
+    static const std::string &path();
+    bool save() const;
+    // Fails if there is no snapshot, e.g. on first start after boot
+    bool load();
+
+    bool operator==(const StateSnapshot &other) const {
+        return modes == other.modes && boosts == other.boosts && sessions == other.sessions;
+    }
+    bool operator!=(const StateSnapshot &other) const { return !(*this == other); }
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "powerhal-libperfmgr"
+
+#include "TouchLatencyController.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <vendor/lineage/touch/1.1/IHighTouchPollingRate.h>
+
+#include <inttypes.h>
+
+#include <thread>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+using ::vendor::lineage::touch::V1_1::IHighTouchPollingRate;
+
+// Sessions go stale and come back between frames and levels, don't flap the
+// controller's scan rate with them
+static constexpr std::chrono::milliseconds kReleaseDelay{1000};
+
+TouchLatencyController &TouchLatencyController::getInstance() {
+    static TouchLatencyController instance;
+    return instance;
+}
+
+TouchLatencyController::TouchLatencyController()
+    : mEnabled(::android::base::GetBoolProperty("vendor.powerhal.touch.auto_polling", false)),
+      mTargetThreshold(::android::base::GetIntProperty<int64_t>(
+              "vendor.powerhal.touch.auto_polling_target_ns", 10000000)) {
+    if (mEnabled) {
+        // Lives as long as the service, like this object
+        std::thread(&TouchLatencyController::workerLoop, this).detach();
+    }
+}
+
+void TouchLatencyController::setGameMode(bool enabled) {
+    if (!mEnabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mGameMode = enabled;
+    mCond.notify_one();
+}
+
+void TouchLatencyController::updateLowLatencySessionCount(bool active) {
+    if (!mEnabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mLowLatencySessions += active ? 1 : -1;
+    mCond.notify_one();
+}
+
+bool TouchLatencyController::apply(bool enabled) {
+    // The touch HAL may come up after us or restart, look it up every time,
+    // this only runs on transitions
+    ::android::sp<IHighTouchPollingRate> touch = IHighTouchPollingRate::tryGetService();
+    if (touch == nullptr) {
+        LOG(WARNING) << "No touch HAL with auto polling rate support";
+        return false;
+    }
+    auto ret = touch->setAutoEnabled(enabled);
+    if (!ret.isOk() || !bool(ret)) {
+        LOG(ERROR) << "Failed to " << (enabled ? "raise" : "drop") << " touch polling rate";
+        return false;
+    }
+    return true;
+}
+
+void TouchLatencyController::workerLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCond.wait(lock, [this] { return wantedLocked() != mApplied; });
+        bool wanted = wantedLocked();
+        if (!wanted && mCond.wait_for(lock, kReleaseDelay, [this] { return wantedLocked(); })) {
+            continue;
+        }
+
+        // Recorded whether or not the HAL took it, so a missing HAL isn't retried in a loop
+        mApplied = wanted;
+        mTransitions++;
+        lock.unlock();
+        apply(wanted);
+        lock.lock();
+    }
+}
+
+void TouchLatencyController::dumpToFd(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    std::string buf(::android::base::StringPrintf(
+            "Touch auto polling: %s, target <= %" PRId64 " ns, game mode %d, "
+            "low latency sessions %d, high rate %d, %u transitions\n",
+            mEnabled ? "enabled" : "disabled", static_cast<int64_t>(mTargetThreshold.count()),
+            mGameMode, mLowLatencySessions, mApplied, mTransitions));
+    ::android::base::WriteStringToFd(buf, fd);
+}
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
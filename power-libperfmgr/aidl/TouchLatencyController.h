@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace aidl {
+namespace google {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace pixel {
+
+// Asks the touch HAL for its high polling rate while GAME mode is on or an
+// active app session targets at most vendor.powerhal.touch.auto_polling_target_ns,
+// and drops it again shortly after. Off unless vendor.powerhal.touch.auto_polling
+// is set.
+class TouchLatencyController {
+  public:
+    static TouchLatencyController &getInstance();
+
+    bool enabled() const { return mEnabled; }
+    bool isLowLatencyTarget(std::chrono::nanoseconds target) const {
+        return target <= mTargetThreshold;
+    }
+    void setGameMode(bool enabled);
+    void updateLowLatencySessionCount(bool active);
+    void dumpToFd(int fd);
+
+  private:
+    TouchLatencyController();
+    TouchLatencyController(TouchLatencyController const &) = delete;
+    void operator=(TouchLatencyController const &) = delete;
+
+    bool wantedLocked() const { return mGameMode || mLowLatencySessions > 0; }
+    void workerLoop();
+    bool apply(bool enabled);
+
+    const bool mEnabled;
+    const std::chrono::nanoseconds mTargetThreshold;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    bool mGameMode = false;       // protected by mLock
+    int mLowLatencySessions = 0;  // protected by mLock
+    bool mApplied = false;        // protected by mLock
+    uint32_t mTransitions = 0;    // protected by mLock
+};
+
+}  // namespace pixel
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace google
+}  // namespace aidl
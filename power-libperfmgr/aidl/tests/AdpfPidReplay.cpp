@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Replays WorkDuration traces through the ADPF PID controller offline.
+//
+//   adpf_pid_replay [--config=<file>] [--trace=<file>]... [benchmark flags]
+//
+// A config file holds powerhint.json AdpfConfig values as Key=value lines,
+// e.g. PID_Po=2.0; unlisted keys keep the defaults below. A trace file has
+// one report per line, "<target_ns> <actual_ns> [<actual_ns>...]", and '#'
+// starts a comment. Without --trace a few synthetic traces are replayed.
+//
+// The trace is replayed closed loop: each recorded duration is rescaled by
+// the CPU capacity the replayed uclamp.min grants against the one it was
+// recorded with (--recorded-min), so config changes show up in the results.
+// Besides the ns/op of the update path every trace reports:
+//   converge_reports  reports until uclamp.min stays within kSettleBand of
+//                     its final value
+//   overshoot         highest uclamp.min above that final value
+//   over_target_pct   share of replayed frames longer than their target
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../AdpfPid.h"
+
+using ::aidl::google::hardware::power::impl::pixel::AdpfConfigSnapshot;
+using ::aidl::google::hardware::power::impl::pixel::PidOutput;
+using ::aidl::google::hardware::power::impl::pixel::PidState;
+
+namespace {
+
+constexpr int kMaxUclamp = 1024;
+// Capacity a task gets without any uclamp.min, as a fraction of kMaxUclamp.
+constexpr int kIdleCapacity = 256;
+constexpr int kSettleBand = 16;
+
+struct Sample {
+    int64_t durationNanos;
+};
+
+struct Report {
+    int64_t targetNanos;
+    std::vector<Sample> samples;
+};
+
+struct Trace {
+    std::string name;
+    std::vector<Report> reports;
+};
+
+struct ReplayResult {
+    size_t convergeReports = 0;
+    int overshoot = 0;
+    double overTargetPct = 0;
+};
+
+int gRecordedMin = 0;
+
+AdpfConfigSnapshot defaultConfig() {
+    AdpfConfigSnapshot config;
+    config.pidOn = true;
+    config.pidPo = 2.0;
+    config.pidPu = 1.0;
+    config.pidI = 0.001;
+    config.pidDo = 500.0;
+    config.pidDu = 0.0;
+    config.pidIHighDivI = 512 / 0.001;
+    config.pidILowDivI = -30 / 0.001;
+    config.uclampMinHigh = 480;
+    config.uclampMinLow = 2;
+    config.samplingWindowP = 1;
+    config.samplingWindowI = 0;
+    config.samplingWindowD = 1;
+    return config;
+}
+
+bool loadConfig(const char *path, AdpfConfigSnapshot *config) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "cannot open config %s\n", path);
+        return false;
+    }
+    double iHigh = config->pidIHighDivI * config->pidI;
+    double iLow = config->pidILowDivI * config->pidI;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, eq);
+        key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+        double value = std::strtod(line.c_str() + eq + 1, nullptr);
+        if (key == "PID_On") {
+            config->pidOn = value != 0;
+        } else if (key == "PID_Po") {
+            config->pidPo = value;
+        } else if (key == "PID_Pu") {
+            config->pidPu = value;
+        } else if (key == "PID_I") {
+            config->pidI = value;
+        } else if (key == "PID_I_High") {
+            iHigh = value;
+        } else if (key == "PID_I_Low") {
+            iLow = value;
+        } else if (key == "PID_Do") {
+            config->pidDo = value;
+        } else if (key == "PID_Du") {
+            config->pidDu = value;
+        } else if (key == "UclampMin_High") {
+            config->uclampMinHigh = value;
+        } else if (key == "UclampMin_Low") {
+            config->uclampMinLow = value;
+        } else if (key == "SamplingWindow_P") {
+            config->samplingWindowP = value;
+        } else if (key == "SamplingWindow_I") {
+            config->samplingWindowI = value;
+        } else if (key == "SamplingWindow_D") {
+            config->samplingWindowD = value;
+        } else if (key == "Predict_On") {
+            config->predictOn = value != 0;
+        } else {
+            fprintf(stderr, "%s: unknown key %s\n", path, key.c_str());
+            return false;
+        }
+    }
+    // Same as AdpfConfig::getPidIHighDivI() and getPidILowDivI().
+    config->pidIHighDivI = config->pidI == 0 ? 0 : iHigh / config->pidI;
+    config->pidILowDivI = config->pidI == 0 ? 0 : iLow / config->pidI;
+    return true;
+}
+
+bool loadTrace(const char *path, Trace *trace) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "cannot open trace %s\n", path);
+        return false;
+    }
+    trace->name = path;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        Report report;
+        if (!(fields >> report.targetNanos)) {
+            continue;
+        }
+        int64_t duration;
+        while (fields >> duration) {
+            report.samples.push_back({duration});
+        }
+        if (report.samples.empty() || report.targetNanos <= 0) {
+            fprintf(stderr, "%s: malformed report '%s'\n", path, line.c_str());
+            return false;
+        }
+        trace->reports.push_back(std::move(report));
+    }
+    return !trace->reports.empty();
+}
+
+std::vector<Trace> syntheticTraces() {
+    constexpr int64_t kTarget = 16666666;
+    constexpr size_t kReports = 600;
+    std::vector<Trace> traces(4);
+    traces[0].name = "steady";
+    traces[1].name = "step";
+    traces[2].name = "periodic";
+    traces[3].name = "noisy";
+    uint32_t seed = 1;
+    for (size_t i = 0; i < kReports; i++) {
+        traces[0].reports.push_back({kTarget, {{kTarget * 13 / 10}}});
+        traces[1].reports.push_back({kTarget, {{i < kReports / 2 ? kTarget / 2 : kTarget * 3 / 2}}});
+        traces[2].reports.push_back({kTarget, {{i % 4 == 0 ? kTarget * 2 : kTarget * 9 / 10}}});
+        seed = seed * 1103515245 + 12345;
+        int64_t jitter = static_cast<int64_t>((seed >> 16) % 41) - 20;
+        traces[3].reports.push_back({kTarget, {{kTarget * (120 + jitter) / 100}}});
+    }
+    return traces;
+}
+
+int capacity(int uclampMin) {
+    return std::max(uclampMin, kIdleCapacity);
+}
+
+// Mirrors the reporting path of PowerHintSession::reportActualWorkDuration.
+class Replayer {
+  public:
+    explicit Replayer(const AdpfConfigSnapshot &config) : mConfig(config) {
+        mPid.window.reset(config.samplingWindowP, config.samplingWindowD, 0);
+    }
+
+    int report(const Report &recorded, std::vector<Sample> *replayed) {
+        replayed->clear();
+        for (const Sample &s : recorded.samples) {
+            replayed->push_back({s.durationNanos * capacity(gRecordedMin) / capacity(mCurrentMin)});
+        }
+        PidOutput out = mPid.update(mConfig, recorded.targetNanos, *replayed);
+        int nextMin = std::min(static_cast<int>(mConfig.uclampMinHigh),
+                               mCurrentMin + static_cast<int>(out.total()));
+        mCurrentMin = std::max(static_cast<int>(mConfig.uclampMinLow), nextMin);
+        return mCurrentMin;
+    }
+
+  private:
+    const AdpfConfigSnapshot &mConfig;
+    PidState mPid;
+    int mCurrentMin = 0;
+};
+
+ReplayResult replay(const AdpfConfigSnapshot &config, const Trace &trace) {
+    Replayer replayer(config);
+    std::vector<int> mins;
+    std::vector<Sample> replayed;
+    size_t frames = 0;
+    size_t overTarget = 0;
+    for (const Report &report : trace.reports) {
+        mins.push_back(replayer.report(report, &replayed));
+        for (const Sample &s : replayed) {
+            frames++;
+            overTarget += s.durationNanos > report.targetNanos;
+        }
+    }
+
+    ReplayResult result;
+    int settled = mins.back();
+    size_t i = mins.size();
+    while (i > 0 && std::abs(mins[i - 1] - settled) <= kSettleBand) {
+        i--;
+    }
+    result.convergeReports = i;
+    for (int min : mins) {
+        result.overshoot = std::max(result.overshoot, min - settled);
+    }
+    result.overTargetPct = 100.0 * overTarget / frames;
+    return result;
+}
+
+void BM_Replay(benchmark::State &state, const AdpfConfigSnapshot *config, const Trace *trace) {
+    ReplayResult result = replay(*config, *trace);
+    std::vector<Sample> replayed;
+    size_t reports = 0;
+    for (auto _ : state) {
+        Replayer replayer(*config);
+        for (const Report &report : trace->reports) {
+            benchmark::DoNotOptimize(replayer.report(report, &replayed));
+        }
+        reports += trace->reports.size();
+    }
+    // Time per iteration covers a whole trace, report it per update too.
+    state.counters["ns_per_update"] = benchmark::Counter(
+            reports, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["converge_reports"] = result.convergeReports;
+    state.counters["overshoot"] = result.overshoot;
+    state.counters["over_target_pct"] = result.overTargetPct;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    static AdpfConfigSnapshot config = defaultConfig();
+    static std::vector<Trace> traces;
+    std::vector<char *> benchmarkArgs;
+    for (int i = 0; i < argc; i++) {
+        if (!strncmp(argv[i], "--config=", 9)) {
+            if (!loadConfig(argv[i] + 9, &config)) {
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--trace=", 8)) {
+            traces.emplace_back();
+            if (!loadTrace(argv[i] + 8, &traces.back())) {
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--recorded-min=", 15)) {
+            gRecordedMin = std::clamp(atoi(argv[i] + 15), 0, kMaxUclamp);
+        } else {
+            benchmarkArgs.push_back(argv[i]);
+        }
+    }
+    if (traces.empty()) {
+        traces = syntheticTraces();
+    }
+    for (const Trace &trace : traces) {
+        benchmark::RegisterBenchmark(("BM_Replay/" + trace.name).c_str(), BM_Replay, &config,
+                                     &trace);
+    }
+
+    int benchmarkArgc = benchmarkArgs.size();
+    benchmark::Initialize(&benchmarkArgc, benchmarkArgs.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmarkArgc, benchmarkArgs.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
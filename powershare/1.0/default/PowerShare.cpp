@@ -6,11 +6,10 @@
 
 #include "PowerShare.h"
 
-#include <android-base/file.h>
 #include <android-base/strings.h>
 
-using ::android::base::ReadFileToString;
-using ::android::base::WriteStringToFile;
+#include <algorithm>
+#include <thread>
 
 namespace vendor {
 namespace lineage {
@@ -18,30 +17,128 @@ namespace powershare {
 namespace V1_0 {
 namespace implementation {
 
-Return<bool> PowerShare::isEnabled() {
+static const std::string kBatteryCapacityNode = "/sys/class/power_supply/battery/capacity";
+
+PowerShare::PowerShare()
+    : mPowerShareAttr(POWERSHARE_PATH, SysfsNode::kReadable | SysfsNode::kWritable),
+      mEnabled(-1),
+      mMinBattery(0),
+      mBatteryCapacityAttr(kBatteryCapacityNode, SysfsNode::kReadable) {
+    refreshEnabled();
+
+    if (mUevents.ok()) {
+        // Lives as long as the service, like this object
+        std::thread(&PowerShare::ueventLoop, this).detach();
+    }
+}
+
+bool PowerShare::refreshEnabled() {
+    std::lock_guard<std::mutex> lock(mRefreshLock);
     std::string value;
 
-    if (!ReadFileToString(POWERSHARE_PATH, &value)) {
+    if (!mPowerShareAttr.read(&value)) {
         LOG(ERROR) << "Failed to read current powershare value";
+        mEnabled = -1;
         return false;
     }
 
     value = android::base::Trim(value);
 
-    return value == POWERSHARE_ENABLED;
+    mEnabled = value == POWERSHARE_ENABLED;
+
+    return true;
 }
 
-Return<bool> PowerShare::setEnabled(bool enable) {
+bool PowerShare::writeEnabled(bool enable) {
     const auto& value = enable ? POWERSHARE_ENABLED : POWERSHARE_DISABLED;
-    return WriteStringToFile(value, POWERSHARE_PATH, true);
+    bool ret;
+    {
+        std::lock_guard<std::mutex> lock(mRefreshLock);
+        ret = mPowerShareAttr.write(value);
+    }
+    if (!ret) {
+        LOG(ERROR) << "Failed to write powershare value";
+    }
+
+    // The driver may refuse, e.g. without a receiver, cache what it reports
+    if (!refreshEnabled() && ret) {
+        mEnabled = enable;
+    }
+
+    return ret;
+}
+
+bool PowerShare::belowMinBatteryLocked() {
+    if (mMinBattery == 0) {
+        return false;
+    }
+
+    uint32_t capacity;
+    if (!mBatteryCapacityAttr.read(&capacity)) {
+        LOG(ERROR) << "Failed to read battery capacity";
+        return false;
+    }
+
+    if (capacity < mMinBattery) {
+        LOG(INFO) << "Battery at " << capacity << "%, below " << mMinBattery << "%";
+        return true;
+    }
+
+    return false;
+}
+
+void PowerShare::applyMinBatteryLocked() {
+    if (mEnabled == 1 && belowMinBatteryLocked()) {
+        LOG(INFO) << "Disabling powershare";
+        writeEnabled(false);
+    }
+}
+
+void PowerShare::ueventLoop() {
+    while (true) {
+        if (!mUevents.waitForPowerSupplyEvent(-1)) {
+            continue;
+        }
+
+        refreshEnabled();
+
+        std::lock_guard<std::mutex> lock(mMinBatteryLock);
+        applyMinBatteryLocked();
+    }
+}
+
+Return<bool> PowerShare::isEnabled() {
+    int enabled = mEnabled;
+    if (enabled < 0 || !mUevents.ok()) {
+        // Nothing keeps the cache fresh without uevents
+        refreshEnabled();
+        enabled = mEnabled;
+    }
+
+    return enabled > 0;
+}
+
+Return<bool> PowerShare::setEnabled(bool enable) {
+    std::lock_guard<std::mutex> lock(mMinBatteryLock);
+    if (enable && belowMinBatteryLocked()) {
+        // Don't let the node flip on just to be turned back off
+        return false;
+    }
+
+    return writeEnabled(enable) && mEnabled == enable;
 }
 
 Return<uint32_t> PowerShare::getMinBattery() {
-    return 0;
+    std::lock_guard<std::mutex> lock(mMinBatteryLock);
+    return mMinBattery;
 }
 
-Return<uint32_t> PowerShare::setMinBattery(uint32_t /*minBattery*/) {
-    return getMinBattery();
+Return<uint32_t> PowerShare::setMinBattery(uint32_t minBattery) {
+    std::lock_guard<std::mutex> lock(mMinBatteryLock);
+    mMinBattery = std::min<uint32_t>(minBattery, 100);
+    applyMinBatteryLocked();
+
+    return mMinBattery;
 }
 
 }  // namespace implementation
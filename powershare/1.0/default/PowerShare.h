@@ -13,6 +13,12 @@
 
 #include <vendor/lineage/powershare/1.0/IPowerShare.h>
 
+#include <atomic>
+#include <mutex>
+
+#include <sysfsnode/SysfsNode.h>
+#include <sysfsnode/UeventListener.h>
+
 namespace vendor {
 namespace lineage {
 namespace powershare {
@@ -22,13 +28,35 @@ namespace implementation {
 using ::android::sp;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
+using ::vendor::lineage::sysfs::SysfsNode;
+using ::vendor::lineage::sysfs::UeventListener;
 
 class PowerShare : public IPowerShare {
   public:
+    PowerShare();
+
     Return<bool> isEnabled() override;
     Return<bool> setEnabled(bool enable) override;
     Return<uint32_t> getMinBattery() override;
     Return<uint32_t> setMinBattery(uint32_t minBattery) override;
+
+  private:
+    bool refreshEnabled();
+    bool writeEnabled(bool enable);
+    bool belowMinBatteryLocked();
+    // Turns powershare off once the battery drops below mMinBattery
+    void applyMinBatteryLocked();
+    void ueventLoop();
+
+    UeventListener mUevents;
+    std::mutex mRefreshLock;
+    SysfsNode mPowerShareAttr;  // protected by mRefreshLock
+    // -1 until the node was read successfully
+    std::atomic<int> mEnabled;
+
+    std::mutex mMinBatteryLock;
+    uint32_t mMinBattery;
+    SysfsNode mBatteryCapacityAttr;  // protected by mMinBatteryLock
 };
 
 }  // namespace implementation
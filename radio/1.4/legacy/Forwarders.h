@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+// Callbacks which reach the framework's V1_4 interface with their arguments
+// unchanged, as X(method, (parameters), (arguments)). The ones which need a
+// conversion are written out in RadioResponse.cpp and RadioIndication.cpp.
+
+#define RADIO_RESPONSE_FORWARDERS(X)                                                               \
+    /* V1_0::IRadioResponse */                                                                     \
+    X(supplyIccPinForAppResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(supplyIccPukForAppResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(supplyIccPin2ForAppResponse,                                                                 \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(supplyIccPuk2ForAppResponse,                                                                 \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(changeIccPinForAppResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(changeIccPin2ForAppResponse,                                                                 \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(supplyNetworkDepersonalizationResponse,                                                      \
+      (const V1_0::RadioResponseInfo& info, int32_t remainingRetries),                             \
+      (info, remainingRetries))                                                                    \
+    X(dialResponse, (const V1_0::RadioResponseInfo& info), (info))                                 \
+    X(getIMSIForAppResponse,                                                                       \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& imsi),                              \
+      (info, imsi))                                                                                \
+    X(hangupConnectionResponse, (const V1_0::RadioResponseInfo& info), (info))                     \
+    X(hangupWaitingOrBackgroundResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(hangupForegroundResumeBackgroundResponse, (const V1_0::RadioResponseInfo& info), (info))     \
+    X(switchWaitingOrHoldingAndActiveResponse, (const V1_0::RadioResponseInfo& info), (info))      \
+    X(conferenceResponse, (const V1_0::RadioResponseInfo& info), (info))                           \
+    X(rejectCallResponse, (const V1_0::RadioResponseInfo& info), (info))                           \
+    X(getLastCallFailCauseResponse,                                                                \
+      (const V1_0::RadioResponseInfo& info, const V1_0::LastCallFailCauseInfo& failCauseinfo),     \
+      (info, failCauseinfo))                                                                       \
+    X(getOperatorResponse,                                                                         \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_string& longName,                                                                \
+       const hidl_string& shortName,                                                               \
+       const hidl_string& numeric),                                                                \
+      (info, longName, shortName, numeric))                                                        \
+    X(setRadioPowerResponse, (const V1_0::RadioResponseInfo& info), (info))                        \
+    X(sendDtmfResponse, (const V1_0::RadioResponseInfo& info), (info))                             \
+    X(sendSmsResponse,                                                                             \
+      (const V1_0::RadioResponseInfo& info, const V1_0::SendSmsResult& sms),                       \
+      (info, sms))                                                                                 \
+    X(sendSMSExpectMoreResponse,                                                                   \
+      (const V1_0::RadioResponseInfo& info, const V1_0::SendSmsResult& sms),                       \
+      (info, sms))                                                                                 \
+    X(iccIOForAppResponse,                                                                         \
+      (const V1_0::RadioResponseInfo& info, const V1_0::IccIoResult& iccIo),                       \
+      (info, iccIo))                                                                               \
+    X(sendUssdResponse, (const V1_0::RadioResponseInfo& info), (info))                             \
+    X(cancelPendingUssdResponse, (const V1_0::RadioResponseInfo& info), (info))                    \
+    X(getClirResponse, (const V1_0::RadioResponseInfo& info, int32_t n, int32_t m), (info, n, m))  \
+    X(setClirResponse, (const V1_0::RadioResponseInfo& info), (info))                              \
+    X(getCallForwardStatusResponse,                                                                \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_vec<V1_0::CallForwardInfo>& callForwardInfos),                                   \
+      (info, callForwardInfos))                                                                    \
+    X(setCallForwardResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(getCallWaitingResponse,                                                                      \
+      (const V1_0::RadioResponseInfo& info, bool enable, int32_t serviceClass),                    \
+      (info, enable, serviceClass))                                                                \
+    X(setCallWaitingResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(acknowledgeLastIncomingGsmSmsResponse, (const V1_0::RadioResponseInfo& info), (info))        \
+    X(acceptCallResponse, (const V1_0::RadioResponseInfo& info), (info))                           \
+    X(deactivateDataCallResponse, (const V1_0::RadioResponseInfo& info), (info))                   \
+    X(getFacilityLockForAppResponse,                                                               \
+      (const V1_0::RadioResponseInfo& info, int32_t response),                                     \
+      (info, response))                                                                            \
+    X(setFacilityLockForAppResponse,                                                               \
+      (const V1_0::RadioResponseInfo& info, int32_t retry),                                        \
+      (info, retry))                                                                               \
+    X(setBarringPasswordResponse, (const V1_0::RadioResponseInfo& info), (info))                   \
+    X(getNetworkSelectionModeResponse,                                                             \
+      (const V1_0::RadioResponseInfo& info, bool manual),                                          \
+      (info, manual))                                                                              \
+    X(setNetworkSelectionModeAutomaticResponse, (const V1_0::RadioResponseInfo& info), (info))     \
+    X(setNetworkSelectionModeManualResponse, (const V1_0::RadioResponseInfo& info), (info))        \
+    X(getAvailableNetworksResponse,                                                                \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_0::OperatorInfo>& networkInfos),     \
+      (info, networkInfos))                                                                        \
+    X(startDtmfResponse, (const V1_0::RadioResponseInfo& info), (info))                            \
+    X(stopDtmfResponse, (const V1_0::RadioResponseInfo& info), (info))                             \
+    X(getBasebandVersionResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& version),                           \
+      (info, version))                                                                             \
+    X(separateConnectionResponse, (const V1_0::RadioResponseInfo& info), (info))                   \
+    X(setMuteResponse, (const V1_0::RadioResponseInfo& info), (info))                              \
+    X(getMuteResponse, (const V1_0::RadioResponseInfo& info, bool enable), (info, enable))         \
+    X(getClipResponse,                                                                             \
+      (const V1_0::RadioResponseInfo& info, V1_0::ClipStatus status),                              \
+      (info, status))                                                                              \
+    X(setSuppServiceNotificationsResponse, (const V1_0::RadioResponseInfo& info), (info))          \
+    X(writeSmsToSimResponse, (const V1_0::RadioResponseInfo& info, int32_t index), (info, index))  \
+    X(deleteSmsOnSimResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(setBandModeResponse, (const V1_0::RadioResponseInfo& info), (info))                          \
+    X(getAvailableBandModesResponse,                                                               \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_0::RadioBandMode>& bandModes),       \
+      (info, bandModes))                                                                           \
+    X(sendEnvelopeResponse,                                                                        \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& commandResponse),                   \
+      (info, commandResponse))                                                                     \
+    X(sendTerminalResponseToSimResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(handleStkCallSetupRequestFromSimResponse, (const V1_0::RadioResponseInfo& info), (info))     \
+    X(explicitCallTransferResponse, (const V1_0::RadioResponseInfo& info), (info))                 \
+    X(getNeighboringCidsResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_0::NeighboringCell>& cells),         \
+      (info, cells))                                                                               \
+    X(setLocationUpdatesResponse, (const V1_0::RadioResponseInfo& info), (info))                   \
+    X(setCdmaSubscriptionSourceResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(setCdmaRoamingPreferenceResponse, (const V1_0::RadioResponseInfo& info), (info))             \
+    X(getCdmaRoamingPreferenceResponse,                                                            \
+      (const V1_0::RadioResponseInfo& info, V1_0::CdmaRoamingType type),                           \
+      (info, type))                                                                                \
+    X(setTTYModeResponse, (const V1_0::RadioResponseInfo& info), (info))                           \
+    X(getTTYModeResponse,                                                                          \
+      (const V1_0::RadioResponseInfo& info, V1_0::TtyMode mode),                                   \
+      (info, mode))                                                                                \
+    X(setPreferredVoicePrivacyResponse, (const V1_0::RadioResponseInfo& info), (info))             \
+    X(getPreferredVoicePrivacyResponse,                                                            \
+      (const V1_0::RadioResponseInfo& info, bool enable),                                          \
+      (info, enable))                                                                              \
+    X(sendCDMAFeatureCodeResponse, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(sendBurstDtmfResponse, (const V1_0::RadioResponseInfo& info), (info))                        \
+    X(sendCdmaSmsResponse,                                                                         \
+      (const V1_0::RadioResponseInfo& info, const V1_0::SendSmsResult& sms),                       \
+      (info, sms))                                                                                 \
+    X(acknowledgeLastIncomingCdmaSmsResponse, (const V1_0::RadioResponseInfo& info), (info))       \
+    X(getGsmBroadcastConfigResponse,                                                               \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_vec<V1_0::GsmBroadcastSmsConfigInfo>& configs),                                  \
+      (info, configs))                                                                             \
+    X(setGsmBroadcastConfigResponse, (const V1_0::RadioResponseInfo& info), (info))                \
+    X(setGsmBroadcastActivationResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(getCdmaBroadcastConfigResponse,                                                              \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_vec<V1_0::CdmaBroadcastSmsConfigInfo>& configs),                                 \
+      (info, configs))                                                                             \
+    X(setCdmaBroadcastConfigResponse, (const V1_0::RadioResponseInfo& info), (info))               \
+    X(setCdmaBroadcastActivationResponse, (const V1_0::RadioResponseInfo& info), (info))           \
+    X(getCDMASubscriptionResponse,                                                                 \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_string& mdn,                                                                     \
+       const hidl_string& hSid,                                                                    \
+       const hidl_string& hNid,                                                                    \
+       const hidl_string& min,                                                                     \
+       const hidl_string& prl),                                                                    \
+      (info, mdn, hSid, hNid, min, prl))                                                           \
+    X(writeSmsToRuimResponse,                                                                      \
+      (const V1_0::RadioResponseInfo& info, uint32_t index),                                       \
+      (info, index))                                                                               \
+    X(deleteSmsOnRuimResponse, (const V1_0::RadioResponseInfo& info), (info))                      \
+    X(getDeviceIdentityResponse,                                                                   \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_string& imei,                                                                    \
+       const hidl_string& imeisv,                                                                  \
+       const hidl_string& esn,                                                                     \
+       const hidl_string& meid),                                                                   \
+      (info, imei, imeisv, esn, meid))                                                             \
+    X(exitEmergencyCallbackModeResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(getSmscAddressResponse,                                                                      \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& smsc),                              \
+      (info, smsc))                                                                                \
+    X(setSmscAddressResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(reportSmsMemoryStatusResponse, (const V1_0::RadioResponseInfo& info), (info))                \
+    X(reportStkServiceIsRunningResponse, (const V1_0::RadioResponseInfo& info), (info))            \
+    X(getCdmaSubscriptionSourceResponse,                                                           \
+      (const V1_0::RadioResponseInfo& info, V1_0::CdmaSubscriptionSource source),                  \
+      (info, source))                                                                              \
+    X(requestIsimAuthenticationResponse,                                                           \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& response),                          \
+      (info, response))                                                                            \
+    X(acknowledgeIncomingGsmSmsWithPduResponse, (const V1_0::RadioResponseInfo& info), (info))     \
+    X(sendEnvelopeWithStatusResponse,                                                              \
+      (const V1_0::RadioResponseInfo& info, const V1_0::IccIoResult& iccIo),                       \
+      (info, iccIo))                                                                               \
+    X(getVoiceRadioTechnologyResponse,                                                             \
+      (const V1_0::RadioResponseInfo& info, V1_0::RadioTechnology rat),                            \
+      (info, rat))                                                                                 \
+    X(setCellInfoListRateResponse, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(setInitialAttachApnResponse, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(getImsRegistrationStateResponse,                                                             \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       bool isRegistered,                                                                          \
+       V1_0::RadioTechnologyFamily ratFamily),                                                     \
+      (info, isRegistered, ratFamily))                                                             \
+    X(sendImsSmsResponse,                                                                          \
+      (const V1_0::RadioResponseInfo& info, const V1_0::SendSmsResult& sms),                       \
+      (info, sms))                                                                                 \
+    X(iccTransmitApduBasicChannelResponse,                                                         \
+      (const V1_0::RadioResponseInfo& info, const V1_0::IccIoResult& result),                      \
+      (info, result))                                                                              \
+    X(iccOpenLogicalChannelResponse,                                                               \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       int32_t channelId,                                                                          \
+       const hidl_vec<int8_t>& selectResponse),                                                    \
+      (info, channelId, selectResponse))                                                           \
+    X(iccCloseLogicalChannelResponse, (const V1_0::RadioResponseInfo& info), (info))               \
+    X(iccTransmitApduLogicalChannelResponse,                                                       \
+      (const V1_0::RadioResponseInfo& info, const V1_0::IccIoResult& result),                      \
+      (info, result))                                                                              \
+    X(nvReadItemResponse,                                                                          \
+      (const V1_0::RadioResponseInfo& info, const hidl_string& result),                            \
+      (info, result))                                                                              \
+    X(nvWriteItemResponse, (const V1_0::RadioResponseInfo& info), (info))                          \
+    X(nvWriteCdmaPrlResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(nvResetConfigResponse, (const V1_0::RadioResponseInfo& info), (info))                        \
+    X(setUiccSubscriptionResponse, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(setDataAllowedResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(getHardwareConfigResponse,                                                                   \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_0::HardwareConfig>& config),         \
+      (info, config))                                                                              \
+    X(requestIccSimAuthenticationResponse,                                                         \
+      (const V1_0::RadioResponseInfo& info, const V1_0::IccIoResult& result),                      \
+      (info, result))                                                                              \
+    X(setDataProfileResponse, (const V1_0::RadioResponseInfo& info), (info))                       \
+    X(requestShutdownResponse, (const V1_0::RadioResponseInfo& info), (info))                      \
+    X(getRadioCapabilityResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, const V1_0::RadioCapability& rc),                      \
+      (info, rc))                                                                                  \
+    X(setRadioCapabilityResponse,                                                                  \
+      (const V1_0::RadioResponseInfo& info, const V1_0::RadioCapability& rc),                      \
+      (info, rc))                                                                                  \
+    X(startLceServiceResponse,                                                                     \
+      (const V1_0::RadioResponseInfo& info, const V1_0::LceStatusInfo& statusInfo),                \
+      (info, statusInfo))                                                                          \
+    X(stopLceServiceResponse,                                                                      \
+      (const V1_0::RadioResponseInfo& info, const V1_0::LceStatusInfo& statusInfo),                \
+      (info, statusInfo))                                                                          \
+    X(pullLceDataResponse,                                                                         \
+      (const V1_0::RadioResponseInfo& info, const V1_0::LceDataInfo& lceInfo),                     \
+      (info, lceInfo))                                                                             \
+    X(getModemActivityInfoResponse,                                                                \
+      (const V1_0::RadioResponseInfo& info, const V1_0::ActivityStatsInfo& activityInfo),          \
+      (info, activityInfo))                                                                        \
+    X(sendDeviceStateResponse, (const V1_0::RadioResponseInfo& info), (info))                      \
+    X(setIndicationFilterResponse, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(acknowledgeRequest, (int32_t serial), (serial))                                              \
+                                                                                                   \
+    /* V1_1::IRadioResponse */                                                                     \
+    X(setCarrierInfoForImsiEncryptionResponse, (const V1_0::RadioResponseInfo& info), (info))      \
+    X(setSimCardPowerResponse_1_1, (const V1_0::RadioResponseInfo& info), (info))                  \
+    X(stopNetworkScanResponse, (const V1_0::RadioResponseInfo& info), (info))                      \
+    X(startKeepaliveResponse,                                                                      \
+      (const V1_0::RadioResponseInfo& info, const V1_1::KeepaliveStatus& status),                  \
+      (info, status))                                                                              \
+    X(stopKeepaliveResponse, (const V1_0::RadioResponseInfo& info), (info))                        \
+                                                                                                   \
+    /* V1_2::IRadioResponse */                                                                     \
+    X(setSignalStrengthReportingCriteriaResponse, (const V1_0::RadioResponseInfo& info), (info))   \
+    X(setLinkCapacityReportingCriteriaResponse, (const V1_0::RadioResponseInfo& info), (info))     \
+    X(getCurrentCallsResponse_1_2,                                                                 \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_2::Call>& calls),                    \
+      (info, calls))                                                                               \
+    X(getVoiceRegistrationStateResponse_1_2,                                                       \
+      (const V1_0::RadioResponseInfo& info, const V1_2::VoiceRegStateResult& voiceRegResponse),    \
+      (info, voiceRegResponse))                                                                    \
+                                                                                                   \
+    /* V1_3::IRadioResponse */                                                                     \
+    X(setSystemSelectionChannelsResponse, (const V1_0::RadioResponseInfo& info), (info))           \
+    X(enableModemResponse, (const V1_0::RadioResponseInfo& info), (info))                          \
+    X(getModemStackStatusResponse,                                                                 \
+      (const V1_0::RadioResponseInfo& info, bool isEnabled),                                       \
+      (info, isEnabled))                                                                           \
+                                                                                                   \
+    /* V1_4::IRadioResponse */                                                                     \
+    X(emergencyDialResponse, (const V1_0::RadioResponseInfo& info), (info))                        \
+    X(startNetworkScanResponse_1_4, (const V1_0::RadioResponseInfo& info), (info))                 \
+    X(getCellInfoListResponse_1_4,                                                                 \
+      (const V1_0::RadioResponseInfo& info, const hidl_vec<V1_4::CellInfo>& cellInfo),             \
+      (info, cellInfo))                                                                            \
+    X(getDataRegistrationStateResponse_1_4,                                                        \
+      (const V1_0::RadioResponseInfo& info, const V1_4::DataRegStateResult& dataRegResponse),      \
+      (info, dataRegResponse))                                                                     \
+    X(getIccCardStatusResponse_1_4,                                                                \
+      (const V1_0::RadioResponseInfo& info, const V1_4::CardStatus& cardStatus),                   \
+      (info, cardStatus))                                                                          \
+    X(getPreferredNetworkTypeBitmapResponse,                                                       \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       hidl_bitfield<V1_4::RadioAccessFamily> networkTypeBitmap),                                  \
+      (info, networkTypeBitmap))                                                                   \
+    X(setPreferredNetworkTypeBitmapResponse, (const V1_0::RadioResponseInfo& info), (info))        \
+    X(getDataCallListResponse_1_4,                                                                 \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const hidl_vec<V1_4::SetupDataCallResult>& dcResponse),                                     \
+      (info, dcResponse))                                                                          \
+    X(setupDataCallResponse_1_4,                                                                   \
+      (const V1_0::RadioResponseInfo& info, const V1_4::SetupDataCallResult& dcResponse),          \
+      (info, dcResponse))                                                                          \
+    X(setAllowedCarriersResponse_1_4, (const V1_0::RadioResponseInfo& info), (info))               \
+    X(getAllowedCarriersResponse_1_4,                                                              \
+      (const V1_0::RadioResponseInfo& info,                                                        \
+       const V1_4::CarrierRestrictionsWithPriority& carriers,                                      \
+       V1_4::SimLockMultiSimPolicy multiSimPolicy),                                                \
+      (info, carriers, multiSimPolicy))                                                            \
+    X(getSignalStrengthResponse_1_4,                                                               \
+      (const V1_0::RadioResponseInfo& info, const V1_4::SignalStrength& signalStrength),           \
+      (info, signalStrength))
+
+#define RADIO_INDICATION_FORWARDERS(X)                                                             \
+    /* V1_0::IRadioIndication */                                                                   \
+    X(radioStateChanged,                                                                           \
+      (V1_0::RadioIndicationType type, V1_0::RadioState radioState),                               \
+      (type, radioState))                                                                          \
+    X(callStateChanged, (V1_0::RadioIndicationType type), (type))                                  \
+    X(networkStateChanged, (V1_0::RadioIndicationType type), (type))                               \
+    X(newSms, (V1_0::RadioIndicationType type, const hidl_vec<uint8_t>& pdu), (type, pdu))         \
+    X(newSmsStatusReport,                                                                          \
+      (V1_0::RadioIndicationType type, const hidl_vec<uint8_t>& pdu),                              \
+      (type, pdu))                                                                                 \
+    X(newSmsOnSim, (V1_0::RadioIndicationType type, int32_t recordNumber), (type, recordNumber))   \
+    X(onUssd,                                                                                      \
+      (V1_0::RadioIndicationType type, V1_0::UssdModeType modeType, const hidl_string& msg),       \
+      (type, modeType, msg))                                                                       \
+    X(nitzTimeReceived,                                                                            \
+      (V1_0::RadioIndicationType type, const hidl_string& nitzTime, uint64_t receivedTime),        \
+      (type, nitzTime, receivedTime))                                                              \
+    X(suppSvcNotify,                                                                               \
+      (V1_0::RadioIndicationType type, const V1_0::SuppSvcNotification& suppSvc),                  \
+      (type, suppSvc))                                                                             \
+    X(stkSessionEnd, (V1_0::RadioIndicationType type), (type))                                     \
+    X(stkProactiveCommand, (V1_0::RadioIndicationType type, const hidl_string& cmd), (type, cmd))  \
+    X(stkEventNotify, (V1_0::RadioIndicationType type, const hidl_string& cmd), (type, cmd))       \
+    X(stkCallSetup, (V1_0::RadioIndicationType type, int64_t timeout), (type, timeout))            \
+    X(simSmsStorageFull, (V1_0::RadioIndicationType type), (type))                                 \
+    X(simRefresh,                                                                                  \
+      (V1_0::RadioIndicationType type, const V1_0::SimRefreshResult& refreshResult),               \
+      (type, refreshResult))                                                                       \
+    X(callRing,                                                                                    \
+      (V1_0::RadioIndicationType type, bool isGsm, const V1_0::CdmaSignalInfoRecord& record),      \
+      (type, isGsm, record))                                                                       \
+    X(simStatusChanged, (V1_0::RadioIndicationType type), (type))                                  \
+    X(cdmaNewSms, (V1_0::RadioIndicationType type, const V1_0::CdmaSmsMessage& msg), (type, msg))  \
+    X(newBroadcastSms,                                                                             \
+      (V1_0::RadioIndicationType type, const hidl_vec<uint8_t>& data),                             \
+      (type, data))                                                                                \
+    X(cdmaRuimSmsStorageFull, (V1_0::RadioIndicationType type), (type))                            \
+    X(restrictedStateChanged,                                                                      \
+      (V1_0::RadioIndicationType type, V1_0::PhoneRestrictedState state),                          \
+      (type, state))                                                                               \
+    X(enterEmergencyCallbackMode, (V1_0::RadioIndicationType type), (type))                        \
+    X(cdmaCallWaiting,                                                                             \
+      (V1_0::RadioIndicationType type, const V1_0::CdmaCallWaiting& callWaitingRecord),            \
+      (type, callWaitingRecord))                                                                   \
+    X(cdmaOtaProvisionStatus,                                                                      \
+      (V1_0::RadioIndicationType type, V1_0::CdmaOtaProvisionStatus status),                       \
+      (type, status))                                                                              \
+    X(cdmaInfoRec,                                                                                 \
+      (V1_0::RadioIndicationType type, const V1_0::CdmaInformationRecords& records),               \
+      (type, records))                                                                             \
+    X(indicateRingbackTone, (V1_0::RadioIndicationType type, bool start), (type, start))           \
+    X(resendIncallMute, (V1_0::RadioIndicationType type), (type))                                  \
+    X(cdmaSubscriptionSourceChanged,                                                               \
+      (V1_0::RadioIndicationType type, V1_0::CdmaSubscriptionSource cdmaSource),                   \
+      (type, cdmaSource))                                                                          \
+    X(cdmaPrlChanged, (V1_0::RadioIndicationType type, int32_t version), (type, version))          \
+    X(exitEmergencyCallbackMode, (V1_0::RadioIndicationType type), (type))                         \
+    X(rilConnected, (V1_0::RadioIndicationType type), (type))                                      \
+    X(voiceRadioTechChanged,                                                                       \
+      (V1_0::RadioIndicationType type, V1_0::RadioTechnology rat),                                 \
+      (type, rat))                                                                                 \
+    X(imsNetworkStateChanged, (V1_0::RadioIndicationType type), (type))                            \
+    X(subscriptionStatusChanged,                                                                   \
+      (V1_0::RadioIndicationType type, bool activate),                                             \
+      (type, activate))                                                                            \
+    X(srvccStateNotify, (V1_0::RadioIndicationType type, V1_0::SrvccState state), (type, state))   \
+    X(hardwareConfigChanged,                                                                       \
+      (V1_0::RadioIndicationType type, const hidl_vec<V1_0::HardwareConfig>& configs),             \
+      (type, configs))                                                                             \
+    X(radioCapabilityIndication,                                                                   \
+      (V1_0::RadioIndicationType type, const V1_0::RadioCapability& rc),                           \
+      (type, rc))                                                                                  \
+    X(onSupplementaryServiceIndication,                                                            \
+      (V1_0::RadioIndicationType type, const V1_0::StkCcUnsolSsResult& ss),                        \
+      (type, ss))                                                                                  \
+    X(stkCallControlAlphaNotify,                                                                   \
+      (V1_0::RadioIndicationType type, const hidl_string& alpha),                                  \
+      (type, alpha))                                                                               \
+    X(lceData, (V1_0::RadioIndicationType type, const V1_0::LceDataInfo& lce), (type, lce))        \
+    X(pcoData, (V1_0::RadioIndicationType type, const V1_0::PcoDataInfo& pco), (type, pco))        \
+    X(modemReset, (V1_0::RadioIndicationType type, const hidl_string& reason), (type, reason))     \
+                                                                                                   \
+    /* V1_1::IRadioIndication */                                                                   \
+    X(carrierInfoForImsiEncryption, (V1_0::RadioIndicationType info), (info))                      \
+    X(keepaliveStatus,                                                                             \
+      (V1_0::RadioIndicationType type, const V1_1::KeepaliveStatus& status),                       \
+      (type, status))                                                                              \
+                                                                                                   \
+    /* V1_2::IRadioIndication */                                                                   \
+    X(currentLinkCapacityEstimate,                                                                 \
+      (V1_0::RadioIndicationType type, const V1_2::LinkCapacityEstimate& lce),                     \
+      (type, lce))                                                                                 \
+                                                                                                   \
+    /* V1_4::IRadioIndication */                                                                   \
+    X(currentEmergencyNumberList,                                                                  \
+      (V1_0::RadioIndicationType type,                                                             \
+       const hidl_vec<V1_4::EmergencyNumber>& emergencyNumberList),                                \
+      (type, emergencyNumberList))                                                                 \
+    X(cellInfoList_1_4,                                                                            \
+      (V1_0::RadioIndicationType type, const hidl_vec<V1_4::CellInfo>& records),                   \
+      (type, records))                                                                             \
+    X(networkScanResult_1_4,                                                                       \
+      (V1_0::RadioIndicationType type, const V1_4::NetworkScanResult& result),                     \
+      (type, result))                                                                              \
+    X(currentPhysicalChannelConfigs_1_4,                                                           \
+      (V1_0::RadioIndicationType type, const hidl_vec<V1_4::PhysicalChannelConfig>& configs),      \
+      (type, configs))                                                                             \
+    X(dataCallListChanged_1_4,                                                                     \
+      (V1_0::RadioIndicationType type, const hidl_vec<V1_4::SetupDataCallResult>& dcList),         \
+      (type, dcList))
+
+#define DECLARE_FORWARDER(method, params, args) Return<void> method params override;
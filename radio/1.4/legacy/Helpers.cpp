@@ -5,8 +5,7 @@
  */
 
 #include "Helpers.h"
-#include <regex>
-#include <vector>
+#include <string_view>
 using namespace android::hardware::radio;
 
 V1_4::SignalStrength Create1_4SignalStrength(const V1_0::SignalStrength& sigStrength){
@@ -61,51 +60,83 @@ V1_4::SignalStrength Create1_4SignalStrength(const V1_2::SignalStrength& sigStre
     return newSigStrength;
 }
 
+// Level 0-4 for a value where smaller is better, like -dBm; thresholds go from 4 bars down
+static int LevelBelow(int value, int first, int last, const int (&thresholds)[4]){
+    if (value < first || value > last)
+        return 0;
+    for (int level = 4; level > 0; --level)
+        if (value <= thresholds[4 - level])
+            return level;
+    return 0;
+}
+
+// Level 0-4 for a GSM/WCDMA ASU value, 99 is unknown
+static int LevelFromAsu(int asu){
+    if (asu <= 2 || asu == 99) return 0;
+    if (asu >= 12) return 4;
+    if (asu >= 8) return 3;
+    if (asu >= 5) return 2;
+    return 1;
+}
+
+int GetSignalLevels(const V1_4::SignalStrength& sigStrength){
+    int gsm = LevelFromAsu(sigStrength.gsm.signalStrength);
+    int wcdma = LevelFromAsu(sigStrength.wcdma.base.signalStrength);
+    int lte = LevelBelow(sigStrength.lte.rsrp, 44, 140, {85, 95, 105, 115});
+    int cdma = LevelBelow(sigStrength.cdma.dbm, 1, 120, {75, 85, 95, 100});
+    int nr = LevelBelow(sigStrength.nr.ssRsrp, 44, 140, {65, 80, 90, 110});
+    return gsm | wcdma << 3 | lte << 6 | cdma << 9 | nr << 12;
+}
+
+// Each record is built inside the destination union, so the nested operator
+// name strings are copied once from the source instead of via a temporary.
 hidl_vec<V1_4::CellInfo> Create1_4CellInfoList(const hidl_vec<V1_0::CellInfo>& cellInfo) {
     hidl_vec<V1_4::CellInfo> newCI;
     newCI.resize(cellInfo.size());
 
-    for(int x = 0; x < cellInfo.size(); ++x){
-        newCI[x].isRegistered = cellInfo[x].registered;
-        newCI[x].connectionStatus = (V1_2::CellConnectionStatus) INT_MAX;
-        if(cellInfo[x].gsm.size() == 1){
-            V1_2::CellInfoGsm GsmInfo = {};
-            GsmInfo.cellIdentityGsm.base = cellInfo[x].gsm[0].cellIdentityGsm;
-            GsmInfo.signalStrengthGsm = cellInfo[x].gsm[0].signalStrengthGsm;
-            newCI[x].info.gsm(GsmInfo);
+    for(size_t x = 0; x < cellInfo.size(); ++x){
+        const V1_0::CellInfo& in = cellInfo[x];
+        V1_4::CellInfo& out = newCI[x];
+        out.isRegistered = in.registered;
+        out.connectionStatus = (V1_2::CellConnectionStatus) INT_MAX;
+        if(in.gsm.size() == 1){
+            out.info.gsm(V1_2::CellInfoGsm{});
+            V1_2::CellInfoGsm& GsmInfo = out.info.gsm();
+            GsmInfo.cellIdentityGsm.base = in.gsm[0].cellIdentityGsm;
+            GsmInfo.signalStrengthGsm = in.gsm[0].signalStrengthGsm;
         }
-        else if(cellInfo[x].cdma.size() == 1){
-            V1_2::CellInfoCdma CdmaInfo = {};
-            CdmaInfo.cellIdentityCdma.base = cellInfo[x].cdma[0].cellIdentityCdma;
-            CdmaInfo.signalStrengthCdma = cellInfo[x].cdma[0].signalStrengthCdma;
-            CdmaInfo.signalStrengthEvdo = cellInfo[x].cdma[0].signalStrengthEvdo;
-            newCI[x].info.cdma(CdmaInfo);
+        else if(in.cdma.size() == 1){
+            out.info.cdma(V1_2::CellInfoCdma{});
+            V1_2::CellInfoCdma& CdmaInfo = out.info.cdma();
+            CdmaInfo.cellIdentityCdma.base = in.cdma[0].cellIdentityCdma;
+            CdmaInfo.signalStrengthCdma = in.cdma[0].signalStrengthCdma;
+            CdmaInfo.signalStrengthEvdo = in.cdma[0].signalStrengthEvdo;
         }
-        else if(cellInfo[x].lte.size() == 1){
-            V1_4::CellInfoLte LteInfo = {};
-            LteInfo.base.cellIdentityLte.base = cellInfo[x].lte[0].cellIdentityLte;
+        else if(in.lte.size() == 1){
+            out.info.lte(V1_4::CellInfoLte{});
+            V1_4::CellInfoLte& LteInfo = out.info.lte();
+            LteInfo.base.cellIdentityLte.base = in.lte[0].cellIdentityLte;
             LteInfo.base.cellIdentityLte.bandwidth = INT_MAX;
             LteInfo.cellConfig.isEndcAvailable = false;
-            LteInfo.base.signalStrengthLte = cellInfo[x].lte[0].signalStrengthLte;
-            newCI[x].info.lte(LteInfo);
+            LteInfo.base.signalStrengthLte = in.lte[0].signalStrengthLte;
         }
-        else if(cellInfo[x].wcdma.size() == 1){
-            V1_2::CellInfoWcdma WcdmaInfo = {};
-            WcdmaInfo.cellIdentityWcdma.base = cellInfo[x].wcdma[0].cellIdentityWcdma;
-            WcdmaInfo.signalStrengthWcdma.base = cellInfo[x].wcdma[0].signalStrengthWcdma;
+        else if(in.wcdma.size() == 1){
+            out.info.wcdma(V1_2::CellInfoWcdma{});
+            V1_2::CellInfoWcdma& WcdmaInfo = out.info.wcdma();
+            WcdmaInfo.cellIdentityWcdma.base = in.wcdma[0].cellIdentityWcdma;
+            WcdmaInfo.signalStrengthWcdma.base = in.wcdma[0].signalStrengthWcdma;
             WcdmaInfo.signalStrengthWcdma.rscp = INT_MAX;
             WcdmaInfo.signalStrengthWcdma.ecno = INT_MAX;
-            newCI[x].info.wcdma(WcdmaInfo);
         }
-        else if(cellInfo[x].tdscdma.size() == 1){
-            V1_2::CellInfoTdscdma TdscdmaInfo = {};
-            TdscdmaInfo.cellIdentityTdscdma.base = cellInfo[x].tdscdma[0].cellIdentityTdscdma;
+        else if(in.tdscdma.size() == 1){
+            out.info.tdscdma(V1_2::CellInfoTdscdma{});
+            V1_2::CellInfoTdscdma& TdscdmaInfo = out.info.tdscdma();
+            TdscdmaInfo.cellIdentityTdscdma.base = in.tdscdma[0].cellIdentityTdscdma;
             TdscdmaInfo.cellIdentityTdscdma.uarfcn = INT_MAX;
             TdscdmaInfo.signalStrengthTdscdma.signalStrength = INT_MAX;
             TdscdmaInfo.signalStrengthTdscdma.bitErrorRate = INT_MAX;
-            TdscdmaInfo.signalStrengthTdscdma.rscp = cellInfo[x].tdscdma[0].signalStrengthTdscdma.rscp != INT_MAX ?
-                -cellInfo[x].tdscdma[0].signalStrengthTdscdma.rscp + 120 : INT_MAX;
-            newCI[x].info.tdscdma(TdscdmaInfo);
+            TdscdmaInfo.signalStrengthTdscdma.rscp = in.tdscdma[0].signalStrengthTdscdma.rscp != INT_MAX ?
+                -in.tdscdma[0].signalStrengthTdscdma.rscp + 120 : INT_MAX;
         }
     }
 
@@ -116,41 +147,66 @@ hidl_vec<V1_4::CellInfo> Create1_4CellInfoList(const hidl_vec<V1_2::CellInfo>& c
     hidl_vec<V1_4::CellInfo> newCI;
     newCI.resize(cellInfo.size());
 
-    for(int x = 0; x < cellInfo.size(); ++x){
-        newCI[x].isRegistered = cellInfo[x].registered;
-        newCI[x].connectionStatus = cellInfo[x].connectionStatus;
-        if(cellInfo[x].gsm.size() == 1)
-            newCI[x].info.gsm(cellInfo[x].gsm[0]);
-
-        else if(cellInfo[x].cdma.size() == 1)
-            newCI[x].info.cdma(cellInfo[x].cdma[0]);
-
-        else if(cellInfo[x].lte.size() == 1){
-            V1_4::CellInfoLte LteInfo = {};
-            LteInfo.base = cellInfo[x].lte[0];
+    for(size_t x = 0; x < cellInfo.size(); ++x){
+        const V1_2::CellInfo& in = cellInfo[x];
+        V1_4::CellInfo& out = newCI[x];
+        out.isRegistered = in.registered;
+        out.connectionStatus = in.connectionStatus;
+        if(in.gsm.size() == 1)
+            out.info.gsm(in.gsm[0]);
+
+        else if(in.cdma.size() == 1)
+            out.info.cdma(in.cdma[0]);
+
+        else if(in.lte.size() == 1){
+            out.info.lte(V1_4::CellInfoLte{});
+            V1_4::CellInfoLte& LteInfo = out.info.lte();
+            LteInfo.base = in.lte[0];
             LteInfo.cellConfig.isEndcAvailable = false;
-            newCI[x].info.lte(LteInfo);
         }
-        else if(cellInfo[x].wcdma.size() == 1)
-            newCI[x].info.wcdma(cellInfo[x].wcdma[0]);
+        else if(in.wcdma.size() == 1)
+            out.info.wcdma(in.wcdma[0]);
 
-        else if(cellInfo[x].tdscdma.size() == 1)
-            newCI[x].info.tdscdma(cellInfo[x].tdscdma[0]);
+        else if(in.tdscdma.size() == 1)
+            out.info.tdscdma(in.tdscdma[0]);
     }
 
     return newCI;
 }
 
-hidl_vec<hidl_string> DelimitedStrToVec(std::string delimitedStr){
-    std::regex rgx("\\s+");
-    std::sregex_token_iterator iter(delimitedStr.begin(), delimitedStr.end(), rgx, -1);
-    std::sregex_token_iterator end;
+static bool IsDelimiter(char c){
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Calls fn with every whitespace separated token of str, empty ones are skipped
+template <typename Fn>
+static void ForEachToken(std::string_view str, Fn fn){
+    size_t pos = 0;
+    while (pos < str.size()) {
+        while (pos < str.size() && IsDelimiter(str[pos]))
+            ++pos;
+        size_t start = pos;
+        while (pos < str.size() && !IsDelimiter(str[pos]))
+            ++pos;
+        if (pos > start)
+            fn(str.substr(start, pos - start));
+    }
+}
+
+hidl_vec<hidl_string> DelimitedStrToVec(const hidl_string& delimitedStr){
+    std::string_view str(delimitedStr.c_str(), delimitedStr.size());
+
+    size_t count = 0;
+    ForEachToken(str, [&](std::string_view) { ++count; });
 
-    std::vector<hidl_string> tokens;
-    for ( ; iter != end; ++iter)
-        tokens.push_back(hidl_string(*iter));
+    hidl_vec<hidl_string> tokens;
+    tokens.resize(count);
+    size_t x = 0;
+    ForEachToken(str, [&](std::string_view token) {
+        tokens[x++] = hidl_string(token.data(), token.size());
+    });
 
-    return hidl_vec(tokens);
+    return tokens;
 }
 
 V1_4::SetupDataCallResult Create1_4SetupDataCallResult(const V1_0::SetupDataCallResult& dcResponse){
@@ -26,4 +26,8 @@ android::hardware::radio::V1_4::SignalStrength Create1_4SignalStrength(const and
 android::hardware::radio::V1_4::SignalStrength Create1_4SignalStrength(const android::hardware::radio::V1_2::SignalStrength& sigStrength);
 hidl_vec<android::hardware::radio::V1_4::CellInfo> Create1_4CellInfoList(const hidl_vec<android::hardware::radio::V1_0::CellInfo>& cellInfo);
 hidl_vec<android::hardware::radio::V1_4::CellInfo> Create1_4CellInfoList(const hidl_vec<android::hardware::radio::V1_2::CellInfo>& cellInfo);
+// Coarse per-RAT signal levels packed into one int, changes whenever a bar would
+int GetSignalLevels(const android::hardware::radio::V1_4::SignalStrength& sigStrength);
+// Splits a whitespace separated list, such as a data call's addresses
+hidl_vec<hidl_string> DelimitedStrToVec(const hidl_string& delimitedStr);
 android::hardware::radio::V1_4::SetupDataCallResult Create1_4SetupDataCallResult(const android::hardware::radio::V1_0::SetupDataCallResult& dcResponse);
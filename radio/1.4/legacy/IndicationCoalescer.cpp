@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "IndicationCoalescer.h"
+
+namespace android::hardware::radio::implementation {
+
+IndicationCoalescer::IndicationCoalescer(std::chrono::milliseconds window) : mWindow(window) {
+    if (enabled()) {
+        mThread = std::thread(&IndicationCoalescer::run, this);
+    }
+}
+
+IndicationCoalescer::~IndicationCoalescer() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void IndicationCoalescer::post(bool urgent, Forward forward) {
+    if (!enabled()) {
+        forward();
+        return;
+    }
+
+    // Forwarding in order matters more than latency, the framework keeps the last value
+    std::lock_guard<std::mutex> forwardLock(mForwardLock);
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        Clock::time_point now = Clock::now();
+        if (!urgent && now - mLastForward < mWindow) {
+            bool wasIdle = !mPending;
+            mPending = std::move(forward);
+            if (wasIdle) {
+                mCond.notify_all();
+            }
+            return;
+        }
+        // Anything held back is older than this one
+        mPending = nullptr;
+        mLastForward = now;
+    }
+    forward();
+}
+
+void IndicationCoalescer::flush() {
+    std::lock_guard<std::mutex> forwardLock(mForwardLock);
+    Forward forward;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        forward = std::move(mPending);
+        mPending = nullptr;
+        mLastForward = Clock::now();
+    }
+    if (forward) {
+        forward();
+    }
+}
+
+void IndicationCoalescer::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mExit) {
+        if (!mPending) {
+            mCond.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline = mLastForward + mWindow;
+        if (Clock::now() < deadline) {
+            mCond.wait_until(lock, deadline);
+            continue;
+        }
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+}  // namespace android::hardware::radio::implementation
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android::hardware::radio::implementation {
+
+// Rate limits indications of one kind: after one was forwarded, newer ones
+// within the window only replace each other and the latest is forwarded
+// once the window ends. A zero window forwards everything right away.
+class IndicationCoalescer {
+  public:
+    using Forward = std::function<void()>;
+
+    explicit IndicationCoalescer(std::chrono::milliseconds window);
+    ~IndicationCoalescer();
+
+    // Urgent indications, e.g. ones that change what the user sees or that must
+    // be acknowledged, skip the window
+    void post(bool urgent, Forward forward);
+    // Forwards a held back indication immediately
+    void flush();
+
+    bool enabled() const { return mWindow.count() > 0; }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+
+    const std::chrono::milliseconds mWindow;
+
+    // Held while forwarding, taken before mLock
+    std::mutex mForwardLock;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    Clock::time_point mLastForward;
+    Forward mPending;
+    bool mExit = false;
+    std::thread mThread;
+};
+
+}  // namespace android::hardware::radio::implementation
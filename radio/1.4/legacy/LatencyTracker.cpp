@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#include <stdio.h>
+
+namespace android::hardware::radio::implementation {
+
+namespace {
+
+constexpr size_t kMaxMethodNames = 256;
+
+// Shared by every slot's tracker so one method has the same id everywhere
+std::mutex sRegistryLock;
+const char* sMethodNames[kMaxMethodNames];
+std::atomic<size_t> sMethodCount{0};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+uint64_t makeKey(LatencyTracker::MethodId method, int32_t serial) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(serial)) << 32 | (method + 1u);
+}
+
+}  // namespace
+
+LatencyTracker::MethodId LatencyTracker::registerMethod(const char* name) {
+    static_assert(kMaxMethodNames == kMaxMethods);
+    std::lock_guard<std::mutex> lock(sRegistryLock);
+
+    // Several Radio methods can end up calling the same one on the vendor RIL
+    size_t count = sMethodCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(sMethodNames[i], name) == 0) return i;
+    }
+    if (count == kMaxMethods) return kUntracked;
+
+    sMethodNames[count] = name;
+    sMethodCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void LatencyTracker::start(MethodId method, int32_t serial) {
+    if (method == kUntracked) return;
+
+    Slot& slot = mSlots[static_cast<uint32_t>(serial) & (kSlots - 1)];
+    slot.startNs.store(nowNs(), std::memory_order_relaxed);
+    uint64_t old = slot.key.exchange(makeKey(method, serial), std::memory_order_release);
+    if (old != 0) {
+        mHistograms[(old & 0xffff) - 1].lost.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LatencyTracker::finish(int32_t serial) {
+    Slot& slot = mSlots[static_cast<uint32_t>(serial) & (kSlots - 1)];
+    uint64_t key = slot.key.load(std::memory_order_acquire);
+    if (key == 0 || static_cast<int32_t>(key >> 32) != serial ||
+        !slot.key.compare_exchange_strong(key, 0, std::memory_order_acq_rel)) {
+        mUnmatched.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int64_t elapsedNs = std::max<int64_t>(nowNs() - slot.startNs.load(std::memory_order_relaxed), 0);
+    uint32_t elapsedUs = std::min<int64_t>(elapsedNs / 1000, UINT32_MAX);
+    uint64_t elapsedMs = elapsedUs / 1000;
+    size_t bucket = 0;
+    while (elapsedMs != 0 && bucket < kBuckets - 1) {
+        elapsedMs >>= 1;
+        bucket++;
+    }
+
+    Histogram& histogram = mHistograms[(key & 0xffff) - 1];
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.totalUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+    uint32_t maxUs = histogram.maxUs.load(std::memory_order_relaxed);
+    while (elapsedUs > maxUs &&
+           !histogram.maxUs.compare_exchange_weak(maxUs, elapsedUs, std::memory_order_relaxed)) {
+    }
+}
+
+std::vector<std::pair<int32_t, const char*>> LatencyTracker::takeInFlight() {
+    std::vector<std::pair<int32_t, const char*>> inFlight;
+    for (Slot& slot : mSlots) {
+        uint64_t key = slot.key.exchange(0, std::memory_order_acquire);
+        if (key == 0) continue;
+        inFlight.emplace_back(static_cast<int32_t>(key >> 32), sMethodNames[(key & 0xffff) - 1]);
+    }
+    return inFlight;
+}
+
+void LatencyTracker::dump(int fd) const {
+    dprintf(fd, "Request latency, bucket i counts responses below 2^i ms:\n");
+
+    size_t count = sMethodCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+        const Histogram& histogram = mHistograms[i];
+        uint32_t buckets[kBuckets];
+        uint32_t total = 0;
+        for (size_t b = 0; b < kBuckets; b++) {
+            buckets[b] = histogram.buckets[b].load(std::memory_order_relaxed);
+            total += buckets[b];
+        }
+        uint32_t lost = histogram.lost.load(std::memory_order_relaxed);
+        if (total == 0 && lost == 0) continue;
+
+        double avgMs = total ? histogram.totalUs.load(std::memory_order_relaxed) / 1000.0 / total : 0;
+        dprintf(fd, "  %s: %u responses, avg %.1f ms, max %.1f ms, %u lost\n   ",
+                sMethodNames[i], total, avgMs,
+                histogram.maxUs.load(std::memory_order_relaxed) / 1000.0, lost);
+        // Trailing empty buckets carry no information
+        size_t last = kBuckets;
+        while (last > 0 && buckets[last - 1] == 0) last--;
+        for (size_t b = 0; b < last; b++) dprintf(fd, " %u", buckets[b]);
+        dprintf(fd, "\n");
+    }
+
+    dprintf(fd, "  unmatched responses: %u\n", mUnmatched.load(std::memory_order_relaxed));
+}
+
+}  // namespace android::hardware::radio::implementation
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace android::hardware::radio::implementation {
+
+// Matches request serials to the responses carrying them and keeps a latency
+// histogram per request method. Recording takes a few atomics and no lock,
+// so it is always on.
+class LatencyTracker {
+  public:
+    using MethodId = uint16_t;
+    static constexpr MethodId kUntracked = UINT16_MAX;
+
+    // Called once per call site through a function local static, see Radio.cpp
+    static MethodId registerMethod(const char* name);
+
+    void start(MethodId method, int32_t serial);
+    void finish(int32_t serial);
+
+    // Forgets every request still waiting for its response and returns them
+    // as (serial, method), without recording any latency
+    std::vector<std::pair<int32_t, const char*>> takeInFlight();
+
+    void dump(int fd) const;
+
+  private:
+    static constexpr size_t kMaxMethods = 256;
+    // Serials are handed out sequentially, so a power of two table indexed by
+    // the low bits only collides once that many requests are outstanding
+    static constexpr size_t kSlots = 512;
+    // Bucket 0 counts latencies below 1 ms, bucket i those below 2^i ms and
+    // the last one everything slower
+    static constexpr size_t kBuckets = 16;
+
+    struct Slot {
+        // serial << 32 | (method + 1), 0 while free
+        std::atomic<uint64_t> key{0};
+        std::atomic<int64_t> startNs{0};
+    };
+
+    struct Histogram {
+        std::atomic<uint32_t> buckets[kBuckets] = {};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint32_t> maxUs{0};
+        // Requests whose slot was taken over before their response arrived
+        std::atomic<uint32_t> lost{0};
+    };
+
+    std::array<Slot, kSlots> mSlots;
+    std::array<Histogram, kMaxMethods> mHistograms;
+    // Responses to serials which weren't recorded or were already lost
+    std::atomic<uint32_t> mUnmatched{0};
+};
+
+}  // namespace android::hardware::radio::implementation
@@ -8,17 +8,32 @@
 
 #include "Radio.h"
 #include "Helpers.h"
+#include "hidl-utils.h"
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <string>
 
 #include <android-base/logging.h>
 
+#define TRACK_REQUEST(method, ...)                                             \
+    do {                                                                       \
+        static const LatencyTracker::MethodId sMethodId =                      \
+                LatencyTracker::registerMethod(#method);                       \
+        startRequest(sMethodId, ##__VA_ARGS__);                                \
+    } while (0)
+
 #define WRAP_V1_0_CALL(method, ...)                                            \
     do {                                                                       \
-        auto realRadio = mRealRadio;                                           \
+        auto realRadio = getRealRadio();                                       \
         if (realRadio != nullptr) {                                            \
+            TRACK_REQUEST(method, ##__VA_ARGS__);                              \
             return realRadio->method(__VA_ARGS__);                             \
         }                                                                      \
+        if (mReconnecting) {                                                   \
+            failRequest(#method, ##__VA_ARGS__);                               \
+            return Void();                                                     \
+        }                                                                      \
         return Status::fromExceptionCode(Status::Exception::EX_ILLEGAL_STATE); \
     } while (0)
 
@@ -26,24 +41,39 @@
     do {                                                \
         auto realRadio_V1_1 = getRealRadio_V1_1();      \
         if (realRadio_V1_1 != nullptr) {                \
+            TRACK_REQUEST(method, __VA_ARGS__);         \
             return realRadio_V1_1->method(__VA_ARGS__); \
         }                                               \
+        if (mReconnecting) {                            \
+            failRequest(#method, __VA_ARGS__);          \
+            return Void();                              \
+        }                                               \
     } while (0)
 
 #define MAYBE_WRAP_V1_2_CALL(method, ...)               \
     do {                                                \
         auto realRadio_V1_2 = getRealRadio_V1_2();      \
         if (realRadio_V1_2 != nullptr) {                \
+            TRACK_REQUEST(method, __VA_ARGS__);         \
             return realRadio_V1_2->method(__VA_ARGS__); \
         }                                               \
+        if (mReconnecting) {                            \
+            failRequest(#method, __VA_ARGS__);          \
+            return Void();                              \
+        }                                               \
     } while (0)
 
 #define MAYBE_WRAP_V1_3_CALL(method, ...)               \
     do {                                                \
         auto realRadio_V1_3 = getRealRadio_V1_3();      \
         if (realRadio_V1_3 != nullptr) {                \
+            TRACK_REQUEST(method, __VA_ARGS__);         \
             return realRadio_V1_3->method(__VA_ARGS__); \
         }                                               \
+        if (mReconnecting) {                            \
+            failRequest(#method, __VA_ARGS__);          \
+            return Void();                              \
+        }                                               \
     } while (0)
 
 #define MAYBE_WRAP_V1_4_CALL(method, ...)                    \
@@ -51,19 +81,39 @@
         auto realRadio_V1_4 = getRealRadio_V1_4();           \
         if (realRadio_V1_4 != nullptr) {                     \
             LOG(WARNING) << "Using wrapper when not needed"; \
+            TRACK_REQUEST(method, __VA_ARGS__);              \
             return realRadio_V1_4->method(__VA_ARGS__);      \
         }                                                    \
+        if (mReconnecting) {                                 \
+            failRequest(#method, __VA_ARGS__);               \
+            return Void();                                   \
+        }                                                    \
     } while (0)
 
 namespace android::hardware::radio::implementation {
 
-Radio::Radio(sp<V1_0::IRadio> realRadio) : mRealRadio(realRadio) {}
+using ::android::hardware::hidl_utils::linkDeath;
+
+Radio::Radio(sp<V1_0::IRadio> realRadio)
+    : mRealRadio(realRadio),
+      // Each castFrom is an interfaceChain transaction, do them once up front
+      mRealRadio_V1_1(V1_1::IRadio::castFrom(realRadio).withDefault(nullptr)),
+      mRealRadio_V1_2(V1_2::IRadio::castFrom(realRadio).withDefault(nullptr)),
+      mRealRadio_V1_3(V1_3::IRadio::castFrom(realRadio).withDefault(nullptr)),
+      mRealRadio_V1_4(V1_4::IRadio::castFrom(realRadio).withDefault(nullptr)) {}
 
 // Methods from ::android::hardware::radio::V1_0::IRadio follow.
 Return<void> Radio::setResponseFunctions(const sp<V1_0::IRadioResponse>& radioResponse,
                                          const sp<V1_0::IRadioIndication>& radioIndication) {
     mRadioResponse->mRealRadioResponse = V1_4::IRadioResponse::castFrom(radioResponse);
     mRadioIndication->mRealRadioIndication = V1_4::IRadioIndication::castFrom(radioIndication);
+    // Everything is converted up to the 1.4 callbacks, a client without them would never hear
+    // back from the modem. That is a framework this service can't work with, so stop here
+    // instead of dropping every response.
+    if (mRadioResponse->mRealRadioResponse == nullptr ||
+        mRadioIndication->mRealRadioIndication == nullptr) {
+        LOG(FATAL) << "setResponseFunctions: callbacks do not implement radio@1.4";
+    }
     WRAP_V1_0_CALL(setResponseFunctions, mRadioResponse, mRadioIndication);
 }
 
@@ -603,6 +653,8 @@ Return<void> Radio::sendDeviceState(int32_t serial, V1_0::DeviceStateType device
 
 Return<void> Radio::setIndicationFilter(int32_t serial,
                                         hidl_bitfield<V1_0::IndicationFilter> indicationFilter) {
+    // The framework only asks for signal strength while the screen is on
+    mRadioIndication->setScreenOn(indicationFilter & V1_0::IndicationFilter::SIGNAL_STRENGTH);
     WRAP_V1_0_CALL(setIndicationFilter, serial, indicationFilter);
 }
 
@@ -670,6 +722,7 @@ Return<void> Radio::startNetworkScan_1_2(int32_t serial, const V1_2::NetworkScan
 
 Return<void> Radio::setIndicationFilter_1_2(
         int32_t serial, hidl_bitfield<V1_2::IndicationFilter> indicationFilter) {
+    mRadioIndication->setScreenOn(indicationFilter & V1_2::IndicationFilter::SIGNAL_STRENGTH);
     MAYBE_WRAP_V1_2_CALL(setIndicationFilter_1_2, serial, indicationFilter);
     WRAP_V1_0_CALL(setIndicationFilter, serial, indicationFilter & V1_0::IndicationFilter::ALL);
 }
@@ -965,20 +1018,114 @@ Return<void> Radio::getSignalStrength_1_4(int32_t serial) {
     WRAP_V1_0_CALL(getSignalStrength, serial);
 }
 
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> Radio::debug(const hidl_handle& handle, const hidl_vec<hidl_string>& /* args */) {
+    if (handle == nullptr || handle->numFds < 1) return Void();
+
+    mRadioResponse->mLatency.dump(handle->data[0]);
+    return Void();
+}
+
+void Radio::reconnectOnDeath(const std::string& instance) {
+    mInstance = instance;
+    linkToRealRadio(getRealRadio());
+}
+
+void Radio::linkToRealRadio(const sp<V1_0::IRadio>& realRadio) {
+    wp<Radio> weakThis = this;
+    auto recipient = linkDeath(realRadio, [weakThis] {
+        auto radio = weakThis.promote();
+        if (radio != nullptr) radio->onRealRadioDied();
+    });
+
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    mDeathRecipient = recipient;
+}
+
+void Radio::onRealRadioDied() {
+    // Set first, a request finding no radio must get answered, not an exception
+    mReconnecting = true;
+    {
+        std::lock_guard<std::mutex> lock(mRealRadioLock);
+        mRealRadio = nullptr;
+        mRealRadio_V1_1 = nullptr;
+        mRealRadio_V1_2 = nullptr;
+        mRealRadio_V1_3 = nullptr;
+        mRealRadio_V1_4 = nullptr;
+    }
+
+    // Tell the framework what a restarting rild would, then answer whatever
+    // the dead RIL still owed it, so nothing waits for the request timeout
+    if (mRadioIndication->mRealRadioIndication != nullptr) {
+        auto ret = mRadioIndication->radioStateChanged(V1_0::RadioIndicationType::UNSOLICITED,
+                                                       V1_0::RadioState::UNAVAILABLE);
+        if (!ret.isOk()) LOG(ERROR) << "radioStateChanged failed: " << ret.description();
+    }
+    for (const auto& [serial, method] : mRadioResponse->mLatency.takeInFlight()) {
+        mRadioResponse->failRequest(method, serial, V1_0::RadioError::RADIO_NOT_AVAILABLE);
+    }
+
+    // Death notifications arrive on the only binder thread, don't wait on it
+    sp<Radio> self = this;
+    std::thread([self] { self->reconnect(); }).detach();
+}
+
+void Radio::reconnect() {
+    sp<V1_0::IRadio> realRadio;
+    // getService only waits a few seconds for an instance to come up
+    while ((realRadio = V1_0::IRadio::getService(mInstance)) == nullptr) {
+        LOG(WARNING) << "Waiting for radio service " << mInstance;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    auto realRadio_V1_1 = V1_1::IRadio::castFrom(realRadio).withDefault(nullptr);
+    auto realRadio_V1_2 = V1_2::IRadio::castFrom(realRadio).withDefault(nullptr);
+    auto realRadio_V1_3 = V1_3::IRadio::castFrom(realRadio).withDefault(nullptr);
+    auto realRadio_V1_4 = V1_4::IRadio::castFrom(realRadio).withDefault(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mRealRadioLock);
+        mRealRadio = realRadio;
+        mRealRadio_V1_1 = realRadio_V1_1;
+        mRealRadio_V1_2 = realRadio_V1_2;
+        mRealRadio_V1_3 = realRadio_V1_3;
+        mRealRadio_V1_4 = realRadio_V1_4;
+    }
+    linkToRealRadio(realRadio);
+    mReconnecting = false;
+
+    // Without the framework's callbacks there's nothing to attach yet,
+    // setResponseFunctions will do it once they arrive
+    if (mRadioResponse->mRealRadioResponse != nullptr) {
+        auto ret = realRadio->setResponseFunctions(mRadioResponse, mRadioIndication);
+        if (!ret.isOk()) LOG(ERROR) << "setResponseFunctions failed: " << ret.description();
+    }
+
+    LOG(INFO) << "Reconnected to radio service " << mInstance;
+}
+
+sp<V1_0::IRadio> Radio::getRealRadio() {
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    return mRealRadio;
+}
+
 sp<V1_1::IRadio> Radio::getRealRadio_V1_1() {
-    return V1_1::IRadio::castFrom(mRealRadio).withDefault(nullptr);
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    return mRealRadio_V1_1;
 }
 
 sp<V1_2::IRadio> Radio::getRealRadio_V1_2() {
-    return V1_2::IRadio::castFrom(mRealRadio).withDefault(nullptr);
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    return mRealRadio_V1_2;
 }
 
 sp<V1_3::IRadio> Radio::getRealRadio_V1_3() {
-    return V1_3::IRadio::castFrom(mRealRadio).withDefault(nullptr);
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    return mRealRadio_V1_3;
 }
 
 sp<V1_4::IRadio> Radio::getRealRadio_V1_4() {
-    return V1_4::IRadio::castFrom(mRealRadio).withDefault(nullptr);
+    std::lock_guard<std::mutex> lock(mRealRadioLock);
+    return mRealRadio_V1_4;
 }
 
 }  // namespace android::hardware::radio::implementation
@@ -13,10 +13,16 @@
 #include "RadioIndication.h"
 #include "RadioResponse.h"
 
+#include <atomic>
+#include <mutex>
+#include <string>
+
 namespace android::hardware::radio::implementation {
 
 using ::android::sp;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_death_recipient;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -27,6 +33,10 @@ struct Radio : public V1_4::IRadio {
   public:
     Radio(sp<V1_0::IRadio> realRadio);
 
+    // Waits for the vendor RIL to come back when it dies instead of taking
+    // this process down with it
+    void reconnectOnDeath(const std::string& instance);
+
     // Methods from ::android::hardware::radio::V1_0::IRadio follow.
     Return<void> setResponseFunctions(const sp<V1_0::IRadioResponse>& radioResponse,
                                       const sp<V1_0::IRadioIndication>& radioIndication) override;
@@ -259,15 +269,51 @@ struct Radio : public V1_4::IRadio {
     Return<void> getAllowedCarriers_1_4(int32_t serial) override;
     Return<void> getSignalStrength_1_4(int32_t serial) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& args) override;
+
   private:
+    // Guards the real radio interfaces, which are replaced after a reconnect
+    std::mutex mRealRadioLock;
     sp<V1_0::IRadio> mRealRadio;
+    // mRealRadio resolved to the newer versions it implements, if any
+    sp<V1_1::IRadio> mRealRadio_V1_1;
+    sp<V1_2::IRadio> mRealRadio_V1_2;
+    sp<V1_3::IRadio> mRealRadio_V1_3;
+    sp<V1_4::IRadio> mRealRadio_V1_4;
     sp<RadioResponse> mRadioResponse = new RadioResponse();
     sp<RadioIndication> mRadioIndication = new RadioIndication();
 
+    std::string mInstance;
+    sp<hidl_death_recipient> mDeathRecipient;
+    // Set from the real radio's death until it is back
+    std::atomic<bool> mReconnecting = false;
+
+    void linkToRealRadio(const sp<V1_0::IRadio>& realRadio);
+    void onRealRadioDied();
+    void reconnect();
+
+    sp<V1_0::IRadio> getRealRadio();
     sp<V1_1::IRadio> getRealRadio_V1_1();
     sp<V1_2::IRadio> getRealRadio_V1_2();
     sp<V1_3::IRadio> getRealRadio_V1_3();
     sp<V1_4::IRadio> getRealRadio_V1_4();
+
+    // Requests take their serial first, the couple which don't aren't tracked
+    template <typename... Args>
+    void startRequest(LatencyTracker::MethodId method, int32_t serial, const Args&...) {
+        mRadioResponse->mLatency.start(method, serial);
+    }
+    template <typename... Args>
+    void startRequest(LatencyTracker::MethodId, const Args&...) {}
+
+    // Answers requests made while reconnecting with RADIO_NOT_AVAILABLE
+    template <typename... Args>
+    void failRequest(const char* method, int32_t serial, const Args&...) {
+        mRadioResponse->failRequest(method, serial, V1_0::RadioError::RADIO_NOT_AVAILABLE);
+    }
+    template <typename... Args>
+    void failRequest(const char*, const Args&...) {}
 };
 
 }  // namespace android::hardware::radio::implementation
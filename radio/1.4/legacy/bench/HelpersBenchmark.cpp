@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <iterator>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../Helpers.h"
+
+using namespace android::hardware::radio;
+
+namespace {
+
+// Address lists as a vendor RIL reports them in a data call setup response
+const char* const kLists[] = {
+        "",
+        "10.0.0.2/32",
+        "10.45.112.7/30 2001:db8:4:9a1c:1d2e:9f01:7a3b:c2d4/64",
+        "8.8.8.8 8.8.4.4 2001:4860:4860::8888 2001:4860:4860::8844",
+};
+
+// The std::regex based split DelimitedStrToVec replaced, kept as a baseline
+hidl_vec<hidl_string> RegexStrToVec(std::string delimitedStr) {
+    std::regex rgx("\\s+");
+    std::sregex_token_iterator iter(delimitedStr.begin(), delimitedStr.end(), rgx, -1);
+    std::sregex_token_iterator end;
+    std::vector<hidl_string> tokens;
+    for (; iter != end; ++iter) {
+        tokens.push_back(hidl_string(*iter));
+    }
+    return hidl_vec<hidl_string>(tokens);
+}
+
+void BM_DelimitedStrToVec(benchmark::State& state) {
+    hidl_string list(kLists[state.range(0)]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(DelimitedStrToVec(list));
+    }
+}
+BENCHMARK(BM_DelimitedStrToVec)->DenseRange(0, std::size(kLists) - 1);
+
+void BM_RegexStrToVec(benchmark::State& state) {
+    hidl_string list(kLists[state.range(0)]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RegexStrToVec(list));
+    }
+}
+BENCHMARK(BM_RegexStrToVec)->DenseRange(0, std::size(kLists) - 1);
+
+// The whole conversion a data call setup response goes through
+void BM_Create1_4SetupDataCallResult(benchmark::State& state) {
+    V1_0::SetupDataCallResult dcResponse = {};
+    dcResponse.type = "IPV4V6";
+    dcResponse.ifname = "rmnet_data0";
+    dcResponse.addresses = kLists[2];
+    dcResponse.dnses = kLists[3];
+    dcResponse.gateways = "10.45.112.5 fe80::1";
+    dcResponse.pcscf = kLists[1];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Create1_4SetupDataCallResult(dcResponse));
+    }
+}
+BENCHMARK(BM_Create1_4SetupDataCallResult);
+
+}  // namespace
+
+BENCHMARK_MAIN();
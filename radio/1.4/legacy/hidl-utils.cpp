@@ -27,6 +27,19 @@ class HalDeathRecipient : public hidl_death_recipient {
     }
 };
 
+class CallbackDeathRecipient : public hidl_death_recipient {
+  public:
+    explicit CallbackDeathRecipient(std::function<void()> onDeath) : mOnDeath(std::move(onDeath)) {}
+
+    void serviceDied(uint64_t /* cookie */, const wp<hidl::base::V1_0::IBase>& /* who */) override {
+        LOG(ERROR) << "One of the linked HALs died. Recovering...";
+        mOnDeath();
+    }
+
+  private:
+    const std::function<void()> mOnDeath;
+};
+
 static const auto gHalDeathRecipient = sp<HalDeathRecipient>::make();
 
 void linkDeathToDeath(sp<::android::hidl::base::V1_0::IBase> hal) {
@@ -34,6 +47,14 @@ void linkDeathToDeath(sp<::android::hidl::base::V1_0::IBase> hal) {
     CHECK(linkStatus.withDefault(false)) << "Failed to link to HAL death";
 }
 
+sp<hidl_death_recipient> linkDeath(sp<::android::hidl::base::V1_0::IBase> hal,
+                                   std::function<void()> onDeath) {
+    auto recipient = sp<CallbackDeathRecipient>::make(std::move(onDeath));
+    const auto linkStatus = hal->linkToDeath(recipient, 0);
+    CHECK(linkStatus.withDefault(false)) << "Failed to link to HAL death";
+    return recipient;
+}
+
 hidl_vec<hidl_string> listManifestByInterface(const char* descriptor) {
     auto manager = hidl::manager::V1_2::IServiceManager::getService();
     hidl_vec<hidl_string> services;
@@ -68,6 +68,14 @@ struct fill : public std::function<void(const T&...)> {
  */
 void linkDeathToDeath(sp<hidl::base::V1_0::IBase> hal);
 
+/**
+ * Link to a given HALs death and call a function instead of restarting.
+ * \param hal HAL to which death to link
+ * \param onDeath Called on a binder thread once the HAL died
+ * \return Recipient which must be kept alive for as long as the link should last
+ */
+sp<hidl_death_recipient> linkDeath(sp<hidl::base::V1_0::IBase> hal, std::function<void()> onDeath);
+
 /**
  * List HAL instances of a given interface.
  *
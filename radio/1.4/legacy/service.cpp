@@ -7,12 +7,16 @@
 #define LOG_TAG "android.hardware.radio@1.4-service.legacy"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <hidl/HidlTransportSupport.h>
 
 #include "Radio.h"
 #include "hidl-utils.h"
 
+#include <future>
 #include <map>
+#include <thread>
+#include <vector>
 
 using namespace android::hardware::radio;
 using namespace android::hardware::hidl_utils;
@@ -28,12 +32,36 @@ using android::status_t;
 
 #define MAX_SLOT_ID 4
 
+struct SlotLookup {
+    sp<V1_0::IRadio> realRadio;
+    sp<Radio> radio;
+};
+
 int main() {
     // Note: Starts from slot 1
     std::map<int, sp<V1_4::IRadio>> slotIdToRadio;
+    bool reconnect =
+            android::base::GetBoolProperty("persist.vendor.radio.reconnect_on_death", false);
+
+    // Look all slots up at once, so waiting for a missing one doesn't hold up
+    // the others
+    std::vector<std::future<SlotLookup>> lookups;
+    for (int slotId = 1; slotId <= MAX_SLOT_ID; slotId++) {
+        std::promise<SlotLookup> lookup;
+        lookups.push_back(lookup.get_future());
+        std::thread([slotId, lookup = std::move(lookup)]() mutable {
+            sp<V1_0::IRadio> realRadio = V1_0::IRadio::getService("slot" + std::to_string(slotId));
+            // Constructing Radio resolves the versioned interfaces, keep that in parallel too
+            lookup.set_value({realRadio, realRadio != nullptr ? new Radio(realRadio) : nullptr});
+        }).detach();
+    }
+
+    configureRpcThreadpool(1, true);
 
+    // Slots are still only registered in order and up to the first missing one,
+    // but each as soon as it is found
     for (int slotId = 1; slotId <= MAX_SLOT_ID; slotId++) {
-        sp<V1_0::IRadio> realRadio = V1_0::IRadio::getService("slot" + std::to_string(slotId));
+        auto [realRadio, radio] = lookups[slotId - 1].get();
         if (realRadio == nullptr) {
             LOG(INFO) << "Cannot get radio service for slot " << slotId;
 
@@ -45,13 +73,13 @@ int main() {
             break;
         }
 
-        slotIdToRadio[slotId] = new Radio(realRadio);
-        linkDeathToDeath(realRadio);
-    }
-
-    configureRpcThreadpool(1, true);
+        if (reconnect) {
+            radio->reconnectOnDeath("slot" + std::to_string(slotId));
+        } else {
+            linkDeathToDeath(realRadio);
+        }
+        slotIdToRadio[slotId] = radio;
 
-    for (auto const& [slotId, radio] : slotIdToRadio) {
         status_t status = radio->registerAsService("slot" + std::to_string(slotId));
         if (status != OK) {
             LOG(ERROR) << "Cannot register Radio HAL service for slot " << slotId;
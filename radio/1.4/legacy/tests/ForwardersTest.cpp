@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../RadioIndication.h"
+#include "../RadioResponse.h"
+
+namespace android::hardware::radio::implementation {
+namespace {
+
+constexpr int32_t kSerial = 4242;
+constexpr V1_0::RadioIndicationType kIndicationType =
+        V1_0::RadioIndicationType::UNSOLICITED_ACK_EXP;
+
+// Every argument is default constructed, except the ones identifying the call
+template <typename T>
+T makeArg() {
+    T arg{};
+    if constexpr (std::is_same_v<T, V1_0::RadioResponseInfo>) {
+        arg.serial = kSerial;
+    } else if constexpr (std::is_same_v<T, V1_0::RadioIndicationType>) {
+        arg = kIndicationType;
+    }
+    return arg;
+}
+
+template <typename Shim, typename... Args>
+void invoke(Shim& shim, Return<void> (Shim::*method)(Args...)) {
+    auto ret = (shim.*method)(makeArg<std::decay_t<Args>>()...);
+    EXPECT_TRUE(ret.isOk());
+}
+
+// Stands in for the framework's callbacks, recording which of the forwarded
+// methods were reached and with what identifying argument
+struct RecordingResponse : public RadioResponse {
+#define RECORD(method, params, args)      \
+    Return<void> method params override { \
+        called.push_back(#method);        \
+        record args;                      \
+        return Void();                    \
+    }
+    RADIO_RESPONSE_FORWARDERS(RECORD)
+#undef RECORD
+
+    template <typename... Args>
+    void record(const V1_0::RadioResponseInfo& info, const Args&...) {
+        serial = info.serial;
+    }
+    // acknowledgeRequest carries a bare serial
+    void record(int32_t s) { serial = s; }
+
+    std::vector<std::string> called;
+    int32_t serial = -1;
+};
+
+struct RecordingIndication : public RadioIndication {
+#define RECORD(method, params, args)      \
+    Return<void> method params override { \
+        called.push_back(#method);        \
+        record args;                      \
+        return Void();                    \
+    }
+    RADIO_INDICATION_FORWARDERS(RECORD)
+#undef RECORD
+
+    template <typename... Args>
+    void record(V1_0::RadioIndicationType t, const Args&...) {
+        type = t;
+    }
+
+    std::vector<std::string> called;
+    V1_0::RadioIndicationType type = V1_0::RadioIndicationType::UNSOLICITED;
+};
+
+TEST(ForwardersTest, ResponsesReachTheSameMethod) {
+    sp<RadioResponse> shim = new RadioResponse();
+    sp<RecordingResponse> real = new RecordingResponse();
+    shim->mRealRadioResponse = real;
+
+#define CHECK_FORWARDED(method, params, args)                       \
+    {                                                               \
+        SCOPED_TRACE(#method);                                      \
+        real->called.clear();                                       \
+        real->serial = -1;                                          \
+        invoke<RadioResponse>(*shim, &RadioResponse::method);       \
+        EXPECT_EQ(real->called, std::vector<std::string>{#method}); \
+        EXPECT_EQ(real->serial, kSerial);                           \
+    }
+    RADIO_RESPONSE_FORWARDERS(CHECK_FORWARDED)
+#undef CHECK_FORWARDED
+}
+
+TEST(ForwardersTest, IndicationsReachTheSameMethod) {
+    sp<RadioIndication> shim = new RadioIndication();
+    sp<RecordingIndication> real = new RecordingIndication();
+    shim->mRealRadioIndication = real;
+
+#define CHECK_FORWARDED(method, params, args)                       \
+    {                                                               \
+        SCOPED_TRACE(#method);                                      \
+        real->called.clear();                                       \
+        real->type = V1_0::RadioIndicationType::UNSOLICITED;        \
+        invoke<RadioIndication>(*shim, &RadioIndication::method);   \
+        EXPECT_EQ(real->called, std::vector<std::string>{#method}); \
+        EXPECT_EQ(real->type, kIndicationType);                     \
+    }
+    RADIO_INDICATION_FORWARDERS(CHECK_FORWARDED)
+#undef CHECK_FORWARDED
+}
+
+TEST(ForwardersTest, FailedRequestsGetTheirResponse) {
+    sp<RadioResponse> shim = new RadioResponse();
+    sp<RecordingResponse> real = new RecordingResponse();
+    shim->mRealRadioResponse = real;
+
+    const std::vector<std::pair<std::string, std::string>> requests = {
+            {"getImsiForApp", "getIMSIForAppResponse"},
+            {"hangup", "hangupConnectionResponse"},
+            {"getCurrentCalls", "getCurrentCallsResponse_1_2"},
+            {"setupDataCall_1_2", "setupDataCallResponse_1_4"},
+    };
+    for (const auto& [request, response] : requests) {
+        SCOPED_TRACE(request);
+        real->called.clear();
+        real->serial = -1;
+        shim->failRequest(request, kSerial, V1_0::RadioError::RADIO_NOT_AVAILABLE);
+        EXPECT_EQ(real->called, std::vector<std::string>{response});
+        EXPECT_EQ(real->serial, kSerial);
+    }
+}
+
+}  // namespace
+}  // namespace android::hardware::radio::implementation
@@ -7,15 +7,23 @@
 #define LOG_TAG "RadioConfigWrapper"
 
 #include <android-base/logging.h>
+#include <android/hidl/manager/1.0/IServiceManager.h>
 
 #include "RadioConfig.h"
 #include "hidl-utils.h"
 
+#include <chrono>
+#include <future>
+#include <thread>
 #include <vector>
 
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
 #define WRAP_V1_0_CALL(method, ...)                                            \
     do {                                                                       \
-        auto realRadioConfig = mRealRadioConfig;                               \
+        auto realRadioConfig = getRealRadioConfig();                           \
         if (realRadioConfig != nullptr) {                                      \
             return realRadioConfig->method(__VA_ARGS__);                       \
         }                                                                      \
@@ -25,7 +33,7 @@
 
 #define MAYBE_WRAP_V1_1_CALL(method, ...)                    \
     do {                                                     \
-        auto realRadioConfigV1_1 = mRealRadioConfigV1_1;     \
+        auto realRadioConfigV1_1 = getRealRadioConfigV1_1(); \
         if (realRadioConfigV1_1 != nullptr) {                \
             return realRadioConfigV1_1->method(__VA_ARGS__); \
         }                                                    \
@@ -60,7 +68,9 @@ Return<void> RadioConfig::setResponseFunctions(
                     mRadioConfigResponse)
                     .withDefault(nullptr);
 
-    auto realRadioConfig = mRealRadioConfig;
+    mRadioConfigIndication = radioConfigIndication;
+
+    auto realRadioConfig = getRealRadioConfig();
     if (realRadioConfig == nullptr) {
         LOG(ERROR) << __func__ << ": realRadioConfig is null";
         return Status::fromExceptionCode(Status::Exception::EX_ILLEGAL_STATE);
@@ -118,36 +128,35 @@ Return<void> RadioConfig::getPhoneCapability(int32_t serial) {
 Return<void> RadioConfig::setPreferredDataModem(int32_t serial, uint8_t modemId) {
     MAYBE_WRAP_V1_1_CALL(setPreferredDataModem, serial, modemId);
 
+    auto start = std::chrono::steady_clock::now();
     std::lock_guard<std::mutex> lock(mMutex);
 
-    std::vector<sp<IRadio>> radios;
-
-    uint8_t numSlots = 0;
-    while (true) {
-        auto radio = getRadioForModemId(numSlots);
-        if (radio == nullptr) {
-            break;
-        }
-
-        radios.push_back(radio);
-
-        numSlots++;
-    }
+    std::vector<sp<IRadio>> radios = getRadiosLocked();
 
     LOG(DEBUG) << __func__ << ": modemId = " << std::to_string(modemId)
-               << ", numSlots = " << std::to_string(numSlots);
+               << ", numSlots = " << std::to_string(radios.size());
 
     RadioError radioError = RadioError::NONE;
 
-    if (radios.empty() || modemId >= radios.size()) {
+    if (radios.empty() || modemId >= radios.size() || radios[modemId] == nullptr) {
         LOG(ERROR) << __func__ << ": Invalid arguments";
         radioError = RadioError::INVALID_ARGUMENTS;
     } else {
+        // setDataAllowed is oneway, taking data away from the other slots
+        // doesn't wait on any of them
         for (uint8_t i = 0; i < radios.size(); i++) {
-            if (i != modemId) radios[i]->setDataAllowed(-1, false);
+            if (i == modemId || radios[i] == nullptr) continue;
+            auto ret = radios[i]->setDataAllowed(-1, false);
+            if (!ret.isOk()) {
+                LOG(ERROR) << "setDataAllowed(false) failed: " << ret.description();
+            }
         }
 
-        radios[modemId]->setDataAllowed(-1, true);
+        auto ret = radios[modemId]->setDataAllowed(-1, true);
+        if (!ret.isOk()) {
+            LOG(ERROR) << "setDataAllowed(true) failed: " << ret.description();
+            radioError = RadioError::RADIO_NOT_AVAILABLE;
+        }
     }
 
     auto radioConfigResponseV1_1 = mRadioConfigResponseV1_1;
@@ -164,6 +173,8 @@ Return<void> RadioConfig::setPreferredDataModem(int32_t serial, uint8_t modemId)
 
     radioConfigResponseV1_1->setPreferredDataModemResponse(radioResponseInfo);
 
+    recordDataModemSwitchLocked(modemId, radioError, std::chrono::steady_clock::now() - start);
+
     return Void();
 }
 
@@ -171,7 +182,7 @@ Return<void> RadioConfig::setModemsConfig(
         int32_t serial,
         const ::android::hardware::radio::config::V1_1::ModemsConfig& modemsConfig) {
     // Cannot use MAYBE_WRAP_V1_1_CALL, needs reinterpret_cast
-    auto realRadioConfigV1_1 = mRealRadioConfigV1_1;
+    auto realRadioConfigV1_1 = getRealRadioConfigV1_1();
     if (realRadioConfigV1_1 != nullptr) {
         return realRadioConfigV1_1->setModemsConfig(
                 serial,
@@ -204,19 +215,216 @@ Return<void> RadioConfig::getModemsConfig(int32_t serial) {
     return Void();
 }
 
+void RadioConfig::reconnectOnDeath() {
+    mReconnect = true;
+    linkToRealRadioConfig();
+}
+
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> RadioConfig::debug(const hidl_handle& handle,
+                                const hidl_vec<hidl_string>& /* args */) {
+    if (handle == nullptr || handle->numFds < 1) return Void();
+    int fd = handle->data[0];
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    dprintf(fd, "Slots: %d\n", mNumSlots);
+    dprintf(fd, "Recent preferred data modem switches:\n");
+    for (const auto& record : mDataModemSwitches) {
+        char when[32];
+        strftime(when, sizeof(when), "%m-%d %H:%M:%S", localtime(&record.when));
+        dprintf(fd, "  %s modem %u: %s in %" PRId64 " us\n", when, record.modemId,
+                toString(record.error).c_str(), record.latencyUs);
+    }
+
+    return Void();
+}
+
 // Helper methods follow.
-sp<IRadio> RadioConfig::getRadioForModemId(uint8_t modemId) {
-    if (mModemIdToRadioCache.find(modemId) == mModemIdToRadioCache.end() ||
-        mModemIdToRadioCache[modemId] == nullptr) {
-        mModemIdToRadioCache[modemId] = IRadio::getService("slot" + std::to_string(modemId + 1));
-        if (mModemIdToRadioCache[modemId] != nullptr) {
-            hidl_utils::linkDeathToDeath(mModemIdToRadioCache[modemId]);
+void RadioConfig::linkToRealRadioConfig() {
+    wp<RadioConfig> weakThis = this;
+    auto onDeath = [weakThis] {
+        auto radioConfig = weakThis.promote();
+        if (radioConfig != nullptr) radioConfig->onRealRadioConfigDied();
+    };
+
+    std::lock_guard<std::mutex> lock(mRealRadioConfigLock);
+    mDeathRecipients.clear();
+    mDeathRecipients.push_back(linkDeath(mRealRadioConfig, onDeath));
+    if (mRealRadioConfigV1_1 != nullptr) {
+        mDeathRecipients.push_back(linkDeath(mRealRadioConfigV1_1, onDeath));
+    }
+}
+
+void RadioConfig::onRealRadioConfigDied() {
+    // Both interfaces usually live in the same process and die together
+    if (mReconnecting.exchange(true)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mRealRadioConfigLock);
+        mRealRadioConfig = nullptr;
+        mRealRadioConfigV1_1 = nullptr;
+    }
+
+    // Death notifications arrive on the only binder thread, don't wait on it
+    sp<RadioConfig> self = this;
+    std::thread([self] { self->reconnect(); }).detach();
+}
+
+void RadioConfig::reconnect() {
+    sp<::lineage::hardware::radio::config::V1_0::IRadioConfig> realRadioConfig;
+    // getService only waits a few seconds for an instance to come up
+    while ((realRadioConfig =
+                    ::lineage::hardware::radio::config::V1_0::IRadioConfig::getService()) ==
+           nullptr) {
+        LOG(WARNING) << "Waiting for backend radio config service";
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    auto realRadioConfigV1_1 = ::lineage::hardware::radio::config::V1_1::IRadioConfig::getService();
+
+    {
+        std::lock_guard<std::mutex> lock(mRealRadioConfigLock);
+        mRealRadioConfig = realRadioConfig;
+        mRealRadioConfigV1_1 = realRadioConfigV1_1;
+    }
+    linkToRealRadioConfig();
+    mReconnecting = false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRadioConfigResponse != nullptr) {
+        auto ret = realRadioConfig->setResponseFunctions(
+                reinterpret_cast<
+                        const sp<::lineage::hardware::radio::config::V1_0::IRadioConfigResponse>&>(
+                        mRadioConfigResponse),
+                reinterpret_cast<const sp<
+                        ::lineage::hardware::radio::config::V1_0::IRadioConfigIndication>&>(
+                        mRadioConfigIndication));
+        if (!ret.isOk()) LOG(ERROR) << "setResponseFunctions failed: " << ret.description();
+    }
+
+    LOG(INFO) << "Reconnected to backend radio config service";
+}
+
+sp<::lineage::hardware::radio::config::V1_0::IRadioConfig> RadioConfig::getRealRadioConfig() {
+    std::lock_guard<std::mutex> lock(mRealRadioConfigLock);
+    return mRealRadioConfig;
+}
+
+sp<::lineage::hardware::radio::config::V1_1::IRadioConfig> RadioConfig::getRealRadioConfigV1_1() {
+    std::lock_guard<std::mutex> lock(mRealRadioConfigLock);
+    return mRealRadioConfigV1_1;
+}
+
+std::vector<sp<IRadio>> RadioConfig::getRadiosLocked() {
+    if (!mRadioNotificationRegistered) {
+        registerForRadioNotificationsLocked();
+    }
+
+    // Slots are numbered without gaps, so the first missing one ends the list.
+    // Look up all slots which aren't cached at once, so a missing one costs a
+    // single getService wait rather than one after the others.
+    if (mNumSlots < 0) {
+        std::map<uint8_t, std::future<sp<IRadio>>> lookups;
+        for (uint8_t i = 0; i < kMaxSlots; i++) {
+            if (!needsRadioLookupLocked(i)) continue;
+            lookups[i] = std::async(std::launch::async, [i] {
+                return IRadio::getService("slot" + std::to_string(i + 1));
+            });
+        }
+
+        int numSlots = 0;
+        for (uint8_t i = 0; i < kMaxSlots; i++) {
+            auto lookup = lookups.find(i);
+            if (lookup != lookups.end()) cacheRadioLocked(i, lookup->second.get());
+            if (mModemIdToRadioCache[i] == nullptr) break;
+            numSlots++;
         }
+        mNumSlots = numSlots;
+    }
+
+    std::vector<sp<IRadio>> radios;
+    for (int i = 0; i < mNumSlots; i++) {
+        radios.push_back(getRadioForModemId(i));
+    }
+    return radios;
+}
+
+void RadioConfig::registerForRadioNotificationsLocked() {
+    auto manager = ::android::hidl::manager::V1_0::IServiceManager::getService();
+    if (manager == nullptr) {
+        LOG(ERROR) << "Cannot get service manager, not caching missing slots";
+        return;
+    }
+
+    mRadioNotification = new RadioNotification(this);
+    auto ret = manager->registerForNotifications(IRadio::descriptor, "", mRadioNotification);
+    mRadioNotificationRegistered = ret.isOk() && ret;
+    if (!mRadioNotificationRegistered) {
+        LOG(ERROR) << "Cannot register for IRadio notifications, not caching missing slots";
+    }
+}
+
+void RadioConfig::invalidateRadiosLocked() {
+    mNumSlots = -1;
+    for (auto it = mModemIdToRadioCache.begin(); it != mModemIdToRadioCache.end();) {
+        it = it->second == nullptr ? mModemIdToRadioCache.erase(it) : std::next(it);
+    }
+}
+
+void RadioConfig::recordDataModemSwitchLocked(uint8_t modemId, RadioError error,
+                                              std::chrono::steady_clock::duration latency) {
+    if (mDataModemSwitches.size() == kMaxDataModemSwitches) {
+        mDataModemSwitches.pop_front();
+    }
+    mDataModemSwitches.push_back({
+            .when = time(nullptr),
+            .modemId = modemId,
+            .error = error,
+            .latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count(),
+    });
+}
+
+Return<void> RadioConfig::RadioNotification::onRegistration(const hidl_string& /* fqName */,
+                                                            const hidl_string& /* name */,
+                                                            bool /* preexisting */) {
+    auto radioConfig = mRadioConfig.promote();
+    if (radioConfig != nullptr) {
+        std::lock_guard<std::mutex> lock(radioConfig->mMutex);
+        radioConfig->invalidateRadiosLocked();
+    }
+    return Void();
+}
+
+sp<IRadio> RadioConfig::getRadioForModemId(uint8_t modemId) {
+    if (needsRadioLookupLocked(modemId)) {
+        cacheRadioLocked(modemId, IRadio::getService("slot" + std::to_string(modemId + 1)));
     }
 
     return mModemIdToRadioCache[modemId];
 }
 
+bool RadioConfig::needsRadioLookupLocked(uint8_t modemId) {
+    // Missing slots are remembered too, until a new IRadio registers
+    auto radio = mModemIdToRadioCache.find(modemId);
+    return radio == mModemIdToRadioCache.end() ||
+           (radio->second == nullptr && !mRadioNotificationRegistered);
+}
+
+void RadioConfig::cacheRadioLocked(uint8_t modemId, const sp<IRadio>& radio) {
+    mModemIdToRadioCache[modemId] = radio;
+    if (radio != nullptr && mReconnect) {
+        // Fetched again on next use
+        wp<RadioConfig> weakThis = this;
+        mModemIdToDeathRecipient[modemId] = linkDeath(radio, [weakThis, modemId] {
+            auto radioConfig = weakThis.promote();
+            if (radioConfig == nullptr) return;
+            std::lock_guard<std::mutex> lock(radioConfig->mMutex);
+            radioConfig->mModemIdToRadioCache.erase(modemId);
+        });
+    } else if (radio != nullptr) {
+        hidl_utils::linkDeathToDeath(radio);
+    }
+}
+
 RadioResponseInfo RadioConfig::getUnimplementedResponseInfo(int32_t serial) {
     return {
             RadioResponseType::SOLICITED,
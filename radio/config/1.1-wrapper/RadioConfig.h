@@ -10,19 +10,28 @@
 #include <android/hardware/radio/config/1.0/IRadioConfig.h>
 #include <android/hardware/radio/config/1.1/IRadioConfig.h>
 #include <android/hardware/radio/config/1.1/IRadioConfigResponse.h>
+#include <android/hidl/manager/1.0/IServiceNotification.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <lineage/hardware/radio/config/1.1/IRadioConfig.h>
 #include <lineage/hardware/radio/config/1.1/IRadioConfigIndication.h>
 #include <lineage/hardware/radio/config/1.1/IRadioConfigResponse.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <mutex>
+#include <vector>
+
+#include <time.h>
 
 namespace android::hardware::radio::config::implementation {
 
 using ::android::sp;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_death_recipient;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -51,19 +60,71 @@ struct RadioConfig : public V1_1::IRadioConfig {
             const ::android::hardware::radio::config::V1_1::ModemsConfig& modemsConfig) override;
     Return<void> getModemsConfig(int32_t serial) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& args) override;
+
+    // Waits for the backend to come back when it dies instead of taking this
+    // process down with it
+    void reconnectOnDeath();
+
   private:
+    // Guards the backend interfaces, which are replaced after a reconnect
+    std::mutex mRealRadioConfigLock;
     sp<::lineage::hardware::radio::config::V1_0::IRadioConfig> mRealRadioConfig;
     sp<::lineage::hardware::radio::config::V1_1::IRadioConfig> mRealRadioConfigV1_1;
 
     sp<::android::hardware::radio::config::V1_0::IRadioConfigResponse> mRadioConfigResponse;
     sp<::android::hardware::radio::config::V1_1::IRadioConfigResponse> mRadioConfigResponseV1_1;
+    sp<::android::hardware::radio::config::V1_0::IRadioConfigIndication> mRadioConfigIndication;
 
     std::map<uint8_t, sp<::android::hardware::radio::V1_0::IRadio>> mModemIdToRadioCache;
+    std::map<uint8_t, sp<hidl_death_recipient>> mModemIdToDeathRecipient;
+    // Number of slots, -1 until probed again after a new IRadio registered
+    int mNumSlots = -1;
+    static constexpr uint8_t kMaxSlots = 4;
+
+    struct RadioNotification : public ::android::hidl::manager::V1_0::IServiceNotification {
+        explicit RadioNotification(const wp<RadioConfig>& radioConfig)
+            : mRadioConfig(radioConfig) {}
+        Return<void> onRegistration(const hidl_string& fqName, const hidl_string& name,
+                                    bool preexisting) override;
+
+        wp<RadioConfig> mRadioConfig;
+    };
+    sp<RadioNotification> mRadioNotification;
+    bool mRadioNotificationRegistered = false;
+
+    struct DataModemSwitch {
+        time_t when;
+        uint8_t modemId;
+        ::android::hardware::radio::V1_0::RadioError error;
+        int64_t latencyUs;
+    };
+    static constexpr size_t kMaxDataModemSwitches = 16;
+    std::deque<DataModemSwitch> mDataModemSwitches;
 
     std::mutex mMutex;
 
+    bool mReconnect = false;
+    std::atomic<bool> mReconnecting = false;
+    std::vector<sp<hidl_death_recipient>> mDeathRecipients;
+
     // Helper methods follow.
+    void linkToRealRadioConfig();
+    void onRealRadioConfigDied();
+    void reconnect();
+    sp<::lineage::hardware::radio::config::V1_0::IRadioConfig> getRealRadioConfig();
+    sp<::lineage::hardware::radio::config::V1_1::IRadioConfig> getRealRadioConfigV1_1();
+    std::vector<sp<::android::hardware::radio::V1_0::IRadio>> getRadiosLocked();
+    void registerForRadioNotificationsLocked();
+    void invalidateRadiosLocked();
+    void recordDataModemSwitchLocked(uint8_t modemId,
+                                     ::android::hardware::radio::V1_0::RadioError error,
+                                     std::chrono::steady_clock::duration latency);
     sp<::android::hardware::radio::V1_0::IRadio> getRadioForModemId(uint8_t modemId);
+    bool needsRadioLookupLocked(uint8_t modemId);
+    void cacheRadioLocked(uint8_t modemId,
+                          const sp<::android::hardware::radio::V1_0::IRadio>& radio);
     ::android::hardware::radio::V1_0::RadioResponseInfo getUnimplementedResponseInfo(
             int32_t serial);
 };
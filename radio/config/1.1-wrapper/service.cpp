@@ -7,11 +7,14 @@
 #define LOG_TAG "android.hardware.radio.config@1.1-service.wrapper"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <hidl/HidlTransportSupport.h>
 
 #include "RadioConfig.h"
 #include "hidl-utils.h"
 
+#include <future>
+
 using namespace android::hardware::hidl_utils;
 
 using android::hardware::configureRpcThreadpool;
@@ -24,21 +27,28 @@ using android::sp;
 using android::status_t;
 
 int main() {
+    // The optional V1.1 lookup may have to time out, don't wait for it after V1.0
+    auto realRadioConfigV1_1Lookup = std::async(std::launch::async, [] {
+        return lineage::hardware::radio::config::V1_1::IRadioConfig::getService();
+    });
+
     sp<lineage::hardware::radio::config::V1_0::IRadioConfig> realRadioConfig =
             lineage::hardware::radio::config::V1_0::IRadioConfig::getService();
     CHECK(realRadioConfig) << "Cannot get backend radio config V1.0 service.";
-    linkDeathToDeath(realRadioConfig);
+    bool reconnect =
+            android::base::GetBoolProperty("persist.vendor.radio.reconnect_on_death", false);
+    if (!reconnect) linkDeathToDeath(realRadioConfig);
 
     sp<lineage::hardware::radio::config::V1_1::IRadioConfig> realRadioConfigV1_1 =
-            lineage::hardware::radio::config::V1_1::IRadioConfig::getService();
+            realRadioConfigV1_1Lookup.get();
     if (realRadioConfigV1_1 == nullptr) {
         LOG(ERROR) << "Cannot get backend radio config V1.1 service (not fatal).";
-    } else {
+    } else if (!reconnect) {
         linkDeathToDeath(realRadioConfigV1_1);
     }
 
-    sp<android::hardware::radio::config::V1_1::IRadioConfig> radioConfig =
-            new RadioConfig(realRadioConfig, realRadioConfigV1_1);
+    sp<RadioConfig> radioConfig = new RadioConfig(realRadioConfig, realRadioConfigV1_1);
+    if (reconnect) radioConfig->reconnectOnDeath();
 
     configureRpcThreadpool(1, true);
 
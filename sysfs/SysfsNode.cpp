@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "libsysfsnode"
+
+#include "sysfsnode/SysfsNode.h"
+
+#include <android-base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+SysfsNode::SysfsNode(std::string path, int flags) : mPath(std::move(path)), mFlags(flags) {
+    mMissing = !open() && (mFlags & kOptional);
+}
+
+bool SysfsNode::open() {
+    int mode = (mFlags & kReadable) && (mFlags & kWritable) ? O_RDWR
+               : (mFlags & kWritable)                      ? O_WRONLY
+                                                           : O_RDONLY;
+    mFd.reset(TEMP_FAILURE_RETRY(::open(mPath.c_str(), mode | O_CLOEXEC)));
+    return mFd.ok();
+}
+
+bool SysfsNode::read(std::string* value) {
+    char buf[kMaxValueLength];
+    ssize_t len = readBuf(buf, sizeof(buf));
+    if (len < 0) {
+        return false;
+    }
+    value->assign(buf, strcspn(buf, "\n"));
+    return true;
+}
+
+ssize_t SysfsNode::readBuf(char* buf, size_t len) {
+    if (mMissing) {
+        errno = ENOENT;
+        return -1;
+    }
+    // A cached fd may belong to a device that went away and came back
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!mFd.ok() && !open()) {
+            break;
+        }
+        ssize_t n = TEMP_FAILURE_RETRY(pread(mFd.get(), buf, len - 1, 0));
+        if (n >= 0) {
+            buf[n] = '\0';
+            return n;
+        }
+        if (errno != ENODEV) {
+            break;
+        }
+        mFd.reset();
+    }
+
+    PLOG(ERROR) << "Failed to read " << mPath;
+    return -1;
+}
+
+bool SysfsNode::writeBuf(const char* buf, size_t len) {
+    if (mMissing) {
+        errno = ENOENT;
+        return false;
+    }
+    bool skipRedundant = mFlags & kSkipRedundantWrites;
+    if (skipRedundant && mLastValid && mLast == std::string_view(buf, len)) {
+        return true;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!mFd.ok() && !open()) {
+            break;
+        }
+        if (TEMP_FAILURE_RETRY(pwrite(mFd.get(), buf, len, 0)) == static_cast<ssize_t>(len)) {
+            if (skipRedundant) {
+                mLast.assign(buf, len);
+                mLastValid = true;
+            }
+            return true;
+        }
+        if (errno != ENODEV) {
+            break;
+        }
+        mFd.reset();
+    }
+
+    PLOG(ERROR) << "Failed to write " << std::string_view(buf, len) << " to " << mPath;
+    // The node state is unknown now, make sure the next write goes out
+    mLastValid = false;
+    return false;
+}
+
+bool SysfsNode::waitForChange(int timeoutMs) {
+    if (mMissing || (!mFd.ok() && !open())) {
+        return false;
+    }
+    struct pollfd pfd = {.fd = mFd.get(), .events = POLLPRI | POLLERR};
+    return TEMP_FAILURE_RETRY(poll(&pfd, 1, timeoutMs)) > 0 && (pfd.revents & (POLLPRI | POLLERR));
+}
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
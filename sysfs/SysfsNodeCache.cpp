@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sysfsnode/SysfsNodeCache.h"
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+SysfsNode& SysfsNodeCache::nodeLocked(std::unordered_map<std::string, SysfsNode>& nodes,
+                                      const std::string& path, int flags) {
+    auto it = nodes.find(path);
+    if (it == nodes.end()) {
+        it = nodes.emplace(path, SysfsNode(path, flags)).first;
+    }
+    return it->second;
+}
+
+bool SysfsNodeCache::read(const std::string& path, std::string* value) {
+    std::lock_guard<std::mutex> lock(mLock);
+    return nodeLocked(mReadNodes, path, SysfsNode::kReadable).read(value);
+}
+
+bool SysfsNodeCache::write(const std::string& path, std::string_view value) {
+    std::lock_guard<std::mutex> lock(mLock);
+    return nodeLocked(mWriteNodes, path, SysfsNode::kWritable).write(value);
+}
+
+bool SysfsNodeCache::canWrite(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mLock);
+    SysfsNode& node = nodeLocked(mWriteNodes, path, SysfsNode::kWritable);
+    if (!node.isOpen()) {
+        // The attribute may have shown up since it was last tried
+        node = SysfsNode(path, SysfsNode::kWritable);
+    }
+    return node.isOpen();
+}
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
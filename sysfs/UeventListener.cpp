@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "libsysfsnode"
+
+#include "sysfsnode/UeventListener.h"
+
+#include <android-base/logging.h>
+#include <cutils/uevent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+static constexpr int kUeventBufferSize = 64 * 1024;
+static constexpr size_t kUeventMsgLen = 2048;
+
+UeventListener::UeventListener()
+    : mFd(uevent_open_socket(kUeventBufferSize, true)),
+      mWakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (!mFd.ok()) {
+        PLOG(ERROR) << "Failed to open uevent socket";
+        return;
+    }
+    fcntl(mFd.get(), F_SETFL, O_NONBLOCK);
+}
+
+bool UeventListener::waitForPowerSupplyEvent(int timeoutMs, int extraFd) {
+    struct pollfd fds[3] = {
+            {.fd = mFd.get(), .events = POLLIN},
+            {.fd = mWakeFd.get(), .events = POLLIN},
+            {.fd = extraFd, .events = POLLIN},
+    };
+    if (TEMP_FAILURE_RETRY(poll(fds, extraFd >= 0 ? 3 : 2, timeoutMs)) <= 0) {
+        return false;
+    }
+    if (fds[1].revents & POLLIN) {
+        uint64_t val;
+        read(mWakeFd.get(), &val, sizeof(val));
+        return false;
+    }
+
+    // Drain everything queued, a single battery update usually comes with several events
+    bool matched = false;
+    char msg[kUeventMsgLen + 2];
+    ssize_t n;
+    while ((n = uevent_kernel_multicast_recv(mFd.get(), msg, kUeventMsgLen)) > 0) {
+        msg[n] = '\0';
+        msg[n + 1] = '\0';
+        for (const char* cp = msg; *cp; cp += strlen(cp) + 1) {
+            if (!strcmp(cp, "SUBSYSTEM=power_supply")) {
+                matched = true;
+                break;
+            }
+        }
+    }
+
+    return matched;
+}
+
+void UeventListener::wake() {
+    uint64_t val = 1;
+    write(mWakeFd.get(), &val, sizeof(val));
+}
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
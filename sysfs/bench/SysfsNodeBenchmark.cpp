@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Compares SysfsNode with opening the file on every access, the way the HALs
+// did before, against real sysfs attributes and files on a tmpfs.
+//
+// Reads use a read-only attribute every kernel has. Writes to real sysfs only
+// run when $SYSFS_BENCH_WRITE_NODE names a writable attribute which reads back
+// what it accepts, its current value then gets written back. Tmpfs files are made under $SYSFS_BENCH_DIR,
+// else /dev on device or /tmp on the host.
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <sysfsnode/SysfsNode.h>
+#include <unistd.h>
+
+#include <string>
+
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+using ::vendor::lineage::sysfs::SysfsNode;
+
+namespace {
+
+constexpr char kRealReadNode[] = "/sys/devices/system/cpu/online";
+
+void BM_SysfsNodeRead(benchmark::State& state, std::string path) {
+    SysfsNode node(path, SysfsNode::kReadable);
+    std::string value;
+    for (auto _ : state) {
+        if (!node.read(&value)) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+}
+
+void BM_ReadFileToString(benchmark::State& state, std::string path) {
+    std::string value;
+    for (auto _ : state) {
+        if (!ReadFileToString(path, &value)) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+}
+
+// Alternates between two values, which the real node can't offer safely
+void BM_SysfsNodeWrite(benchmark::State& state, std::string path, std::string a, std::string b) {
+    SysfsNode node(path, SysfsNode::kWritable);
+    bool flip = false;
+    for (auto _ : state) {
+        if (!node.write((flip = !flip) ? a : b)) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+}
+
+void BM_WriteStringToFile(benchmark::State& state, std::string path, std::string a,
+                          std::string b) {
+    bool flip = false;
+    for (auto _ : state) {
+        if (!WriteStringToFile((flip = !flip) ? a : b, path)) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+}
+
+void BM_SysfsNodeRedundantWrite(benchmark::State& state, std::string path) {
+    SysfsNode node(path, SysfsNode::kWritable | SysfsNode::kSkipRedundantWrites);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(node.write(1));
+    }
+}
+
+// A light without that LED, which every update still writes to
+void BM_SysfsNodeMissingOptionalWrite(benchmark::State& state, std::string path) {
+    SysfsNode node(path, SysfsNode::kWritable | SysfsNode::kOptional);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(node.write(1));
+    }
+}
+
+// Files on a tmpfs, removed again at exit
+class TmpfsDir {
+  public:
+    TmpfsDir() {
+        const char* base = getenv("SYSFS_BENCH_DIR");
+#ifdef __ANDROID__
+        mDir = base ? base : "/dev";
+#else
+        mDir = base ? base : "/tmp";
+#endif
+        mDir += "/sysfsnode-bench.XXXXXX";
+        CHECK(mkdtemp(mDir.data()) != nullptr) << "Cannot create " << mDir;
+        mNode = mDir + "/value";
+        CHECK(WriteStringToFile("0\n", mNode)) << "Cannot create " << mNode;
+    }
+    ~TmpfsDir() {
+        unlink(mNode.c_str());
+        rmdir(mDir.c_str());
+    }
+
+    const std::string& dir() const { return mDir; }
+    const std::string& node() const { return mNode; }
+
+  private:
+    std::string mDir;
+    std::string mNode;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    TmpfsDir tmpfs;
+
+    benchmark::RegisterBenchmark("BM_SysfsNodeRead/real", BM_SysfsNodeRead, kRealReadNode);
+    benchmark::RegisterBenchmark("BM_ReadFileToString/real", BM_ReadFileToString, kRealReadNode);
+    benchmark::RegisterBenchmark("BM_SysfsNodeRead/tmpfs", BM_SysfsNodeRead, tmpfs.node());
+    benchmark::RegisterBenchmark("BM_ReadFileToString/tmpfs", BM_ReadFileToString, tmpfs.node());
+
+    if (const char* writeNode = getenv("SYSFS_BENCH_WRITE_NODE")) {
+        std::string value;
+        if (ReadFileToString(writeNode, &value)) {
+            value = ::android::base::Trim(value);
+            benchmark::RegisterBenchmark("BM_SysfsNodeWrite/real", BM_SysfsNodeWrite, writeNode,
+                                         value, value);
+            benchmark::RegisterBenchmark("BM_WriteStringToFile/real", BM_WriteStringToFile,
+                                         writeNode, value, value);
+        } else {
+            PLOG(ERROR) << "Cannot read " << writeNode << ", skipping real writes";
+        }
+    }
+    benchmark::RegisterBenchmark("BM_SysfsNodeWrite/tmpfs", BM_SysfsNodeWrite, tmpfs.node(), "0",
+                                 "255");
+    benchmark::RegisterBenchmark("BM_WriteStringToFile/tmpfs", BM_WriteStringToFile, tmpfs.node(),
+                                 "0", "255");
+    benchmark::RegisterBenchmark("BM_SysfsNodeRedundantWrite/tmpfs", BM_SysfsNodeRedundantWrite,
+                                 tmpfs.node());
+    benchmark::RegisterBenchmark("BM_SysfsNodeMissingOptionalWrite",
+                                 BM_SysfsNodeMissingOptionalWrite, tmpfs.dir() + "/missing");
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <sys/types.h>
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+// A sysfs attribute kept open for its lifetime. Sysfs regenerates an
+// attribute on every access from offset 0, so a read is one pread() and a
+// write one pwrite(), both from a stack buffer. An fd of a device that went
+// away fails with ENODEV and is reopened once, a node which couldn't be
+// opened yet is retried on its next use unless it is kOptional.
+//
+// Not thread safe, callers sharing a node serialize access to it.
+class SysfsNode {
+  public:
+    static constexpr int kReadable = 1 << 0;
+    static constexpr int kWritable = 1 << 1;
+    // Remembers the last value written and skips writing it again. Only for
+    // nodes nothing but this process changes, see invalidate().
+    static constexpr int kSkipRedundantWrites = 1 << 2;
+    // The node may not exist on every device. If the constructor can't open
+    // it, it is never retried and using it fails without logging.
+    static constexpr int kOptional = 1 << 3;
+
+    // Longest value read or formatted, longer reads are truncated
+    static constexpr size_t kMaxValueLength = 256;
+
+    SysfsNode() = default;
+    SysfsNode(std::string path, int flags);
+
+    const std::string& path() const { return mPath; }
+    bool isOpen() const { return mFd.ok(); }
+    // Whether this is a kOptional node the device doesn't have
+    bool isMissing() const { return mMissing; }
+
+    // Reads the first line, without the newline
+    bool read(std::string* value);
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    bool read(T* value) {
+        char buf[kMaxValueLength];
+        ssize_t len = readBuf(buf, sizeof(buf));
+        if (len < 0) return false;
+        const char* begin = buf;
+        const char* end = buf + len;
+        while (begin != end && *begin == ' ') begin++;
+        while (end != begin && (end[-1] == '\n' || end[-1] == ' ')) end--;
+        auto [ptr, ec] = std::from_chars(begin, end, *value);
+        return ec == std::errc() && ptr == end;
+    }
+
+    bool write(std::string_view value) { return writeBuf(value.data(), value.size()); }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    bool write(T value) {
+        char buf[24];
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        return writeBuf(buf, ptr - buf);
+    }
+
+    // Whether a write of value would be skipped as redundant
+    bool isCurrent(std::string_view value) const { return mLastValid && mLast == value; }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    bool isCurrent(T value) const {
+        char buf[24];
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        return isCurrent(std::string_view(buf, ptr - buf));
+    }
+    // Forgets the last value written, e.g. once the driver may have changed it
+    void invalidate() { mLastValid = false; }
+
+    // Waits up to timeoutMs, or forever if negative, for the driver to
+    // sysfs_notify() the attribute. Only attributes whose driver does that
+    // ever return true; the node must have been read since the last change.
+    bool waitForChange(int timeoutMs);
+
+  private:
+    bool open();
+    ssize_t readBuf(char* buf, size_t len);
+    bool writeBuf(const char* buf, size_t len);
+
+    android::base::unique_fd mFd;
+    std::string mPath;
+    int mFlags = 0;
+    // last value written, valid only with kSkipRedundantWrites
+    std::string mLast;
+    bool mLastValid = false;
+    bool mMissing = false;
+};
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <sysfsnode/SysfsNode.h>
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+// SysfsNodes by path, for attributes whose paths are only known at runtime,
+// e.g. one per port. Each path is opened on its first use and stays open.
+// Thread safe.
+class SysfsNodeCache {
+  public:
+    // Reads the first line of path, without the newline
+    bool read(const std::string& path, std::string* value);
+    bool write(const std::string& path, std::string_view value);
+    // Whether path can be opened for writing; keeps the node for write()
+    bool canWrite(const std::string& path);
+
+  private:
+    SysfsNode& nodeLocked(std::unordered_map<std::string, SysfsNode>& nodes,
+                          const std::string& path, int flags);
+
+    std::mutex mLock;
+    // Sysfs attributes can be read or write only, so the two are kept apart
+    std::unordered_map<std::string, SysfsNode> mReadNodes;   // protected by mLock
+    std::unordered_map<std::string, SysfsNode> mWriteNodes;  // protected by mLock
+};
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+namespace vendor {
+namespace lineage {
+namespace sysfs {
+
+// Kernel uevent socket filtered to the power_supply subsystem
+class UeventListener {
+  public:
+    UeventListener();
+
+    bool ok() const { return mFd.ok(); }
+
+    // Waits up to timeoutMs, or forever if negative, for power_supply uevents.
+    // Returns true if at least one arrived, false on timeout or wake(). Also
+    // returns once extraFd, e.g. a timerfd, is readable; reading it is left
+    // to the caller.
+    bool waitForPowerSupplyEvent(int timeoutMs, int extraFd = -1);
+    // Makes a pending or the next waitForPowerSupplyEvent() return early
+    void wake();
+
+  private:
+    android::base::unique_fd mFd;
+    android::base::unique_fd mWakeFd;
+};
+
+}  // namespace sysfs
+}  // namespace lineage
+}  // namespace vendor
@@ -19,20 +19,24 @@
 #include <android-base/logging.h>
 #include <assert.h>
 #include <chrono>
+#include <ctype.h>
 #include <dirent.h>
+#include <inttypes.h>
 #include <pthread.h>
-#include <regex>
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <thread>
+#include <time.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <vector>
 
-#include <cutils/uevent.h>
-#include <sys/epoll.h>
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
 
+#include <sysfsnode/SysfsNodeCache.h>
+
 #include "Usb.h"
 
 namespace android {
@@ -44,53 +48,19 @@ namespace implementation {
 const char GOOGLE_USB_VENDOR_ID_STR[] = "18d1";
 const char GOOGLE_USBC_35_ADAPTER_UNPLUGGED_ID_STR[] = "5029";
 
-// Set by the signal handler to destroy the thread
-volatile bool destroyThread;
-
 static void checkUsbDeviceAutoSuspend(const std::string& devicePath);
+static void uevent_event(Usb *usb, const char *msg);
 
-static int32_t readFile(const std::string &filename, std::string *contents) {
-  FILE *fp;
-  ssize_t read = 0;
-  char *line = NULL;
-  size_t len = 0;
-
-  fp = fopen(filename.c_str(), "r");
-  if (fp != NULL) {
-    if ((read = getline(&line, &len, fp)) != -1) {
-      char *pos;
-      if ((pos = strchr(line, '\n')) != NULL) *pos = '\0';
-      *contents = line;
-    }
-    free(line);
-    fclose(fp);
-    return 0;
-  } else {
-    ALOGE("fopen failed in readFile %s, errno=%d", filename.c_str(), errno);
-  }
+// Role nodes are read on every port query, keep them open
+static ::vendor::lineage::sysfs::SysfsNodeCache sysfsNodes;
 
-  return -1;
+static int32_t readFile(const std::string &filename, std::string *contents) {
+  return sysfsNodes.read(filename, contents) ? 0 : -1;
 }
 
 static int32_t writeFile(const std::string &filename,
                          const std::string &contents) {
-  FILE *fp;
-  int ret;
-
-  fp = fopen(filename.c_str(), "w");
-  if (fp != NULL) {
-    ret = fputs(contents.c_str(), fp);
-    fclose(fp);
-    if (ret == EOF) {
-      ALOGE("fputs failed in writeFile %s", filename.c_str());
-      return -1;
-    }
-    return 0;
-  } else {
-    ALOGE("fopen failed in writeFile %s, errno=%d", filename.c_str(), errno);
-  }
-
-  return -1;
+  return sysfsNodes.write(filename, contents) ? 0 : -1;
 }
 
 std::string appendRoleNodeHelper(const std::string &portName,
@@ -140,29 +110,38 @@ void extractRole(std::string *roleName) {
 void switchToDrp(const std::string &portName) {
   std::string filename =
       appendRoleNodeHelper(std::string(portName.c_str()), PortRoleType::MODE);
-  FILE *fp;
 
   if (filename != "") {
-    fp = fopen(filename.c_str(), "w");
-    if (fp != NULL) {
-      int ret = fputs("dual", fp);
-      fclose(fp);
-      if (ret == EOF)
-        ALOGE("Fatal: Error while switching back to drp");
-    } else {
-      ALOGE("Fatal: Cannot open file to switch back to drp");
-    }
+    if (writeFile(filename, "dual"))
+      ALOGE("Fatal: Error while switching back to drp");
   } else {
     ALOGE("Fatal: invalid node type");
   }
 }
 
+Status getCurrentRoleHelper(const std::string &portName, bool connected,
+                            PortRoleType type, uint32_t *currentRole);
+
+/*
+ * The mode switch is done once the partner is back and the port reports
+ * the requested mode.
+ */
+static bool modeSwitchConfirmed(const std::string &portName, const PortRole &newRole) {
+  uint32_t currentRole;
+
+  if (access(("/sys/class/typec/" + portName + "-partner").c_str(), F_OK))
+    return false;
+
+  return getCurrentRoleHelper(portName, true, PortRoleType::MODE, &currentRole) ==
+             Status::SUCCESS &&
+         currentRole == newRole.role;
+}
+
 bool switchMode(const hidl_string &portName,
                              const PortRole &newRole, struct Usb *usb) {
   std::string filename =
        appendRoleNodeHelper(std::string(portName.c_str()), newRole.type);
   std::string written;
-  FILE *fp;
   bool roleSwitch = false;
 
   if (filename == "") {
@@ -170,39 +149,40 @@ bool switchMode(const hidl_string &portName,
     return false;
   }
 
-  fp = fopen(filename.c_str(), "w");
-  if (fp != NULL) {
-    // Hold the lock here to prevent loosing connected signals
-    // as once the file is written the partner added signal
-    // can arrive anytime.
+  if (sysfsNodes.canWrite(filename)) {
+    // Hold the lock here to prevent loosing port signals
+    // as once the file is written the uevents can arrive anytime.
     pthread_mutex_lock(&usb->mPartnerLock);
-    usb->mPartnerUp = false;
-    int ret = fputs(convertRoletoString(newRole).c_str(), fp);
-    fclose(fp);
-
-    if (ret != EOF) {
-      struct timespec   to;
-      struct timespec   now;
-
-wait_again:
-      clock_gettime(CLOCK_MONOTONIC, &now);
-      to.tv_sec = now.tv_sec + PORT_TYPE_TIMEOUT;
-      to.tv_nsec = now.tv_nsec;
-
-      int err = pthread_cond_timedwait(&usb->mPartnerCV, &usb->mPartnerLock, &to);
-      // There are no uevent signals which implies role swap timed out.
-      if (err == ETIMEDOUT) {
-        ALOGI("uevents wait timedout");
-      // Sanity check.
-      } else if (!usb->mPartnerUp) {
-        goto wait_again;
-      // Role switch succeeded since usb->mPartnerUp is true.
-      } else {
-        roleSwitch = true;
+    usb->mSwapPort = portName;
+    usb->mSwapEvent = false;
+
+    if (!writeFile(filename, convertRoletoString(newRole))) {
+      struct timespec to;
+
+      clock_gettime(CLOCK_MONOTONIC, &to);
+      to.tv_sec += PORT_TYPE_TIMEOUT;
+
+      while (true) {
+        // Check sysfs without the lock, an event arriving meanwhile sets mSwapEvent
+        pthread_mutex_unlock(&usb->mPartnerLock);
+        roleSwitch = modeSwitchConfirmed(portName, newRole);
+        pthread_mutex_lock(&usb->mPartnerLock);
+        if (roleSwitch) break;
+
+        int err = 0;
+        while (!usb->mSwapEvent && err != ETIMEDOUT)
+          err = pthread_cond_timedwait(&usb->mPartnerCV, &usb->mPartnerLock, &to);
+        // There are no uevent signals which implies role swap timed out.
+        if (!usb->mSwapEvent) {
+          ALOGI("uevents wait timedout");
+          break;
+        }
+        usb->mSwapEvent = false;
       }
     } else {
       ALOGI("Role switch failed while wrting to file");
     }
+    usb->mSwapPort.clear();
     pthread_mutex_unlock(&usb->mPartnerLock);
   }
 
@@ -216,7 +196,9 @@ Usb::Usb()
         : mLock(PTHREAD_MUTEX_INITIALIZER),
           mRoleSwitchLock(PTHREAD_MUTEX_INITIALIZER),
           mPartnerLock(PTHREAD_MUTEX_INITIALIZER),
-          mPartnerUp(false) {
+          mSwapEvent(false),
+          mPortsValid(false),
+          mUevents({"typec", "usb"}, [this](const char *msg) { uevent_event(this, msg); }) {
     pthread_condattr_t attr;
     if (pthread_condattr_init(&attr)) {
         ALOGE("pthread_condattr_init failed: %s", strerror(errno));
@@ -234,6 +216,9 @@ Usb::Usb()
         ALOGE("pthread_condattr_destroy failed: %s", strerror(errno));
         abort();
     }
+
+    // Lives as long as the service
+    std::thread(&Usb::notifyLoop, this).detach();
 }
 
 
@@ -242,7 +227,6 @@ Return<void> Usb::switchRole(const hidl_string &portName,
   std::string filename =
       appendRoleNodeHelper(std::string(portName.c_str()), newRole.type);
   std::string written;
-  FILE *fp;
   bool roleSwitch = false;
 
   if (filename == "") {
@@ -251,6 +235,7 @@ Return<void> Usb::switchRole(const hidl_string &portName,
   }
 
   pthread_mutex_lock(&mRoleSwitchLock);
+  auto start = std::chrono::steady_clock::now();
 
   ALOGI("filename write: %s role:%s", filename.c_str(),
         convertRoletoString(newRole).c_str());
@@ -258,42 +243,69 @@ Return<void> Usb::switchRole(const hidl_string &portName,
   if (newRole.type == PortRoleType::MODE) {
       roleSwitch = switchMode(portName, newRole, this);
   } else {
-    fp = fopen(filename.c_str(), "w");
-    if (fp != NULL) {
-      int ret = fputs(convertRoletoString(newRole).c_str(), fp);
-      fclose(fp);
-      if ((ret != EOF) && !readFile(filename, &written)) {
-        extractRole(&written);
-        ALOGI("written: %s", written.c_str());
-        if (written == convertRoletoString(newRole)) {
-          roleSwitch = true;
-        } else {
-          ALOGE("Role switch failed");
-        }
+    if (!writeFile(filename, convertRoletoString(newRole)) &&
+        !readFile(filename, &written)) {
+      extractRole(&written);
+      ALOGI("written: %s", written.c_str());
+      if (written == convertRoletoString(newRole)) {
+        roleSwitch = true;
       } else {
-        ALOGE("failed to update the new role");
+        ALOGE("Role switch failed");
       }
     } else {
-      ALOGE("fopen failed");
+      ALOGE("failed to update the new role");
     }
   }
 
+  recordRoleSwitch(portName, newRole, roleSwitch,
+                   std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start).count());
+
   pthread_mutex_lock(&mLock);
-  if (mCallback_1_0 != NULL) {
+  sp<V1_0::IUsbCallback> callback = mCallback_1_0;
+  pthread_mutex_unlock(&mLock);
+
+  if (callback != NULL) {
     Return<void> ret =
-        mCallback_1_0->notifyRoleSwitchStatus(portName, newRole,
+        callback->notifyRoleSwitchStatus(portName, newRole,
         roleSwitch ? Status::SUCCESS : Status::ERROR);
     if (!ret.isOk())
       ALOGE("RoleSwitchStatus error %s", ret.description().c_str());
   } else {
     ALOGE("Not notifying the userspace. Callback is not set");
   }
-  pthread_mutex_unlock(&mLock);
   pthread_mutex_unlock(&mRoleSwitchLock);
 
   return Void();
 }
 
+void Usb::recordRoleSwitch(const std::string &portName, const PortRole &role,
+                           bool success, int64_t latencyMs) {
+  static constexpr size_t kMaxRoleSwitchRecords = 16;
+  std::lock_guard<std::mutex> lock(mRoleSwitchHistoryLock);
+
+  mRoleSwitchHistory.push_back(
+      {portName, convertRoletoString(role), success, latencyMs, time(nullptr)});
+  if (mRoleSwitchHistory.size() > kMaxRoleSwitchRecords)
+    mRoleSwitchHistory.pop_front();
+}
+
+Return<void> Usb::debug(const hidl_handle &handle, const hidl_vec<hidl_string> & /*args*/) {
+  if (handle == nullptr || handle->numFds < 1) return Void();
+  int fd = handle->data[0];
+
+  std::lock_guard<std::mutex> lock(mRoleSwitchHistoryLock);
+  dprintf(fd, "Recent role switches:\n");
+  for (const auto &record : mRoleSwitchHistory) {
+    char when[32];
+    strftime(when, sizeof(when), "%m-%d %H:%M:%S", localtime(&record.when));
+    dprintf(fd, "  %s %s -> %s: %s in %" PRId64 " ms\n", when, record.portName.c_str(),
+            record.role.c_str(), record.success ? "done" : "failed", record.latencyMs);
+  }
+
+  return Void();
+}
+
 Status getAccessoryConnected(const std::string &portName, std::string *accessory) {
   std::string filename =
     "/sys/class/typec/" + portName + "-partner/accessory_mode";
@@ -417,109 +429,189 @@ bool canSwitchRoleHelper(const std::string &portName, PortRoleType /*type*/) {
   return false;
 }
 
+static Status readPortState(const std::string &portName, bool connected,
+                            PortState *state) {
+  uint32_t currentRole;
+
+  ALOGI("%s", portName.c_str());
+  state->connected = connected;
+
+  if (getCurrentRoleHelper(portName, connected, PortRoleType::POWER_ROLE,
+                           &currentRole) != Status::SUCCESS) {
+    ALOGE("Error while retreiving portNames");
+    return Status::ERROR;
+  }
+  state->powerRole = static_cast<PortPowerRole>(currentRole);
+
+  if (getCurrentRoleHelper(portName, connected, PortRoleType::DATA_ROLE,
+                           &currentRole) != Status::SUCCESS) {
+    ALOGE("Error while retreiving current port role");
+    return Status::ERROR;
+  }
+  state->dataRole = static_cast<PortDataRole>(currentRole);
+
+  if (getCurrentRoleHelper(portName, connected, PortRoleType::MODE,
+                           &currentRole) != Status::SUCCESS) {
+    ALOGE("Error while retreiving current data role");
+    return Status::ERROR;
+  }
+  state->mode = static_cast<PortMode_1_1>(currentRole);
+
+  // canSwitchRoleHelper only depends on the partner supporting PD
+  state->supportsPD =
+      connected ? canSwitchRoleHelper(portName, PortRoleType::DATA_ROLE) : false;
+
+  return Status::SUCCESS;
+}
+
 /*
- * Reuse the same method for both V1_0 and V1_1 callback objects.
- * The caller of this method would reconstruct the V1_0::PortStatus
- * object if required.
+ * Rebuilds the whole port cache from sysfs. Called with mLock held.
  */
-Status getPortStatusHelper(hidl_vec<PortStatus_1_1> *currentPortStatus_1_1,
-    bool V1_0) {
+static Status rescanPortsLocked(Usb *usb) {
   std::unordered_map<std::string, bool> names;
-  Status result = getTypeCPortNamesHelper(&names);
-  int i = -1;
 
-  if (result == Status::SUCCESS) {
-    currentPortStatus_1_1->resize(names.size());
-    for (std::pair<std::string, bool> port : names) {
-      i++;
-      ALOGI("%s", port.first.c_str());
-      (*currentPortStatus_1_1)[i].status.portName = port.first;
-
-      uint32_t currentRole;
-      if (getCurrentRoleHelper(port.first, port.second,
-                               PortRoleType::POWER_ROLE,
-                               &currentRole) == Status::SUCCESS) {
-        (*currentPortStatus_1_1)[i].status.currentPowerRole =
-            static_cast<PortPowerRole>(currentRole);
-      } else {
-        ALOGE("Error while retreiving portNames");
-        goto done;
-      }
+  usb->mPorts.clear();
+  usb->mPortsValid = false;
 
-      if (getCurrentRoleHelper(port.first, port.second, PortRoleType::DATA_ROLE,
-                               &currentRole) == Status::SUCCESS) {
-        (*currentPortStatus_1_1)[i].status.currentDataRole =
-            static_cast<PortDataRole>(currentRole);
-      } else {
-        ALOGE("Error while retreiving current port role");
-        goto done;
-      }
+  if (getTypeCPortNamesHelper(&names) != Status::SUCCESS) return Status::ERROR;
 
-      if (getCurrentRoleHelper(port.first, port.second, PortRoleType::MODE,
-                               &currentRole) == Status::SUCCESS) {
-        (*currentPortStatus_1_1)[i].currentMode =
-            static_cast<PortMode_1_1>(currentRole);
-        (*currentPortStatus_1_1)[i].status.currentMode =
-            static_cast<V1_0::PortMode>(currentRole);
-      } else {
-        ALOGE("Error while retreiving current data role");
-        goto done;
-      }
+  for (const auto &port : names) {
+    PortState state;
+    if (readPortState(port.first, port.second, &state) != Status::SUCCESS)
+      return Status::ERROR;
+    usb->mPorts[port.first] = state;
+  }
 
-      (*currentPortStatus_1_1)[i].status.canChangeMode = true;
-      (*currentPortStatus_1_1)[i].status.canChangeDataRole =
-          port.second ? canSwitchRoleHelper(port.first, PortRoleType::DATA_ROLE)
-                      : false;
-      (*currentPortStatus_1_1)[i].status.canChangePowerRole =
-          port.second
-              ? canSwitchRoleHelper(port.first, PortRoleType::POWER_ROLE)
-              : false;
-
-      ALOGI("connected:%d canChangeMode:%d canChagedata:%d canChangePower:%d",
-            port.second, (*currentPortStatus_1_1)[i].status.canChangeMode,
-            (*currentPortStatus_1_1)[i].status.canChangeDataRole,
-            (*currentPortStatus_1_1)[i].status.canChangePowerRole);
-
-      if (V1_0) {
-        (*currentPortStatus_1_1)[i].status.supportedModes = V1_0::PortMode::DFP;
-      } else {
-        (*currentPortStatus_1_1)[i].supportedModes = PortMode_1_1::UFP | PortMode_1_1::DFP;
-        (*currentPortStatus_1_1)[i].status.supportedModes = V1_0::PortMode::NONE;
-        (*currentPortStatus_1_1)[i].status.currentMode = V1_0::PortMode::NONE;
-      }
-    }
+  usb->mPortsValid = true;
+  return Status::SUCCESS;
+}
+
+/*
+ * Re-reads a single port, connected overrides the partner lookup when the
+ * uevent already tells. Called with mLock held.
+ */
+static Status refreshPortLocked(Usb *usb, const std::string &portName,
+                                const bool *connected, bool *changed) {
+  std::string path = "/sys/class/typec/" + portName;
+
+  if (access(path.c_str(), F_OK)) {
+    *changed = usb->mPorts.erase(portName) > 0;
     return Status::SUCCESS;
   }
-done:
-  return Status::ERROR;
+
+  PortState state;
+  bool partner = connected ? *connected : !access((path + "-partner").c_str(), F_OK);
+  if (readPortState(portName, partner, &state) != Status::SUCCESS) {
+    usb->mPortsValid = false;
+    return Status::ERROR;
+  }
+
+  auto it = usb->mPorts.find(portName);
+  *changed = it == usb->mPorts.end() || !(it->second == state);
+  usb->mPorts[portName] = state;
+  return Status::SUCCESS;
 }
 
-Return<void> Usb::queryPortStatus() {
-  hidl_vec<PortStatus_1_1> currentPortStatus_1_1;
-  hidl_vec<V1_0::PortStatus> currentPortStatus;
-  Status status;
-  sp<IUsbCallback> callback_V1_1 = IUsbCallback::castFrom(mCallback_1_0);
+/*
+ * Reuse the same method for both V1_0 and V1_1 callback objects.
+ * The caller of this method would reconstruct the V1_0::PortStatus
+ * object if required. Called with mLock held.
+ */
+Status getPortStatusHelper(Usb *usb, hidl_vec<PortStatus_1_1> *currentPortStatus_1_1,
+    bool V1_0) {
+  Status result = usb->mPortsValid ? Status::SUCCESS : rescanPortsLocked(usb);
+  int i = -1;
 
-  pthread_mutex_lock(&mLock);
-  if (mCallback_1_0 != NULL) {
-    if (callback_V1_1 != NULL) {
-      status = getPortStatusHelper(&currentPortStatus_1_1, false);
+  currentPortStatus_1_1->resize(usb->mPorts.size());
+  for (const auto &port : usb->mPorts) {
+    const PortState &state = port.second;
+    i++;
+    (*currentPortStatus_1_1)[i].status.portName = port.first;
+    (*currentPortStatus_1_1)[i].status.currentPowerRole = state.powerRole;
+    (*currentPortStatus_1_1)[i].status.currentDataRole = state.dataRole;
+    (*currentPortStatus_1_1)[i].currentMode = state.mode;
+    (*currentPortStatus_1_1)[i].status.currentMode =
+        static_cast<V1_0::PortMode>(state.mode);
+
+    (*currentPortStatus_1_1)[i].status.canChangeMode = true;
+    (*currentPortStatus_1_1)[i].status.canChangeDataRole = state.supportsPD;
+    (*currentPortStatus_1_1)[i].status.canChangePowerRole = state.supportsPD;
+
+    ALOGI("connected:%d canChangeMode:%d canChagedata:%d canChangePower:%d",
+          state.connected, (*currentPortStatus_1_1)[i].status.canChangeMode,
+          (*currentPortStatus_1_1)[i].status.canChangeDataRole,
+          (*currentPortStatus_1_1)[i].status.canChangePowerRole);
+
+    if (V1_0) {
+      (*currentPortStatus_1_1)[i].status.supportedModes = V1_0::PortMode::DFP;
     } else {
-      status = getPortStatusHelper(&currentPortStatus_1_1, true);
-      currentPortStatus.resize(currentPortStatus_1_1.size());
-      for (unsigned long i = 0; i < currentPortStatus_1_1.size(); i++)
-        currentPortStatus[i] = currentPortStatus_1_1[i].status;
+      (*currentPortStatus_1_1)[i].supportedModes = PortMode_1_1::UFP | PortMode_1_1::DFP;
+      (*currentPortStatus_1_1)[i].status.supportedModes = V1_0::PortMode::NONE;
+      (*currentPortStatus_1_1)[i].status.currentMode = V1_0::PortMode::NONE;
     }
+  }
 
-    Return<void> ret;
+  return result;
+}
 
-    if (callback_V1_1 != NULL)
-      ret = callback_V1_1->notifyPortStatusChange_1_1(currentPortStatus_1_1, status);
-    else
-      ret = mCallback_1_0->notifyPortStatusChange(currentPortStatus, status);
+void Usb::queuePortStatusLocked() {
+  PendingPortStatus pending;
+
+  pending.callback = mCallback_1_0;
+  pending.callback_1_1 = mCallback_1_1;
+  pending.result = getPortStatusHelper(this, &pending.status, mCallback_1_1 == NULL);
+
+  {
+    std::lock_guard<std::mutex> lock(mNotifyLock);
+    if (mPendingStatus) ALOGI("Replacing undelivered port status");
+    mPendingStatus = std::move(pending);
+  }
+  mNotifyCV.notify_one();
+}
+
+/*
+ * Delivers port status callbacks outside of mLock, so a slow framework
+ * doesn't hold up uevent processing. Updates queued meanwhile collapse
+ * into the latest one.
+ */
+void Usb::notifyLoop() {
+  while (true) {
+    PendingPortStatus pending;
+    {
+      std::unique_lock<std::mutex> lock(mNotifyLock);
+      mNotifyCV.wait(lock, [this] { return mPendingStatus.has_value(); });
+      pending = std::move(*mPendingStatus);
+      mPendingStatus.reset();
+    }
+
+    Return<void> ret;
+    if (pending.callback_1_1 != NULL) {
+      ret = pending.callback_1_1->notifyPortStatusChange_1_1(pending.status,
+                                                             pending.result);
+    } else {
+      /*
+       * Copying the result from getPortStatusHelper
+       * into V1_0::PortStatus to pass back through
+       * the V1_0 callback object.
+       */
+      hidl_vec<V1_0::PortStatus> currentPortStatus;
+      currentPortStatus.resize(pending.status.size());
+      for (unsigned long i = 0; i < pending.status.size(); i++)
+        currentPortStatus[i] = pending.status[i].status;
+
+      ret = pending.callback->notifyPortStatusChange(currentPortStatus, pending.result);
+    }
 
     if (!ret.isOk())
-      ALOGE("queryPortStatus_1_1 error %s", ret.description().c_str());
+      ALOGE("notifyPortStatusChange error %s", ret.description().c_str());
+  }
+}
+
+Return<void> Usb::queryPortStatus() {
+  pthread_mutex_lock(&mLock);
+  if (mCallback_1_0 != NULL) {
+    // Goes through the notifier too, so it can't overtake a queued uevent update
+    queuePortStatusLocked();
   } else {
     ALOGI("Notifying userspace skipped. Callback is NULL");
   }
@@ -528,165 +620,130 @@ Return<void> Usb::queryPortStatus() {
   return Void();
 }
 
-struct data {
-  int uevent_fd;
-  android::hardware::usb::V1_1::implementation::Usb *usb;
-};
+static bool startsWith(const char *str, const char *prefix, size_t prefixLen) {
+  return !strncmp(str, prefix, prefixLen);
+}
 
-static void uevent_event(uint32_t /*epevents*/, struct data *payload) {
-  char msg[UEVENT_MSG_LEN + 2];
-  char *cp;
-  int n;
+static bool endsWith(const char *str, size_t len, const char *suffix, size_t suffixLen) {
+  return len >= suffixLen && !memcmp(str + len - suffixLen, suffix, suffixLen);
+}
 
-  n = uevent_kernel_multicast_recv(payload->uevent_fd, msg, UEVENT_MSG_LEN);
-  if (n <= 0) return;
-  if (n >= UEVENT_MSG_LEN) /* overflow -- discard */
-    return;
+/*
+ * Matches "add@<xhci root>/usb<N>/<N>-<N>/..." and returns the length of the
+ * device path following "add@", or 0 if the line doesn't match.
+ */
+static size_t matchXhciDeviceAdd(const char *line) {
+  static constexpr char kPrefix[] =
+      "add@/devices/soc/a800000.ssusb/a800000.dwc3/xhci-hcd.0.auto/usb";
+  static constexpr size_t kPrefixLen = sizeof(kPrefix) - 1;
 
-  msg[n] = '\0';
-  msg[n + 1] = '\0';
-  cp = msg;
+  if (!startsWith(line, kPrefix, kPrefixLen)) return 0;
 
-  while (*cp) {
-    std::cmatch match;
-    if (std::regex_match(cp, std::regex("(add)(.*)(-partner)"))) {
-       ALOGI("partner added");
-       pthread_mutex_lock(&payload->usb->mPartnerLock);
-       payload->usb->mPartnerUp = true;
-       pthread_cond_signal(&payload->usb->mPartnerCV);
-       pthread_mutex_unlock(&payload->usb->mPartnerLock);
-    } else if (!strncmp(cp, "DEVTYPE=typec_", strlen("DEVTYPE=typec_"))) {
-      hidl_vec<PortStatus_1_1> currentPortStatus_1_1;
-      ALOGI("uevent received %s", cp);
-      pthread_mutex_lock(&payload->usb->mLock);
-      if (payload->usb->mCallback_1_0 != NULL) {
-        sp<IUsbCallback> callback_V1_1 = IUsbCallback::castFrom(payload->usb->mCallback_1_0);
-        Return<void> ret;
-
-        // V1_1 callback
-        if (callback_V1_1 != NULL) {
-          Status status = getPortStatusHelper(&currentPortStatus_1_1, false);
-          ret = callback_V1_1->notifyPortStatusChange_1_1(
-              currentPortStatus_1_1, status);
-        } else { // V1_0 callback
-          Status status = getPortStatusHelper(&currentPortStatus_1_1, true);
-
-          /*
-           * Copying the result from getPortStatusHelper
-           * into V1_0::PortStatus to pass back through
-           * the V1_0 callback object.
-           */
-          hidl_vec<V1_0::PortStatus> currentPortStatus;
-          currentPortStatus.resize(currentPortStatus_1_1.size());
-          for (unsigned long i = 0; i < currentPortStatus_1_1.size(); i++)
-            currentPortStatus[i] = currentPortStatus_1_1[i].status;
-
-          ret = payload->usb->mCallback_1_0->notifyPortStatusChange(
-              currentPortStatus, status);
-        }
-        if (!ret.isOk()) ALOGE("error %s", ret.description().c_str());
-      } else {
-        ALOGI("Notifying userspace skipped. Callback is NULL");
-      }
-      pthread_mutex_unlock(&payload->usb->mLock);
+  const char *p = line + kPrefixLen;
+  if (!isdigit(p[0]) || p[1] != '/' || !isdigit(p[2]) || p[3] != '-' ||
+      !isdigit(p[4]) || p[5] != '/')
+    return 0;
 
-      //Role switch is not in progress and port is in disconnected state
-      if (!pthread_mutex_trylock(&payload->usb->mRoleSwitchLock)) {
-        for (unsigned long i = 0; i < currentPortStatus_1_1.size(); i++) {
-          DIR *dp = opendir(std::string("/sys/class/typec/"
-              + std::string(currentPortStatus_1_1[i].status.portName.c_str())
-              + "-partner").c_str());
-          if (dp == NULL) {
-              //PortRole role = {.role = static_cast<uint32_t>(PortMode::UFP)};
-              switchToDrp(currentPortStatus_1_1[i].status.portName);
-          } else {
-              closedir(dp);
-          }
-        }
-        pthread_mutex_unlock(&payload->usb->mRoleSwitchLock);
-      }
-      break;
-    } else if (std::regex_match(cp, match,
-          std::regex("add@(/devices/soc/a800000\\.ssusb/a800000\\.dwc3/xhci-hcd\\.0\\.auto/"
-                     "usb\\d/\\d-\\d)/.*"))) {
-      if (match.size() == 2) {
-        std::csub_match submatch = match[1];
-        checkUsbDeviceAutoSuspend("/sys" +  submatch.str());
-      }
-    }
+  return p + 5 - (line + strlen("add@"));
+}
 
-    /* advance to after the next \0 */
-    while (*cp++) {}
+/*
+ * Only typec and usb events are of interest. The socket filter normally
+ * drops everything else already, check the SUBSYSTEM key in case it isn't
+ * attached or the message isn't laid out as expected.
+ */
+static bool isInterestingSubsystem(const char *msg) {
+  for (const char *cp = msg; *cp; cp += strlen(cp) + 1) {
+    if (startsWith(cp, "SUBSYSTEM=", strlen("SUBSYSTEM="))) {
+      const char *subsystem = cp + strlen("SUBSYSTEM=");
+      return !strcmp(subsystem, "typec") || !strcmp(subsystem, "usb");
+    }
   }
+  return false;
 }
 
-void *work(void *param) {
-  int epoll_fd, uevent_fd;
-  struct epoll_event ev;
-  int nevents = 0;
-  struct data payload;
-
-  ALOGE("creating thread");
+/*
+ * Extracts "portN" from the "ACTION@DEVPATH" header of a typec uevent,
+ * for the port itself as well as for its partner, cable or plugs.
+ */
+static bool typecPortFromHeader(const char *header, std::string *portName) {
+  const char *typec = strstr(header, "/typec/");
+  if (typec == NULL) return false;
 
-  uevent_fd = uevent_open_socket(64 * 1024, true);
+  const char *name = typec + strlen("/typec/");
+  size_t len = strcspn(name, "-/");
+  if (len == 0) return false;
 
-  if (uevent_fd < 0) {
-    ALOGE("uevent_init: uevent_open_socket failed\n");
-    return NULL;
-  }
+  portName->assign(name, len);
+  return true;
+}
 
-  payload.uevent_fd = uevent_fd;
-  payload.usb = (android::hardware::usb::V1_1::implementation::Usb *)param;
+static void uevent_event(Usb *usb, const char *msg) {
+  const char *cp = msg;
 
-  fcntl(uevent_fd, F_SETFL, O_NONBLOCK);
+  if (!isInterestingSubsystem(msg)) return;
 
-  ev.events = EPOLLIN;
-  ev.data.ptr = (void *)uevent_event;
+  // The header names the device, and a partner add or remove tells its state
+  std::string portName;
+  bool hasPort = typecPortFromHeader(msg, &portName);
+  size_t headerLen = strlen(msg);
+  bool partnerEvent = endsWith(msg, headerLen, "-partner", strlen("-partner")) &&
+      (startsWith(msg, "add@", strlen("add@")) || startsWith(msg, "remove@", strlen("remove@")));
+  bool partnerConnected = msg[0] == 'a';
 
-  epoll_fd = epoll_create(64);
-  if (epoll_fd == -1) {
-    ALOGE("epoll_create failed; errno=%d", errno);
-    goto error;
-  }
+  while (*cp) {
+    size_t len = strlen(cp);
+    size_t devicePathLen;
+    if (cp == msg && hasPort) {
+      // A mode switch in progress on this port re-checks sysfs on every event
+      pthread_mutex_lock(&usb->mPartnerLock);
+      if (usb->mSwapPort == portName) {
+        ALOGI("uevent for port in role switch: %s", cp);
+        usb->mSwapEvent = true;
+        pthread_cond_signal(&usb->mPartnerCV);
+      }
+      pthread_mutex_unlock(&usb->mPartnerLock);
+    } else if (!strncmp(cp, "DEVTYPE=typec_", strlen("DEVTYPE=typec_"))) {
+      std::vector<std::string> disconnected;
+      ALOGI("uevent received %s", cp);
+      pthread_mutex_lock(&usb->mLock);
+
+      // Only the port the uevent is about needs to be read again
+      bool changed = true;
+      if (usb->mPortsValid && hasPort) {
+        if (refreshPortLocked(usb, portName, partnerEvent ? &partnerConnected : nullptr,
+                              &changed) != Status::SUCCESS)
+          changed = true;
+      } else {
+        rescanPortsLocked(usb);
+      }
 
-  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, uevent_fd, &ev) == -1) {
-    ALOGE("epoll_ctl failed; errno=%d", errno);
-    goto error;
-  }
+      if (!changed) {
+        ALOGI("Port status unchanged, not notifying");
+      } else if (usb->mCallback_1_0 != NULL) {
+        usb->queuePortStatusLocked();
+      } else {
+        ALOGI("Notifying userspace skipped. Callback is NULL");
+      }
 
-  while (!destroyThread) {
-    struct epoll_event events[64];
+      for (const auto &port : usb->mPorts) {
+        if (!port.second.connected) disconnected.push_back(port.first);
+      }
+      pthread_mutex_unlock(&usb->mLock);
 
-    nevents = epoll_wait(epoll_fd, events, 64, -1);
-    if (nevents == -1) {
-      if (errno == EINTR) continue;
-      ALOGE("usb epoll_wait failed; errno=%d", errno);
+      //Role switch is not in progress and port is in disconnected state
+      if (!pthread_mutex_trylock(&usb->mRoleSwitchLock)) {
+        for (const auto &name : disconnected) switchToDrp(name);
+        pthread_mutex_unlock(&usb->mRoleSwitchLock);
+      }
       break;
+    } else if ((devicePathLen = matchXhciDeviceAdd(cp)) != 0) {
+      checkUsbDeviceAutoSuspend("/sys" + std::string(cp + strlen("add@"), devicePathLen));
     }
 
-    for (int n = 0; n < nevents; ++n) {
-      if (events[n].data.ptr)
-        (*(void (*)(int, struct data *payload))events[n].data.ptr)(
-            events[n].events, &payload);
-    }
-  }
-
-  ALOGI("exiting worker thread");
-error:
-  close(uevent_fd);
-
-  if (epoll_fd >= 0) close(epoll_fd);
-
-  return NULL;
-}
-
-void sighandler(int sig) {
-  if (sig == SIGUSR1) {
-    destroyThread = true;
-    ALOGI("destroy set");
-    return;
+    /* advance to after the next \0 */
+    cp += len + 1;
   }
-  signal(SIGUSR1, sighandler);
 }
 
 Return<void> Usb::setCallback(const sp<V1_0::IUsbCallback> &callback) {
@@ -712,33 +769,32 @@ Return<void> Usb::setCallback(const sp<V1_0::IUsbCallback> &callback) {
      * when the callback is actually invoked.
      */
     mCallback_1_0 = callback;
+    mCallback_1_1 = callback_V1_1;
     pthread_mutex_unlock(&mLock);
     return Void();
   }
 
   mCallback_1_0 = callback;
+  mCallback_1_1 = callback_V1_1;
   ALOGI("registering callback");
 
   // Kill the worker thread if the new callback is NULL.
   if (mCallback_1_0 == NULL) {
+    // Nothing keeps the cache current without the worker thread
+    mPortsValid = false;
     pthread_mutex_unlock(&mLock);
-    if (!pthread_kill(mPoll, SIGUSR1)) {
-      pthread_join(mPoll, NULL);
-      ALOGI("pthread destroyed");
-    }
+    mUevents.stop();
     return Void();
   }
 
-  destroyThread = false;
-  signal(SIGUSR1, sighandler);
-
   /*
    * Create a background thread if the old callback value is NULL
    * and being updated with a new value.
    */
-  if (pthread_create(&mPoll, NULL, work, this)) {
+  if (!mUevents.start()) {
     ALOGE("pthread creation failed %d", errno);
     mCallback_1_0 = NULL;
+    mCallback_1_1 = NULL;
   }
 
   pthread_mutex_unlock(&mLock);
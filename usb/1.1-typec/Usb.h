@@ -5,9 +5,16 @@
 #include <android/hardware/usb/1.1/types.h>
 #include <android/hardware/usb/1.1/IUsbCallback.h>
 #include <hidl/Status.h>
+#include <usbhal/UeventLoop.h>
 #include <utils/Log.h>
 
-#define UEVENT_MSG_LEN 2048
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
 // The type-c stack waits for 4.5 - 5.5 secs before declaring a port non-pd.
 // The -partner directory would not be created until this is done.
 // Having a margin of ~3 secs for the directory and other related bookeeping
@@ -32,6 +39,7 @@ using ::android::hardware::usb::V1_1::PortStatus_1_1;
 using ::android::hidl::base::V1_0::DebugInfo;
 using ::android::hidl::base::V1_0::IBase;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -39,15 +47,55 @@ using ::android::hardware::Return;
 using ::android::hardware::Void;
 using ::android::sp;
 
+// Last known attributes of a typec port
+struct PortState {
+    bool connected;
+    PortPowerRole powerRole;
+    PortDataRole dataRole;
+    PortMode_1_1 mode;
+    bool supportsPD;
+
+    bool operator==(const PortState& other) const {
+        return connected == other.connected && powerRole == other.powerRole &&
+               dataRole == other.dataRole && mode == other.mode &&
+               supportsPD == other.supportsPD;
+    }
+};
+
+// Port status snapshot waiting to be delivered to the framework
+struct PendingPortStatus {
+    sp<V1_0::IUsbCallback> callback;
+    sp<IUsbCallback> callback_1_1;
+    hidl_vec<PortStatus_1_1> status;
+    Status result;
+};
+
+// Outcome of one switchRole call, kept for dumpsys
+struct RoleSwitchRecord {
+    std::string portName;
+    std::string role;
+    bool success;
+    int64_t latencyMs;
+    time_t when;
+};
+
 struct Usb : public IUsb {
     Usb();
 
     Return<void> switchRole(const hidl_string& portName, const PortRole& role) override;
     Return<void> setCallback(const sp<V1_0::IUsbCallback>& callback) override;
     Return<void> queryPortStatus() override;
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& args) override;
+
 
+    // Snapshots the port status for the notifier thread, called with mLock held
+    void queuePortStatusLocked();
+    void recordRoleSwitch(const std::string& portName, const PortRole& role, bool success,
+                          int64_t latencyMs);
 
     sp<V1_0::IUsbCallback> mCallback_1_0;
+    // mCallback_1_0 cast to V1_1 once in setCallback, NULL for V1_0 clients
+    sp<IUsbCallback> mCallback_1_1;
     // Protects mCallback variable
     pthread_mutex_t mLock;
     // Protects roleSwitch operation
@@ -56,11 +104,26 @@ struct Usb : public IUsb {
     pthread_cond_t mPartnerCV;
     // lock protecting mPartnerCV
     pthread_mutex_t mPartnerLock;
-    // Variable to signal partner coming back online after type switch
-    bool mPartnerUp;
+    // Port whose mode is being switched, empty if none
+    std::string mSwapPort;
+    // Set on any typec uevent for mSwapPort
+    bool mSwapEvent;
+    // Port states kept up to date from typec uevents, protected by mLock
+    std::unordered_map<std::string, PortState> mPorts;
+    // False until the first full scan and after a failed refresh
+    bool mPortsValid;
 
     private:
-        pthread_t mPoll;
+        void notifyLoop();
+
+        common::UeventLoop mUevents;
+        std::mutex mNotifyLock;
+        std::condition_variable mNotifyCV;
+        // Latest undelivered snapshot, a newer one replaces it
+        std::optional<PendingPortStatus> mPendingStatus;
+
+        std::mutex mRoleSwitchHistoryLock;
+        std::deque<RoleSwitchRecord> mRoleSwitchHistory;
 };
 
 }  // namespace implementation
@@ -20,11 +20,8 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <fstream>
-#include <iostream>
 
-#include <cutils/uevent.h>
-#include <sys/epoll.h>
+#include <sysfsnode/SysfsNodeCache.h>
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
 
@@ -36,11 +33,15 @@ namespace usb {
 namespace V1_3 {
 namespace implementation {
 
+// Role nodes are read on every port query, keep them open. The gadget's UDC
+// node is configfs, an fd kept open there would pin the gadget.
+static ::vendor::lineage::sysfs::SysfsNodeCache sysfsNodes;
+
 Return<bool> Usb::enableUsbDataSignal(bool enable) {
     bool result = true;
     ALOGI("Userspace turn %s USB data signaling", enable ? "on" : "off");
     if (enable) {
-        if (!WriteStringToFile("1", mDevicePath + USB_DATA_PATH)) {
+        if (!sysfsNodes.write(mDevicePath + USB_DATA_PATH, "1")) {
             ALOGE("Not able to turn on usb connection notification");
             result = false;
         }
@@ -48,13 +49,13 @@ Return<bool> Usb::enableUsbDataSignal(bool enable) {
             ALOGW("Gadget cannot be pulled up");
         }
     } else {
-        if (!WriteStringToFile("1", mDevicePath + ID_PATH)) {
+        if (!sysfsNodes.write(mDevicePath + ID_PATH, "1")) {
             ALOGW("Not able to turn off host mode");
         }
-        if (!WriteStringToFile("0", mDevicePath + VBUS_PATH)) {
+        if (!sysfsNodes.write(mDevicePath + VBUS_PATH, "0")) {
             ALOGW("Not able to set Vbus state");
         }
-        if (!WriteStringToFile("0", mDevicePath + USB_DATA_PATH)) {
+        if (!sysfsNodes.write(mDevicePath + USB_DATA_PATH, "0")) {
             ALOGE("Not able to turn off usb connection notification");
             result = false;
         }
@@ -65,21 +66,11 @@ Return<bool> Usb::enableUsbDataSignal(bool enable) {
     return result;
 }
 
-// Set by the signal handler to destroy the thread
-volatile bool destroyThread;
-
-int32_t readFile(std::string filename, std::string& contents) {
-    std::ifstream file(filename);
-
-    if (file.is_open()) {
-        getline(file, contents);
-        file.close();
-        return 0;
-    }
-    return -1;
+int32_t readFile(const std::string& filename, std::string& contents) {
+    return sysfsNodes.read(filename, &contents) ? 0 : -1;
 }
 
-std::string appendRoleNodeHelper(const std::string portName, PortRoleType type) {
+std::string appendRoleNodeHelper(const std::string& portName, PortRoleType type) {
     std::string node("/sys/class/dual_role_usb/" + portName);
 
     switch (type) {
@@ -110,7 +101,6 @@ std::string convertRoletoString(PortRole role) {
 
 Return<void> Usb::switchRole(const hidl_string& portName, const PortRole& newRole) {
     std::string filename = appendRoleNodeHelper(std::string(portName.c_str()), newRole.type);
-    std::ofstream file(filename);
     std::string written;
     bool roleSwitch = false;
 
@@ -123,9 +113,7 @@ Return<void> Usb::switchRole(const hidl_string& portName, const PortRole& newRol
 
     ALOGI("filename write: %s role:%d", filename.c_str(), newRole.role);
 
-    if (file.is_open()) {
-        file << convertRoletoString(newRole).c_str();
-        file.close();
+    if (sysfsNodes.write(filename, convertRoletoString(newRole))) {
         if (!readFile(filename, written)) {
             ALOGI("written: %s", written.c_str());
             if (written == convertRoletoString(newRole)) {
@@ -236,19 +224,11 @@ Status getTypeCPortNamesHelper(std::vector<std::string>& names) {
 }
 
 bool canSwitchRoleHelper(const std::string& portName, PortRoleType type) {
-    std::string filename = appendRoleNodeHelper(portName, type);
-    std::ofstream file(filename);
-
-    if (file.is_open()) {
-        file.close();
-        return true;
-    }
-    return false;
+    return sysfsNodes.canWrite(appendRoleNodeHelper(portName, type));
 }
 
-Status getPortModeHelper(const std::string portName, V1_0::PortMode& portMode) {
-    std::string filename =
-            "/sys/class/dual_role_usb/" + std::string(portName.c_str()) + "/supported_modes";
+Status getPortModeHelper(const std::string& portName, V1_0::PortMode& portMode) {
+    std::string filename = "/sys/class/dual_role_usb/" + portName + "/supported_modes";
     std::string modes;
 
     if (readFile(filename, modes)) {
@@ -268,9 +248,8 @@ Status getPortModeHelper(const std::string portName, V1_0::PortMode& portMode) {
     return Status::SUCCESS;
 }
 
-Status getPortMode_1_1Helper(const std::string portName, PortMode_1_1& portMode) {
-    std::string filename =
-            "/sys/class/dual_role_usb/" + std::string(portName.c_str()) + "/supported_modes";
+Status getPortMode_1_1Helper(const std::string& portName, PortMode_1_1& portMode) {
+    std::string filename = "/sys/class/dual_role_usb/" + portName + "/supported_modes";
     std::string modes;
 
     if (readFile(filename, modes)) {
@@ -416,11 +395,6 @@ Return<void> Usb::queryPortStatus() {
     return Void();
 }
 
-struct data {
-    int uevent_fd;
-    android::hardware::usb::V1_3::implementation::Usb* usb;
-};
-
 Return<void> Usb::enableContaminantPresenceDetection(const hidl_string& portName __unused,
                                                      bool enable __unused) {
     ALOGI("Contaminant Presence Detection is not supported");
@@ -433,104 +407,14 @@ Return<void> Usb::enableContaminantPresenceProtection(const hidl_string& portNam
     return Void();
 }
 
-static void uevent_event(uint32_t /*epevents*/, struct data* payload) {
-    char msg[UEVENT_MSG_LEN + 2];
-    char* cp;
-    int n;
-
-    n = uevent_kernel_multicast_recv(payload->uevent_fd, msg, UEVENT_MSG_LEN);
-    if (n <= 0) return;
-    if (n >= UEVENT_MSG_LEN) /* overflow -- discard */
-        return;
-
-    msg[n] = '\0';
-    msg[n + 1] = '\0';
-    cp = msg;
-
-    while (*cp) {
-        sp<IUsbCallback> callback_V1_2 = IUsbCallback::castFrom(payload->usb->mCallback_1_0);
-        sp<V1_1::IUsbCallback> callback_V1_1 =
-                V1_1::IUsbCallback::castFrom(payload->usb->mCallback_1_0);
-        hidl_vec<PortStatus> currentPortStatus_1_2;
-        Return<void> ret;
+static void uevent_event(Usb* usb, const char* msg) {
+    for (const char* cp = msg; *cp; cp += strlen(cp) + 1) {
         if (!strcmp(cp, "SUBSYSTEM=dual_role_usb")) {
             ALOGE("uevent received %s", cp);
-            ret = payload->usb->queryPortStatus();
-            break;
-        }
-        /* advance to after the next \0 */
-        while (*cp++)
-            ;
-    }
-}
-
-void* work(void* param) {
-    int epoll_fd, uevent_fd;
-    struct epoll_event ev;
-    int nevents = 0;
-    struct data payload;
-
-    ALOGE("creating thread");
-
-    uevent_fd = uevent_open_socket(64 * 1024, true);
-
-    if (uevent_fd < 0) {
-        ALOGE("uevent_init: uevent_open_socket failed\n");
-        return NULL;
-    }
-
-    payload.uevent_fd = uevent_fd;
-    payload.usb = (android::hardware::usb::V1_3::implementation::Usb*)param;
-
-    fcntl(uevent_fd, F_SETFL, O_NONBLOCK);
-
-    ev.events = EPOLLIN;
-    ev.data.ptr = (void*)uevent_event;
-
-    epoll_fd = epoll_create(64);
-    if (epoll_fd == -1) {
-        ALOGE("epoll_create failed; errno=%d", errno);
-        goto error;
-    }
-
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, uevent_fd, &ev) == -1) {
-        ALOGE("epoll_ctl failed; errno=%d", errno);
-        goto error;
-    }
-
-    while (!destroyThread) {
-        struct epoll_event events[64];
-
-        nevents = epoll_wait(epoll_fd, events, 64, -1);
-        if (nevents == -1) {
-            if (errno == EINTR) continue;
-            ALOGE("usb epoll_wait failed; errno=%d", errno);
+            usb->queryPortStatus();
             break;
         }
-
-        for (int n = 0; n < nevents; ++n) {
-            if (events[n].data.ptr)
-                (*(void (*)(int, struct data* payload))events[n].data.ptr)(events[n].events,
-                                                                           &payload);
-        }
     }
-
-    ALOGI("exiting worker thread");
-error:
-    close(uevent_fd);
-
-    if (epoll_fd >= 0) close(epoll_fd);
-
-    return NULL;
-}
-
-void sighandler(int sig) {
-    if (sig == SIGUSR1) {
-        destroyThread = true;
-        ALOGI("destroy set");
-        return;
-    }
-    signal(SIGUSR1, sighandler);
 }
 
 Return<void> Usb::setCallback(const sp<V1_0::IUsbCallback>& callback) {
@@ -565,21 +449,15 @@ Return<void> Usb::setCallback(const sp<V1_0::IUsbCallback>& callback) {
     // Kill the worker thread if the new callback is NULL.
     if (mCallback_1_0 == NULL) {
         pthread_mutex_unlock(&mLock);
-        if (!pthread_kill(mPoll, SIGUSR1)) {
-            pthread_join(mPoll, NULL);
-            ALOGI("pthread destroyed");
-        }
+        mUevents.stop();
         return Void();
     }
 
-    destroyThread = false;
-    signal(SIGUSR1, sighandler);
-
     /*
      * Create a background thread if the old callback value is NULL
      * and being updated with a new value.
      */
-    if (pthread_create(&mPoll, NULL, work, this)) {
+    if (!mUevents.start()) {
         ALOGE("pthread creation failed %d", errno);
         mCallback_1_0 = NULL;
     }
@@ -593,7 +471,8 @@ pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 Usb* usb;
 
 Usb::Usb(std::string deviceName, std::string gadgetName)
-    : mGadgetName(gadgetName) {
+    : mUevents({"dual_role_usb"}, [this](const char* msg) { uevent_event(this, msg); }),
+      mGadgetName(gadgetName) {
     if (access(SOC_PLATFORM_PATH, F_OK) == 0) {
         mDevicePath = SOC_PLATFORM_PATH + deviceName + "/";
     } else if (access(SOC_PATH, F_OK) == 0) {
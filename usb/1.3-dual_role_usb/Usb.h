@@ -23,13 +23,13 @@
 #include <android/hardware/usb/1.3/IUsb.h>
 #include <hidl/Status.h>
 #include <log/log.h>
+#include <usbhal/UeventLoop.h>
 
 #ifdef LOG_TAG
 #undef LOG_TAG
 #endif
 
 #define LOG_TAG "android.hardware.usb@1.3-service.dual_role_usb"
-#define UEVENT_MSG_LEN 2048
 
 namespace android {
 namespace hardware {
@@ -84,7 +84,7 @@ struct Usb : public IUsb {
     Return<bool> enableUsbDataSignal(bool enable) override;
 
     sp<V1_0::IUsbCallback> mCallback_1_0;
-    pthread_t mPoll;
+    common::UeventLoop mUevents;
     // Protects mCallback variable
     pthread_mutex_t mLock = PTHREAD_MUTEX_INITIALIZER;
     // Protects roleSwitch operation
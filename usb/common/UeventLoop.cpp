@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.usb-common"
+
+#include "usbhal/UeventLoop.h"
+
+#include <cutils/uevent.h>
+#include <fcntl.h>
+#include <linux/filter.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace usb {
+namespace common {
+
+static constexpr int kUeventBufferSize = 64 * 1024;
+static constexpr size_t kUeventMsgLen = 2048;
+
+/*
+ * Kernel uevents are laid out as "ACTION@DEVPATH\0ACTION=...\0DEVPATH=...\0SUBSYSTEM=...\0",
+ * so SUBSYSTEM= starts at 2 * H + 15, H being the header length including its NUL.
+ * Classic BPF has no loops, the header scan is unrolled up to kMaxUeventHeaderLen.
+ * Anything not laid out like that is passed on and left to userspace.
+ */
+static constexpr uint32_t kMaxUeventHeaderLen = 512;
+static constexpr uint32_t kUeventAccept = 0xffffffff;
+
+struct BpfProgram {
+    std::vector<sock_filter> insns;
+    // ja instructions to point at a label once it is placed
+    std::vector<std::pair<size_t, int>> fixups;
+    std::vector<size_t> labels;
+
+    int newLabel() {
+        labels.push_back(0);
+        return labels.size() - 1;
+    }
+    void place(int label) { labels[label] = insns.size(); }
+    void stmt(uint16_t code, uint32_t k) { insns.push_back(BPF_STMT(code, k)); }
+    void jumpTo(int label) {
+        fixups.push_back({insns.size(), label});
+        stmt(BPF_JMP | BPF_JA, 0);
+    }
+    // Compares bytes at X + offset, jumping to fail on the first mismatch
+    void match(const char* bytes, size_t len, int fail) {
+        for (size_t off = 0; off < len;) {
+            size_t size = len - off >= 4 ? 4 : len - off >= 2 ? 2 : 1;
+            uint32_t value = 0;
+            for (size_t i = 0; i < size; i++) value = (value << 8) | (uint8_t)bytes[off + i];
+            stmt(BPF_LD | (size == 4 ? BPF_W : size == 2 ? BPF_H : BPF_B) | BPF_IND, off);
+            insns.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, value, 1, 0));
+            jumpTo(fail);
+            off += size;
+        }
+    }
+    void resolve() {
+        for (const auto& [index, label] : fixups) insns[index].k = labels[label] - index - 1;
+    }
+};
+
+static void attachUeventFilter(int fd, const std::vector<std::string>& subsystems) {
+    BpfProgram prog;
+    int found = prog.newLabel();
+    int accept = prog.newLabel();
+
+    for (uint32_t i = 0; i < kMaxUeventHeaderLen; i++) {
+        prog.stmt(BPF_LD | BPF_B | BPF_ABS, i);
+        prog.insns.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2));
+        prog.stmt(BPF_LDX | BPF_IMM, i + 1);
+        prog.jumpTo(found);
+    }
+    prog.jumpTo(accept);
+
+    prog.place(found);
+    prog.stmt(BPF_MISC | BPF_TXA, 0);
+    prog.stmt(BPF_ALU | BPF_ADD | BPF_X, 0);
+    prog.stmt(BPF_ALU | BPF_ADD | BPF_K, 15);
+    prog.stmt(BPF_MISC | BPF_TAX, 0);
+    prog.match("SUBSYSTEM=", strlen("SUBSYSTEM="), accept);
+    prog.stmt(BPF_MISC | BPF_TXA, 0);
+    prog.stmt(BPF_ALU | BPF_ADD | BPF_K, strlen("SUBSYSTEM="));
+    prog.stmt(BPF_MISC | BPF_TAX, 0);
+    for (const auto& subsystem : subsystems) {
+        int next = prog.newLabel();
+        // include the NUL so "usb" doesn't match "usb_power_delivery"
+        prog.match(subsystem.c_str(), subsystem.size() + 1, next);
+        prog.stmt(BPF_RET | BPF_K, kUeventAccept);
+        prog.place(next);
+    }
+    prog.stmt(BPF_RET | BPF_K, 0);
+
+    prog.place(accept);
+    prog.stmt(BPF_RET | BPF_K, kUeventAccept);
+    prog.resolve();
+
+    struct sock_fprog fprog = {
+            .len = static_cast<unsigned short>(prog.insns.size()),
+            .filter = prog.insns.data(),
+    };
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0)
+        ALOGE("Failed to attach uevent filter, errno=%d", errno);
+}
+
+UeventLoop::UeventLoop(std::vector<std::string> subsystems, Handler handler)
+    : mSubsystems(std::move(subsystems)), mHandler(std::move(handler)) {}
+
+UeventLoop::~UeventLoop() {
+    stop();
+}
+
+bool UeventLoop::start() {
+    if (running()) return true;
+
+    mUeventFd.reset(uevent_open_socket(kUeventBufferSize, true));
+    if (!mUeventFd.ok()) {
+        ALOGE("uevent_init: uevent_open_socket failed");
+        return false;
+    }
+    fcntl(mUeventFd.get(), F_SETFL, O_NONBLOCK);
+    attachUeventFilter(mUeventFd.get(), mSubsystems);
+
+    mStopFd.reset(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    mEpollFd.reset(epoll_create1(EPOLL_CLOEXEC));
+    if (!mStopFd.ok() || !mEpollFd.ok()) {
+        ALOGE("Failed to set up uevent loop, errno=%d", errno);
+        return false;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN};
+    ev.data.fd = mUeventFd.get();
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mUeventFd.get(), &ev) == -1) {
+        ALOGE("epoll_ctl failed; errno=%d", errno);
+        return false;
+    }
+    ev.data.fd = mStopFd.get();
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mStopFd.get(), &ev) == -1) {
+        ALOGE("epoll_ctl failed; errno=%d", errno);
+        return false;
+    }
+
+    mThread = std::thread(&UeventLoop::run, this);
+    return true;
+}
+
+void UeventLoop::stop() {
+    if (!running()) return;
+
+    uint64_t val = 1;
+    write(mStopFd.get(), &val, sizeof(val));
+    mThread.join();
+    ALOGI("uevent thread destroyed");
+
+    mEpollFd.reset();
+    mStopFd.reset();
+    mUeventFd.reset();
+}
+
+void UeventLoop::run() {
+    ALOGI("creating thread");
+
+    while (true) {
+        struct epoll_event events[2];
+        int nevents = epoll_wait(mEpollFd.get(), events, 2, -1);
+        if (nevents == -1) {
+            if (errno == EINTR) continue;
+            ALOGE("usb epoll_wait failed; errno=%d", errno);
+            break;
+        }
+
+        for (int n = 0; n < nevents; ++n) {
+            if (events[n].data.fd == mStopFd.get()) {
+                ALOGI("exiting worker thread");
+                return;
+            }
+            drain();
+        }
+    }
+}
+
+void UeventLoop::drain() {
+    char msg[kUeventMsgLen + 2];
+    ssize_t n;
+
+    while ((n = uevent_kernel_multicast_recv(mUeventFd.get(), msg, kUeventMsgLen)) > 0) {
+        if (n >= static_cast<ssize_t>(kUeventMsgLen)) /* overflow -- discard */
+            continue;
+
+        msg[n] = '\0';
+        msg[n + 1] = '\0';
+        mHandler(msg);
+    }
+}
+
+}  // namespace common
+}  // namespace usb
+}  // namespace hardware
+}  // namespace android
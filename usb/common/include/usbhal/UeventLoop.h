@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace usb {
+namespace common {
+
+// Receives kernel uevents of a few subsystems on an epoll thread. A socket
+// filter drops all other uevents in the kernel, before the thread wakes up.
+class UeventLoop {
+  public:
+    // Gets one uevent as NUL separated lines, ending with an empty line
+    using Handler = std::function<void(const char* msg)>;
+
+    UeventLoop(std::vector<std::string> subsystems, Handler handler);
+    ~UeventLoop();
+
+    bool start();
+    // Returns once the thread has exited, must not be called from the handler
+    void stop();
+    bool running() const { return mThread.joinable(); }
+
+  private:
+    void run();
+    void drain();
+
+    const std::vector<std::string> mSubsystems;
+    const Handler mHandler;
+
+    android::base::unique_fd mUeventFd;
+    android::base::unique_fd mEpollFd;
+    android::base::unique_fd mStopFd;
+    std::thread mThread;
+};
+
+}  // namespace common
+}  // namespace usb
+}  // namespace hardware
+}  // namespace android
@@ -14,14 +14,16 @@
  * limitations under the License.
  */
 
+#define ATRACE_TAG ATRACE_TAG_HAL
 #define LOG_TAG "VibratorService"
 
 #include <log/log.h>
+#include <utils/Trace.h>
 
 #include "Vibrator.h"
 
 #include <cmath>
-#include <fstream>
+#include <iterator>
 
 namespace android {
 namespace hardware {
@@ -38,52 +40,43 @@ namespace implementation {
 
 #define CLICK_TIMING_MS 20
 
+#define CLICK_LIGHT_AMPLITUDE   36
+#define CLICK_MEDIUM_AMPLITUDE  128
+#define CLICK_STRONG_AMPLITUDE  255
+
 #define DEFAULT_MIN_VTG 0
 #define DEFAULT_MAX_VTG 255
 
-static int get(std::string path, int defaultValue) {
-    int value = defaultValue;
-    std::ifstream file(path);
+static int get(const char *path, int defaultValue) {
+    int value;
 
-    if (!file) {
-        ALOGE("Failed to open %s", path.c_str());
-        return value;
-    }
-
-    file >> value;
-
-    if (!file) {
-        ALOGE("Failed to read value from %s", path.c_str());
+    if (!SysfsNode(path, SysfsNode::kReadable).read(&value)) {
+        ALOGE("Failed to read value from %s", path);
+        return defaultValue;
     }
 
     return value;
 }
 
-static int set(std::string path, int value) {
-    std::ofstream file(path);
-
-    if (!file) {
-        ALOGE("Failed to open %s", path.c_str());
-        return -1;
-    }
-
-    file << value;
-
-    if (!file) {
-        ALOGE("Failed to write %d to %s", value, path.c_str());
-        return -1;
-    }
+Vibrator::Vibrator() : Vibrator(VIBRATOR) {}
 
-    return 0;
-}
+Vibrator::Vibrator(const std::string &dir)
+    : enable(dir + ENABLE, SysfsNode::kWritable),
+      vtgLevel(dir + VTG_LEVEL, SysfsNode::kWritable | SysfsNode::kSkipRedundantWrites) {
+    minVoltage = get((dir + VTG_MIN).c_str(), DEFAULT_MIN_VTG);
+    maxVoltage = get((dir + VTG_MAX).c_str(), DEFAULT_MAX_VTG);
 
-Vibrator::Vibrator() {
-    minVoltage = get(VIBRATOR VTG_MIN, DEFAULT_MIN_VTG);
-    maxVoltage = get(VIBRATOR VTG_MAX, DEFAULT_MAX_VTG);
+    clickTimings[static_cast<size_t>(EffectStrength::LIGHT)] =
+            {amplitudeToVoltage(CLICK_LIGHT_AMPLITUDE), CLICK_TIMING_MS};
+    clickTimings[static_cast<size_t>(EffectStrength::MEDIUM)] =
+            {amplitudeToVoltage(CLICK_MEDIUM_AMPLITUDE), CLICK_TIMING_MS};
+    clickTimings[static_cast<size_t>(EffectStrength::STRONG)] =
+            {amplitudeToVoltage(CLICK_STRONG_AMPLITUDE), CLICK_TIMING_MS};
 }
 
 Return<Status> Vibrator::on(uint32_t timeout_ms) {
-    if (set(VIBRATOR ENABLE, timeout_ms)) {
+    ATRACE_CALL();
+    if (!enable.write(timeout_ms)) {
         return Status::UNKNOWN_ERROR;
     }
 
@@ -91,7 +84,8 @@ Return<Status> Vibrator::on(uint32_t timeout_ms) {
 }
 
 Return<Status> Vibrator::off()  {
-    if (set(VIBRATOR ENABLE, 0)) {
+    ATRACE_CALL();
+    if (!enable.write(0)) {
         return Status::UNKNOWN_ERROR;
     }
 
@@ -103,55 +97,50 @@ Return<bool> Vibrator::supportsAmplitudeControl()  {
 }
 
 Return<Status> Vibrator::setAmplitude(uint8_t amplitude) {
+    ATRACE_CALL();
     if (amplitude == 0) {
         return Status::BAD_VALUE;
     }
 
-    /*
-     * Scale the voltage such that an amplitude of 1 is minVoltage
-     * and an amplitude of 255 is maxVoltage.
-     */
-    uint32_t voltage =
-            std::lround((amplitude - 1) / 254.0 * (maxVoltage - minVoltage) + minVoltage);
+    return setVoltage(amplitudeToVoltage(amplitude));
+}
 
-    if (set(VIBRATOR VTG_LEVEL, voltage)) {
+/*
+ * Scale the voltage such that an amplitude of 1 is minVoltage
+ * and an amplitude of 255 is maxVoltage.
+ */
+int32_t Vibrator::amplitudeToVoltage(uint8_t amplitude) const {
+    return std::lround((amplitude - 1) / 254.0 * (maxVoltage - minVoltage) + minVoltage);
+}
+
+Status Vibrator::setVoltage(int32_t level) {
+    if (!vtgLevel.write(level)) {
         return Status::UNKNOWN_ERROR;
     }
 
-    ALOGI("Voltage set to: %u", voltage);
+    ALOGV("Voltage set to: %d", level);
 
     return Status::OK;
 }
 
 Return<void> Vibrator::perform(Effect effect, EffectStrength strength, perform_cb _hidl_cb) {
-    switch (effect) {
-    case Effect::CLICK:
-        uint8_t amplitude;
-
-        switch (strength) {
-        case EffectStrength::LIGHT:
-            amplitude = 36;
-            break;
-        case EffectStrength::MEDIUM:
-            amplitude = 128;
-            break;
-        case EffectStrength::STRONG:
-            amplitude = 255;
-            break;
-        default:
-            _hidl_cb(Status::UNSUPPORTED_OPERATION, 0);
-            return Void();
-        }
-
-        on(CLICK_TIMING_MS);
-        setAmplitude(amplitude);
-        _hidl_cb(Status::OK, CLICK_TIMING_MS);
-        break;
-    default:
+    ATRACE_CALL();
+    size_t index = static_cast<size_t>(strength);
+
+    if (effect != Effect::CLICK || index >= std::size(clickTimings)) {
         _hidl_cb(Status::UNSUPPORTED_OPERATION, 0);
-        break;
+        return Void();
+    }
+
+    // Voltage first so the click starts at the requested strength
+    const EffectTiming &timing = clickTimings[index];
+    if (setVoltage(timing.voltage) != Status::OK ||
+            !enable.write(timing.durationMs)) {
+        _hidl_cb(Status::UNKNOWN_ERROR, 0);
+        return Void();
     }
 
+    _hidl_cb(Status::OK, timing.durationMs);
     return Void();
 }
 
@@ -18,6 +18,9 @@
 
 #include <android/hardware/vibrator/1.0/IVibrator.h>
 #include <hidl/Status.h>
+#include <sysfsnode/SysfsNode.h>
+
+#include <string>
 
 namespace android {
 namespace hardware {
@@ -25,9 +28,13 @@ namespace vibrator {
 namespace V1_0 {
 namespace implementation {
 
+using ::vendor::lineage::sysfs::SysfsNode;
+
 class Vibrator : public IVibrator {
 public:
   Vibrator();
+  // dir holds the timed_output nodes, with a trailing slash
+  explicit Vibrator(const std::string &dir);
 
   Return<Status> on(uint32_t timeoutMs) override;
   Return<Status> off() override;
@@ -36,8 +43,22 @@ public:
   Return<void> perform(Effect effect, EffectStrength strength, perform_cb _hidl_cb) override;
 
 private:
+  struct EffectTiming {
+    int32_t voltage;
+    uint32_t durationMs;
+  };
+
+  int32_t amplitudeToVoltage(uint8_t amplitude) const;
+  Status setVoltage(int32_t level);
+
   uint32_t minVoltage;
   uint32_t maxVoltage;
+  // nodes written on every haptic tick stay open, vtgLevel skips repeated
+  // voltages
+  SysfsNode enable;
+  SysfsNode vtgLevel;
+  // click timing per EffectStrength, resolved once from the voltage range
+  EffectTiming clickTimings[3];
 };
 
 }  // namespace implementation
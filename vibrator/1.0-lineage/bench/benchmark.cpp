@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+#include <vibratorbench/BenchUtils.h>
+
+#include "../Vibrator.h"
+
+using ::android::sp;
+using ::android::hardware::vibrator::V1_0::Effect;
+using ::android::hardware::vibrator::V1_0::EffectStrength;
+using ::android::hardware::vibrator::V1_0::Status;
+using ::android::hardware::vibrator::V1_0::implementation::Vibrator;
+using ::vendor::lineage::vibrator::bench::FakeSysfs;
+using ::vendor::lineage::vibrator::bench::measureCalls;
+
+namespace {
+
+// A timed_output vibrator directory with the nodes the HAL opens
+class VibratorFixture {
+  public:
+    VibratorFixture() {
+        mSysfs.create("enable", "0\n");
+        mSysfs.create("vtg_level", "0\n");
+        mSysfs.create("vtg_min", "12\n");
+        mSysfs.create("vtg_max", "31\n");
+        mVibrator = new Vibrator(mSysfs.dir());
+    }
+
+    Vibrator &vibrator() { return *mVibrator; }
+
+  private:
+    FakeSysfs mSysfs;
+    sp<Vibrator> mVibrator;
+};
+
+void BM_On(benchmark::State &state) {
+    VibratorFixture fixture;
+    uint32_t timeoutMs = 1;
+    measureCalls(state, [&] { fixture.vibrator().on(timeoutMs++ % 1000 + 1); });
+}
+
+void BM_Off(benchmark::State &state) {
+    VibratorFixture fixture;
+    measureCalls(state, [&] { fixture.vibrator().off(); });
+}
+
+// Alternates amplitudes so every call reaches the node
+void BM_SetAmplitude(benchmark::State &state) {
+    VibratorFixture fixture;
+    uint8_t amplitude = 1;
+    measureCalls(state, [&] {
+        fixture.vibrator().setAmplitude(amplitude);
+        amplitude = amplitude == 1 ? 255 : 1;
+    });
+}
+
+// The voltage write of repeating a strength is skipped
+void BM_SetAmplitudeRepeated(benchmark::State &state) {
+    VibratorFixture fixture;
+    measureCalls(state, [&] { fixture.vibrator().setAmplitude(128); });
+}
+
+void BM_Perform(benchmark::State &state) {
+    VibratorFixture fixture;
+    int strength = 0;
+    measureCalls(state, [&] {
+        fixture.vibrator().perform(Effect::CLICK, static_cast<EffectStrength>(strength++ % 3),
+                                   [](Status, uint32_t) {});
+    });
+}
+
+}  // namespace
+
+BENCHMARK(BM_On)->UseManualTime();
+BENCHMARK(BM_Off)->UseManualTime();
+BENCHMARK(BM_SetAmplitude)->UseManualTime();
+BENCHMARK(BM_SetAmplitudeRepeated)->UseManualTime();
+BENCHMARK(BM_Perform)->UseManualTime();
+
+BENCHMARK_MAIN();
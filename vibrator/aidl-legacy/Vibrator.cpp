@@ -5,18 +5,56 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#define ATRACE_TAG ATRACE_TAG_HAL
+
 #include <log/log.h>
+#include <utils/Trace.h>
 
 #include <hardware/hardware.h>
 #include <hardware/vibrator.h>
 
 #include "Vibrator.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace vibrator {
 
+namespace {
+
+constexpr int32_t kCompositionDelayMaxMs = 1000;
+constexpr int32_t kCompositionSizeMax = 32;
+constexpr int32_t kPwlePrimitiveDurationMaxMs = 1000;
+constexpr int32_t kPwleCompositionSizeMax = 32;
+
+// Pulse length of each primitive at full scale. There is no amplitude
+// control, so lighter primitives and lower scales get shorter pulses.
+constexpr std::pair<CompositePrimitive, int32_t> kPrimitiveDurations[] = {
+    {CompositePrimitive::NOOP, 0},
+    {CompositePrimitive::CLICK, 20},
+    {CompositePrimitive::THUD, 40},
+    {CompositePrimitive::SPIN, 60},
+    {CompositePrimitive::QUICK_RISE, 40},
+    {CompositePrimitive::SLOW_RISE, 80},
+    {CompositePrimitive::QUICK_FALL, 30},
+    {CompositePrimitive::LIGHT_TICK, 8},
+    {CompositePrimitive::LOW_TICK, 10},
+};
+
+const int32_t *primitiveDuration(CompositePrimitive primitive) {
+    for (const auto &[p, duration] : kPrimitiveDurations) {
+        if (p == primitive) {
+            return &duration;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
 Vibrator::Vibrator() {
     vibrator_device_t *vib_device;
     const hw_module_t *hw_module = nullptr;
@@ -34,16 +72,21 @@ Vibrator::Vibrator() {
     }
 
     mDevice = vib_device;
+    mScheduler = std::make_unique<WaveformScheduler>(mDevice);
 }
 
+Vibrator::Vibrator(vibrator_device_t *device)
+    : mDevice(device), mScheduler(std::make_unique<WaveformScheduler>(device)) {}
+
 ndk::ScopedAStatus Vibrator::getCapabilities(int32_t* _aidl_return) {
     ALOGV("Vibrator reporting capabilities");
-    *_aidl_return = IVibrator::CAP_ON_CALLBACK;
+    *_aidl_return = IVibrator::CAP_ON_CALLBACK | IVibrator::CAP_COMPOSE_EFFECTS;
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Vibrator::off() {
-    int32_t ret = mDevice->vibrator_off(mDevice);
+    ATRACE_CALL();
+    int32_t ret = mScheduler->stop();
     if (ret != 0) {
         ALOGE("off command failed : %s", strerror(-ret));
         return ndk::ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
@@ -51,10 +94,15 @@ ndk::ScopedAStatus Vibrator::off() {
     return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::on(int32_t timeoutMs, const std::shared_ptr<IVibratorCallback>& /*callback*/) {
+ndk::ScopedAStatus Vibrator::on(int32_t timeoutMs, const std::shared_ptr<IVibratorCallback>& callback) {
+    ATRACE_CALL();
+    // Replaces whatever is playing before the driver takes over, so no
+    // pulse of it can cut this vibration short
+    mScheduler->expect(timeoutMs, callback);
     int32_t ret = mDevice->vibrator_on(mDevice, timeoutMs);
     if (ret != 0) {
         ALOGE("on command failed : %s", strerror(-ret));
+        mScheduler->stop();
         return ndk::ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
     }
     return ndk::ScopedAStatus::ok();
@@ -76,24 +124,61 @@ ndk::ScopedAStatus Vibrator::setExternalControl(bool /*enabled*/) {
     return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
 }
 
-ndk::ScopedAStatus Vibrator::getCompositionDelayMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getCompositionDelayMax(int32_t* _aidl_return) {
+    *_aidl_return = kCompositionDelayMaxMs;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getCompositionSizeMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getCompositionSizeMax(int32_t* _aidl_return) {
+    *_aidl_return = kCompositionSizeMax;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getSupportedPrimitives(std::vector<CompositePrimitive>* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getSupportedPrimitives(std::vector<CompositePrimitive>* _aidl_return) {
+    _aidl_return->clear();
+    for (const auto &[primitive, duration] : kPrimitiveDurations) {
+        _aidl_return->push_back(primitive);
+    }
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getPrimitiveDuration(CompositePrimitive /*primitive*/, int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPrimitiveDuration(CompositePrimitive primitive, int32_t* _aidl_return) {
+    const int32_t *duration = primitiveDuration(primitive);
+    if (duration == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    *_aidl_return = *duration;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::compose(const std::vector<CompositeEffect>& /*composite*/, const std::shared_ptr<IVibratorCallback>& /*callback*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::compose(const std::vector<CompositeEffect>& composite, const std::shared_ptr<IVibratorCallback>& callback) {
+    ATRACE_CALL();
+    if (composite.empty() || composite.size() > kCompositionSizeMax) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    Waveform waveform;
+    int32_t t = 0;
+    for (const auto &effect : composite) {
+        const int32_t *duration = primitiveDuration(effect.primitive);
+        if (effect.delayMs < 0 || effect.delayMs > kCompositionDelayMaxMs ||
+            effect.scale < 0.0f || effect.scale > 1.0f) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+        if (duration == nullptr) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+        }
+        t += effect.delayMs;
+        if (*duration > 0 && effect.scale > 0.0f) {
+            int32_t pulseMs = std::max<int32_t>(1, std::lround(*duration * (0.5f + 0.5f * effect.scale)));
+            waveform.pulses.push_back({t, pulseMs});
+            t += pulseMs;
+        }
+    }
+    waveform.totalMs = t;
+
+    mScheduler->play(std::move(waveform), callback);
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Vibrator::getSupportedAlwaysOnEffects(std::vector<Effect>* /*_aidl_return*/) {
@@ -128,20 +213,62 @@ ndk::ScopedAStatus Vibrator::getBandwidthAmplitudeMap(std::vector<float>* /*_aid
     return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
 }
 
-ndk::ScopedAStatus Vibrator::getPwlePrimitiveDurationMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPwlePrimitiveDurationMax(int32_t* _aidl_return) {
+    *_aidl_return = kPwlePrimitiveDurationMaxMs;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getPwleCompositionSizeMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPwleCompositionSizeMax(int32_t* _aidl_return) {
+    *_aidl_return = kPwleCompositionSizeMax;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getSupportedBraking(std::vector<Braking>* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getSupportedBraking(std::vector<Braking>* _aidl_return) {
+    *_aidl_return = {Braking::NONE};
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::composePwle(const std::vector<PrimitivePwle>& /*composite*/, const std::shared_ptr<IVibratorCallback>& /*callback*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+// Without amplitude or frequency control a PWLE segment is either driven or
+// not, consecutive driven segments are merged into a single pulse.
+ndk::ScopedAStatus Vibrator::composePwle(const std::vector<PrimitivePwle>& composite, const std::shared_ptr<IVibratorCallback>& callback) {
+    ATRACE_CALL();
+    if (composite.empty() || composite.size() > kPwleCompositionSizeMax) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    Waveform waveform;
+    int32_t t = 0;
+    bool driving = false;
+    for (const auto &pwle : composite) {
+        int32_t duration;
+        bool drive;
+        if (pwle.getTag() == PrimitivePwle::active) {
+            const auto &active = pwle.get<PrimitivePwle::active>();
+            duration = active.duration;
+            drive = active.startAmplitude > 0.0f || active.endAmplitude > 0.0f;
+        } else {
+            const auto &braking = pwle.get<PrimitivePwle::braking>();
+            if (braking.braking != Braking::NONE) {
+                return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+            }
+            duration = braking.duration;
+            drive = false;
+        }
+        if (duration < 0 || duration > kPwlePrimitiveDurationMaxMs) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+        if (drive && driving) {
+            waveform.pulses.back().durationMs += duration;
+        } else if (drive && duration > 0) {
+            waveform.pulses.push_back({t, duration});
+        }
+        driving = drive && duration > 0;
+        t += duration;
+    }
+    waveform.totalMs = t;
+
+    mScheduler->play(std::move(waveform), callback);
+    return ndk::ScopedAStatus::ok();
 }
 
 } // namespace vibrator
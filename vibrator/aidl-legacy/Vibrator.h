@@ -11,6 +11,10 @@
 #include <hardware/hardware.h>
 #include <hardware/vibrator.h>
 
+#include <memory>
+
+#include "WaveformScheduler.h"
+
 using ::aidl::android::hardware::vibrator::IVibratorCallback;
 using ::aidl::android::hardware::vibrator::Braking;
 using ::aidl::android::hardware::vibrator::Effect;
@@ -27,6 +31,8 @@ namespace vibrator {
 class Vibrator : public BnVibrator {
 public:
     Vibrator();
+    // Drives an already opened device, which must outlive the Vibrator
+    explicit Vibrator(vibrator_device_t *device);
 
     ndk::ScopedAStatus getCapabilities(int32_t* _aidl_return) override;
     ndk::ScopedAStatus off() override;
@@ -55,6 +61,7 @@ public:
 
 private:
     vibrator_device_t *mDevice;
+    std::unique_ptr<WaveformScheduler> mScheduler;
 };
 
 } // namespace vibrator
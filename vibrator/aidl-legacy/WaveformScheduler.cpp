@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define ATRACE_TAG ATRACE_TAG_HAL
+#define LOG_TAG "VibratorWaveform"
+
+#include "WaveformScheduler.h"
+
+#include <log/log.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <utils/Trace.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+namespace {
+
+constexpr int kSchedFifoPriority = 2;
+
+}  // namespace
+
+WaveformScheduler::WaveformScheduler(vibrator_device_t *device)
+    : mDevice(device),
+      mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      mEventFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (!mTimerFd.ok() || !mEventFd.ok()) {
+        ALOGE("Failed to set up waveform timer: %s", strerror(errno));
+        return;
+    }
+    mThread = std::thread(&WaveformScheduler::run, this);
+}
+
+WaveformScheduler::~WaveformScheduler() {
+    if (!mThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    uint64_t val = 1;
+    write(mEventFd.get(), &val, sizeof(val));
+    mThread.join();
+}
+
+void WaveformScheduler::play(Waveform waveform, const std::shared_ptr<IVibratorCallback> &callback) {
+    std::shared_ptr<IVibratorCallback> replaced;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        replaced = std::move(mCallback);
+        mWaveform = std::move(waveform);
+        mNextPulse = 0;
+        mStart = Clock::now();
+        mCallback = callback;
+        mPlaying = true;
+        armTimerLocked(mStart);
+    }
+    // the replaced vibration has ended as far as its caller is concerned
+    if (replaced) {
+        replaced->onComplete();
+    }
+}
+
+void WaveformScheduler::expect(int32_t durationMs, const std::shared_ptr<IVibratorCallback> &callback) {
+    play(Waveform{.totalMs = durationMs}, callback);
+}
+
+int WaveformScheduler::stop() {
+    std::shared_ptr<IVibratorCallback> callback;
+    int ret;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mPlaying) {
+            mPlaying = false;
+            callback = std::move(mCallback);
+            armTimerLocked(Clock::time_point());
+        }
+        ret = mDevice->vibrator_off(mDevice);
+    }
+    if (callback) {
+        callback->onComplete();
+    }
+    return ret;
+}
+
+void WaveformScheduler::armTimerLocked(Clock::time_point deadline) {
+    struct itimerspec spec = {};
+    if (deadline != Clock::time_point()) {
+        // steady_clock is CLOCK_MONOTONIC, a deadline already passed fires at once
+        nanoseconds ns = std::max(deadline.time_since_epoch(), nanoseconds(1));
+        spec.it_value.tv_sec = ns.count() / 1000000000LL;
+        spec.it_value.tv_nsec = ns.count() % 1000000000LL;
+    }
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        ALOGE("Failed to arm waveform timer: %s", strerror(errno));
+    }
+}
+
+std::shared_ptr<IVibratorCallback> WaveformScheduler::stepLocked(Clock::time_point now) {
+    while (mNextPulse < mWaveform.pulses.size() &&
+           mStart + milliseconds(mWaveform.pulses[mNextPulse].startMs) <= now) {
+        const WaveformPulse &pulse = mWaveform.pulses[mNextPulse++];
+        ATRACE_NAME("WaveformScheduler::pulse");
+        // the driver times the pulse itself, so only its start needs to be precise
+        int ret = mDevice->vibrator_on(mDevice, pulse.durationMs);
+        ALOGE_IF(ret != 0, "Waveform pulse failed: %s", strerror(-ret));
+    }
+
+    if (mNextPulse < mWaveform.pulses.size()) {
+        armTimerLocked(mStart + milliseconds(mWaveform.pulses[mNextPulse].startMs));
+        return nullptr;
+    }
+    Clock::time_point end = mStart + milliseconds(mWaveform.totalMs);
+    if (end > now) {
+        armTimerLocked(end);
+        return nullptr;
+    }
+    mPlaying = false;
+    return std::move(mCallback);
+}
+
+void WaveformScheduler::run() {
+    pthread_setname_np(pthread_self(), "VibWaveform");
+    struct sched_param param = {.sched_priority = kSchedFifoPriority};
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        ALOGW("Failed to make the waveform thread SCHED_FIFO, timing may jitter");
+    }
+
+    struct pollfd fds[2] = {
+            {.fd = mTimerFd.get(), .events = POLLIN},
+            {.fd = mEventFd.get(), .events = POLLIN},
+    };
+    while (true) {
+        if (TEMP_FAILURE_RETRY(poll(fds, 2, -1)) < 0) {
+            ALOGE("Waveform wait failed: %s", strerror(errno));
+            return;
+        }
+        uint64_t val;
+        // drain, both fds are non blocking
+        read(mTimerFd.get(), &val, sizeof(val));
+        read(mEventFd.get(), &val, sizeof(val));
+
+        std::shared_ptr<IVibratorCallback> callback;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mExit) {
+                return;
+            }
+            if (!mPlaying) {
+                continue;
+            }
+            callback = stepLocked(Clock::now());
+        }
+        if (callback) {
+            ATRACE_NAME("WaveformScheduler::onComplete");
+            callback->onComplete();
+        }
+    }
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/vibrator/BnVibrator.h>
+#include <android-base/unique_fd.h>
+
+#include <hardware/vibrator.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+// One motor pulse of a waveform, relative to the start of playback
+struct WaveformPulse {
+    int32_t startMs;
+    int32_t durationMs;
+};
+
+struct Waveform {
+    std::vector<WaveformPulse> pulses;  // sorted by startMs, not overlapping
+    int32_t totalMs = 0;
+};
+
+// Plays waveforms on top of the legacy vibrator_on/vibrator_off ops from a
+// single SCHED_FIFO thread, which sleeps on an absolute timerfd until the
+// next pulse so a whole effect plays with tight timing from one binder call.
+class WaveformScheduler {
+  public:
+    explicit WaveformScheduler(vibrator_device_t *device);
+    ~WaveformScheduler();
+
+    // Replaces whatever is playing, completing its callback early. The new
+    // callback fires once the waveform ends
+    void play(Waveform waveform, const std::shared_ptr<IVibratorCallback> &callback);
+    // Tracks a vibration the driver times itself, firing the callback
+    // once durationMs has passed
+    void expect(int32_t durationMs, const std::shared_ptr<IVibratorCallback> &callback);
+    // Stops playback, turns the motor off and fires any pending callback.
+    // Returns what vibrator_off returned
+    int stop();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    void armTimerLocked(Clock::time_point deadline);
+    // Returns the callback to fire, if the waveform finished
+    std::shared_ptr<IVibratorCallback> stepLocked(Clock::time_point now);
+
+    vibrator_device_t *const mDevice;
+    ::android::base::unique_fd mTimerFd;
+    ::android::base::unique_fd mEventFd;
+
+    std::mutex mLock;
+    bool mExit = false;
+    bool mPlaying = false;
+    Waveform mWaveform;
+    size_t mNextPulse = 0;
+    Clock::time_point mStart;
+    std::shared_ptr<IVibratorCallback> mCallback;
+
+    std::thread mThread;
+};
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
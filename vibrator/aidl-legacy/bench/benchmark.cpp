@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <vibratorbench/BenchUtils.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../Vibrator.h"
+
+using ::aidl::android::hardware::vibrator::Vibrator;
+using ::vendor::lineage::vibrator::bench::FakeSysfs;
+using ::vendor::lineage::vibrator::bench::measureCalls;
+
+namespace {
+
+// Stands in for the legacy libhardware vibrator module, which opens and
+// writes timed_output/enable on every call.
+struct StubDevice {
+    vibrator_device_t device = {};
+    std::string enablePath;
+    std::atomic<uint64_t> onCalls = 0;
+};
+
+// vibrator_device_t has no user data, there is a single fixture at a time
+StubDevice *sStub;
+
+int writeEnable(unsigned int value) {
+    ::android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(sStub->enablePath.c_str(), O_WRONLY)));
+    if (!fd.ok()) {
+        return -errno;
+    }
+    std::string s = std::to_string(value);
+    return ::android::base::WriteStringToFd(s, fd) ? 0 : -errno;
+}
+
+int stubOn(vibrator_device_t * /*device*/, unsigned int timeoutMs) {
+    int ret = writeEnable(timeoutMs);
+    sStub->onCalls++;
+    return ret;
+}
+
+int stubOff(vibrator_device_t * /*device*/) {
+    return writeEnable(0);
+}
+
+class VibratorFixture {
+  public:
+    VibratorFixture() {
+        mStub.enablePath = mSysfs.create("enable", "0\n");
+        mStub.device.vibrator_on = stubOn;
+        mStub.device.vibrator_off = stubOff;
+        sStub = &mStub;
+        mVibrator = ndk::SharedRefBase::make<Vibrator>(&mStub.device);
+    }
+
+    Vibrator &vibrator() { return *mVibrator; }
+    const StubDevice &stub() const { return mStub; }
+
+  private:
+    FakeSysfs mSysfs;
+    StubDevice mStub;
+    std::shared_ptr<Vibrator> mVibrator;
+};
+
+void BM_On(benchmark::State &state) {
+    VibratorFixture fixture;
+    measureCalls(state, [&] { fixture.vibrator().on(1000, nullptr); });
+}
+
+void BM_Off(benchmark::State &state) {
+    VibratorFixture fixture;
+    measureCalls(state, [&] { fixture.vibrator().off(); });
+}
+
+// Setting the amplitude is unsupported, this is the cost of refusing it
+void BM_SetAmplitude(benchmark::State &state) {
+    VibratorFixture fixture;
+    measureCalls(state, [&] { fixture.vibrator().setAmplitude(0.5f); });
+}
+
+// perform() has no effects to play and composing is how effects get played
+// here, so this covers compose() up to the scheduler thread starting the
+// first pulse. Syscalls are only counted on the calling thread.
+void BM_Perform(benchmark::State &state) {
+    VibratorFixture fixture;
+    const std::vector<CompositeEffect> click = {{.delayMs = 0,
+                                                 .primitive = CompositePrimitive::CLICK,
+                                                 .scale = 1.0f}};
+    measureCalls(state, [&] {
+        uint64_t target = fixture.stub().onCalls + 1;
+        fixture.vibrator().compose(click, nullptr);
+        while (fixture.stub().onCalls < target) {
+            std::this_thread::yield();
+        }
+    });
+}
+
+}  // namespace
+
+BENCHMARK(BM_On)->UseManualTime();
+BENCHMARK(BM_Off)->UseManualTime();
+BENCHMARK(BM_SetAmplitude)->UseManualTime();
+BENCHMARK(BM_Perform)->UseManualTime();
+
+BENCHMARK_MAIN();
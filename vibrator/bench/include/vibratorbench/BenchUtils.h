@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+#include <benchmark/benchmark.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Helpers shared by the vibrator HAL benchmarks.
+
+namespace vendor {
+namespace lineage {
+namespace vibrator {
+namespace bench {
+
+// Counts the syscalls issued by the calling thread through the
+// raw_syscalls:sys_enter tracepoint. That needs tracefs and root, without
+// them ok() is false and no syscall counts are reported.
+class SyscallCounter {
+  public:
+    SyscallCounter() {
+        std::string id;
+        if (!::android::base::ReadFileToString(
+                    "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id", &id) &&
+            !::android::base::ReadFileToString(
+                    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id", &id)) {
+            return;
+        }
+        struct perf_event_attr attr = {};
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = strtoull(id.c_str(), nullptr, 10);
+        mFd.reset(syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (!mFd.ok()) {
+            PLOG(WARNING) << "Cannot count syscalls";
+        }
+    }
+
+    bool ok() const { return mFd.ok(); }
+
+    // Reading the counter is a syscall itself, which is counted by the read
+    // that ends a measurement but not the one starting it.
+    uint64_t read() const {
+        uint64_t count = 0;
+        if (mFd.ok() && ::read(mFd.get(), &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+        return count;
+    }
+
+  private:
+    ::android::base::unique_fd mFd;
+};
+
+// Times every call of a loop driven with UseManualTime() and reports the
+// p50/p99 latency next to the syscalls per call.
+template <typename Call>
+void measureCalls(benchmark::State &state, Call &&call) {
+    using Clock = std::chrono::steady_clock;
+    SyscallCounter syscalls;
+    std::vector<int64_t> latencies;
+    uint64_t syscallCount = 0;
+    for (auto _ : state) {
+        uint64_t before = syscalls.read();
+        Clock::time_point start = Clock::now();
+        call();
+        Clock::time_point end = Clock::now();
+        if (syscalls.ok()) {
+            syscallCount += syscalls.read() - before - 1;
+        }
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        latencies.push_back(ns);
+        state.SetIterationTime(ns / 1e9);
+    }
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    state.counters["p50_us"] = latencies[latencies.size() / 2] / 1e3;
+    state.counters["p99_us"] = latencies[latencies.size() * 99 / 100] / 1e3;
+    if (syscalls.ok()) {
+        state.counters["syscalls_per_call"] =
+                static_cast<double>(syscallCount) / latencies.size();
+    }
+}
+
+// A scratch directory standing in for a sysfs device directory. It is made
+// under $VIBRATOR_BENCH_DIR, else the /dev tmpfs on device or /tmp on the
+// host, so writes don't hit storage.
+class FakeSysfs {
+  public:
+    FakeSysfs() {
+        const char *base = getenv("VIBRATOR_BENCH_DIR");
+#ifdef __ANDROID__
+        std::string dir = base ? base : "/dev";
+#else
+        std::string dir = base ? base : "/tmp";
+#endif
+        dir += "/vibrator-bench.XXXXXX";
+        CHECK(mkdtemp(dir.data()) != nullptr) << "Cannot create " << dir;
+        mDir = dir + "/";
+    }
+
+    ~FakeSysfs() {
+        for (const std::string &node : mNodes) {
+            unlink(node.c_str());
+        }
+        rmdir(mDir.c_str());
+    }
+
+    // Directory path, with a trailing slash
+    const std::string &dir() const { return mDir; }
+
+    std::string create(const std::string &name, const std::string &value) {
+        std::string path = mDir + name;
+        CHECK(::android::base::WriteStringToFile(value, path)) << "Cannot create " << path;
+        mNodes.push_back(path);
+        return path;
+    }
+
+  private:
+    std::string mDir;
+    std::vector<std::string> mNodes;
+};
+
+}  // namespace bench
+}  // namespace vibrator
+}  // namespace lineage
+}  // namespace vendor